@@ -297,13 +297,18 @@ namespace wiz {
         struct In {
             In(
                 const std::vector<StringView>& pieces,
+                const std::vector<std::vector<StringView>>& alternatePieces,
                 FwdUniquePtr<const Expression> dest,
                 FwdUniquePtr<const Statement> body)
             : pieces(pieces),
+            alternatePieces(alternatePieces),
             dest(std::move(dest)),
             body(std::move(body)) {}
 
             std::vector<StringView> pieces;
+            // Any further banks listed after the first. If there are some, each declaration in the body
+            // is placed in whichever of the listed banks suits it best, rather than always in the first.
+            std::vector<std::vector<StringView>> alternatePieces;
             FwdUniquePtr<const Expression> dest;
             FwdUniquePtr<const Statement> body;
         };    
@@ -1,3 +1,6 @@
+#include <iterator>
+#include <algorithm>
+
 #include <wiz/compiler/bank.h>
 #include <wiz/compiler/ir_node.h>
 #include <wiz/utility/report.h>
@@ -44,8 +47,7 @@ namespace wiz {
     origin(origin),
     relativePosition(0),
     capacity(capacity),
-    data(isBankKindStored(kind) ? capacity : 0, padValue),
-    ownership(capacity) {}
+    padValue(padValue) {}
 
     Bank::~Bank() {}
 
@@ -61,6 +63,10 @@ namespace wiz {
         return capacity;
     }
 
+    Optional<std::size_t> Bank::getOrigin() const {
+        return origin;
+    }
+
     Address Bank::getAddress() const {
         return Address(
             relativePosition,
@@ -77,12 +83,12 @@ namespace wiz {
         relativePosition = dest;
     }
 
-    ArrayView<std::uint8_t> Bank::getData() const {
-        return ArrayView<std::uint8_t>(data);
+    std::uint8_t Bank::getPadValue() const {
+        return padValue;
     }
 
-    ArrayView<std::uint8_t> Bank::getUsedData() const {
-        return ArrayView<std::uint8_t>(data.data(), calculateUsedSize());
+    ArrayView<std::uint8_t> Bank::getStoredData() const {
+        return ArrayView<std::uint8_t>(data);
     }
 
     void Bank::rewind() {
@@ -107,14 +113,13 @@ namespace wiz {
         }
     }
 
-    bool Bank::write(Report* report, StringView description, const void* node, SourceLocation location, const std::vector<std::uint8_t>& values) {
-        const auto size = values.size();
+    std::uint8_t* Bank::getWritableData(Report* report, StringView description, const void* node, SourceLocation location, std::size_t size) {
         if (relativePosition + size > capacity) {
             report->error(description.toString() + " needs " + std::to_string(size)
                 + " byte(s), which exceeds the remaining space in bank `" + name.toString()
                 + "` by " + std::to_string(relativePosition + size - capacity) + " byte(s)",
                 location, ReportErrorFlags::Fatal);
-            return false;
+            return nullptr;
         }
 
         const auto match = nodesToOwners.find(node);
@@ -124,31 +129,46 @@ namespace wiz {
                 + "`, with " + description.toString()
                 + " that never reserved any space for itself",
                 location, ReportErrorFlags::Fatal | ReportErrorFlags::InternalError);
-            return false;
+            return nullptr;
         }
 
+        // Neighbouring runs with the same owner are merged, so a valid write lies entirely within a single run.
         const auto ownerID = match->second;
-        for (std::size_t i = 0; i != size; ++i) {
-            if (ownership[relativePosition + i] != ownerID) {
-                report->error("write conflict encountered at " + getAddressDescription(relativePosition + i)
-                    + " while attempting to write byte " + std::to_string(i) + " of " + std::to_string(size)
-                    + " byte(s) for " + description.toString(),
-                    location, ReportErrorFlags::InternalError | ReportErrorFlags::Continued);
-
-                if (const auto previousID = ownership[relativePosition + i]) {
-                    const auto& previous = owners[previousID - 1];
-                    report->error("address was supposed to be reserved here, by " + previous.description.toString(), previous.location, ReportErrorFlags::Fatal);
+        const auto rangeEnd = relativePosition + size;
+        const auto range = findOwnedRange(relativePosition);
+        const auto containsStart = range != ownership.end() && range->first <= relativePosition;
+        if (size != 0 && (!containsStart || range->second.ownerID != ownerID || range->second.end < rangeEnd)) {
+            std::size_t conflictOffset = relativePosition;
+            std::size_t previousID = 0;
+            if (containsStart) {
+                if (range->second.ownerID != ownerID) {
+                    previousID = range->second.ownerID;
                 } else {
-                    report->error("address was never reserved when it was supposed to be", location, ReportErrorFlags::Fatal);
+                    conflictOffset = range->second.end;
+                    const auto next = std::next(range);
+                    if (next != ownership.end() && next->first == conflictOffset) {
+                        previousID = next->second.ownerID;
+                    }
                 }
-                return false;
             }
-        }
 
-        for (const auto& value : values) {
-            data[relativePosition++] = value;
+            const auto i = conflictOffset - relativePosition;
+            report->error("write conflict encountered at " + getAddressDescription(conflictOffset)
+                + " while attempting to write byte " + std::to_string(i) + " of " + std::to_string(size)
+                + " byte(s) for " + description.toString(),
+                location, ReportErrorFlags::InternalError | ReportErrorFlags::Continued);
+
+            if (previousID != 0) {
+                const auto& previous = owners[previousID - 1];
+                report->error("address was supposed to be reserved here, by " + previous.description.toString(), previous.location, ReportErrorFlags::Fatal);
+            } else {
+                report->error("address was never reserved when it was supposed to be", location, ReportErrorFlags::Fatal);
+            }
+            return nullptr;
         }
-        return true;
+
+        // An empty write has no storage of its own, but still needs somewhere to point.
+        return size != 0 ? data.data() + relativePosition : &padValue;
     }
 
     bool Bank::absoluteSeek(Report* report, std::size_t dest, const SourceLocation& location) {
@@ -173,12 +193,40 @@ namespace wiz {
     }
 
     std::size_t Bank::calculateUsedSize() const {
-        for (std::size_t i = ownership.size() - 1; i < ownership.size(); --i) {
-            if (ownership[i] != 0) {
-                return i + 1;
+        return !ownership.empty() ? ownership.rbegin()->second.end : 0;
+    }
+
+    bool Bank::isRangeAvailable(std::size_t offset, std::size_t size) const {
+        if (offset > capacity || size > capacity - offset) {
+            return false;
+        }
+        if (size == 0) {
+            return true;
+        }
+
+        // Runs don't overlap, so only the last one starting before the end of the range can reach into it.
+        const auto next = ownership.lower_bound(offset + size);
+        return next == ownership.begin() || std::prev(next)->second.end <= offset;
+    }
+
+    std::vector<BankOwnedRange> Bank::getOwnedRanges() const {
+        std::vector<BankOwnedRange> result;
+        result.reserve(ownership.size());
+        for (const auto& range : ownership) {
+            result.push_back(BankOwnedRange(range.first, range.second.end, &owners[range.second.ownerID - 1]));
+        }
+        return result;
+    }
+
+    Bank::OwnershipMap::iterator Bank::findOwnedRange(std::size_t offset) {
+        const auto next = ownership.upper_bound(offset);
+        if (next != ownership.begin()) {
+            const auto previous = std::prev(next);
+            if (previous->second.end > offset) {
+                return previous;
             }
         }
-        return 0;
+        return next;
     }
 
     std::string Bank::getAddressDescription(std::size_t offset) {
@@ -189,6 +237,19 @@ namespace wiz {
         }
     }
 
+    void Bank::growStorage(std::size_t end) {
+        if (!isBankKindStored(kind) || end <= data.size()) {
+            return;
+        }
+
+        // Rounded up to a whole page, but never past the end of the bank, so that a bank which is filled a little at a time isn't copied on every reservation.
+        const auto size = std::min(capacity, (end + StoragePageSize - 1) / StoragePageSize * StoragePageSize);
+        if (size > data.capacity()) {
+            data.reserve(std::min(capacity, std::max(size, data.capacity() * 2)));
+        }
+        data.resize(size, padValue);
+    }
+
     bool Bank::reserve(Report* report, StringView description, const void* node, SourceLocation location, std::size_t size) {
         if (relativePosition + size > capacity) {
             report->error(description.toString() + " needs " + std::to_string(size)
@@ -208,10 +269,14 @@ namespace wiz {
             ownerID = match->second;
         }
 
-        for (std::size_t i = 0; i != size; ++i) {
-            if (const auto previousID = ownership[relativePosition + i]) {
-                const auto& previous = owners[previousID - 1];
-                report->error("overlap conflict encountered at " + getAddressDescription(relativePosition + i)
+        if (size != 0) {
+            const auto rangeEnd = relativePosition + size;
+            const auto next = findOwnedRange(relativePosition);
+            if (next != ownership.end() && next->first < rangeEnd) {
+                const auto conflictOffset = std::max(next->first, relativePosition);
+                const auto i = conflictOffset - relativePosition;
+                const auto& previous = owners[next->second.ownerID - 1];
+                report->error("overlap conflict encountered at " + getAddressDescription(conflictOffset)
                     + " while reserving byte " + std::to_string(i) + " of " + std::to_string(size)
                     + " byte(s) needed for " + description.toString(),
                     location, ReportErrorFlags::Continued);
@@ -219,7 +284,23 @@ namespace wiz {
                 return false;
             }
 
-            ownership[relativePosition + i] = ownerID;
+            // Extend the run just before this one if it has the same owner, otherwise start a new run.
+            auto range = next;
+            if (range != ownership.begin() && std::prev(range)->second.end == relativePosition && std::prev(range)->second.ownerID == ownerID) {
+                range = std::prev(range);
+                range->second.end = rangeEnd;
+            } else {
+                range = ownership.emplace_hint(next, relativePosition, OwnedRange(rangeEnd, ownerID));
+            }
+
+            if (next != ownership.end() && next->first == rangeEnd && next->second.ownerID == ownerID) {
+                range->second.end = next->second.end;
+                ownership.erase(next);
+            }
+
+            // Writes only happen within reserved space, so this is the only place storage needs to grow.
+            // Nothing is reserved while fixups are being written, so storage doesn't move under the threads writing them.
+            growStorage(rangeEnd);
         }
 
         relativePosition += size;
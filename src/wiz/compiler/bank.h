@@ -1,14 +1,17 @@
 #ifndef WIZ_COMPILER_BANK_H
 #define WIZ_COMPILER_BANK_H
 
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 
 #include <wiz/compiler/address.h>
+#include <wiz/utility/macros.h>
 #include <wiz/utility/optional.h>
 #include <wiz/utility/array_view.h>
 #include <wiz/utility/string_view.h>
@@ -37,6 +40,21 @@ namespace wiz {
         SourceLocation location;
     };
 
+    // A run of bytes that were all reserved by the same owner, from start up to but not including end.
+    struct BankOwnedRange {
+        BankOwnedRange(
+            std::size_t start,
+            std::size_t end,
+            const BankRegionOwner* owner)
+        : start(start),
+        end(end),
+        owner(owner) {}
+
+        std::size_t start;
+        std::size_t end;
+        const BankRegionOwner* owner;
+    };
+
     enum class BankKind {
         None,
         UninitializedRam,
@@ -49,10 +67,59 @@ namespace wiz {
     bool isBankKindStored(BankKind kind);
     bool isBankKindWritable(BankKind kind);
 
+    // A bounded window onto a bank's storage, which instruction encodings and constant serialization append to directly.
+    // Bytes past the end of the window are dropped but still counted, so that the caller can report the overflow afterward.
+    class BankWriter {
+        public:
+            BankWriter(
+                std::uint8_t* data,
+                std::size_t capacity)
+            : data(data),
+            capacity(capacity),
+            count(0),
+            overflow(0) {}
+
+            WIZ_FORCE_INLINE void push_back(std::uint8_t value) {
+                if (count < capacity) {
+                    data[count] = value;
+                }
+                ++count;
+            }
+
+            void append(ArrayView<std::uint8_t> values) {
+                const auto length = values.size();
+                if (count < capacity && length != 0) {
+                    const auto available = capacity - count;
+                    std::memcpy(data + count, values.getData(), length < available ? length : available);
+                }
+                count += length;
+            }
+
+            WIZ_FORCE_INLINE std::uint8_t& operator [](std::size_t index) {
+                return index < capacity ? data[index] : overflow;
+            }
+
+            WIZ_FORCE_INLINE std::size_t size() const {
+                return count;
+            }
+
+            WIZ_FORCE_INLINE std::size_t getCapacity() const {
+                return capacity;
+            }
+
+        private:
+            std::uint8_t* data;
+            std::size_t capacity;
+            std::size_t count;
+            std::uint8_t overflow;
+    };
+
     class Bank {
         public:
             // Value used to pad unused bank space.
             enum : std::uint8_t { DefaultPadValue = 0xFF };
+            // Storage grows in steps of this many bytes, as space is reserved.
+            static const std::size_t StoragePageSize = 0x1000;
         
             Bank(
                 StringView name,
@@ -66,22 +133,52 @@ namespace wiz {
             StringView getName() const;
             BankKind getKind() const;
             std::size_t getCapacity() const;
+            Optional<std::size_t> getOrigin() const;
             Address getAddress() const;
             std::size_t getRelativePosition() const;
-            ArrayView<std::uint8_t> getData() const;
-            ArrayView<std::uint8_t> getUsedData() const;
+            std::uint8_t getPadValue() const;
+            // Returns the bytes that have storage, from the start of the bank up to somewhere past the last reserved byte.
+            // The rest of the bank is all the pad value, which is left for whoever reads the bank to fill in.
+            ArrayView<std::uint8_t> getStoredData() const;
             void setRelativePosition(std::size_t dest);
 
             void rewind();
             bool reserveRam(Report* report, StringView description, const void* node, SourceLocation location, std::size_t size);
             bool reserveRom(Report* report, StringView description, const void* node, SourceLocation location, std::size_t size);
-            bool write(Report* report, StringView description, const void* node, SourceLocation location, const std::vector<std::uint8_t>& values);
+
+            // Checks that the next size bytes were all reserved by the given node, and returns their storage, or nullptr on error.
+            // The position isn't advanced, so that the address of what's being written can still be read while writing it.
+            std::uint8_t* getWritableData(Report* report, StringView description, const void* node, SourceLocation location, std::size_t size);
             bool absoluteSeek(Report* report, std::size_t dest, const SourceLocation& location);
 
             std::size_t calculateUsedSize() const;
+            // Returns true if the given range fits within the bank and none of it has been reserved yet.
+            bool isRangeAvailable(std::size_t offset, std::size_t size) const;
+            // Returns every reserved run of bytes, in order of offset.
+            std::vector<BankOwnedRange> getOwnedRanges() const;
 
         private:
+            // A run of bytes that were all reserved by the same owner, stored in `ownership` under the offset of its first byte.
+            // Runs never overlap, and neighbouring runs with the same owner are merged.
+            struct OwnedRange {
+                OwnedRange(
+                    std::size_t end,
+                    std::size_t ownerID)
+                : end(end),
+                ownerID(ownerID) {}
+
+                std::size_t end;
+                std::size_t ownerID;
+            };
+
+            using OwnershipMap = std::map<std::size_t, OwnedRange>;
+
+            // Returns the first run that ends after the given offset, which either contains it or starts after it.
+            OwnershipMap::iterator findOwnedRange(std::size_t offset);
+
             std::string getAddressDescription(std::size_t offset);
+            // Makes sure storage exists for everything before the given offset.
+            void growStorage(std::size_t end);
             bool reserve(Report* report, StringView description, const void* node, SourceLocation location, std::size_t size);
 
             StringView name;
@@ -89,8 +186,10 @@ namespace wiz {
             Optional<std::size_t> origin;
             std::size_t relativePosition;
             std::size_t capacity;
+            std::uint8_t padValue;
+            // Only covers the bank up to the page after the last reserved byte, the rest is padding that's filled in on output.
             std::vector<std::uint8_t> data;
-            std::vector<std::size_t> ownership;
+            OwnershipMap ownership;
 
             std::unordered_map<const void*, std::size_t> nodesToOwners;
             std::vector<BankRegionOwner> owners;
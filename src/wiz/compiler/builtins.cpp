@@ -26,6 +26,11 @@ namespace wiz {
             "nmi",
             "fallthrough",
             "align",
+            "trampoline",
+            "locals",
+            "fast",
+            "keep",
+            "nocross",
         };
     }
 
@@ -136,8 +141,16 @@ namespace wiz {
     }
 
     const InstructionOperandPattern* Builtins::addInstructionOperandPattern(FwdUniquePtr<const InstructionOperandPattern> uniquePattern) {
+        // Platforms build many structurally identical patterns, so share them.
+        // This keeps the tables smaller, and lets isSubsetOf() exit early on identical patterns.
+        const auto match = internedInstructionOperandPatterns.find(uniquePattern.get());
+        if (match != internedInstructionOperandPatterns.end()) {
+            return *match;
+        }
+
         auto result = uniquePattern.get();
         instructionOperandPatterns.push_back(std::move(uniquePattern));
+        internedInstructionOperandPatterns.insert(result);
         return result;
     }
 
@@ -248,34 +261,81 @@ namespace wiz {
         return result;
     }
 
-    const Instruction* Builtins::selectInstruction(const InstructionType& instructionType, std::uint32_t modeFlags, const std::vector<InstructionOperandRoot>& operandRoots) const {
+    const Instruction* Builtins::selectInstruction(const InstructionType& instructionType, std::uint32_t modeFlags, ArrayView<InstructionOperandRoot> operandRoots) const {
         const auto primaryInstructionsIter = primaryInstructionsByInstructionTypes.find(instructionType);
+        if (primaryInstructionsIter == primaryInstructionsByInstructionTypes.end()) {
+            return nullptr;
+        }
 
-        if (primaryInstructionsIter != primaryInstructionsByInstructionTypes.end()) {
-            const auto& primaryInstructions = primaryInstructionsIter->second;
+        const auto& primaryInstructions = primaryInstructionsIter->second;
 
-            for (const auto primaryInstruction : primaryInstructions) {
-                if (primaryInstruction->signature.matches(modeFlags, operandRoots)) {
-                    auto bestInstruction = primaryInstruction;
-                    retry: {
-                        const auto specializationsIter = specializationsByInstructions.find(bestInstruction);
-                        if (specializationsIter != specializationsByInstructions.end()) {
-                            const auto& specializations = specializationsIter->second;
-                            for (const auto specialization : specializations) {
-                                if (specialization->signature.matches(modeFlags, operandRoots)) {
-                                    bestInstruction = specialization;
-                                    goto retry;
-                                }
+        auto instructionIndexIter = instructionIndexesByInstructionTypes.find(instructionType);
+        if (instructionIndexIter == instructionIndexesByInstructionTypes.end()) {
+            instructionIndexIter = instructionIndexesByInstructionTypes.emplace(instructionType, InstructionIndex()).first;
+
+            // Compile the matchers of everything this type can select now, so the generation passes only ever read them.
+            for (const auto instruction : findAllInstructionsByType(instructionType)) {
+                instruction->signature.compileMatchPrograms();
+                instructionIndexIter->second.add(instruction);
+            }
+        }
+
+        const auto& instructionIndex = instructionIndexIter->second;
+
+        // Operands that the patterns can't tell apart always select the same instruction, so remember the result by shape.
+        instructionSelectionShape.assign(reinterpret_cast<const char*>(&modeFlags), sizeof(modeFlags));
+        instructionIndex.appendShape(operandRoots, instructionSelectionShape);
+
+        ++instructionSelectionCount;
+
+        auto& cache = instructionSelectionCache[instructionType];
+        const auto cacheIter = cache.find(instructionSelectionShape);
+        if (cacheIter != cache.end()) {
+            ++instructionSelectionCacheHitCount;
+            return cacheIter->second;
+        }
+
+        // The index finds every instruction whose operand patterns match, so that the primary/specialization
+        // walk below is only a membership test rather than a full signature match for every candidate.
+        std::vector<const Instruction*> operandMatches;
+        instructionIndex.findAllMatches(operandRoots, operandMatches);
+
+        const auto matches = [&](const Instruction* instruction) {
+            return instruction->signature.matchesModeFlags(modeFlags)
+            && std::find(operandMatches.begin(), operandMatches.end(), instruction) != operandMatches.end();
+        };
+
+        const Instruction* bestInstruction = nullptr;
+
+        for (const auto primaryInstruction : primaryInstructions) {
+            if (matches(primaryInstruction)) {
+                bestInstruction = primaryInstruction;
+                retry: {
+                    const auto specializationsIter = specializationsByInstructions.find(bestInstruction);
+                    if (specializationsIter != specializationsByInstructions.end()) {
+                        const auto& specializations = specializationsIter->second;
+                        for (const auto specialization : specializations) {
+                            if (matches(specialization)) {
+                                bestInstruction = specialization;
+                                goto retry;
                             }
                         }
                     }
-                    
-                    return bestInstruction;
                 }
+                break;
             }
         }
 
-        return nullptr;
+        cache[instructionSelectionShape] = bestInstruction;
+        return bestInstruction;
+    }
+
+    std::size_t Builtins::getInstructionSelectionCount() const {
+        return instructionSelectionCount;
+    }
+
+    std::size_t Builtins::getInstructionSelectionCacheHitCount() const {
+        return instructionSelectionCacheHitCount;
     }
 
     void Builtins::addRegisterDecomposition(const Definition* reg, std::vector<Definition*> subRegisters) {
@@ -324,9 +384,20 @@ namespace wiz {
             case DeclarationAttribute::Irq:
             case DeclarationAttribute::Nmi:
             case DeclarationAttribute::Fallthrough:
+            case DeclarationAttribute::Trampoline:
                 return statement->kind == StatementKind::Func;
             case DeclarationAttribute::Align:
                 return statement->kind == StatementKind::Var;
+            case DeclarationAttribute::NoCross:
+                return statement->kind == StatementKind::Func || statement->kind == StatementKind::Var;
+            case DeclarationAttribute::Keep:
+                return statement->kind == StatementKind::Func
+                    || statement->kind == StatementKind::Var
+                    || statement->kind == StatementKind::Namespace
+                    || statement->kind == StatementKind::In;
+            case DeclarationAttribute::Locals:
+            case DeclarationAttribute::Fast:
+                return statement->kind == StatementKind::Bank;
             default: return false;
         }
     }
@@ -336,6 +407,11 @@ namespace wiz {
             case DeclarationAttribute::Irq:
             case DeclarationAttribute::Nmi:
             case DeclarationAttribute::Fallthrough:
+            case DeclarationAttribute::Trampoline:
+            case DeclarationAttribute::Locals:
+            case DeclarationAttribute::Fast:
+            case DeclarationAttribute::Keep:
+            case DeclarationAttribute::NoCross:
                 return 0;
             case DeclarationAttribute::Align:
                 return 1;
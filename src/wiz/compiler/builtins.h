@@ -1,12 +1,15 @@
 #ifndef WIZ_COMPILER_BUILTINS_H
 #define WIZ_COMPILER_BUILTINS_H
 
+#include <set>
+#include <string>
 #include <vector>
 #include <memory>
 #include <utility>
 #include <unordered_map>
 
 #include <wiz/compiler/instruction.h>
+#include <wiz/compiler/instruction_index.h>
 #include <wiz/utility/int128.h>
 #include <wiz/utility/array_view.h>
 #include <wiz/utility/fwd_unique_ptr.h>
@@ -71,6 +74,11 @@ namespace wiz {
                 Nmi,
                 Fallthrough,
                 Align,
+                Trampoline,
+                Locals,
+                Fast,
+                Keep,
+                NoCross,
 
                 Count
             };
@@ -115,7 +123,9 @@ namespace wiz {
             const Instruction* addInstruction(FwdUniquePtr<const Instruction> uniqueInstruction);
             std::vector<const Instruction*> findAllInstructionsByType(const InstructionType& instructionType) const;
             std::vector<const Instruction*> findAllSpecializationsByInstruction(const Instruction* instruction) const;
-            const Instruction* selectInstruction(const InstructionType& instructionType, std::uint32_t modeFlags, const std::vector<InstructionOperandRoot>& operandRoots) const;
+            const Instruction* selectInstruction(const InstructionType& instructionType, std::uint32_t modeFlags, ArrayView<InstructionOperandRoot> operandRoots) const;
+            std::size_t getInstructionSelectionCount() const;
+            std::size_t getInstructionSelectionCacheHitCount() const;
 
             void addRegisterDecomposition(const Definition* reg, std::vector<Definition*> subRegisters);
             ArrayView<Definition*> findRegisterDecomposition(const Definition* reg) const;
@@ -162,10 +172,26 @@ namespace wiz {
             Definition* getDef = nullptr;
             FwdUniquePtr<const TypeExpression> unitTuple;
 
+            struct InstructionOperandPatternLess {
+                bool operator()(const InstructionOperandPattern* a, const InstructionOperandPattern* b) const {
+                    return *a < *b;
+                }
+            };
+
             std::vector<FwdUniquePtr<const InstructionOperandPattern>> instructionOperandPatterns;
+            std::set<const InstructionOperandPattern*, InstructionOperandPatternLess> internedInstructionOperandPatterns;
             std::vector<FwdUniquePtr<const InstructionEncoding>> instructionEncodings;
             std::vector<FwdUniquePtr<const Instruction>> instructions;
             std::unordered_map<InstructionType, std::vector<const Instruction*>> primaryInstructionsByInstructionTypes;
+
+            // Built on the first selection of each instruction type, since most programs only use a few of them.
+            mutable std::unordered_map<InstructionType, InstructionIndex> instructionIndexesByInstructionTypes;
+
+            // Previous results of selectInstruction, keyed by instruction type, mode flags and operand shape.
+            mutable std::unordered_map<InstructionType, std::unordered_map<std::string, const Instruction*>> instructionSelectionCache;
+            mutable std::string instructionSelectionShape;
+            mutable std::size_t instructionSelectionCount = 0;
+            mutable std::size_t instructionSelectionCacheHitCount = 0;
             std::unordered_map<const Instruction*, std::vector<const Instruction*>> specializationsByInstructions;
             std::unordered_map<const Definition*, std::vector<Definition*>> registerDecompositions;
 
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cassert>
 #include <algorithm>
 #include <set>
@@ -19,6 +20,7 @@
 #include <wiz/utility/text.h>
 #include <wiz/utility/reader.h>
 #include <wiz/utility/report.h>
+#include <wiz/utility/parallel.h>
 #include <wiz/utility/writer.h>
 #include <wiz/utility/scope_guard.h>
 #include <wiz/utility/import_manager.h>
@@ -31,14 +33,18 @@ namespace wiz {
         Config* config,
         ImportManager* importManager,
         Report* report,
-        std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines)
+        const OptimizationOptions& optimizationOptions,
+        std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines,
+        std::unordered_map<std::string, std::size_t> variableProfile)
     : program(std::move(program)),
     platform(platform),
     stringPool(stringPool),
     config(config),
     importManager(importManager),
     report(report),
-    builtins(stringPool, platform, std::move(defines)) {
+    optimizationOptions(optimizationOptions),
+    builtins(stringPool, platform, std::move(defines)),
+    variableProfile(std::move(variableProfile)) {
         currentInlineSite = &defaultInlineSite;
     }
 
@@ -47,8 +53,13 @@ namespace wiz {
     bool Compiler::compile() {
         return reserveDefinitions(program.get())
         && resolveDefinitionTypes()
+        && removeUnusedDefinitions()
         && reserveStorage(program.get())
+        && placeFastVariables()
         && emitStatementIr(program.get())
+        && emitTrampolineIr()
+        && allocateLocalStorage()
+        && runIrPasses()
         && generateCode();
     }
 
@@ -108,6 +119,26 @@ namespace wiz {
         return modeFlags;
     }
 
+    const std::vector<IrPassStatistics>& Compiler::getIrPassStatistics() const {
+        return irPassStatistics;
+    }
+
+    const LocalStorageStatistics& Compiler::getLocalStorageStatistics() const {
+        return localStorageStatistics;
+    }
+
+    const std::vector<FastVariablePlacement>& Compiler::getFastVariablePlacements() const {
+        return fastVariablePlacements;
+    }
+
+    const std::vector<const Definition*>& Compiler::getRemovedDefinitions() const {
+        return removedDefinitions;
+    }
+
+    const PageCrossingStatistics& Compiler::getPageCrossingStatistics() const {
+        return pageCrossingStatistics;
+    }
+
     SymbolTable* Compiler::getOrCreateStatementScope(StringView name, const Statement* statement, SymbolTable* parentScope) {
         auto& statementScopes = currentInlineSite->statementScopes;
         const auto match = statementScopes.find(statement);
@@ -3534,7 +3565,7 @@ namespace wiz {
         return Optional<std::size_t>();
     }
 
-    bool Compiler::serializeInteger(Int128 value, std::size_t size, std::vector<std::uint8_t>& result) const {
+    bool Compiler::serializeInteger(Int128 value, std::size_t size, BankWriter& result) const {
         // TODO: handle big-endian
         switch (size) {
             case 1: {
@@ -3572,7 +3603,7 @@ namespace wiz {
     }
 
 
-    bool Compiler::serializeConstantInitializer(const Expression* expression, std::vector<std::uint8_t>& result) const {
+    bool Compiler::serializeConstantInitializer(const Expression* expression, BankWriter& result) const {
         // NOTE: this requires a fully-reduced literal value expression.
         // All identifiers, operators, embeds, etc. must be substituted with a reduced literal values.
         // Otherwise, it cannot be serialized.
@@ -3629,12 +3660,9 @@ namespace wiz {
             }
             case ExpressionKind::SideEffect: return false;
             case ExpressionKind::StringLiteral: {
+                // Embedded files end up here too, so copy the bytes in one go rather than one at a time.
                 const auto& stringLiteral = expression->stringLiteral;
-                const auto data = stringLiteral.value.getData();
-                const auto len = stringLiteral.value.getLength();
-                for (std::size_t i = 0; i != len; ++i) {
-                    result.push_back(data[i]);
-                }
+                result.append(ArrayView<std::uint8_t>(reinterpret_cast<const std::uint8_t*>(stringLiteral.value.getData()), stringLiteral.value.getLength()));
                 return true;
             }
             case ExpressionKind::StructLiteral: {
@@ -3690,50 +3718,79 @@ namespace wiz {
     }
 
 
-    std::pair<bool, Optional<std::size_t>> Compiler::handleInStatement(const std::vector<StringView>& bankIdentifierPieces, const Expression* dest, SourceLocation location) {
-        const auto resolveResult = resolveIdentifier(bankIdentifierPieces, location);
+    Bank* Compiler::resolveBankIdentifier(const std::vector<StringView>& pieces, SourceLocation location) {
+        const auto resolveResult = resolveIdentifier(pieces, location);
         if (resolveResult.first == nullptr) {
-            return {false, Optional<std::size_t>()};
+            return nullptr;
+        }
+        if (resolveResult.second < pieces.size() - 1) {
+            raiseUnresolvedIdentifierError(pieces, resolveResult.second, location);
+            return nullptr;
+        }
+
+        const auto definition = resolveResult.first;
+        if (const auto bankDefinition = definition->tryGet<Definition::Bank>()) {
+            return bankDefinition->bank;
+        } else {
+            report->error(getResolvedIdentifierName(definition, pieces) + " is not a valid bank", definition->name);
+            return nullptr;
+        }
+    }
+
+    ArrayView<Bank*> Compiler::resolvePlacementBanks(const std::vector<std::vector<StringView>>& alternatePieces, const Expression* dest, SourceLocation location) {
+        if (dest != nullptr) {
+            report->error("`in` statement that lists more than one bank cannot have an address, since the bank of each declaration is chosen automatically", dest->location);
+            return ArrayView<Bank*>();
         }
-        if (resolveResult.second < bankIdentifierPieces.size() - 1) {
-            raiseUnresolvedIdentifierError(bankIdentifierPieces, resolveResult.second, location);
-            return {false, Optional<std::size_t>()};
+
+        std::vector<Bank*> banks {currentBank};
+        for (const auto& pieces : alternatePieces) {
+            const auto bank = resolveBankIdentifier(pieces, location);
+            if (bank == nullptr) {
+                return ArrayView<Bank*>();
+            }
+            if (bank->getKind() != currentBank->getKind()) {
+                report->error("bank `" + bank->getName().toString() + "` cannot be listed in the same `in` statement as bank `" + currentBank->getName().toString() + "`, because they hold different kinds of data", location);
+                return ArrayView<Bank*>();
+            }
+            if (std::find(banks.begin(), banks.end(), bank) == banks.end()) {
+                banks.push_back(bank);
+            }
         }
 
-        if (const auto definition = resolveResult.first) {
-            if (auto bankDefinition = definition->tryGet<Definition::Bank>()) {
-                currentBank = bankDefinition->bank;
+        return placementBankLists.add(banks);
+    }
 
-                if (dest != nullptr) {
-                    if (const auto reducedAddressExpression = reduceExpression(dest)) {
-                        if (const auto addressLiteral = reducedAddressExpression->tryGet<Expression::IntegerLiteral>()) {
-                            if (addressLiteral->value.isNegative()) {
-                                report->error("address must be a non-negative integer, but got `" + addressLiteral->value.toString() + "` instead", reducedAddressExpression->location);
+    std::pair<bool, Optional<std::size_t>> Compiler::handleInStatement(const std::vector<StringView>& bankIdentifierPieces, const Expression* dest, SourceLocation location) {
+        if (const auto bank = resolveBankIdentifier(bankIdentifierPieces, location)) {
+            currentBank = bank;
+
+            if (dest != nullptr) {
+                if (const auto reducedAddressExpression = reduceExpression(dest)) {
+                    if (const auto addressLiteral = reducedAddressExpression->tryGet<Expression::IntegerLiteral>()) {
+                        if (addressLiteral->value.isNegative()) {
+                            report->error("address must be a non-negative integer, but got `" + addressLiteral->value.toString() + "` instead", reducedAddressExpression->location);
+                        } else {
+                            const auto oldPosition = currentBank->getAddress().absolutePosition;
+                            const auto maxPointerSizedType = platform->getFarPointerSizedType();
+                            const auto addressMax = Int128((1U << (8U * maxPointerSizedType->builtinIntegerType.size)) - 1);
+
+                            if (addressLiteral->value > addressMax) {
+                                report->error("address of `0x" + addressLiteral->value.toString(16) + "` is outside the address range `0` .. `0x" + addressMax.toString(16) + "` supported by this platform.", reducedAddressExpression->location);
+                            } else if (!oldPosition.hasValue() && addressLiteral->value + Int128(currentBank->getCapacity() - 1) > addressMax) {
+                                report->error("bank start address of `0x" + addressLiteral->value.toString(16) + "` with size `" + Int128(currentBank->getCapacity()).toString() + "` will cause upper address `0x" + (addressLiteral->value + Int128(currentBank->getCapacity() - 1)).toString(16) + "` to be outside the valid address range `0` .. `0x" + addressMax.toString(16) + "` supported by this platform.", reducedAddressExpression->location);
                             } else {
-                                const auto oldPosition = currentBank->getAddress().absolutePosition;
-                                const auto maxPointerSizedType = platform->getFarPointerSizedType();
-                                const auto addressMax = Int128((1U << (8U * maxPointerSizedType->builtinIntegerType.size)) - 1);
-
-                                if (addressLiteral->value > addressMax) {
-                                    report->error("address of `0x" + addressLiteral->value.toString(16) + "` is outside the address range `0` .. `0x" + addressMax.toString(16) + "` supported by this platform.", reducedAddressExpression->location);
-                                } else if (!oldPosition.hasValue() && addressLiteral->value + Int128(currentBank->getCapacity() - 1) > addressMax) {
-                                    report->error("bank start address of `0x" + addressLiteral->value.toString(16) + "` with size `" + Int128(currentBank->getCapacity()).toString() + "` will cause upper address `0x" + (addressLiteral->value + Int128(currentBank->getCapacity() - 1)).toString(16) + "` to be outside the valid address range `0` .. `0x" + addressMax.toString(16) + "` supported by this platform.", reducedAddressExpression->location);
-                                } else {
-                                    currentBank->absoluteSeek(report, static_cast<std::size_t>(addressLiteral->value), reducedAddressExpression->location);
-                                    return {true, static_cast<std::size_t>(addressLiteral->value)};
-                                }
+                                currentBank->absoluteSeek(report, static_cast<std::size_t>(addressLiteral->value), reducedAddressExpression->location);
+                                return {true, static_cast<std::size_t>(addressLiteral->value)};
                             }
-                        } else {
-                            report->error("address must be a compile-time integer literal", reducedAddressExpression->location);
-                            return {false, Optional<std::size_t>()};
                         }
+                    } else {
+                        report->error("address must be a compile-time integer literal", reducedAddressExpression->location);
+                        return {false, Optional<std::size_t>()};
                     }
-                } else {
-                    return {true, Optional<std::size_t>()};
                 }
             } else {
-                report->error(getResolvedIdentifierName(definition, bankIdentifierPieces) + " is not a valid bank", definition->name);
-                return {false, Optional<std::size_t>()};
+                return {true, Optional<std::size_t>()};
             }
         }
         return {false, Optional<std::size_t>()};
@@ -3884,8 +3941,51 @@ namespace wiz {
                 const auto& names = bankDeclaration.names;
                 const auto& addresses = bankDeclaration.addresses;
                 const auto typeExpression = bankDeclaration.typeExpression.get();
+
+                bool locals = false;
+                bool fast = false;
+                for (const auto& attribute : attributeStack) {
+                    if (attribute->statement == statement) {
+                        const auto bankAttribute = builtins.findDeclarationAttributeByName(attribute->name);
+                        switch (bankAttribute) {
+                            case Builtins::DeclarationAttribute::Locals: locals = true; break;
+                            case Builtins::DeclarationAttribute::Fast: fast = true; break;
+                            case Builtins::DeclarationAttribute::None: break;
+                            default: std::abort(); break;
+                        }
+                    }
+                }
+
+                if (locals && names.size() != 1) {
+                    report->error("`#[locals]` must be placed on a `bank` declaration with exactly one name", statement->location);
+                    locals = false;
+                }
+                if (fast && names.size() != 1) {
+                    report->error("`#[fast]` must be placed on a `bank` declaration with exactly one name", statement->location);
+                    fast = false;
+                }
+
                 for (std::size_t i = 0, size = names.size(); i != size; ++i) {
-                    definitionsToResolve.push_back(currentScope->createDefinition(report, Definition::Bank(addresses[i].get(), typeExpression), names[i], statement));
+                    const auto definition = currentScope->createDefinition(report, Definition::Bank(addresses[i].get(), typeExpression), names[i], statement);
+                    definitionsToResolve.push_back(definition);
+
+                    if (locals && definition != nullptr) {
+                        if (localsBankDefinition != nullptr) {
+                            report->error("bank `" + definition->name.toString() + "` cannot be marked `#[locals]`, because `" + localsBankDefinition->name.toString() + "` already is", statement->location, ReportErrorFlags::Continued);
+                            report->error("`" + localsBankDefinition->name.toString() + "` was declared here", localsBankDefinition->declaration->location);
+                        } else {
+                            localsBankDefinition = definition;
+                        }
+                    }
+
+                    if (fast && definition != nullptr) {
+                        if (fastBankDefinition != nullptr) {
+                            report->error("bank `" + definition->name.toString() + "` cannot be marked `#[fast]`, because `" + fastBankDefinition->name.toString() + "` already is", statement->location, ReportErrorFlags::Continued);
+                            report->error("`" + fastBankDefinition->name.toString() + "` was declared here", fastBankDefinition->declaration->location);
+                        } else {
+                            fastBankDefinition = definition;
+                        }
+                    }
                 }
                 break;
             }
@@ -3970,6 +4070,8 @@ namespace wiz {
                 });
 
                 bool fallthrough = false;
+                bool trampoline = false;
+                bool noCross = false;
                 BranchKind returnKind = funcDeclaration.far ? BranchKind::FarReturn : BranchKind::Return;
                 for (const auto& attribute : attributeStack) {
                     if (attribute->statement == statement) {
@@ -3978,6 +4080,9 @@ namespace wiz {
                             case Builtins::DeclarationAttribute::Irq: returnKind = BranchKind::IrqReturn; break;
                             case Builtins::DeclarationAttribute::Nmi: returnKind = BranchKind::NmiReturn; break;
                             case Builtins::DeclarationAttribute::Fallthrough: fallthrough = true; break;
+                            case Builtins::DeclarationAttribute::Trampoline: trampoline = true; break;
+                            case Builtins::DeclarationAttribute::NoCross: noCross = true; break;
+                            case Builtins::DeclarationAttribute::Keep: break;
                             case Builtins::DeclarationAttribute::None: break;
                             default: std::abort(); break;
                         }
@@ -4000,6 +4105,28 @@ namespace wiz {
                     break;
                 }
 
+                if (trampoline) {
+                    const auto& parameters = funcDeclaration.parameters;
+                    if (!funcDeclaration.inlined) {
+                        report->error("`#[trampoline]` func `" + funcDeclaration.name.toString() + "` must be an `inline func`, since a copy of it is generated for every func that is called from another bank", statement->location);
+                    } else if (parameters.size() != 2 || parameters[0]->kind != FuncParameterKind::Let || parameters[1]->kind != FuncParameterKind::Let) {
+                        report->error("`#[trampoline]` func `" + funcDeclaration.name.toString() + "` must have exactly two `let` parameters, for the bank index and the func to call", statement->location);
+                    } else if (trampolineTemplate != nullptr) {
+                        report->error("`#[trampoline]` func `" + funcDeclaration.name.toString() + "` conflicts with `" + trampolineTemplate->name.toString() + "`, since only one can be declared", statement->location, ReportErrorFlags::Continued);
+                        report->error("`" + trampolineTemplate->name.toString() + "` was declared here", trampolineTemplate->declaration->location);
+                    } else {
+                        trampolineTemplate = definition;
+                    }
+                }
+
+                if (noCross) {
+                    if (funcDeclaration.inlined) {
+                        report->error("`#[nocross]` func `" + funcDeclaration.name.toString() + "` cannot be an `inline func`, since it has no code of its own to place", statement->location);
+                    } else {
+                        pageLocalDefinitions.insert(definition);
+                    }
+                }
+
                 auto& funcDefinition = definition->func;
 
                 enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), body, currentScope));
@@ -4139,6 +4266,7 @@ namespace wiz {
                 const auto typeExpression = varDeclaration.typeExpression.get();
 
                 std::size_t alignment = 0;
+                bool noCross = false;
 
                 for (const auto& attribute : attributeStack) {
                     if (attribute->statement == statement) {
@@ -4155,6 +4283,8 @@ namespace wiz {
                                 }
                                 break;
                             }
+                            case Builtins::DeclarationAttribute::NoCross: noCross = true; break;
+                            case Builtins::DeclarationAttribute::Keep: break;
                             case Builtins::DeclarationAttribute::None: break;
                             default: std::abort(); break;
                         }
@@ -4162,7 +4292,12 @@ namespace wiz {
                 }
 
                 for (std::size_t i = 0, size = names.size(); i != size; ++i) {
-                    definitionsToResolve.push_back(currentScope->createDefinition(report, Definition::Var(varDeclaration.qualifiers, currentFunction, addresses[i].get(), typeExpression, alignment), names[i], statement));
+                    const auto definition = currentScope->createDefinition(report, Definition::Var(varDeclaration.qualifiers, currentFunction, addresses[i].get(), typeExpression, alignment), names[i], statement);
+                    definitionsToResolve.push_back(definition);
+
+                    if (noCross && definition != nullptr) {
+                        pageLocalDefinitions.insert(definition);
+                    }
                 }
                 break;
             }
@@ -4371,2657 +4506,4661 @@ namespace wiz {
         return true;
     }
 
-    bool Compiler::reserveStorage(const Statement* statement) {
+    void Compiler::collectDefinitionReferences(const Statement* statement, Definition* source, bool removable) {
+        // Declarations that come right after something that can run into them have to stay where they are.
+        const auto collectItems = [&](const std::vector<FwdUniquePtr<const Statement>>& items) {
+            for (std::size_t i = 0; i != items.size(); ++i) {
+                collectDefinitionReferences(items[i].get(), source, removable && (i == 0 || !canRunIntoNextStatement(items[i - 1].get())));
+            }
+        };
+
         switch (statement->kind) {
             case StatementKind::Attribution: {
                 const auto& attributedStatement = statement->attribution;
+                for (const auto& attribute : attributedStatement.attributes) {
+                    if (builtins.findDeclarationAttributeByName(attribute->name) == Builtins::DeclarationAttribute::Keep) {
+                        removable = false;
+                    }
+                }
+
                 pushAttributeList(statementAttributeLists[statement]);
                 if (checkConditionalCompilationAttributes()) {
-                    reserveStorage(attributedStatement.body.get());
+                    collectDefinitionReferences(attributedStatement.body.get(), source, removable);
                 }
                 popAttributeList();
                 break;
             }
-            case StatementKind::Bank: break;
             case StatementKind::Block: {
                 const auto& blockStatement = statement->block;
                 enterScope(getOrCreateStatementScope(StringView(), statement, currentScope));
-                for (const auto& item : blockStatement.items) {
-                    reserveStorage(item.get());
-                }
+                collectItems(blockStatement.items);
                 exitScope();
                 break;
             }
-            case StatementKind::Config: break;
+            case StatementKind::Branch: {
+                const auto& branchStatement = statement->branch;
+                if (branchStatement.destination) {
+                    collectDefinitionReferences(branchStatement.destination.get(), source);
+                }
+                if (branchStatement.returnValue) {
+                    collectDefinitionReferences(branchStatement.returnValue.get(), source);
+                }
+                if (branchStatement.condition) {
+                    collectDefinitionReferences(branchStatement.condition.get(), source);
+                }
+                break;
+            }
+            case StatementKind::Config: {
+                for (const auto& item : statement->config.items) {
+                    collectDefinitionReferences(item->value.get(), source);
+                }
+                break;
+            }
             case StatementKind::DoWhile: {
                 const auto& doWhileStatement = statement->doWhile;
-                reserveStorage(doWhileStatement.body.get());
+                collectDefinitionReferences(doWhileStatement.body.get(), source, false);
+                collectDefinitionReferences(doWhileStatement.condition.get(), source);
+                break;
+            }
+            case StatementKind::ExpressionStatement: {
+                collectDefinitionReferences(statement->expressionStatement.expression.get(), source);
                 break;
             }
-            case StatementKind::Enum: break;
-            case StatementKind::ExpressionStatement: break;
             case StatementKind::File: {
                 const auto& file = statement->file;
                 enterScope(findStatementScope(statement));
-                for (const auto& item : file.items) {
-                    reserveStorage(item.get());
-                }
+                collectItems(file.items);
                 exitScope();
                 break;
             }
             case StatementKind::For: {
                 const auto& forStatement = statement->for_;
-                reserveStorage(forStatement.body.get());
+                collectDefinitionReferences(forStatement.counter.get(), source);
+                collectDefinitionReferences(forStatement.sequence.get(), source);
+                collectDefinitionReferences(forStatement.body.get(), source, false);
                 break;
             }
             case StatementKind::Func: {
                 const auto& funcDeclaration = statement->func;
-
-                auto definition = currentScope->findLocalMemberDefinition(funcDeclaration.name);
-                auto& funcDefinition = definition->func;    
-                
-                const auto oldFunction = currentFunction;
-                const auto onExit = makeScopeGuard([&]() {
-                    currentFunction = oldFunction;
-                });
-
-                for (auto& parameter : funcDefinition.parameters) {
-                    auto& parameterVarDefinition = parameter->var;
-
-                    if (parameterVarDefinition.enclosingFunction != nullptr) {
-                        if (parameterVarDefinition.typeExpression->kind != TypeExpressionKind::DesignatedStorage) {
-                            report->error("function parameter `" + parameter->name.toString() + "` must have a designated storage type", statement->location);
-                            break;
-                        }
-                    }
+                const auto definition = currentScope->findLocalMemberDefinition(funcDeclaration.name);
+                if (definition == nullptr) {
+                    collectDefinitionReferences(funcDeclaration.body.get(), source, false);
+                    break;
                 }
 
-                currentFunction = definition;
-                reserveStorage(funcDeclaration.body.get());
+                // Interrupt handlers are entered by the hardware rather than by name, so they're always kept.
+                const auto& funcDefinition = definition->func;
+                if (!funcDefinition.inlined) {
+                    startsCollectedBank();
+                }
+                if (funcDefinition.inlined) {
+                    collectDefinitionReferences(funcDeclaration.body.get(), definition, false);
+                } else if (removable && !funcDefinition.fallthrough && definition != trampolineTemplate
+                && (funcDefinition.returnKind == BranchKind::Return || funcDefinition.returnKind == BranchKind::FarReturn)) {
+                    removableDefinitions.push_back(definition);
+                    collectDefinitionReferences(funcDeclaration.body.get(), definition, false);
+                } else {
+                    collectDefinitionReferences(funcDeclaration.body.get(), nullptr, false);
+                }
                 break;
             }
             case StatementKind::If: {
                 const auto& ifStatement = statement->if_;
-                reserveStorage(ifStatement.body.get());
+                collectDefinitionReferences(ifStatement.condition.get(), source);
+                collectDefinitionReferences(ifStatement.body.get(), source, false);
                 if (ifStatement.alternative) {
-                    reserveStorage(ifStatement.alternative.get());
+                    collectDefinitionReferences(ifStatement.alternative.get(), source, false);
                 }
                 break;
             }
             case StatementKind::In: {
+                // Anything at an explicit address was put there on purpose.
                 const auto& inStatement = statement->in;
-                bankStack.push_back(currentBank);
+                if (inStatement.dest) {
+                    collectDefinitionReferences(inStatement.dest.get(), source);
+                }
 
-                const auto result = handleInStatement(inStatement.pieces, inStatement.dest.get(), statement->location);
-                if (result.first) {
-                    reserveStorage(inStatement.body.get());
+                // Declarations spread automatically over several banks have no particular spot.
+                const auto oldCollectedBank = collectedBank;
+                collectedBank = nullptr;
+                if (inStatement.alternatePieces.size() == 0 && findDefinitionsQuietly(inStatement.pieces)) {
+                    if (const auto bankDefinition = (*resolveIdentifierTempState.results.begin())->tryGet<Definition::Bank>()) {
+                        collectedBank = bankDefinition->bank;
+                        if (inStatement.dest) {
+                            startsCollectedBank();
+                        }
+                    }
                 }
 
-                currentBank = bankStack.back();
-                bankStack.pop_back();
+                collectDefinitionReferences(inStatement.body.get(), source, removable && !inStatement.dest);
+                collectedBank = oldCollectedBank;
+                break;
+            }
+            case StatementKind::InlineFor: {
+                // The body only gets its own scopes once it's expanded, so names in it are looked up from around it instead.
+                const auto& inlineForStatement = statement->inlineFor;
+                collectDefinitionReferences(inlineForStatement.sequence.get(), source);
+                collectDefinitionReferences(inlineForStatement.body.get(), source, false);
+                break;
+            }
+            case StatementKind::Label: {
+                // A label is only kept if the code around it is, so using one keeps the rest of that code too.
+                const auto definition = currentScope->findLocalMemberDefinition(statement->label.name);
+                if (definition != nullptr && source != nullptr) {
+                    definitionReferences[definition].push_back(source);
+                }
+                break;
+            }
+            case StatementKind::Let: {
+                const auto& letDeclaration = statement->let;
+                collectDefinitionReferences(letDeclaration.value.get(), currentScope->findLocalMemberDefinition(letDeclaration.name));
                 break;
             }
-            case StatementKind::InlineFor: break;
-            case StatementKind::ImportReference: break;
-            case StatementKind::InternalDeclaration: break;
-            case StatementKind::Branch: break;
-            case StatementKind::Label: break;
-            case StatementKind::Let: break;
             case StatementKind::Namespace: {
                 const auto& namespaceDeclaration = statement->namespace_;
                 enterScope(findStatementScope(namespaceDeclaration.body.get()));
-                reserveStorage(namespaceDeclaration.body.get());
+                collectDefinitionReferences(namespaceDeclaration.body.get(), source, removable);
                 exitScope();
                 break;
             }
-            case StatementKind::Struct: break;
-            case StatementKind::TypeAlias: break;
             case StatementKind::Var: {
                 const auto& varDeclaration = statement->var;
-                const auto& names = varDeclaration.names;
-                const auto description = statement->getDescription();
-                const auto location = statement->location;
+                for (const auto& name : varDeclaration.names) {
+                    const auto definition = currentScope->findLocalMemberDefinition(name);
+                    if (definition == nullptr) {
+                        continue;
+                    }
 
-                if (varDeclaration.value != nullptr) {
-                    if (names.size() != 1) {
-                        report->error(description.toString() + " with initializer must contain exactly one declaration.", location);
-                        break;
+                    const auto& varDefinition = definition->var;
+                    const auto startsBank = varDefinition.enclosingFunction == nullptr && startsCollectedBank();
+                    auto valueSource = source;
+                    // Anonymous constants are only there to be at a certain spot, since nothing can refer to them.
+                    // So is whatever comes first in a bank with an origin, like a vector table or a header.
+                    if (removable
+                    && !startsBank
+                    && (varDefinition.qualifiers & Qualifiers::Const) != Qualifiers::None
+                    && (name.getLength() == 0 || name[0] != '$')
+                    && varDefinition.addressExpression == nullptr
+                    && varDefinition.enclosingFunction == nullptr) {
+                        removableDefinitions.push_back(definition);
+                        valueSource = definition;
+                    } else if (source != nullptr) {
+                        definitionReferences[definition].push_back(source);
                     }
 
-                    if (!resolveVariableInitializer(currentScope->findLocalMemberDefinition(varDeclaration.names[0]), varDeclaration.value.get(), description, location)) {
-                        break;
+                    if (varDeclaration.typeExpression) {
+                        collectDefinitionReferences(varDeclaration.typeExpression.get(), valueSource);
+                    }
+                    if (varDeclaration.value) {
+                        collectDefinitionReferences(varDeclaration.value.get(), valueSource);
                     }
                 }
-
-                for (std::size_t i = 0, size = names.size(); i != size; ++i) {
-                    if (!reserveVariableStorage(currentScope->findLocalMemberDefinition(names[i]), description, location)) {
-                        break;
+                for (const auto& address : varDeclaration.addresses) {
+                    if (address) {
+                        collectDefinitionReferences(address.get(), source);
                     }
                 }
-
                 break;
             }
             case StatementKind::While: {
                 const auto& whileStatement = statement->while_;
-                reserveStorage(whileStatement.body.get());
+                collectDefinitionReferences(whileStatement.condition.get(), source);
+                collectDefinitionReferences(whileStatement.body.get(), source, false);
                 break;
             }
-            default: std::abort(); return false;
+            default: break;
         }
-
-        return statement == program.get() ? report->validate() : report->alive();
     }
 
-    bool Compiler::resolveVariableInitializer(Definition* definition, const Expression* initializer, StringView description, SourceLocation location) {
-        auto& varDefinition = definition->var;
-
-        if (currentBank == nullptr || !isBankKindStored(currentBank->getKind())) {
-            report->error(description.toString() + " with initializer " + (currentBank == nullptr ? "must be inside an `in` statement" : "is not allowed in bank `" + currentBank->getName().toString() + "`"), location);
-            return false;
-        }
-
-        allowReservedConstants = true;
-
-        if (auto reducedValue = reduceExpression(initializer)) {
-            if (const auto declarationType = varDefinition.reducedTypeExpression.get()) {
-                if (const auto compatibleInitializerType = findCompatibleAssignmentType(reducedValue.get(), declarationType)) {
-                    varDefinition.initializerExpression = createConvertedExpression(reducedValue.get(), compatibleInitializerType);
-                } else {
-                    report->error(description.toString() + " of type `" + getTypeName(varDefinition.reducedTypeExpression.get()) + "` cannot be initialized with `" + getTypeName(reducedValue->info->type.get()) + "` expression", location);
-                    return false;
+    void Compiler::collectDefinitionReferences(const Expression* expression, Definition* source) {
+        switch (expression->kind) {
+            case ExpressionKind::ArrayComprehension: {
+                const auto& arrayComprehension = expression->arrayComprehension;
+                collectDefinitionReferences(arrayComprehension.expression.get(), source);
+                collectDefinitionReferences(arrayComprehension.sequence.get(), source);
+                break;
+            }
+            case ExpressionKind::ArrayPadLiteral: {
+                const auto& arrayPadLiteral = expression->arrayPadLiteral;
+                collectDefinitionReferences(arrayPadLiteral.valueExpression.get(), source);
+                collectDefinitionReferences(arrayPadLiteral.sizeExpression.get(), source);
+                break;
+            }
+            case ExpressionKind::ArrayLiteral: {
+                for (const auto& item : expression->arrayLiteral.items) {
+                    collectDefinitionReferences(item.get(), source);
                 }
-            } else {
-                varDefinition.initializerExpression = std::move(reducedValue);
+                break;
             }
-
-            if (varDefinition.initializerExpression != nullptr) {
-                if (const auto arrayType = varDefinition.initializerExpression->info->type->tryGet<TypeExpression::Array>()) {
-                    if (arrayType->elementType == nullptr) {
-                        report->error("array has unknown element type", location);
-                        return false;
-                    }
+            case ExpressionKind::BinaryOperator: {
+                const auto& binaryOperator = expression->binaryOperator;
+                collectDefinitionReferences(binaryOperator.left.get(), source);
+                collectDefinitionReferences(binaryOperator.right.get(), source);
+                break;
+            }
+            case ExpressionKind::Call: {
+                const auto& call = expression->call;
+                collectDefinitionReferences(call.function.get(), source);
+                for (const auto& argument : call.arguments) {
+                    collectDefinitionReferences(argument.get(), source);
                 }
+                break;
             }
-
-            if (varDefinition.reducedTypeExpression != nullptr && varDefinition.reducedTypeExpression->kind == TypeExpressionKind::DesignatedStorage) {
-                varDefinition.resolvedType = varDefinition.reducedTypeExpression.get();
-            } else {
-                varDefinition.resolvedType = varDefinition.initializerExpression->info->type.get();
+            case ExpressionKind::Cast: {
+                const auto& cast = expression->cast;
+                collectDefinitionReferences(cast.operand.get(), source);
+                collectDefinitionReferences(cast.type.get(), source);
+                break;
             }
-        }
-
-        allowReservedConstants = false;
-        varDefinition.nestedConstants.insert(varDefinition.nestedConstants.end(), reservedConstants.begin(), reservedConstants.end());
-        reservedConstants.clear();
-
-        return true;
-    }
-
-    bool Compiler::reserveVariableStorage(Definition* definition, StringView description, SourceLocation location) {
-        auto& varDefinition = definition->var;
-        const auto name = definition->name;
-
-        if (!varDefinition.resolvedType) {
-            report->error("could not resolve declaration type", location);
-            return false;
-        }
-
-        if (varDefinition.resolvedType->kind == TypeExpressionKind::DesignatedStorage) {
-            if ((varDefinition.qualifiers & (Qualifiers::Extern | Qualifiers::Const | Qualifiers::WriteOnly)) != Qualifiers::None) {
-                report->error(((varDefinition.qualifiers & Qualifiers::Extern) != Qualifiers::None ? "extern " : "") + description.toString() + " of `" + name.toString() + "` cannot have designated storage type", location);
+            case ExpressionKind::FieldAccess: {
+                collectDefinitionReferences(expression->fieldAccess.operand.get(), source);
+                break;
             }
-        } else {
-            const auto storageSize = calculateStorageSize(varDefinition.resolvedType, description);
-            if (!storageSize.hasValue()) {
-                return false;
+            case ExpressionKind::Identifier: {
+                // Every match of an ambiguous name counts.
+                // Names that can't be found from here, like `let` parameters, never refer to anything removable.
+                if (findDefinitionsQuietly(expression->identifier.pieces)) {
+                    const auto& results = resolveIdentifierTempState.results;
+                    auto& references = definitionReferences[source];
+                    references.insert(references.end(), results.begin(), results.end());
+                }
+                break;
             }
+            case ExpressionKind::RangeLiteral: {
+                const auto& rangeLiteral = expression->rangeLiteral;
+                collectDefinitionReferences(rangeLiteral.start.get(), source);
+                collectDefinitionReferences(rangeLiteral.end.get(), source);
+                if (rangeLiteral.step) {
+                    collectDefinitionReferences(rangeLiteral.step.get(), source);
+                }
+                break;
+            }
+            case ExpressionKind::ResolvedIdentifier: {
+                definitionReferences[source].push_back(expression->resolvedIdentifier.definition);
+                break;
+            }
+            case ExpressionKind::SideEffect: {
+                const auto& sideEffect = expression->sideEffect;
+                collectDefinitionReferences(sideEffect.statement.get(), source, false);
+                collectDefinitionReferences(sideEffect.result.get(), source);
+                break;
+            }
+            case ExpressionKind::StructLiteral: {
+                for (const auto& item : expression->structLiteral.items) {
+                    collectDefinitionReferences(item.second->value.get(), source);
+                }
+                break;
+            }
+            case ExpressionKind::TupleLiteral: {
+                for (const auto& item : expression->tupleLiteral.items) {
+                    collectDefinitionReferences(item.get(), source);
+                }
+                break;
+            }
+            case ExpressionKind::TypeOf: {
+                collectDefinitionReferences(expression->typeOf.expression.get(), source);
+                break;
+            }
+            case ExpressionKind::TypeQuery: {
+                collectDefinitionReferences(expression->typeQuery.type.get(), source);
+                break;
+            }
+            case ExpressionKind::UnaryOperator: {
+                collectDefinitionReferences(expression->unaryOperator.operand.get(), source);
+                break;
+            }
+            default: break;
+        }
+    }
 
-            varDefinition.storageSize = storageSize;
-
-            if (varDefinition.addressExpression != nullptr) {
-                if ((varDefinition.qualifiers & Qualifiers::Extern) != Qualifiers::None || varDefinition.enclosingFunction != nullptr || currentBank == nullptr || !isBankKindStored(currentBank->getKind())) {
-                    // Variable definitions with explicit addresses can be placed at any absolute address.
-                    // (They don't have relative addresses because of the explcit address can be outside of the current bank.)
-                    varDefinition.address = Address(Optional<std::size_t>(), resolveExplicitAddressExpression(varDefinition.addressExpression), nullptr);
+    void Compiler::collectDefinitionReferences(const TypeExpression* typeExpression, Definition* source) {
+        switch (typeExpression->kind) {
+            case TypeExpressionKind::Array: {
+                const auto& arrayType = typeExpression->array;
+                collectDefinitionReferences(arrayType.elementType.get(), source);
+                if (arrayType.size) {
+                    collectDefinitionReferences(arrayType.size.get(), source);
                 }
-            } else {
-                if ((varDefinition.qualifiers & Qualifiers::Extern) != Qualifiers::None) {
-                    report->error("extern " + description.toString() + " of `" + name.toString() + "` must have an explicit address", location);
-                } else if (varDefinition.enclosingFunction == nullptr) {
-                    if (currentBank == nullptr) {
-                        report->error(description.toString() + " of `" + name.toString() + "` must be inside an `in` statement, have an explicit address `@`, or have a designated storage type", location);
-                        return false;
-                    }
+                break;
+            }
+            case TypeExpressionKind::DesignatedStorage: {
+                const auto& designatedStorageType = typeExpression->designatedStorage;
+                collectDefinitionReferences(designatedStorageType.elementType.get(), source);
+                collectDefinitionReferences(designatedStorageType.holder.get(), source);
+                break;
+            }
+            case TypeExpressionKind::Function: {
+                const auto& functionType = typeExpression->function;
+                for (const auto& parameter : functionType.parameters) {
+                    collectDefinitionReferences(parameter->parameterType.get(), source);
+                }
+                collectDefinitionReferences(functionType.returnType.get(), source);
+                break;
+            }
+            case TypeExpressionKind::Pointer: {
+                collectDefinitionReferences(typeExpression->pointer.elementType.get(), source);
+                break;
+            }
+            case TypeExpressionKind::Tuple: {
+                for (const auto& elementType : typeExpression->tuple.elementTypes) {
+                    collectDefinitionReferences(elementType.get(), source);
+                }
+                break;
+            }
+            case TypeExpressionKind::TypeOf: {
+                collectDefinitionReferences(typeExpression->typeOf.expression.get(), source);
+                break;
+            }
+            default: break;
+        }
+    }
 
-                    if (!isBankKindStored(currentBank->getKind())) {
-                        // FIXME: natural alignment requirements
-                        const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
-                        if (alignment > 1) {
-                            const auto unalignedAddress = currentBank->getAddress().absolutePosition.get();
-                            currentBank->absoluteSeek(report, (unalignedAddress + alignment - 1) / alignment * alignment, location);
-                        }
+    bool Compiler::findDefinitionsQuietly(const std::vector<StringView>& pieces) {
+        auto& previousResults = resolveIdentifierTempState.previousResults;
+        auto& results = resolveIdentifierTempState.results;
+        previousResults.clear();
+        results.clear();
 
-                        varDefinition.address = currentBank->getAddress();
+        for (std::size_t pieceIndex = 0; pieceIndex != pieces.size(); ++pieceIndex) {
+            const auto piece = pieces[pieceIndex];
 
-                        if (!currentBank->reserveRam(report, description, definition->declaration, location, storageSize.get())) {
-                            return false;
-                        }
+            if (previousResults.empty()) {
+                currentScope->findUnqualifiedDefinitions(piece, results);
+            } else {
+                for (const auto definition : previousResults) {
+                    if (const auto ns = definition->tryGet<Definition::Namespace>()) {
+                        ns->environment->findMemberDefinitions(piece, results);
                     }
-                } else {
-                    report->error("local " + description.toString() + " of `" + name.toString() + "` must have an explicit address, or have a designated storage type", location);
-                    return false;
                 }
             }
-        }
-
-        for (auto& nestedConstant : varDefinition.nestedConstants) {
-            reserveVariableStorage(nestedConstant, "nested constant"_sv, nestedConstant->declaration->location);
-        }
 
-        return true;
-    }
+            if (results.size() == 0) {
+                return false;
+            }
 
-    FwdUniquePtr<InstructionOperand> Compiler::createPlaceholderFromResolvedTypeDefinition(const Definition* resolvedTypeDefinition) const {
-        if (const auto builtinIntegerType = resolvedTypeDefinition->tryGet<Definition::BuiltinIntegerType>()) {
-            const auto placeholder = platform->getPlaceholderValue();
-            const auto mask = Int128((1U << (8U * builtinIntegerType->size)) - 1);
-            return makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(placeholder & mask, true));
-        } else if (resolvedTypeDefinition->kind == DefinitionKind::BuiltinBoolType) {
-            return makeFwdUnique<InstructionOperand>(InstructionOperand::Boolean(false, true));
-        } 
-        return nullptr;
-    }
+            if (pieceIndex == pieces.size() - 1 || (*results.begin())->kind != DefinitionKind::Namespace) {
+                return true;
+            }
 
-    FwdUniquePtr<InstructionOperand> Compiler::createPlaceholderFromTypeExpression(const TypeExpression* typeExpression) const {
-        if (const auto resolvedTypeDefinition = tryGetResolvedIdentifierTypeDefinition(typeExpression)) {
-            return createPlaceholderFromResolvedTypeDefinition(resolvedTypeDefinition);
-        } else if (isPointerLikeType(typeExpression)) {
-            return createPlaceholderFromResolvedTypeDefinition(isFarType(typeExpression) ? platform->getFarPointerSizedType() : platform->getPointerSizedType());
+            previousResults.swap(results);
+            results.clear();
         }
-        return nullptr;
+        return false;
     }
 
-    FwdUniquePtr<InstructionOperand> Compiler::createOperandFromResolvedIdentifier(const Expression* expression, const Definition* definition) const {
-        const auto far = (expression->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
-        const auto pointerSizedType = far ? platform->getFarPointerSizedType() : platform->getPointerSizedType();
-        bool isAddressableOperand = false;
-        bool isFunctionLiteral = false;
-        Optional<std::size_t> absolutePosition;
+    bool Compiler::startsCollectedBank() {
+        return collectedBank != nullptr
+        && collectedBank->getOrigin().hasValue()
+        && startedBanks.insert(collectedBank).second;
+    }
 
-        if (const auto varDefinition = definition->tryGet<Definition::Var>()) {
-            isAddressableOperand = true;
-            if (const auto address = varDefinition->address.tryGet()) {
-                absolutePosition = address->absolutePosition;
+    bool Compiler::canRunIntoNextStatement(const Statement* statement) const {
+        switch (statement->kind) {
+            case StatementKind::Attribution: {
+                const auto& attributedStatement = statement->attribution;
+                for (const auto& attribute : attributedStatement.attributes) {
+                    if (builtins.findDeclarationAttributeByName(attribute->name) == Builtins::DeclarationAttribute::Fallthrough) {
+                        return true;
+                    }
+                }
+                return canRunIntoNextStatement(attributedStatement.body.get());
             }
-        } else if (const auto funcDefinition = definition->tryGet<Definition::Func>()) {
-            if (funcDefinition->inlined) {
-                return nullptr;
+            case StatementKind::Block: {
+                const auto& items = statement->block.items;
+                return items.size() != 0 && canRunIntoNextStatement(items.back().get());
             }
+            case StatementKind::File: {
+                const auto& items = statement->file.items;
+                return items.size() != 0 && canRunIntoNextStatement(items.back().get());
+            }
+            case StatementKind::In: return canRunIntoNextStatement(statement->in.body.get());
+            case StatementKind::Namespace: return canRunIntoNextStatement(statement->namespace_.body.get());
+            case StatementKind::Bank:
+            case StatementKind::Config:
+            case StatementKind::Enum:
+            case StatementKind::Func:
+            case StatementKind::ImportReference:
+            case StatementKind::InternalDeclaration:
+            case StatementKind::Let:
+            case StatementKind::Struct:
+            case StatementKind::TypeAlias:
+            case StatementKind::Var:
+                return false;
+            default: return true;
+        }
+    }
 
-            isAddressableOperand = true;
-            isFunctionLiteral = true;
-
-            if (const auto address = funcDefinition->address.tryGet()) {
-                absolutePosition = address->absolutePosition;
-            }
+    bool Compiler::removeUnusedDefinitions() {
+        if (!optimizationOptions.isPassEnabled(IrPassKind::RemoveUnusedDefinitions)) {
+            return true;
         }
 
-        if (isAddressableOperand) {
-            FwdUniquePtr<InstructionOperand> operand;
-            if (absolutePosition.hasValue()) {
-                const auto mask = Int128((1U << (8U * pointerSizedType->builtinIntegerType.size)) - 1);
-                operand = makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(*absolutePosition) & mask));
-            } else {
-                operand = createPlaceholderFromResolvedTypeDefinition(pointerSizedType);
-            }
+        collectDefinitionReferences(program.get(), nullptr, true);
 
-            const auto expressionType = expression->info->type.get();
+        // Everything reachable from code that is always kept. Removable declarations are only kept if they are reached.
+        std::unordered_set<const Definition*> reachable;
+        std::vector<const Definition*> pending {nullptr};
+        while (!pending.empty()) {
+            const auto source = pending.back();
+            pending.pop_back();
 
-            if (expressionType->kind != TypeExpressionKind::Array
-            && (!isFunctionLiteral || expressionType->kind != TypeExpressionKind::Function)) {
-                if (const auto indirectionSize = calculateStorageSize(expressionType, "operand"_sv)) {
-                    return makeFwdUnique<InstructionOperand>(InstructionOperand::Dereference(far, std::move(operand), *indirectionSize));
+            const auto match = definitionReferences.find(source);
+            if (match != definitionReferences.end()) {
+                for (const auto definition : match->second) {
+                    if (reachable.insert(definition).second) {
+                        pending.push_back(definition);
+                    }
                 }
-                return nullptr;
-            } else {
-                return operand;
             }
         }
 
-        if (definition->kind == DefinitionKind::BuiltinRegister) {
-            return makeFwdUnique<InstructionOperand>(InstructionOperand::Register(definition));
+        for (const auto definition : removableDefinitions) {
+            if (reachable.find(definition) == reachable.end()) {
+                unusedDefinitions.insert(definition);
+                removedDefinitions.push_back(definition);
+            }
         }
 
-        return nullptr;
+        definitionReferences.clear();
+        startedBanks.clear();
+        return report->validate();
     }
 
-    FwdUniquePtr<InstructionOperand> Compiler::createOperandFromLinkTimeExpression(const Expression* expression, bool quiet) const {
-        static_cast<void>(quiet);
-        if (const auto integerLiteral = expression->tryGet<Expression::IntegerLiteral>()) {
-            return makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(integerLiteral->value));
-        } else if (const auto booleanLiteral = expression->tryGet<Expression::BooleanLiteral>()) {
-            return makeFwdUnique<InstructionOperand>(InstructionOperand::Boolean(booleanLiteral->value));
-        } else if (const auto resolvedIdentifier = expression->tryGet<Expression::ResolvedIdentifier>()) {
-            return createOperandFromResolvedIdentifier(expression, resolvedIdentifier->definition);
-        }
+    bool Compiler::reserveStorage(const Statement* statement) {
+        switch (statement->kind) {
+            case StatementKind::Attribution: {
+                const auto& attributedStatement = statement->attribution;
+                pushAttributeList(statementAttributeLists[statement]);
+                if (checkConditionalCompilationAttributes()) {
+                    reserveStorage(attributedStatement.body.get());
+                }
+                popAttributeList();
+                break;
+            }
+            case StatementKind::Bank: break;
+            case StatementKind::Block: {
+                const auto& blockStatement = statement->block;
+                enterScope(getOrCreateStatementScope(StringView(), statement, currentScope));
+                for (const auto& item : blockStatement.items) {
+                    reserveStorage(item.get());
+                }
+                exitScope();
+                break;
+            }
+            case StatementKind::Config: break;
+            case StatementKind::DoWhile: {
+                const auto& doWhileStatement = statement->doWhile;
+                reserveStorage(doWhileStatement.body.get());
+                break;
+            }
+            case StatementKind::Enum: break;
+            case StatementKind::ExpressionStatement: break;
+            case StatementKind::File: {
+                const auto& file = statement->file;
+                enterScope(findStatementScope(statement));
+                for (const auto& item : file.items) {
+                    reserveStorage(item.get());
+                }
+                exitScope();
+                break;
+            }
+            case StatementKind::For: {
+                const auto& forStatement = statement->for_;
+                reserveStorage(forStatement.body.get());
+                break;
+            }
+            case StatementKind::Func: {
+                const auto& funcDeclaration = statement->func;
 
-        return createPlaceholderFromTypeExpression(expression->info->type.get());
-    }
+                auto definition = currentScope->findLocalMemberDefinition(funcDeclaration.name);
+                auto& funcDefinition = definition->func;    
 
-    FwdUniquePtr<InstructionOperand> Compiler::createOperandFromRunTimeExpression(const Expression* expression, bool quiet) const {
-        switch (expression->kind){
-            case ExpressionKind::ArrayComprehension: return nullptr;
-            case ExpressionKind::ArrayPadLiteral: return nullptr;
-            case ExpressionKind::BinaryOperator: {
-                const auto& binaryOperator = expression->binaryOperator;
-                if (binaryOperator.op == BinaryOperatorKind::Indexing
-                || binaryOperator.op == BinaryOperatorKind::UnalignedIndexing) {
-                    const auto indexLiteral = binaryOperator.right->tryGet<Expression::IntegerLiteral>();
+                const auto oldFunction = currentFunction;
+                const auto oldFrameFunction = frameFunction;
+                const auto oldCheckingUnusedDefinition = checkingUnusedDefinition;
+                const auto onExit = makeScopeGuard([&]() {
+                    currentFunction = oldFunction;
+                    frameFunction = oldFrameFunction;
+                    checkingUnusedDefinition = oldCheckingUnusedDefinition;
+                });
 
-                    if (binaryOperator.left->info->context == EvaluationContext::LinkTime && indexLiteral != nullptr) {
-                        if (const auto indirectionSize = calculateStorageSize(expression->info->type.get(), "operand"_sv)) {
-                            const auto far = (binaryOperator.left->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
+                // The declarations in a func that was left out are still checked, but get no storage.
+                if (unusedDefinitions.find(definition) != unusedDefinitions.end()) {
+                    checkingUnusedDefinition = true;
+                }
 
-                            return makeFwdUnique<InstructionOperand>(InstructionOperand::Dereference(
-                                far,
-                                createPlaceholderFromResolvedTypeDefinition(far ? platform->getFarPointerSizedType() : platform->getPointerSizedType()),
-                                *indirectionSize));
+                // Locals of an inline func's declaration are never used, only those of each place it gets inlined into.
+                if (currentInlineSite == &defaultInlineSite) {
+                    frameFunction = funcDefinition.inlined ? nullptr : definition;
+                }
+
+                for (auto& parameter : funcDefinition.parameters) {
+                    auto& parameterVarDefinition = parameter->var;
+
+                    if (parameterVarDefinition.enclosingFunction != nullptr) {
+                        if (parameterVarDefinition.typeExpression->kind != TypeExpressionKind::DesignatedStorage) {
+                            if (localsBankDefinition != nullptr && frameFunction == definition) {
+                                reserveVariableStorage(parameter, "parameter"_sv, statement->location);
+                            } else {
+                                report->error("function parameter `" + parameter->name.toString() + "` must have a designated storage type", statement->location);
+                                break;
+                            }
                         }
-                        return nullptr;
                     }
-                    if (const auto indirectionSize = calculateStorageSize(expression->info->type.get(), "operand"_sv)) {
-                        if (auto operand = createOperandFromExpression(binaryOperator.left.get(), quiet)) {
-                            if (auto subscript = createOperandFromExpression(binaryOperator.right.get(), quiet)) {
-                                const auto far = (binaryOperator.left->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
-
-                                if (operand->kind == InstructionOperandKind::Integer && subscript->kind == InstructionOperandKind::Integer) {
-                                    auto reducedOperand = makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(operand->integer.value
-                                        + Int128(binaryOperator.op == BinaryOperatorKind::UnalignedIndexing ? 1 : *indirectionSize) * subscript->integer.value));
-                                    return makeFwdUnique<InstructionOperand>(InstructionOperand::Dereference(
-                                        far,
-                                        std::move(reducedOperand),
-                                        *indirectionSize));                                    
-                                }
+                }
 
-                                return makeFwdUnique<InstructionOperand>(InstructionOperand::Index(
-                                    far,
-                                    std::move(operand),
-                                    std::move(subscript),
-                                    binaryOperator.op == BinaryOperatorKind::UnalignedIndexing ? 1 : *indirectionSize,
-                                    *indirectionSize));
-                            }
-                        }
+                if (definition == trampolineTemplate) {
+                    if (currentBank == nullptr || placementBanks.size() != 0) {
+                        report->error("`#[trampoline]` func `" + definition->name.toString() + "` must be inside an `in` statement with a single bank, which is where its trampolines are placed", statement->location);
                     }
-                    return nullptr;
-                } else if (binaryOperator.op == BinaryOperatorKind::BitIndexing) {
-                    auto operand = createOperandFromExpression(binaryOperator.left.get(), quiet);
-                    auto subscript = createOperandFromExpression(binaryOperator.right.get(), quiet);
-                    if (operand && subscript) {
-                        return makeFwdUnique<InstructionOperand>(InstructionOperand::BitIndex(std::move(operand), std::move(subscript)));
-                    }
-                } else if (binaryOperator.op != BinaryOperatorKind::Assignment) {
-                    auto left = createOperandFromExpression(binaryOperator.left.get(), quiet);
-                    auto right = createOperandFromExpression(binaryOperator.right.get(), quiet);
-                    if (left && right) {
-                        const auto leftIntegerOperand = left->tryGet<InstructionOperand::Integer>();
-                        const auto rightIntegerOperand = right->tryGet<InstructionOperand::Integer>();
+                    trampolineBank = currentBank;
+                } else if (!funcDefinition.inlined && !checkingUnusedDefinition && currentBank != nullptr && placementBanks.size() == 0) {
+                    funcBanks[definition] = currentBank;
+                }
 
-                        if (leftIntegerOperand != nullptr && rightIntegerOperand != nullptr) {
-                            if (leftIntegerOperand->placeholder) {
-                                return left->clone();
-                            } else if (rightIntegerOperand->placeholder) {
-                                return right->clone();
-                            }
-                        }
+                currentFunction = definition;
+                reserveStorage(funcDeclaration.body.get());
+                break;
+            }
+            case StatementKind::If: {
+                const auto& ifStatement = statement->if_;
+                reserveStorage(ifStatement.body.get());
+                if (ifStatement.alternative) {
+                    reserveStorage(ifStatement.alternative.get());
+                }
+                break;
+            }
+            case StatementKind::In: {
+                const auto& inStatement = statement->in;
+                bankStack.push_back(currentBank);
+
+                const auto oldPlacementBanks = placementBanks;
+
+                // An address only makes sense with a single bank, which is reported when the other banks are resolved.
+                const auto dest = inStatement.alternatePieces.size() == 0 ? inStatement.dest.get() : nullptr;
+                const auto result = handleInStatement(inStatement.pieces, dest, statement->location);
+                if (result.first) {
+                    placementBanks = ArrayView<Bank*>();
+                    if (inStatement.alternatePieces.size() != 0) {
+                        placementBanks = resolvePlacementBanks(inStatement.alternatePieces, inStatement.dest.get(), statement->location);
+                    }
 
-                        return makeFwdUnique<InstructionOperand>(InstructionOperand::Binary(binaryOperator.op, std::move(left), std::move(right)));
+                    if (inStatement.alternatePieces.size() == 0 || placementBanks.size() != 0) {
+                        reserveStorage(inStatement.body.get());
                     }
                 }
 
-                return nullptr;
+                currentBank = bankStack.back();
+                bankStack.pop_back();
+                placementBanks = oldPlacementBanks;
+                break;
             }
-            case ExpressionKind::BooleanLiteral: {
-                const auto& booleanLiteral = expression->booleanLiteral;
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Boolean(booleanLiteral.value));
+            case StatementKind::InlineFor: break;
+            case StatementKind::ImportReference: break;
+            case StatementKind::InternalDeclaration: break;
+            case StatementKind::Branch: break;
+            case StatementKind::Label: break;
+            case StatementKind::Let: break;
+            case StatementKind::Namespace: {
+                const auto& namespaceDeclaration = statement->namespace_;
+                enterScope(findStatementScope(namespaceDeclaration.body.get()));
+                reserveStorage(namespaceDeclaration.body.get());
+                exitScope();
+                break;
             }
-            case ExpressionKind::Call: return nullptr;
-            case ExpressionKind::Cast: {
-                const auto& cast = expression->cast;
-                const auto sourceType = cast.operand->info->type.get();
-                const auto destType = expression->info->type.get();
-                if (const auto sourceExpressionSize = calculateStorageSize(sourceType, "left-hand side of cast expression"_sv)) {
-                    if (const auto destTypeSize = calculateStorageSize(destType, "right-hand side of cast expression"_sv)) {
-                        bool validRuntimeCast = false;
+            case StatementKind::Struct: break;
+            case StatementKind::TypeAlias: break;
+            case StatementKind::Var: {
+                const auto& varDeclaration = statement->var;
+                const auto& names = varDeclaration.names;
+                const auto description = statement->getDescription();
+                const auto location = statement->location;
 
-                        if (sourceExpressionSize.get() == destTypeSize.get()) {
-                            validRuntimeCast = true;
-                        } else {
-                            if (const auto resolvedIdentifier = cast.operand->tryGet<Expression::ResolvedIdentifier>()) {
-                                if (resolvedIdentifier->definition->kind == DefinitionKind::BuiltinRegister) {
-                                    validRuntimeCast = true;
-                                }
-                            }
-                        }
+                if (varDeclaration.value != nullptr) {
+                    if (names.size() != 1) {
+                        report->error(description.toString() + " with initializer must contain exactly one declaration.", location);
+                        break;
+                    }
 
-                        if (validRuntimeCast) {
-                            return createOperandFromExpression(cast.operand.get(), quiet);
-                        } else {
-                            if (!quiet) {
-                                report->error("run-time cast from `" + getTypeName(sourceType) + "` to `" + getTypeName(destType) + "` is not possible because it would require a temporary", expression->location, ReportErrorFlags::Continued);
-                            }
-                        }
+                    if (!resolveVariableInitializer(currentScope->findLocalMemberDefinition(varDeclaration.names[0]), varDeclaration.value.get(), description, location)) {
+                        break;
                     }
                 }
-                return nullptr;
-            }
-            case ExpressionKind::Embed: return nullptr;
-            case ExpressionKind::FieldAccess: return nullptr;
-            case ExpressionKind::Identifier: return nullptr;
-            case ExpressionKind::IntegerLiteral: {
-                const auto& integerLiteral = expression->integerLiteral;
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(integerLiteral.value));
-            }
-            case ExpressionKind::OffsetOf: return nullptr;
-            case ExpressionKind::RangeLiteral: return nullptr;
-            case ExpressionKind::ResolvedIdentifier: {
-                const auto& resolvedIdentifier = expression->resolvedIdentifier;
-                return createOperandFromResolvedIdentifier(expression, resolvedIdentifier.definition);
-            }
-            case ExpressionKind::SideEffect: return nullptr;
-            case ExpressionKind::StringLiteral: return nullptr;
-            case ExpressionKind::StructLiteral: return nullptr;
-            case ExpressionKind::TupleLiteral: return nullptr;
-            case ExpressionKind::TypeOf: return nullptr;
-            case ExpressionKind::TypeQuery: return nullptr;
-            case ExpressionKind::UnaryOperator: {
-                const auto& unaryOperator = expression->unaryOperator;
-                if (auto operand = createOperandFromExpression(unaryOperator.operand.get(), quiet)) {
-                    switch (unaryOperator.op) {
-                        case UnaryOperatorKind::Indirection: {
-                            const auto far = (unaryOperator.operand->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
 
-                            if (const auto indirectionSize = calculateStorageSize(expression->info->type.get(), "operand"_sv)) {
-                                if (const auto bin = operand->tryGet<InstructionOperand::Binary>()) {
-                                    if (bin->kind == BinaryOperatorKind::Addition) {
-                                        return makeFwdUnique<InstructionOperand>(InstructionOperand::Index(
-                                            far,
-                                            bin->left->clone(),
-                                            bin->right->clone(),
-                                            1,
-                                            *indirectionSize));
-                                    } else if (bin->kind == BinaryOperatorKind::Subtraction) {
-                                        if (const auto rightIntegerOperand = bin->right->tryGet<InstructionOperand::Integer>()) {
-                                            if (rightIntegerOperand->placeholder) {
-                                                return makeFwdUnique<InstructionOperand>(InstructionOperand::Index(
-                                                    far,
-                                                    bin->left->clone(),
-                                                    bin->right->clone(),
-                                                    1,
-                                                    *indirectionSize));
-                                            } else {
-                                                return makeFwdUnique<InstructionOperand>(InstructionOperand::Index(
-                                                    far,
-                                                    bin->left->clone(),
-                                                    makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(-rightIntegerOperand->value)),
-                                                    1,
-                                                    *indirectionSize));
-                                            }
-                                        }
-                                    }
-                                }
-                                return makeFwdUnique<InstructionOperand>(InstructionOperand::Dereference(
-                                    far,
-                                    std::move(operand),
-                                    *indirectionSize));
-                            }
-                            return nullptr;
-                        }
-                        default: {
-                            return makeFwdUnique<InstructionOperand>(InstructionOperand::Unary(unaryOperator.op, std::move(operand)));
-                        }
+                // A const that was left out is still checked, but gets no storage.
+                const auto oldCheckingUnusedDefinition = checkingUnusedDefinition;
+                if (names.size() == 1 && unusedDefinitions.find(currentScope->findLocalMemberDefinition(names[0])) != unusedDefinitions.end()) {
+                    checkingUnusedDefinition = true;
+                }
+
+                for (std::size_t i = 0, size = names.size(); i != size; ++i) {
+                    if (!reserveVariableStorage(currentScope->findLocalMemberDefinition(names[i]), description, location)) {
+                        break;
                     }
                 }
-                return nullptr;
+
+                checkingUnusedDefinition = oldCheckingUnusedDefinition;
+
+                break;
             }
-            default: std::abort(); return nullptr;
+            case StatementKind::While: {
+                const auto& whileStatement = statement->while_;
+                reserveStorage(whileStatement.body.get());
+                break;
+            }
+            default: std::abort(); return false;
         }
+
+        return statement == program.get() ? report->validate() : report->alive();
     }
 
-    FwdUniquePtr<InstructionOperand> Compiler::createOperandFromExpression(const Expression* expression, bool quiet) const {
-        if (expression->info->context == EvaluationContext::RunTime) {
-            return createOperandFromRunTimeExpression(expression, quiet);
-        } else {
-            return createOperandFromLinkTimeExpression(expression, quiet);
+    bool Compiler::resolveVariableInitializer(Definition* definition, const Expression* initializer, StringView description, SourceLocation location) {
+        auto& varDefinition = definition->var;
+
+        if (currentBank == nullptr || !isBankKindStored(currentBank->getKind())) {
+            report->error(description.toString() + " with initializer " + (currentBank == nullptr ? "must be inside an `in` statement" : "is not allowed in bank `" + currentBank->getName().toString() + "`"), location);
+            return false;
         }
-    }
 
-    bool Compiler::isLeafExpression(const Expression* expression) const {
-        if (expression->info->context == EvaluationContext::RunTime) {
-            switch (expression->kind){
-                case ExpressionKind::ArrayComprehension: return true;
-                case ExpressionKind::ArrayPadLiteral: return true;
-                case ExpressionKind::ArrayLiteral: return true;
-                case ExpressionKind::BinaryOperator: {
-                    const auto& binaryOperator = expression->binaryOperator;
-                    const auto op = binaryOperator.op;
-                    if (op == BinaryOperatorKind::BitIndexing                    
-                    || op == BinaryOperatorKind::Indexing
-                    || op == BinaryOperatorKind::UnalignedIndexing) {
-                        return true;
-                    }
+        allowReservedConstants = true;
+
+        if (auto reducedValue = reduceExpression(initializer)) {
+            if (const auto declarationType = varDefinition.reducedTypeExpression.get()) {
+                if (const auto compatibleInitializerType = findCompatibleAssignmentType(reducedValue.get(), declarationType)) {
+                    varDefinition.initializerExpression = createConvertedExpression(reducedValue.get(), compatibleInitializerType);
+                } else {
+                    report->error(description.toString() + " of type `" + getTypeName(varDefinition.reducedTypeExpression.get()) + "` cannot be initialized with `" + getTypeName(reducedValue->info->type.get()) + "` expression", location);
                     return false;
                 }
-                case ExpressionKind::BooleanLiteral: return true;
-                case ExpressionKind::Call: return false;
-                case ExpressionKind::Cast: return true;
-                case ExpressionKind::Embed: return true;
-                case ExpressionKind::FieldAccess: return true;
-                case ExpressionKind::Identifier: return true;
-                case ExpressionKind::IntegerLiteral: return true;
-                case ExpressionKind::OffsetOf: return true;
-                case ExpressionKind::RangeLiteral: return true;
-                case ExpressionKind::ResolvedIdentifier: return true;
-                case ExpressionKind::SideEffect: return false;
-                case ExpressionKind::StringLiteral: return true;
-                case ExpressionKind::StructLiteral: return true;
-                case ExpressionKind::TupleLiteral: return true;
-                case ExpressionKind::TypeOf: return true;
-                case ExpressionKind::TypeQuery: return true;
-                case ExpressionKind::UnaryOperator: {
-                    const auto& unaryOperator = expression->unaryOperator;
-                    if (unaryOperator.op == UnaryOperatorKind::Indirection) {
-                        return true;
+            } else {
+                varDefinition.initializerExpression = std::move(reducedValue);
+            }
+
+            if (varDefinition.initializerExpression != nullptr) {
+                if (const auto arrayType = varDefinition.initializerExpression->info->type->tryGet<TypeExpression::Array>()) {
+                    if (arrayType->elementType == nullptr) {
+                        report->error("array has unknown element type", location);
+                        return false;
                     }
-                    return false;
                 }
-                default: std::abort(); return false;
             }
-        } else {
-            return true;
+
+            if (varDefinition.reducedTypeExpression != nullptr && varDefinition.reducedTypeExpression->kind == TypeExpressionKind::DesignatedStorage) {
+                varDefinition.resolvedType = varDefinition.reducedTypeExpression.get();
+            } else {
+                varDefinition.resolvedType = varDefinition.initializerExpression->info->type.get();
+            }
         }
-    }
 
-    bool Compiler::hasNestedAssignment(const Expression* expression) const {
-        if (expression->info->context == EvaluationContext::RunTime) {
-            switch (expression->kind){
-                case ExpressionKind::ArrayComprehension: return false;
-                case ExpressionKind::ArrayPadLiteral: return false;
-                case ExpressionKind::ArrayLiteral: return false;
-                case ExpressionKind::BinaryOperator: {
-                    const auto& binaryOperator = expression->binaryOperator;
-                    return binaryOperator.op == BinaryOperatorKind::Assignment
-                        || hasNestedAssignment(binaryOperator.left.get())
-                        || hasNestedAssignment(binaryOperator.right.get());
-                }
-                case ExpressionKind::BooleanLiteral: return false;
-                case ExpressionKind::Call: {
-                    const auto& call = expression->call;
-                    return !call.inlined && hasNestedAssignment(call.function.get());
-                }
-                case ExpressionKind::Cast: {
-                    const auto& cast = expression->cast;
-                    return hasNestedAssignment(cast.operand.get());
-                }
-                case ExpressionKind::Embed: return false;
-                case ExpressionKind::FieldAccess: return false;
-                case ExpressionKind::Identifier: return false;
-                case ExpressionKind::IntegerLiteral: return false;
-                case ExpressionKind::OffsetOf: return false;
-                case ExpressionKind::RangeLiteral: return false;
-                case ExpressionKind::ResolvedIdentifier: return false;
-                case ExpressionKind::SideEffect: return false;
-                case ExpressionKind::StringLiteral: return false;
-                case ExpressionKind::StructLiteral: return false;
-                case ExpressionKind::TupleLiteral: return false;
-                case ExpressionKind::TypeOf: return false;
-                case ExpressionKind::TypeQuery: return false;
-                case ExpressionKind::UnaryOperator: {
-                    const auto& unaryOperator = expression->unaryOperator;
-                    return isUnaryIncrementOperator(unaryOperator.op)
-                        || hasNestedAssignment(unaryOperator.operand.get());
-                }
-                default: std::abort(); return false;
-            }
-        } else {
+        allowReservedConstants = false;
+        varDefinition.nestedConstants.insert(varDefinition.nestedConstants.end(), reservedConstants.begin(), reservedConstants.end());
+        reservedConstants.clear();
+
+        return true;
+    }
+
+    bool Compiler::reserveVariableStorage(Definition* definition, StringView description, SourceLocation location) {
+        auto& varDefinition = definition->var;
+        const auto name = definition->name;
+
+        if (!varDefinition.resolvedType) {
+            report->error("could not resolve declaration type", location);
             return false;
         }
-    }
 
-    bool Compiler::emitNestedAssignmentIr(const Expression* expression, bool pre, bool post) {
-        if (expression->info->context == EvaluationContext::RunTime) {
-            switch (expression->kind){
-                case ExpressionKind::ArrayComprehension: return true;
-                case ExpressionKind::ArrayPadLiteral: return true;
-                case ExpressionKind::ArrayLiteral: return true;
-                case ExpressionKind::BinaryOperator: {
-                    const auto& binaryOperator = expression->binaryOperator;
-                    const auto left = binaryOperator.left.get();
-                    const auto right = binaryOperator.right.get();
+        if (varDefinition.resolvedType->kind == TypeExpressionKind::DesignatedStorage) {
+            if ((varDefinition.qualifiers & (Qualifiers::Extern | Qualifiers::Const | Qualifiers::WriteOnly)) != Qualifiers::None) {
+                report->error(((varDefinition.qualifiers & Qualifiers::Extern) != Qualifiers::None ? "extern " : "") + description.toString() + " of `" + name.toString() + "` cannot have designated storage type", location);
+            }
+        } else {
+            const auto storageSize = calculateStorageSize(varDefinition.resolvedType, description);
+            if (!storageSize.hasValue()) {
+                return false;
+            }
 
-                    if (binaryOperator.op == BinaryOperatorKind::Assignment) {
-                        return pre
-                            ? emitAssignmentExpressionIr(left, right, left->location)
-                            : true;
-                    } else {
-                        return emitNestedAssignmentIr(left, pre, post)
-                            && emitNestedAssignmentIr(right, pre, post);
-                    }
+            varDefinition.storageSize = storageSize;
+
+            if (varDefinition.addressExpression != nullptr) {
+                if ((varDefinition.qualifiers & Qualifiers::Extern) != Qualifiers::None || varDefinition.enclosingFunction != nullptr || currentBank == nullptr || !isBankKindStored(currentBank->getKind())) {
+                    // Variable definitions with explicit addresses can be placed at any absolute address.
+                    // (They don't have relative addresses because of the explcit address can be outside of the current bank.)
+                    varDefinition.address = Address(Optional<std::size_t>(), resolveExplicitAddressExpression(varDefinition.addressExpression), nullptr);
                 }
-                case ExpressionKind::BooleanLiteral: return true;
-                case ExpressionKind::Call: {
-                    const auto& call = expression->call;
-                    if (!call.inlined) {
-                        return emitNestedAssignmentIr(call.function.get(), pre, post);
-                    } else {
-                        return true;
+            } else {
+                if ((varDefinition.qualifiers & Qualifiers::Extern) != Qualifiers::None) {
+                    report->error("extern " + description.toString() + " of `" + name.toString() + "` must have an explicit address", location);
+                } else if (varDefinition.enclosingFunction == nullptr) {
+                    if (currentBank == nullptr) {
+                        report->error(description.toString() + " of `" + name.toString() + "` must be inside an `in` statement, have an explicit address `@`, or have a designated storage type", location);
+                        return false;
                     }
-                }
-                case ExpressionKind::Cast: {
-                    const auto& cast = expression->cast;
-                    return emitNestedAssignmentIr(cast.operand.get(), pre, post);
-                }
-                case ExpressionKind::Embed: return true;
-                case ExpressionKind::FieldAccess: return true;
-                case ExpressionKind::Identifier: return true;
-                case ExpressionKind::IntegerLiteral: return true;
-                case ExpressionKind::OffsetOf: return true;
-                case ExpressionKind::RangeLiteral: return true;
-                case ExpressionKind::ResolvedIdentifier: return true;
-                case ExpressionKind::SideEffect: return true;
-                case ExpressionKind::StringLiteral: return true;
-                case ExpressionKind::StructLiteral: return true;
-                case ExpressionKind::TupleLiteral: return true;
-                case ExpressionKind::TypeOf: return true;
-                case ExpressionKind::TypeQuery: return true;
-                case ExpressionKind::UnaryOperator: {
-                    const auto& unaryOperator = expression->unaryOperator;
-                    const auto& op = unaryOperator.op;
-                    const auto operand = unaryOperator.operand.get();
 
-                    if (isUnaryPreIncrementOperator(op)) {
-                        if (pre && !emitUnaryExpressionIr(operand, op, operand, operand->location)) {
-                            raiseEmitUnaryExpressionError(operand, UnaryOperatorKind::PreIncrement, operand, operand->location);
-                            return false;
+                    if (!isBankKindStored(currentBank->getKind()) && !checkingUnusedDefinition) {
+                        if (fastBankDefinition != nullptr && std::find(placementBanks.begin(), placementBanks.end(), fastBankDefinition->bank.bank) != placementBanks.end()) {
+                            // Which of the banks this goes in depends on how often it's used, which isn't known until everything is reserved.
+                            fastCandidates.push_back(FastCandidate(definition, placementBanks, description, location));
+                        } else {
+                            // When the `in` statement lists several banks, use the first one with room left.
+                            const auto bank = findBankWithRoom(placementBanks, definition);
+                            if (!reserveVariableRam(definition, bank != nullptr ? bank : currentBank, description, location)) {
+                                return false;
+                            }
                         }
-                        return true;
-                    } else if (isUnaryPostIncrementOperator(op)) {
-                        if (post && !emitUnaryExpressionIr(operand, getUnaryPreIncrementEquivalent(op), operand, operand->location)) {
-                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
-                            return false;
+                    }
+                } else if (localsBankDefinition != nullptr && (varDefinition.qualifiers & (Qualifiers::Const | Qualifiers::WriteOnly)) == Qualifiers::None) {
+                    // The address is chosen once every call is known, since storage is shared by funcs that can't run at the same time.
+                    if (frameFunction != nullptr) {
+                        if (!checkingUnusedDefinition) {
+                            auto& locals = frameLocals[frameFunction];
+                            if (locals.empty()) {
+                                frameFunctions.push_back(frameFunction);
+                            }
+                            locals.push_back(definition);
                         }
-                        return true;
-                    } else {
-                        return emitNestedAssignmentIr(operand, pre, post);
+                    } else if (currentInlineSite != &defaultInlineSite) {
+                        report->error("local " + description.toString() + " of `" + name.toString() + "` can only be given storage in the `#[locals]` bank when it is inside a func", location);
+                        return false;
                     }
+                } else {
+                    report->error("local " + description.toString() + " of `" + name.toString() + "` must have an explicit address, have a designated storage type, or be in a func while a bank is marked `#[locals]`", location);
+                    return false;
                 }
-                default: std::abort(); return false;
             }
-        } else {
-            return true;
         }
+
+        for (auto& nestedConstant : varDefinition.nestedConstants) {
+            reserveVariableStorage(nestedConstant, "nested constant"_sv, nestedConstant->declaration->location);
+        }
+
+        return true;
     }
 
-    FwdUniquePtr<const Expression> Compiler::stripNestedAssignment(const Expression* expression) const {
-        if (expression->info->context == EvaluationContext::RunTime) {
-            switch (expression->kind){
-                case ExpressionKind::ArrayComprehension: return expression->clone();
-                case ExpressionKind::ArrayPadLiteral: return expression->clone();
-                case ExpressionKind::ArrayLiteral: return expression->clone();
-                case ExpressionKind::BinaryOperator: {
-                    const auto& binaryOperator = expression->binaryOperator;
-                    const auto op = binaryOperator.op;
-                    const auto left = binaryOperator.left.get();
-                    const auto right = binaryOperator.right.get();
+    Bank* Compiler::findBankWithRoom(ArrayView<Bank*> banks, const Definition* definition) const {
+        const auto& varDefinition = definition->var;
 
-                    auto strippedLeft = stripNestedAssignment(left);
+        // FIXME: natural alignment requirements
+        const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
+        const auto pageLocal = pageLocalDefinitions.find(definition) != pageLocalDefinitions.end();
 
-                    if (op == BinaryOperatorKind::Assignment) {
-                        return strippedLeft;
-                    } else {
-                        auto strippedRight = stripNestedAssignment(right);
+        for (const auto bank : banks) {
+            const auto absolutePosition = bank->getAddress().absolutePosition;
+            auto padding = absolutePosition.hasValue() ? (alignment - absolutePosition.get() % alignment) % alignment : 0;
+            if (pageLocal && absolutePosition.hasValue()) {
+                padding += calculatePagePadding(absolutePosition.get() + padding, varDefinition.storageSize.get()).getOrDefault(0);
+            }
+            if (bank->isRangeAvailable(bank->getRelativePosition(), padding + varDefinition.storageSize.get())) {
+                return bank;
+            }
+        }
 
-                        return makeFwdUnique<const Expression>(
-                            Expression::BinaryOperator(op, std::move(strippedLeft), std::move(strippedRight)),
-                            expression->location,
-                            expression->info->clone());
-                    }
-                }
-                case ExpressionKind::BooleanLiteral: return expression->clone();
-                case ExpressionKind::Call: {
-                    const auto& call = expression->call;
+        return nullptr;
+    }
 
-                    if (!call.inlined) {
-                        const auto function = call.function.get();
-                        const auto& arguments = call.arguments;
+    bool Compiler::reserveVariableRam(Definition* definition, Bank* bank, StringView description, SourceLocation location) {
+        auto& varDefinition = definition->var;
 
-                        auto strippedFunction = stripNestedAssignment(function);
-                        std::vector<FwdUniquePtr<const Expression>> clonedArguments;
-                        for (auto& argument : arguments) {
-                            clonedArguments.push_back(argument->clone());
-                        }
+        // FIXME: natural alignment requirements
+        const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
+        if (alignment > 1) {
+            const auto unalignedAddress = bank->getAddress().absolutePosition.get();
+            bank->absoluteSeek(report, (unalignedAddress + alignment - 1) / alignment * alignment, location);
+        }
 
-                        return makeFwdUnique<const Expression>(
-                            Expression::Call(false, std::move(strippedFunction), std::move(clonedArguments)),
-                            expression->location,
-                            expression->info->clone());
-                    } else {
-                        return expression->clone();
-                    }
-                }
-                case ExpressionKind::Cast: {
-                    const auto& cast = expression->cast;
-                    const auto& operand = cast.operand.get();
-                    auto strippedOperand = stripNestedAssignment(operand);
+        if (pageLocalDefinitions.find(definition) != pageLocalDefinitions.end()) {
+            keepTableInPage(bank, varDefinition.storageSize.get(), location);
+        }
 
-                    return makeFwdUnique<const Expression>(
-                        Expression::Cast(std::move(strippedOperand), cast.type->clone()),
-                        expression->location,
-                        expression->info->clone());
-                }
-                case ExpressionKind::Embed: return expression->clone();
-                case ExpressionKind::FieldAccess: return expression->clone();
-                case ExpressionKind::Identifier: return expression->clone();
-                case ExpressionKind::IntegerLiteral: return expression->clone();
-                case ExpressionKind::OffsetOf: return expression->clone();
-                case ExpressionKind::RangeLiteral: return expression->clone();
-                case ExpressionKind::ResolvedIdentifier: return expression->clone();
-                case ExpressionKind::SideEffect: return expression->clone();
-                case ExpressionKind::StringLiteral: return expression->clone();
-                case ExpressionKind::StructLiteral: return expression->clone();
-                case ExpressionKind::TupleLiteral: return expression->clone();
-                case ExpressionKind::TypeOf: return expression->clone();
-                case ExpressionKind::TypeQuery: return expression->clone();
-                case ExpressionKind::UnaryOperator: {
-                    const auto& unaryOperator = expression->unaryOperator;
-                    const auto op = unaryOperator.op;
-                    const auto operand = unaryOperator.operand.get();
+        varDefinition.address = bank->getAddress();
 
-                    auto strippedOperand = stripNestedAssignment(operand);
+        return bank->reserveRam(report, description, definition->declaration, location, varDefinition.storageSize.get());
+    }
 
-                    if (isUnaryIncrementOperator(op)) {
-                        return strippedOperand;
-                    } else {
-                        return makeFwdUnique<const Expression>(
-                            Expression::UnaryOperator(op, std::move(strippedOperand)),
-                            expression->location,
-                            expression->info->clone());
-                    }
-                }
-                default: std::abort(); return nullptr;
-            }
-        } else {
-            return expression->clone();
+    Optional<std::size_t> Compiler::calculatePagePadding(std::size_t absolutePosition, std::size_t size) const {
+        // Something bigger than a page crosses a boundary wherever it goes.
+        if (size > PageSize) {
+            return Optional<std::size_t>();
+        }
+        if (size == 0 || absolutePosition / PageSize == (absolutePosition + size - 1) / PageSize) {
+            return Optional<std::size_t>(0);
         }
+        return Optional<std::size_t>(PageSize - absolutePosition % PageSize);
     }
 
-    bool Compiler::emitLoadExpressionIr(const Expression* dest, const Expression* source, SourceLocation location) {
-        auto destOperand = createOperandFromExpression(dest, true);
-        auto sourceOperand = createOperandFromExpression(source, true);
-
-        if (!destOperand || !sourceOperand) {
-            return false;
+    void Compiler::keepTableInPage(Bank* bank, std::size_t size, SourceLocation location) {
+        if (!bank->getOrigin().hasValue()) {
+            return;
         }
 
-        if (*destOperand == *sourceOperand) {
-            return true;
+        const auto absolutePosition = bank->getAddress().absolutePosition.get();
+        const auto padding = calculatePagePadding(absolutePosition, size);
+        if (!padding.hasValue()) {
+            ++pageCrossingStatistics.crossingCount;
+        } else if (padding.get() != 0) {
+            // Padding is skipped if it would run out of room, which is reported as still crossing.
+            if (bank->isRangeAvailable(bank->getRelativePosition(), padding.get() + size)) {
+                bank->absoluteSeek(report, absolutePosition + padding.get(), location);
+                ++pageCrossingStatistics.tableCount;
+                pageCrossingStatistics.paddingSize += padding.get();
+            } else {
+                ++pageCrossingStatistics.crossingCount;
+            }
         }
+    }
 
-        std::vector<InstructionOperandRoot> operandRoots;
-        operandRoots.reserve(2);
-        operandRoots.push_back(InstructionOperandRoot(dest, std::move(destOperand)));
-        operandRoots.push_back(InstructionOperandRoot(source, std::move(sourceOperand)));
+    void Compiler::countVariableUses(const Statement* statement, std::size_t weight) {
+        // Code inside of a loop is assumed to run several times for every time the code around it runs.
+        const auto loopWeight = weight < 0x1000000 ? weight * 8 : weight;
 
-        if (const auto instruction = builtins.selectInstruction(InstructionType(BinaryOperatorKind::Assignment), modeFlags, operandRoots)) {
-            irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), location);
-            return true;
-        } else {
-            return false;
+        switch (statement->kind) {
+            case StatementKind::Attribution: {
+                const auto& attributedStatement = statement->attribution;
+                pushAttributeList(statementAttributeLists[statement]);
+                if (checkConditionalCompilationAttributes()) {
+                    countVariableUses(attributedStatement.body.get(), weight);
+                }
+                popAttributeList();
+                break;
+            }
+            case StatementKind::Block: {
+                const auto& blockStatement = statement->block;
+                enterScope(getOrCreateStatementScope(StringView(), statement, currentScope));
+                for (const auto& item : blockStatement.items) {
+                    countVariableUses(item.get(), weight);
+                }
+                exitScope();
+                break;
+            }
+            case StatementKind::Branch: {
+                const auto& branchStatement = statement->branch;
+                if (branchStatement.destination) {
+                    countVariableUses(branchStatement.destination.get(), weight);
+                }
+                if (branchStatement.returnValue) {
+                    countVariableUses(branchStatement.returnValue.get(), weight);
+                }
+                if (branchStatement.condition) {
+                    countVariableUses(branchStatement.condition.get(), weight);
+                }
+                break;
+            }
+            case StatementKind::DoWhile: {
+                const auto& doWhileStatement = statement->doWhile;
+                countVariableUses(doWhileStatement.body.get(), loopWeight);
+                countVariableUses(doWhileStatement.condition.get(), loopWeight);
+                break;
+            }
+            case StatementKind::ExpressionStatement: {
+                const auto& expressionStatement = statement->expressionStatement;
+                countVariableUses(expressionStatement.expression.get(), weight);
+                break;
+            }
+            case StatementKind::File: {
+                const auto& file = statement->file;
+                enterScope(findStatementScope(statement));
+                for (const auto& item : file.items) {
+                    countVariableUses(item.get(), weight);
+                }
+                exitScope();
+                break;
+            }
+            case StatementKind::For: {
+                const auto& forStatement = statement->for_;
+                countVariableUses(forStatement.counter.get(), loopWeight);
+                countVariableUses(forStatement.sequence.get(), weight);
+                countVariableUses(forStatement.body.get(), loopWeight);
+                break;
+            }
+            case StatementKind::Func: {
+                const auto& funcDeclaration = statement->func;
+                if (unusedDefinitions.find(currentScope->findLocalMemberDefinition(funcDeclaration.name)) == unusedDefinitions.end()) {
+                    countVariableUses(funcDeclaration.body.get(), weight);
+                }
+                break;
+            }
+            case StatementKind::If: {
+                const auto& ifStatement = statement->if_;
+                countVariableUses(ifStatement.condition.get(), weight);
+                countVariableUses(ifStatement.body.get(), weight);
+                if (ifStatement.alternative) {
+                    countVariableUses(ifStatement.alternative.get(), weight);
+                }
+                break;
+            }
+            case StatementKind::In: {
+                const auto& inStatement = statement->in;
+                countVariableUses(inStatement.body.get(), weight);
+                break;
+            }
+            case StatementKind::Namespace: {
+                const auto& namespaceDeclaration = statement->namespace_;
+                enterScope(findStatementScope(namespaceDeclaration.body.get()));
+                countVariableUses(namespaceDeclaration.body.get(), weight);
+                exitScope();
+                break;
+            }
+            case StatementKind::While: {
+                const auto& whileStatement = statement->while_;
+                countVariableUses(whileStatement.condition.get(), loopWeight);
+                countVariableUses(whileStatement.body.get(), loopWeight);
+                break;
+            }
+            // `inline for` bodies only get scopes once they're expanded, so their uses aren't counted.
+            default: break;
         }
     }
 
-    bool Compiler::emitUnaryExpressionIr(const Expression* dest, UnaryOperatorKind op, const Expression* source, SourceLocation location) {
-        auto destOperand = createOperandFromExpression(dest, true);
-        auto sourceOperand = createOperandFromExpression(source, true);
-
-        if (!destOperand || !sourceOperand) {
-            return false;
+    void Compiler::countVariableUses(const Expression* expression, std::size_t weight) {
+        switch (expression->kind) {
+            case ExpressionKind::ArrayComprehension: {
+                const auto& arrayComprehension = expression->arrayComprehension;
+                countVariableUses(arrayComprehension.sequence.get(), weight);
+                break;
+            }
+            case ExpressionKind::ArrayPadLiteral: {
+                const auto& arrayPadLiteral = expression->arrayPadLiteral;
+                countVariableUses(arrayPadLiteral.valueExpression.get(), weight);
+                break;
+            }
+            case ExpressionKind::ArrayLiteral: {
+                for (const auto& item : expression->arrayLiteral.items) {
+                    countVariableUses(item.get(), weight);
+                }
+                break;
+            }
+            case ExpressionKind::BinaryOperator: {
+                const auto& binaryOperator = expression->binaryOperator;
+                countVariableUses(binaryOperator.left.get(), weight);
+                countVariableUses(binaryOperator.right.get(), weight);
+                break;
+            }
+            case ExpressionKind::Call: {
+                const auto& call = expression->call;
+                countVariableUses(call.function.get(), weight);
+                for (const auto& argument : call.arguments) {
+                    countVariableUses(argument.get(), weight);
+                }
+                break;
+            }
+            case ExpressionKind::Cast: {
+                countVariableUses(expression->cast.operand.get(), weight);
+                break;
+            }
+            case ExpressionKind::FieldAccess: {
+                countVariableUses(expression->fieldAccess.operand.get(), weight);
+                break;
+            }
+            case ExpressionKind::Identifier: {
+                // Identifiers that can't be found yet, like `let` arguments, are skipped rather than reported.
+                if (findDefinitionsQuietly(expression->identifier.pieces)) {
+                    const auto& results = resolveIdentifierTempState.results;
+                    if (results.size() == 1) {
+                        const auto definition = *results.begin();
+                        if (definition->kind == DefinitionKind::Var) {
+                            variableUseCounts[definition] += weight;
+                        }
+                    }
+                }
+                break;
+            }
+            case ExpressionKind::RangeLiteral: {
+                const auto& rangeLiteral = expression->rangeLiteral;
+                countVariableUses(rangeLiteral.start.get(), weight);
+                countVariableUses(rangeLiteral.end.get(), weight);
+                if (rangeLiteral.step) {
+                    countVariableUses(rangeLiteral.step.get(), weight);
+                }
+                break;
+            }
+            case ExpressionKind::ResolvedIdentifier: {
+                const auto definition = expression->resolvedIdentifier.definition;
+                if (definition->kind == DefinitionKind::Var) {
+                    variableUseCounts[definition] += weight;
+                }
+                break;
+            }
+            case ExpressionKind::SideEffect: {
+                countVariableUses(expression->sideEffect.result.get(), weight);
+                break;
+            }
+            case ExpressionKind::StructLiteral: {
+                for (const auto& item : expression->structLiteral.items) {
+                    countVariableUses(item.second->value.get(), weight);
+                }
+                break;
+            }
+            case ExpressionKind::TupleLiteral: {
+                for (const auto& item : expression->tupleLiteral.items) {
+                    countVariableUses(item.get(), weight);
+                }
+                break;
+            }
+            case ExpressionKind::UnaryOperator: {
+                countVariableUses(expression->unaryOperator.operand.get(), weight);
+                break;
+            }
+            default: break;
         }
+    }
 
-        std::vector<InstructionOperandRoot> operandRoots;
-
-        if (*destOperand == *sourceOperand) {
-            // dest = -dest; or ++dest; instruction
-            operandRoots.reserve(1);
-            operandRoots.push_back(InstructionOperandRoot(dest, std::move(destOperand)));
-        } else {
-            // dest = -source; instruction
-            operandRoots.reserve(2);
-            operandRoots.push_back(InstructionOperandRoot(dest, std::move(destOperand)));
-            operandRoots.push_back(InstructionOperandRoot(source, std::move(sourceOperand)));
-        }            
-
-        if (const auto instruction = builtins.selectInstruction(InstructionType(op), modeFlags, operandRoots)) {
-            irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), location);
+    bool Compiler::placeFastVariables() {
+        if (fastCandidates.empty()) {
             return true;
-        } else {
-            return false;
         }
-    }
 
-    bool Compiler::emitBinaryExpressionIr(const Expression* dest, BinaryOperatorKind op, const Expression* left, const Expression* right, SourceLocation location) {
-        auto destOperand = createOperandFromExpression(dest, true);
-        auto leftOperand = createOperandFromExpression(left, true);
-        auto rightOperand = createOperandFromExpression(right, true);
+        const auto fastBank = fastBankDefinition->bank.bank;
 
-        if (!destOperand || !leftOperand || !rightOperand) {
-            return false;
-        }
+        countVariableUses(program.get(), 1);
 
-        std::vector<InstructionOperandRoot> operandRoots;
+        // A profile replaces the counts entirely, since anything it doesn't mention was never touched while it was recorded.
+        std::vector<std::size_t> scores;
+        std::vector<std::size_t> order;
+        scores.reserve(fastCandidates.size());
+        order.reserve(fastCandidates.size());
+        for (const auto& candidate : fastCandidates) {
+            const auto definition = candidate.definition;
+            if (variableProfile.empty()) {
+                scores.push_back(variableUseCounts[definition]);
+            } else {
+                std::string fullName;
+                if (definition->parentScope != nullptr) {
+                    fullName = definition->parentScope->getFullName();
+                    if (!fullName.empty()) {
+                        fullName += '.';
+                    }
+                }
+                fullName += definition->name.toString();
 
-        if (*destOperand == *leftOperand) {
-            // dest += right; instruction
-            operandRoots.reserve(2);
-            operandRoots.push_back(InstructionOperandRoot(dest, std::move(destOperand)));
-            operandRoots.push_back(InstructionOperandRoot(right, std::move(rightOperand)));
-        } else {
-            // dest = left + right; instruction
-            operandRoots.reserve(3);
-            operandRoots.push_back(InstructionOperandRoot(dest, std::move(destOperand)));
-            operandRoots.push_back(InstructionOperandRoot(left, std::move(leftOperand)));
-            operandRoots.push_back(InstructionOperandRoot(right, std::move(rightOperand)));
+                const auto match = variableProfile.find(fullName);
+                scores.push_back(match != variableProfile.end() ? match->second : 0);
+            }
+            order.push_back(order.size());
         }
 
-        if (const auto instruction = builtins.selectInstruction(InstructionType(op), modeFlags, operandRoots)) {
-            irNodes.addNew(
-                IrNode::Code(instruction, std::move(operandRoots)),
-                location);
-            return true;
-        } else {
-            return false;
+        // Hottest first. Ties keep their declaration order, so that the layout only changes when the uses do.
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return scores[a] > scores[b]; });
+
+        std::vector<bool> placed(fastCandidates.size());
+        for (const auto index : order) {
+            const auto& candidate = fastCandidates[index];
+            if (scores[index] != 0 && findBankWithRoom(ArrayView<Bank*>(&fastBank, 1), candidate.definition) != nullptr) {
+                if (!reserveVariableRam(candidate.definition, fastBank, candidate.description, candidate.location)) {
+                    return false;
+                }
+                placed[index] = true;
+            }
         }
-    }
 
-    bool Compiler::emitArgumentPassIr(const TypeExpression* functionTypeExpression, const std::vector<Definition*>& parameters, const std::vector<FwdUniquePtr<const Expression>>& arguments, SourceLocation location) {
-        static_cast<void>(location);
+        // Everything else goes in the first of the other banks with room left, and only falls back to the fast bank once they're full.
+        std::vector<Bank*> banks;
+        for (std::size_t i = 0; i != fastCandidates.size(); ++i) {
+            if (!placed[i]) {
+                const auto& candidate = fastCandidates[i];
 
-        auto& functionType = functionTypeExpression->function;
+                banks.clear();
+                for (const auto bank : candidate.banks) {
+                    if (bank != fastBank) {
+                        banks.push_back(bank);
+                    }
+                }
+                banks.push_back(fastBank);
 
-        if (functionType.parameters.size() != arguments.size()) {
-            return false;
+                const auto bank = findBankWithRoom(ArrayView<Bank*>(banks.data(), banks.size()), candidate.definition);
+                if (!reserveVariableRam(candidate.definition, bank != nullptr ? bank : banks[0], candidate.description, candidate.location)) {
+                    return false;
+                }
+            }
         }
 
-        for (std::size_t i = 0; i != arguments.size(); ++i) {
-            const auto& parameterType = functionType.parameters[i]->parameterType;
-            const auto& argument = arguments[i];
-            if (i < parameters.size() && parameters[i]->tryGet<Definition::Let>() != nullptr) {
-                continue;
-            } else if (auto designatedStorageType = parameterType->tryGet<TypeExpression::DesignatedStorage>()) {
-                emitAssignmentExpressionIr(designatedStorageType->holder.get(), argument.get(), argument->location);
-            } else {
-                report->error(
-                    "could not generate initializer for argument "
-                        + (parameters.size() != 0 ? "`" + parameters[i]->name.toString() + "`" : " #" + std::to_string(i))
-                        + " of type `" + getTypeName(parameterType.get()) + "`",
-                    argument->location);
-                return false;
-            }
+        fastVariablePlacements.reserve(fastCandidates.size());
+        for (const auto index : order) {
+            fastVariablePlacements.push_back(FastVariablePlacement(fastCandidates[index].definition, scores[index]));
         }
 
-        return true;
+        return report->validate();
     }
 
-    bool Compiler::emitCallExpressionIr(std::size_t distanceHint, bool inlined, bool tailCall, const Expression* resultDestination, const Expression* function, const std::vector<FwdUniquePtr<const Expression>>& arguments, SourceLocation location) {
-        if (const auto resolvedIdentifier = function->tryGet<Expression::ResolvedIdentifier>()) {
-            const auto definition = resolvedIdentifier->definition;
+    const InstructionOperand* Compiler::createOperand(InstructionOperand operand) const {
+        return operandPool.addNew(operand);
+    }
 
-            if (const auto funcDefinition = definition->tryGet<Definition::Func>()) {
-                auto& functionType = funcDefinition->resolvedSignatureType->function;
+    const InstructionOperand* Compiler::createPlaceholderFromResolvedTypeDefinition(const Definition* resolvedTypeDefinition) const {
+        if (const auto builtinIntegerType = resolvedTypeDefinition->tryGet<Definition::BuiltinIntegerType>()) {
+            const auto placeholder = platform->getPlaceholderValue();
+            const auto mask = Int128((1U << (8U * builtinIntegerType->size)) - 1);
+            return createOperand(InstructionOperand::Integer(placeholder & mask, true));
+        } else if (resolvedTypeDefinition->kind == DefinitionKind::BuiltinBoolType) {
+            return createOperand(InstructionOperand::Boolean(false, true));
+        } 
+        return nullptr;
+    }
 
-                if (!emitArgumentPassIr(funcDefinition->resolvedSignatureType.get(), funcDefinition->parameters, arguments, location)) {
-                    return false;
-                }
+    const InstructionOperand* Compiler::createPlaceholderFromTypeExpression(const TypeExpression* typeExpression) const {
+        if (const auto resolvedTypeDefinition = tryGetResolvedIdentifierTypeDefinition(typeExpression)) {
+            return createPlaceholderFromResolvedTypeDefinition(resolvedTypeDefinition);
+        } else if (isPointerLikeType(typeExpression)) {
+            return createPlaceholderFromResolvedTypeDefinition(isFarType(typeExpression) ? platform->getFarPointerSizedType() : platform->getPointerSizedType());
+        }
+        return nullptr;
+    }
 
-                if (inlined || funcDefinition->inlined) {
-                    tailCall = false;
-                    static_cast<void>(tailCall);
+    const InstructionOperand* Compiler::createOperandFromResolvedIdentifier(const Expression* expression, const Definition* definition) const {
+        const auto far = (expression->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
+        const auto pointerSizedType = far ? platform->getFarPointerSizedType() : platform->getPointerSizedType();
+        bool isAddressableOperand = false;
+        bool isFunctionLiteral = false;
+        Optional<std::size_t> absolutePosition;
 
-                    auto oldReturnKind = funcDefinition->returnKind;
-                    auto oldInlined = funcDefinition->inlined;
-                    funcDefinition->returnKind = BranchKind::None;
-                    funcDefinition->inlined = true;
+        if (const auto varDefinition = definition->tryGet<Definition::Var>()) {
+            isAddressableOperand = true;
+            if (const auto address = varDefinition->address.tryGet()) {
+                absolutePosition = address->absolutePosition;
+            }
+        } else if (const auto funcDefinition = definition->tryGet<Definition::Func>()) {
+            if (funcDefinition->inlined) {
+                return nullptr;
+            }
 
-                    const auto oldContinueLabel = continueLabel;
-                    const auto oldBreakLabel = breakLabel;
-                    const auto onExit = makeScopeGuard([&]() {
-                        continueLabel = oldContinueLabel;
-                        breakLabel = oldBreakLabel;
-                    });
+            isAddressableOperand = true;
+            isFunctionLiteral = true;
 
-                    continueLabel = nullptr;
-                    breakLabel = nullptr;
+            if (const auto address = funcDefinition->address.tryGet()) {
+                absolutePosition = address->absolutePosition;
+            }
+        }
 
-                    enterInlineSite(registeredInlineSites.addNew());
+        if (isAddressableOperand) {
+            const InstructionOperand* operand = nullptr;
+            if (absolutePosition.hasValue()) {
+                const auto mask = Int128((1U << (8U * pointerSizedType->builtinIntegerType.size)) - 1);
+                operand = createOperand(InstructionOperand::Integer(Int128(*absolutePosition) & mask));
+            } else {
+                operand = createPlaceholderFromResolvedTypeDefinition(pointerSizedType);
+            }
 
-                    const auto funcDeclaration = definition->declaration;
-                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), funcDeclaration->func.body.get(), funcDefinition->enclosingScope));
+            const auto expressionType = expression->info->type.get();
 
-                    for (std::size_t i = 0; i != funcDefinition->parameters.size(); i++) {
-                        auto& parameter = funcDefinition->parameters[i];
-                        auto& argument = arguments[i];
+            if (expressionType->kind != TypeExpressionKind::Array
+            && (!isFunctionLiteral || expressionType->kind != TypeExpressionKind::Function)) {
+                if (const auto indirectionSize = calculateStorageSize(expressionType, "operand"_sv)) {
+                    return createOperand(InstructionOperand::Dereference(far, operand, *indirectionSize));
+                }
+                return nullptr;
+            } else {
+                return operand;
+            }
+        }
 
-                        if (auto letParameter = parameter->tryGet<Definition::Let>()) {
-                            if (argument->info->context == EvaluationContext::RunTime) {
-                                report->error("argument `" + parameter->name.toString() + "` is a `let` expression, so it cannot accept a run-time expression", argument->location);
-                            }
-                            currentInlineSite->inlineArguments.push_back(expressionPool.add(argument->clone()));
-                        } else {
-                            currentInlineSite->inlineArguments.push_back(nullptr);
-                        }
-                    }
+        if (definition->kind == DefinitionKind::BuiltinRegister) {
+            return createOperand(InstructionOperand::Register(definition));
+        }
 
-                    bool valid = reserveDefinitions(funcDeclaration) && resolveDefinitionTypes() && reserveStorage(funcDeclaration);
+        return nullptr;
+    }
 
-                    if (valid) {
-                        // TODO: templating on type or expression???
+    const InstructionOperand* Compiler::createOperandFromLinkTimeExpression(const Expression* expression, bool quiet) const {
+        static_cast<void>(quiet);
+        if (const auto integerLiteral = expression->tryGet<Expression::IntegerLiteral>()) {
+            return createOperand(InstructionOperand::Integer(integerLiteral->value));
+        } else if (const auto booleanLiteral = expression->tryGet<Expression::BooleanLiteral>()) {
+            return createOperand(InstructionOperand::Boolean(booleanLiteral->value));
+        } else if (const auto resolvedIdentifier = expression->tryGet<Expression::ResolvedIdentifier>()) {
+            return createOperandFromResolvedIdentifier(expression, resolvedIdentifier->definition);
+        }
 
-                        valid = emitFunctionIr(definition, function->location);
-                        static_cast<void>(valid);
-                    }
+        return createPlaceholderFromTypeExpression(expression->info->type.get());
+    }
 
-                    exitScope();
-                    exitInlineSite();
-                    funcDefinition->returnKind = oldReturnKind;
-                    funcDefinition->inlined = oldInlined;
+    const InstructionOperand* Compiler::createOperandFromRunTimeExpression(const Expression* expression, bool quiet) const {
+        switch (expression->kind){
+            case ExpressionKind::ArrayComprehension: return nullptr;
+            case ExpressionKind::ArrayPadLiteral: return nullptr;
+            case ExpressionKind::BinaryOperator: {
+                const auto& binaryOperator = expression->binaryOperator;
+                if (binaryOperator.op == BinaryOperatorKind::Indexing
+                || binaryOperator.op == BinaryOperatorKind::UnalignedIndexing) {
+                    const auto indexLiteral = binaryOperator.right->tryGet<Expression::IntegerLiteral>();
 
-                } else {
-                    auto destOperand = createOperandFromExpression(function, true);
+                    if (binaryOperator.left->info->context == EvaluationContext::LinkTime && indexLiteral != nullptr) {
+                        if (const auto indirectionSize = calculateStorageSize(expression->info->type.get(), "operand"_sv)) {
+                            const auto far = (binaryOperator.left->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
 
-                    if (!destOperand) {
-                        return false;
+                            return createOperand(InstructionOperand::Dereference(
+                                far,
+                                createPlaceholderFromResolvedTypeDefinition(far ? platform->getFarPointerSizedType() : platform->getPointerSizedType()),
+                                *indirectionSize));
+                        }
+                        return nullptr;
                     }
+                    if (const auto indirectionSize = calculateStorageSize(expression->info->type.get(), "operand"_sv)) {
+                        if (auto operand = createOperandFromExpression(binaryOperator.left.get(), quiet)) {
+                            if (auto subscript = createOperandFromExpression(binaryOperator.right.get(), quiet)) {
+                                const auto far = (binaryOperator.left->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
 
-                    std::vector<InstructionOperandRoot> operandRoots;
-                    operandRoots.reserve(2);
-                    operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(distanceHint)))));
-                    operandRoots.push_back(InstructionOperandRoot(function, std::move(destOperand)));
-
-                    bool far = functionType.far;
-                    BranchKind kind = BranchKind::None;
+                                if (operand->kind == InstructionOperandKind::Integer && subscript->kind == InstructionOperandKind::Integer) {
+                                    auto reducedOperand = createOperand(InstructionOperand::Integer(operand->integer.value
+                                        + Int128(binaryOperator.op == BinaryOperatorKind::UnalignedIndexing ? 1 : *indirectionSize) * subscript->integer.value));
+                                    return createOperand(InstructionOperand::Dereference(
+                                        far,
+                                        reducedOperand,
+                                        *indirectionSize));                                    
+                                }
 
-                    if (tailCall) {
-                        kind = far ? BranchKind::FarGoto : BranchKind::Goto;
-                    } else {
-                        kind = far ? BranchKind::FarCall : BranchKind::Call;
+                                return createOperand(InstructionOperand::Index(
+                                    far,
+                                    operand,
+                                    subscript,
+                                    binaryOperator.op == BinaryOperatorKind::UnalignedIndexing ? 1 : *indirectionSize,
+                                    *indirectionSize));
+                            }
+                        }
                     }
-
-                    if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
-                        irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), function->location);
-                    } else {
-                        return false;
+                    return nullptr;
+                } else if (binaryOperator.op == BinaryOperatorKind::BitIndexing) {
+                    auto operand = createOperandFromExpression(binaryOperator.left.get(), quiet);
+                    auto subscript = createOperandFromExpression(binaryOperator.right.get(), quiet);
+                    if (operand && subscript) {
+                        return createOperand(InstructionOperand::BitIndex(operand, subscript));
                     }
-                }
-
-                if (resultDestination != nullptr) {
-                    const auto returnType = functionType.returnType.get();
-
-					if (const auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
-						auto destOperand = createOperandFromExpression(resultDestination, true);
-						auto sourceOperand = createOperandFromExpression(designatedStorageType->holder.get(), true);
-
-						if (destOperand == nullptr || sourceOperand == nullptr || *destOperand != *sourceOperand) {
-							report->error("could not generate assignment for `func " + definition->name.toString() + "` result of type `" + getTypeName(returnType) + "`", location);
-							return false;
-						}
-					}
-				}
-
-                return true;
-            } else if (definition->kind == DefinitionKind::BuiltinVoidIntrinsic) {
-                if (resultDestination != nullptr) {
-                    report->error("void intrinsic `" + definition->name.toString() + "` has no return value so its result cannot be stored.", location);
-                    return false;
-                }
-
-                std::vector<InstructionOperandRoot> operandRoots;
-                operandRoots.reserve(arguments.size());
-
-                for (const auto& argument : arguments) {
-                    const Expression* expression = nullptr;
-                    FwdUniquePtr<InstructionOperand> operand;
+                } else if (binaryOperator.op != BinaryOperatorKind::Assignment) {
+                    auto left = createOperandFromExpression(binaryOperator.left.get(), quiet);
+                    auto right = createOperandFromExpression(binaryOperator.right.get(), quiet);
+                    if (left && right) {
+                        const auto leftIntegerOperand = left->tryGet<InstructionOperand::Integer>();
+                        const auto rightIntegerOperand = right->tryGet<InstructionOperand::Integer>();
 
-                    expression = argument.get();
-                    operand = createOperandFromExpression(argument.get(), true);
-                    if (!operand) {
-                        if (const auto binaryOperator = argument->tryGet<Expression::BinaryOperator>()) {
-                            if (binaryOperator->op == BinaryOperatorKind::Assignment) {
-                                if (!emitAssignmentExpressionIr(binaryOperator->left.get(), binaryOperator->right.get(), binaryOperator->left->location)) {
-                                    return false;
-                                }
-                                expression = binaryOperator->left.get();
-                                operand = createOperandFromExpression(expression, true);
-                            }
-                        } else if (const auto unaryOperator = argument->tryGet<Expression::UnaryOperator>()) {
-                            const auto term = unaryOperator->operand.get();
-                            const auto op = unaryOperator->op;
-                            if (op == UnaryOperatorKind::PreIncrement || op == UnaryOperatorKind::PreDecrement) {
-                                if (!emitUnaryExpressionIr(term, op, term, term->location)) {
-                                    raiseEmitUnaryExpressionError(term, op, term, term->location);
-                                    return false;
-                                }
-                                expression = term;
-                                operand = createOperandFromExpression(term, true);
-                            } else {
-                                expression = nullptr;
-                                operand = nullptr;
+                        if (leftIntegerOperand != nullptr && rightIntegerOperand != nullptr) {
+                            if (leftIntegerOperand->placeholder) {
+                                return left;
+                            } else if (rightIntegerOperand->placeholder) {
+                                return right;
                             }
                         }
-                    }
-                        
-                    operandRoots.push_back(InstructionOperandRoot(expression, std::move(operand)));
-                }
 
-                if (const auto instruction = builtins.selectInstruction(
-                    InstructionType(InstructionType::VoidIntrinsic(definition)),
-                    modeFlags,
-                    operandRoots)
-                ) {
-                    irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), function->location);
-                    return true;
-                } else {
-                    raiseEmitIntrinsicError(InstructionType(InstructionType::VoidIntrinsic(definition)), operandRoots, location);
-                    return false;
-                }
-            } else if (definition->kind == DefinitionKind::BuiltinLoadIntrinsic) {
-                if (resultDestination == nullptr) {
-                    report->error("load intrinsic `" + definition->name.toString() + "` must have its result stored somewhere.", location);
-                    return false;
+                        return createOperand(InstructionOperand::Binary(binaryOperator.op, left, right));
+                    }
                 }
 
-                std::vector<InstructionOperandRoot> operandRoots;
-                operandRoots.reserve(arguments.size() + 1);
-
-                operandRoots.push_back(InstructionOperandRoot(resultDestination, createOperandFromExpression(resultDestination, true)));
-
-                for (const auto& argument : arguments) {
-                    const Expression* expression = nullptr;
-                    FwdUniquePtr<InstructionOperand> operand;
-
-                    expression = argument.get();
-                    operand = createOperandFromExpression(argument.get(), true);
+                return nullptr;
+            }
+            case ExpressionKind::BooleanLiteral: {
+                const auto& booleanLiteral = expression->booleanLiteral;
+                return createOperand(InstructionOperand::Boolean(booleanLiteral.value));
+            }
+            case ExpressionKind::Call: return nullptr;
+            case ExpressionKind::Cast: {
+                const auto& cast = expression->cast;
+                const auto sourceType = cast.operand->info->type.get();
+                const auto destType = expression->info->type.get();
+                if (const auto sourceExpressionSize = calculateStorageSize(sourceType, "left-hand side of cast expression"_sv)) {
+                    if (const auto destTypeSize = calculateStorageSize(destType, "right-hand side of cast expression"_sv)) {
+                        bool validRuntimeCast = false;
 
-                    if (!operand) {
-                        if (const auto binaryOperator = argument->tryGet<Expression::BinaryOperator>()) {
-                            if (binaryOperator->op == BinaryOperatorKind::Assignment) {
-                                if (!emitAssignmentExpressionIr(binaryOperator->left.get(), binaryOperator->right.get(), binaryOperator->left->location)) {
-                                    return false;
+                        if (sourceExpressionSize.get() == destTypeSize.get()) {
+                            validRuntimeCast = true;
+                        } else {
+                            if (const auto resolvedIdentifier = cast.operand->tryGet<Expression::ResolvedIdentifier>()) {
+                                if (resolvedIdentifier->definition->kind == DefinitionKind::BuiltinRegister) {
+                                    validRuntimeCast = true;
                                 }
-                                expression = binaryOperator->left.get();
-                                operand = createOperandFromExpression(expression, true);
                             }
-                        } else if (const auto unaryOperator = argument->tryGet<Expression::UnaryOperator>()) {
-                            const auto term = unaryOperator->operand.get();
-                            const auto op = unaryOperator->op;
-                            if (op == UnaryOperatorKind::PreIncrement || op == UnaryOperatorKind::PreDecrement) {
-                                if (!emitUnaryExpressionIr(term, op, term, term->location)) {
-                                    raiseEmitUnaryExpressionError(term, op, term, term->location);
-                                    return false;
-                                }
-                                expression = term;
-                                operand = createOperandFromExpression(term, true);
-                            } else {
-                                expression = nullptr;
-                                operand = nullptr;
+                        }
+
+                        if (validRuntimeCast) {
+                            return createOperandFromExpression(cast.operand.get(), quiet);
+                        } else {
+                            if (!quiet) {
+                                report->error("run-time cast from `" + getTypeName(sourceType) + "` to `" + getTypeName(destType) + "` is not possible because it would require a temporary", expression->location, ReportErrorFlags::Continued);
                             }
                         }
                     }
-                    
-                    operandRoots.push_back(InstructionOperandRoot(expression, std::move(operand)));
-                }
-                
-                if (const auto instruction = builtins.selectInstruction(
-                    InstructionType(InstructionType::LoadIntrinsic(definition)),
-                    modeFlags,
-                    operandRoots)
-                ) {
-                    irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), location);
-                    return true;
-                } else {
-                    raiseEmitIntrinsicError(InstructionType(InstructionType::LoadIntrinsic(definition)), operandRoots, location);
-                    return false;
                 }
+                return nullptr;
             }
-        } else if (const auto functionType = function->info->type->tryGet<TypeExpression::Function>()) {
-            auto destOperand = createOperandFromExpression(function, true);
-
-            if (!destOperand) {
-                return false;
+            case ExpressionKind::Embed: return nullptr;
+            case ExpressionKind::FieldAccess: return nullptr;
+            case ExpressionKind::Identifier: return nullptr;
+            case ExpressionKind::IntegerLiteral: {
+                const auto& integerLiteral = expression->integerLiteral;
+                return createOperand(InstructionOperand::Integer(integerLiteral.value));
             }
-
-            std::vector<InstructionOperandRoot> operandRoots;
-            operandRoots.reserve(2);
-            operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(0)))));
-            operandRoots.push_back(InstructionOperandRoot(function, std::move(destOperand)));
-
-            if (!emitArgumentPassIr(function->info->type.get(), {}, arguments, location)) {
-                return false;
-            }
-
-            bool far = functionType->far;
-            BranchKind kind = BranchKind::None;
-
-            if (tailCall) {
-                kind = far ? BranchKind::FarGoto : BranchKind::Goto;
-            } else {
-                kind = far ? BranchKind::FarCall : BranchKind::Call;
+            case ExpressionKind::OffsetOf: return nullptr;
+            case ExpressionKind::RangeLiteral: return nullptr;
+            case ExpressionKind::ResolvedIdentifier: {
+                const auto& resolvedIdentifier = expression->resolvedIdentifier;
+                return createOperandFromResolvedIdentifier(expression, resolvedIdentifier.definition);
             }
+            case ExpressionKind::SideEffect: return nullptr;
+            case ExpressionKind::StringLiteral: return nullptr;
+            case ExpressionKind::StructLiteral: return nullptr;
+            case ExpressionKind::TupleLiteral: return nullptr;
+            case ExpressionKind::TypeOf: return nullptr;
+            case ExpressionKind::TypeQuery: return nullptr;
+            case ExpressionKind::UnaryOperator: {
+                const auto& unaryOperator = expression->unaryOperator;
+                if (auto operand = createOperandFromExpression(unaryOperator.operand.get(), quiet)) {
+                    switch (unaryOperator.op) {
+                        case UnaryOperatorKind::Indirection: {
+                            const auto far = (unaryOperator.operand->info->qualifiers & Qualifiers::Far) != Qualifiers::None;
 
-            if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
-                irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), function->location);
-
-                if (resultDestination != nullptr) {
-                    const auto returnType = functionType->returnType.get();
-
-                    if (auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
-                        emitAssignmentExpressionIr(resultDestination, designatedStorageType->holder.get(), location);
-                    } else {
-                        report->error("could not generate assignment for `func` result of type `" + getTypeName(returnType) + "`", location);
+                            if (const auto indirectionSize = calculateStorageSize(expression->info->type.get(), "operand"_sv)) {
+                                if (const auto bin = operand->tryGet<InstructionOperand::Binary>()) {
+                                    if (bin->kind == BinaryOperatorKind::Addition) {
+                                        return createOperand(InstructionOperand::Index(
+                                            far,
+                                            bin->left,
+                                            bin->right,
+                                            1,
+                                            *indirectionSize));
+                                    } else if (bin->kind == BinaryOperatorKind::Subtraction) {
+                                        if (const auto rightIntegerOperand = bin->right->tryGet<InstructionOperand::Integer>()) {
+                                            if (rightIntegerOperand->placeholder) {
+                                                return createOperand(InstructionOperand::Index(
+                                                    far,
+                                                    bin->left,
+                                                    bin->right,
+                                                    1,
+                                                    *indirectionSize));
+                                            } else {
+                                                return createOperand(InstructionOperand::Index(
+                                                    far,
+                                                    bin->left,
+                                                    createOperand(InstructionOperand::Integer(-rightIntegerOperand->value)),
+                                                    1,
+                                                    *indirectionSize));
+                                            }
+                                        }
+                                    }
+                                }
+                                return createOperand(InstructionOperand::Dereference(
+                                    far,
+                                    operand,
+                                    *indirectionSize));
+                            }
+                            return nullptr;
+                        }
+                        default: {
+                            return createOperand(InstructionOperand::Unary(unaryOperator.op, operand));
+                        }
                     }
                 }
-
-                return true;
-            } else {
-                return false;
+                return nullptr;
             }
+            default: std::abort(); return nullptr;
         }
-
-        report->error("unhandled call expression", location, ReportErrorFlags::InternalError);
-        return false;
     }
 
-    std::string Compiler::getModeFlagString(std::uint32_t modeFlags) {
-        std::string result = "";
-        for (std::size_t modeIndex = 0, modeCount = builtins.getModeAttributeCount(); modeIndex != modeCount; ++modeIndex) {
-            if ((modeFlags & (1U << modeIndex)) != 0) {
-                const auto modeAttribute = builtins.getModeAttribute(modeIndex);
-                result += (result.size() > 0 ? ", " : "") + modeAttribute->name.toString();
-            }
+    const InstructionOperand* Compiler::createOperandFromExpression(const Expression* expression, bool quiet) const {
+        if (expression->info->context == EvaluationContext::RunTime) {
+            return createOperandFromRunTimeExpression(expression, quiet);
+        } else {
+            return createOperandFromLinkTimeExpression(expression, quiet);
         }
-        return result;
     }
 
-    void Compiler::raiseEmitLoadError(const Expression* dest, const Expression* source, SourceLocation location) {
-        const auto candidates = builtins.findAllInstructionsByType(InstructionType(BinaryOperatorKind::Assignment));
-        report->error("could not generate code for " + getBinaryOperatorName(BinaryOperatorKind::Assignment).toString(), source->location, ReportErrorFlags::Continued);
-
-        auto destOperand = createOperandFromExpression(dest, false);
-        auto sourceOperand = createOperandFromExpression(source, false);
-
-        if (destOperand == nullptr) {
-            report->error("could not create an instruction operand for destination of " + getBinaryOperatorName(BinaryOperatorKind::Assignment).toString(), location);
-            return;
-        }
-        if (sourceOperand == nullptr) {
-            report->error("could not create an instruction operand for source of " + getBinaryOperatorName(BinaryOperatorKind::Assignment).toString(), location);
-            return;
-        }
-
-        {
-            auto message = "got: `"
-                + destOperand->toString()
-                + " = " + sourceOperand->toString()
-                + "`";
-            if (modeFlags != 0) {
-                message += " (" + getModeFlagString(modeFlags) + ")";
-            }
-
-            report->error(message, source->location, ReportErrorFlags::Continued);
-        }
-
-        if (candidates.size() > 0) {
-            std::size_t optionCount = 0;
-            for (const auto candidate : candidates) {
-                switch (candidate->signature.operandPatterns.size()) {
-                    case 2: {
-                        if (candidate->signature.operandPatterns[0]->matches(*destOperand)) {
-                            if (optionCount == 0) {
-                                report->error("possible options:", source->location, ReportErrorFlags::Continued);
-                            }
-                            ++optionCount;
-
-                            auto message = "  `"
-                                + candidate->signature.operandPatterns[0]->toString()
-                                + " = " + candidate->signature.operandPatterns[1]->toString()
-                                + "`";
-                            if (candidate->signature.requiredModeFlags != 0) {
-                                message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
-                            }
-
-                            report->log(message);
-                        }
-                        break;
+    bool Compiler::isLeafExpression(const Expression* expression) const {
+        if (expression->info->context == EvaluationContext::RunTime) {
+            switch (expression->kind){
+                case ExpressionKind::ArrayComprehension: return true;
+                case ExpressionKind::ArrayPadLiteral: return true;
+                case ExpressionKind::ArrayLiteral: return true;
+                case ExpressionKind::BinaryOperator: {
+                    const auto& binaryOperator = expression->binaryOperator;
+                    const auto op = binaryOperator.op;
+                    if (op == BinaryOperatorKind::BitIndexing                    
+                    || op == BinaryOperatorKind::Indexing
+                    || op == BinaryOperatorKind::UnalignedIndexing) {
+                        return true;
                     }
-                    default: {
-                        std::abort();
-                        break;
+                    return false;
+                }
+                case ExpressionKind::BooleanLiteral: return true;
+                case ExpressionKind::Call: return false;
+                case ExpressionKind::Cast: return true;
+                case ExpressionKind::Embed: return true;
+                case ExpressionKind::FieldAccess: return true;
+                case ExpressionKind::Identifier: return true;
+                case ExpressionKind::IntegerLiteral: return true;
+                case ExpressionKind::OffsetOf: return true;
+                case ExpressionKind::RangeLiteral: return true;
+                case ExpressionKind::ResolvedIdentifier: return true;
+                case ExpressionKind::SideEffect: return false;
+                case ExpressionKind::StringLiteral: return true;
+                case ExpressionKind::StructLiteral: return true;
+                case ExpressionKind::TupleLiteral: return true;
+                case ExpressionKind::TypeOf: return true;
+                case ExpressionKind::TypeQuery: return true;
+                case ExpressionKind::UnaryOperator: {
+                    const auto& unaryOperator = expression->unaryOperator;
+                    if (unaryOperator.op == UnaryOperatorKind::Indirection) {
+                        return true;
                     }
+                    return false;
                 }
+                default: std::abort(); return false;
             }
+        } else {
+            return true;
         }
-
-        report->error("assignment must be rewritten some other way\n", source->location);
     }
 
-    void Compiler::raiseEmitUnaryExpressionError(const Expression* dest, UnaryOperatorKind op, const Expression* source, SourceLocation location) {
-        const auto candidates = builtins.findAllInstructionsByType(InstructionType(op));
-        report->error("could not generate code for " + getUnaryOperatorName(op).toString(), source->location, ReportErrorFlags::Continued);
-
-        auto destOperand = createOperandFromExpression(dest, false);
-        auto sourceOperand = createOperandFromExpression(source, false);
-
-        if (destOperand == nullptr) {
-            report->error("could not create an instruction operand for destination of " + getUnaryOperatorName(op).toString(), location);
-            return;
-        }
-        if (sourceOperand == nullptr) {
-            report->error("could not create an instruction operand for source of " + getUnaryOperatorName(op).toString(), location);
-            return;
+    bool Compiler::hasNestedAssignment(const Expression* expression) const {
+        if (expression->info->context == EvaluationContext::RunTime) {
+            switch (expression->kind){
+                case ExpressionKind::ArrayComprehension: return false;
+                case ExpressionKind::ArrayPadLiteral: return false;
+                case ExpressionKind::ArrayLiteral: return false;
+                case ExpressionKind::BinaryOperator: {
+                    const auto& binaryOperator = expression->binaryOperator;
+                    return binaryOperator.op == BinaryOperatorKind::Assignment
+                        || hasNestedAssignment(binaryOperator.left.get())
+                        || hasNestedAssignment(binaryOperator.right.get());
+                }
+                case ExpressionKind::BooleanLiteral: return false;
+                case ExpressionKind::Call: {
+                    const auto& call = expression->call;
+                    return !call.inlined && hasNestedAssignment(call.function.get());
+                }
+                case ExpressionKind::Cast: {
+                    const auto& cast = expression->cast;
+                    return hasNestedAssignment(cast.operand.get());
+                }
+                case ExpressionKind::Embed: return false;
+                case ExpressionKind::FieldAccess: return false;
+                case ExpressionKind::Identifier: return false;
+                case ExpressionKind::IntegerLiteral: return false;
+                case ExpressionKind::OffsetOf: return false;
+                case ExpressionKind::RangeLiteral: return false;
+                case ExpressionKind::ResolvedIdentifier: return false;
+                case ExpressionKind::SideEffect: return false;
+                case ExpressionKind::StringLiteral: return false;
+                case ExpressionKind::StructLiteral: return false;
+                case ExpressionKind::TupleLiteral: return false;
+                case ExpressionKind::TypeOf: return false;
+                case ExpressionKind::TypeQuery: return false;
+                case ExpressionKind::UnaryOperator: {
+                    const auto& unaryOperator = expression->unaryOperator;
+                    return isUnaryIncrementOperator(unaryOperator.op)
+                        || hasNestedAssignment(unaryOperator.operand.get());
+                }
+                default: std::abort(); return false;
+            }
+        } else {
+            return false;
         }
+    }
 
-        bool isIncrement = isUnaryIncrementOperator(op);
-        op = getUnaryPreIncrementEquivalent(op);
+    bool Compiler::emitNestedAssignmentIr(const Expression* expression, bool pre, bool post) {
+        if (expression->info->context == EvaluationContext::RunTime) {
+            switch (expression->kind){
+                case ExpressionKind::ArrayComprehension: return true;
+                case ExpressionKind::ArrayPadLiteral: return true;
+                case ExpressionKind::ArrayLiteral: return true;
+                case ExpressionKind::BinaryOperator: {
+                    const auto& binaryOperator = expression->binaryOperator;
+                    const auto left = binaryOperator.left.get();
+                    const auto right = binaryOperator.right.get();
 
-        if (isIncrement && *destOperand == *sourceOperand) {
-            auto message = "got: `"
-                + getUnaryOperatorSymbol(op).toString()
-                + destOperand->toString()
-                + "`";
-            if (modeFlags != 0) {
-                message += " (" + getModeFlagString(modeFlags) + ")";
-            }
+                    if (binaryOperator.op == BinaryOperatorKind::Assignment) {
+                        return pre
+                            ? emitAssignmentExpressionIr(left, right, left->location)
+                            : true;
+                    } else {
+                        return emitNestedAssignmentIr(left, pre, post)
+                            && emitNestedAssignmentIr(right, pre, post);
+                    }
+                }
+                case ExpressionKind::BooleanLiteral: return true;
+                case ExpressionKind::Call: {
+                    const auto& call = expression->call;
+                    if (!call.inlined) {
+                        return emitNestedAssignmentIr(call.function.get(), pre, post);
+                    } else {
+                        return true;
+                    }
+                }
+                case ExpressionKind::Cast: {
+                    const auto& cast = expression->cast;
+                    return emitNestedAssignmentIr(cast.operand.get(), pre, post);
+                }
+                case ExpressionKind::Embed: return true;
+                case ExpressionKind::FieldAccess: return true;
+                case ExpressionKind::Identifier: return true;
+                case ExpressionKind::IntegerLiteral: return true;
+                case ExpressionKind::OffsetOf: return true;
+                case ExpressionKind::RangeLiteral: return true;
+                case ExpressionKind::ResolvedIdentifier: return true;
+                case ExpressionKind::SideEffect: return true;
+                case ExpressionKind::StringLiteral: return true;
+                case ExpressionKind::StructLiteral: return true;
+                case ExpressionKind::TupleLiteral: return true;
+                case ExpressionKind::TypeOf: return true;
+                case ExpressionKind::TypeQuery: return true;
+                case ExpressionKind::UnaryOperator: {
+                    const auto& unaryOperator = expression->unaryOperator;
+                    const auto& op = unaryOperator.op;
+                    const auto operand = unaryOperator.operand.get();
 
-            report->error(message, source->location, ReportErrorFlags::Continued);
-        } else {
-            auto message = "got: `"
-                + destOperand->toString()
-                + " = "
-                + getUnaryOperatorSymbol(op).toString()
-                + sourceOperand->toString()
-                + "`";
-            if (modeFlags != 0) {
-                message += " (" + getModeFlagString(modeFlags) + ")";
+                    if (isUnaryPreIncrementOperator(op)) {
+                        if (pre && !emitUnaryExpressionIr(operand, op, operand, operand->location)) {
+                            raiseEmitUnaryExpressionError(operand, UnaryOperatorKind::PreIncrement, operand, operand->location);
+                            return false;
+                        }
+                        return true;
+                    } else if (isUnaryPostIncrementOperator(op)) {
+                        if (post && !emitUnaryExpressionIr(operand, getUnaryPreIncrementEquivalent(op), operand, operand->location)) {
+                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
+                            return false;
+                        }
+                        return true;
+                    } else {
+                        return emitNestedAssignmentIr(operand, pre, post);
+                    }
+                }
+                default: std::abort(); return false;
             }
-
-            report->error(message, source->location, ReportErrorFlags::Continued);
+        } else {
+            return true;
         }
+    }
 
-        if (candidates.size() > 0) {
-            report->error("possible options:", source->location, ReportErrorFlags::Continued);
-            for (const auto candidate : candidates) {
-                switch (candidate->signature.operandPatterns.size()) {
-                    case 1: {
-                        std::string message;
-                        if (isIncrement) {
-                            message += "  `"
-                                + getUnaryOperatorSymbol(op).toString()
-                                + candidate->signature.operandPatterns[0]->toString()
-                                + "`";
-                        } else {
-                            message += "  `"
-                                + candidate->signature.operandPatterns[0]->toString()
-                                + " = "
-                                + getUnaryOperatorSymbol(op).toString()
-                                + candidate->signature.operandPatterns[0]->toString()
-                                + "`";
-                        }
-                        if (candidate->signature.requiredModeFlags != 0) {
-                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
-                        }
+    FwdUniquePtr<const Expression> Compiler::stripNestedAssignment(const Expression* expression) const {
+        if (expression->info->context == EvaluationContext::RunTime) {
+            switch (expression->kind){
+                case ExpressionKind::ArrayComprehension: return expression->clone();
+                case ExpressionKind::ArrayPadLiteral: return expression->clone();
+                case ExpressionKind::ArrayLiteral: return expression->clone();
+                case ExpressionKind::BinaryOperator: {
+                    const auto& binaryOperator = expression->binaryOperator;
+                    const auto op = binaryOperator.op;
+                    const auto left = binaryOperator.left.get();
+                    const auto right = binaryOperator.right.get();
 
-                        report->log(message);
+                    auto strippedLeft = stripNestedAssignment(left);
 
-                        break;
+                    if (op == BinaryOperatorKind::Assignment) {
+                        return strippedLeft;
+                    } else {
+                        auto strippedRight = stripNestedAssignment(right);
+
+                        return makeFwdUnique<const Expression>(
+                            Expression::BinaryOperator(op, std::move(strippedLeft), std::move(strippedRight)),
+                            expression->location,
+                            expression->info->clone());
                     }
-                    case 2: {
-                        auto message = "  `"
-                            + candidate->signature.operandPatterns[0]->toString()
-                            + " = "
-                            + getUnaryOperatorSymbol(op).toString()
-                            + candidate->signature.operandPatterns[1]->toString()
-                            + "`";
-                        if (candidate->signature.requiredModeFlags != 0) {
-                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                }
+                case ExpressionKind::BooleanLiteral: return expression->clone();
+                case ExpressionKind::Call: {
+                    const auto& call = expression->call;
+
+                    if (!call.inlined) {
+                        const auto function = call.function.get();
+                        const auto& arguments = call.arguments;
+
+                        auto strippedFunction = stripNestedAssignment(function);
+                        std::vector<FwdUniquePtr<const Expression>> clonedArguments;
+                        for (auto& argument : arguments) {
+                            clonedArguments.push_back(argument->clone());
                         }
 
-                        report->log(message);
-                        break;
+                        return makeFwdUnique<const Expression>(
+                            Expression::Call(false, std::move(strippedFunction), std::move(clonedArguments)),
+                            expression->location,
+                            expression->info->clone());
+                    } else {
+                        return expression->clone();
                     }
-                    default: {
-                        std::abort();
-                        break;
+                }
+                case ExpressionKind::Cast: {
+                    const auto& cast = expression->cast;
+                    const auto& operand = cast.operand.get();
+                    auto strippedOperand = stripNestedAssignment(operand);
+
+                    return makeFwdUnique<const Expression>(
+                        Expression::Cast(std::move(strippedOperand), cast.type->clone()),
+                        expression->location,
+                        expression->info->clone());
+                }
+                case ExpressionKind::Embed: return expression->clone();
+                case ExpressionKind::FieldAccess: return expression->clone();
+                case ExpressionKind::Identifier: return expression->clone();
+                case ExpressionKind::IntegerLiteral: return expression->clone();
+                case ExpressionKind::OffsetOf: return expression->clone();
+                case ExpressionKind::RangeLiteral: return expression->clone();
+                case ExpressionKind::ResolvedIdentifier: return expression->clone();
+                case ExpressionKind::SideEffect: return expression->clone();
+                case ExpressionKind::StringLiteral: return expression->clone();
+                case ExpressionKind::StructLiteral: return expression->clone();
+                case ExpressionKind::TupleLiteral: return expression->clone();
+                case ExpressionKind::TypeOf: return expression->clone();
+                case ExpressionKind::TypeQuery: return expression->clone();
+                case ExpressionKind::UnaryOperator: {
+                    const auto& unaryOperator = expression->unaryOperator;
+                    const auto op = unaryOperator.op;
+                    const auto operand = unaryOperator.operand.get();
+
+                    auto strippedOperand = stripNestedAssignment(operand);
+
+                    if (isUnaryIncrementOperator(op)) {
+                        return strippedOperand;
+                    } else {
+                        return makeFwdUnique<const Expression>(
+                            Expression::UnaryOperator(op, std::move(strippedOperand)),
+                            expression->location,
+                            expression->info->clone());
                     }
                 }
+                default: std::abort(); return nullptr;
             }
+        } else {
+            return expression->clone();
         }
-
-        report->error("expression must be rewritten some other way\n", source->location);
     }
 
-    void Compiler::raiseEmitBinaryExpressionError(const Expression* dest, BinaryOperatorKind op, const Expression* left, const Expression* right, SourceLocation location) {
-        const auto candidates = builtins.findAllInstructionsByType(InstructionType(op));
-        report->error("could not generate code for " + getBinaryOperatorName(op).toString(), right->location, ReportErrorFlags::Continued);
-
-        auto destOperand = createOperandFromExpression(dest, false);
-        auto leftOperand = createOperandFromExpression(left, false);
-        auto rightOperand = createOperandFromExpression(right, false);
+    bool Compiler::emitLoadExpressionIr(const Expression* dest, const Expression* source, SourceLocation location) {
+        auto destOperand = createOperandFromExpression(dest, true);
+        auto sourceOperand = createOperandFromExpression(source, true);
 
-        if (destOperand == nullptr) {
-            report->error("could not create an instruction operand for assignment destination of " + getBinaryOperatorName(op).toString(), location);
-            return;
-        }
-        if (leftOperand == nullptr) {
-            report->error("could not create an instruction operand for left-hand side of " + getBinaryOperatorName(op).toString(), location);
-            return;
+        if (!destOperand || !sourceOperand) {
+            return false;
         }
-        if (rightOperand == nullptr) {
-            report->error("could not create an instruction operand for right-hand side of " + getBinaryOperatorName(op).toString(), location);
-            return;
+
+        if (*destOperand == *sourceOperand) {
+            return true;
         }
 
-        if (*destOperand == *leftOperand) {
-            auto message = "got: `"
-                + destOperand->toString()
-                + " " + getBinaryOperatorSymbol(op).toString() + "= "
-                + rightOperand->toString()
-                + "`";
-            if (modeFlags != 0) {
-                message += " (" + getModeFlagString(modeFlags) + ")";
-            }
+        const InstructionOperandRoot operandRoots[] {
+            InstructionOperandRoot(dest, destOperand),
+            InstructionOperandRoot(source, sourceOperand),
+        };
 
-            report->error(message, right->location, ReportErrorFlags::Continued);
+        if (const auto instruction = builtins.selectInstruction(InstructionType(BinaryOperatorKind::Assignment), modeFlags, operandRoots)) {
+            irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), location);
+            return true;
         } else {
-            auto message = "got: `"
-                + destOperand->toString()
-                + " " + leftOperand->toString()
-                + " " + getBinaryOperatorSymbol(op).toString()
-                + " " + rightOperand->toString()
-                + "`";
-            if (modeFlags != 0) {
-                message += " (" + getModeFlagString(modeFlags) + ")";
-            }
+            return false;
+        }
+    }
 
-            report->error(message, right->location, ReportErrorFlags::Continued);
+    bool Compiler::emitUnaryExpressionIr(const Expression* dest, UnaryOperatorKind op, const Expression* source, SourceLocation location) {
+        auto destOperand = createOperandFromExpression(dest, true);
+        auto sourceOperand = createOperandFromExpression(source, true);
+
+        if (!destOperand || !sourceOperand) {
+            return false;
         }
 
-        if (candidates.size() > 0) {
-            report->error("possible options:", right->location, ReportErrorFlags::Continued);
-            for (const auto candidate : candidates) {
-                switch (candidate->signature.operandPatterns.size()) {
-                    case 2: {
-                        auto message = "  `"
-                            + candidate->signature.operandPatterns[0]->toString()
-                            + " " + getBinaryOperatorSymbol(op).toString()
-                            + "= " + candidate->signature.operandPatterns[1]->toString()
-                            + "`";
-                        if (candidate->signature.requiredModeFlags != 0) {
-                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+        const InstructionOperandRoot operandRootStorage[] {
+            InstructionOperandRoot(dest, destOperand),
+            InstructionOperandRoot(source, sourceOperand),
+        };
+        // dest = -dest; or ++dest; instruction only takes dest, while dest = -source; instruction takes both.
+        const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStorage, *destOperand == *sourceOperand ? 1 : 2);
+
+        if (const auto instruction = builtins.selectInstruction(InstructionType(op), modeFlags, operandRoots)) {
+            irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), location);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    bool Compiler::emitBinaryExpressionIr(const Expression* dest, BinaryOperatorKind op, const Expression* left, const Expression* right, SourceLocation location) {
+        auto destOperand = createOperandFromExpression(dest, true);
+        auto leftOperand = createOperandFromExpression(left, true);
+        auto rightOperand = createOperandFromExpression(right, true);
+
+        if (!destOperand || !leftOperand || !rightOperand) {
+            return false;
+        }
+
+        InstructionOperandRoot operandRootStorage[3];
+        std::size_t operandRootCount = 0;
+
+        if (*destOperand == *leftOperand) {
+            // dest += right; instruction
+            operandRootStorage[operandRootCount++] = InstructionOperandRoot(dest, destOperand);
+            operandRootStorage[operandRootCount++] = InstructionOperandRoot(right, rightOperand);
+        } else {
+            // dest = left + right; instruction
+            operandRootStorage[operandRootCount++] = InstructionOperandRoot(dest, destOperand);
+            operandRootStorage[operandRootCount++] = InstructionOperandRoot(left, leftOperand);
+            operandRootStorage[operandRootCount++] = InstructionOperandRoot(right, rightOperand);
+        }
+
+        const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStorage, operandRootCount);
+
+        if (const auto instruction = builtins.selectInstruction(InstructionType(op), modeFlags, operandRoots)) {
+            irNodes.emplace_back(
+                IrNode::Code(instruction, irOperandRoots.add(operandRoots)),
+                location);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    bool Compiler::emitArgumentPassIr(const TypeExpression* functionTypeExpression, const std::vector<Definition*>& parameters, const std::vector<FwdUniquePtr<const Expression>>& arguments, SourceLocation location) {
+        static_cast<void>(location);
+
+        auto& functionType = functionTypeExpression->function;
+
+        if (functionType.parameters.size() != arguments.size()) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i != arguments.size(); ++i) {
+            const auto& parameterType = functionType.parameters[i]->parameterType;
+            const auto& argument = arguments[i];
+            if (i < parameters.size() && parameters[i]->tryGet<Definition::Let>() != nullptr) {
+                continue;
+            } else if (auto designatedStorageType = parameterType->tryGet<TypeExpression::DesignatedStorage>()) {
+                emitAssignmentExpressionIr(designatedStorageType->holder.get(), argument.get(), argument->location);
+            } else if (i < parameters.size() && parameters[i]->tryGet<Definition::Var>() != nullptr && localsBankDefinition != nullptr) {
+                const auto parameterExpression = expressionPool.add(resolveDefinitionExpression(parameters[i], {parameters[i]->name}, argument->location));
+                if (parameterExpression == nullptr || !emitAssignmentExpressionIr(parameterExpression, argument.get(), argument->location)) {
+                    return false;
+                }
+            } else {
+                report->error(
+                    "could not generate initializer for argument "
+                        + (parameters.size() != 0 ? "`" + parameters[i]->name.toString() + "`" : " #" + std::to_string(i))
+                        + " of type `" + getTypeName(parameterType.get()) + "`",
+                    argument->location);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Compiler::emitCallExpressionIr(std::size_t distanceHint, bool inlined, bool tailCall, const Expression* resultDestination, const Expression* function, const std::vector<FwdUniquePtr<const Expression>>& arguments, SourceLocation location) {
+        if (const auto resolvedIdentifier = function->tryGet<Expression::ResolvedIdentifier>()) {
+            const auto definition = resolvedIdentifier->definition;
+
+            if (const auto funcDefinition = definition->tryGet<Definition::Func>()) {
+                auto& functionType = funcDefinition->resolvedSignatureType->function;
+
+                if (!emitArgumentPassIr(funcDefinition->resolvedSignatureType.get(), funcDefinition->parameters, arguments, location)) {
+                    return false;
+                }
+
+                if (inlined || funcDefinition->inlined) {
+                    tailCall = false;
+                    static_cast<void>(tailCall);
+
+                    auto oldReturnKind = funcDefinition->returnKind;
+                    auto oldInlined = funcDefinition->inlined;
+                    funcDefinition->returnKind = BranchKind::None;
+                    funcDefinition->inlined = true;
+
+                    const auto oldContinueLabel = continueLabel;
+                    const auto oldBreakLabel = breakLabel;
+                    const auto onExit = makeScopeGuard([&]() {
+                        continueLabel = oldContinueLabel;
+                        breakLabel = oldBreakLabel;
+                    });
+
+                    continueLabel = nullptr;
+                    breakLabel = nullptr;
+
+                    enterInlineSite(registeredInlineSites.addNew());
+
+                    const auto funcDeclaration = definition->declaration;
+                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), funcDeclaration->func.body.get(), funcDefinition->enclosingScope));
+
+                    for (std::size_t i = 0; i != funcDefinition->parameters.size(); i++) {
+                        auto& parameter = funcDefinition->parameters[i];
+                        auto& argument = arguments[i];
+
+                        if (auto letParameter = parameter->tryGet<Definition::Let>()) {
+                            if (argument->info->context == EvaluationContext::RunTime) {
+                                report->error("argument `" + parameter->name.toString() + "` is a `let` expression, so it cannot accept a run-time expression", argument->location);
+                            }
+                            currentInlineSite->inlineArguments.push_back(expressionPool.add(argument->clone()));
+                        } else {
+                            currentInlineSite->inlineArguments.push_back(nullptr);
                         }
+                    }
 
-                        report->log(message);
-                        break;
+                    bool valid = reserveDefinitions(funcDeclaration) && resolveDefinitionTypes() && reserveStorage(funcDeclaration);
+
+                    if (valid) {
+                        // TODO: templating on type or expression???
+
+                        valid = emitFunctionIr(definition, function->location);
+                        static_cast<void>(valid);
                     }
-                    case 3: {
-                        auto message = "  `"
-                            + candidate->signature.operandPatterns[0]->toString()
-                            + " = " + candidate->signature.operandPatterns[1]->toString()
-                            + " " + getBinaryOperatorSymbol(op).toString()
-                            + " " + candidate->signature.operandPatterns[2]->toString()
-                            + "`";
-                        if (candidate->signature.requiredModeFlags != 0) {
-                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+
+                    exitScope();
+                    exitInlineSite();
+                    funcDefinition->returnKind = oldReturnKind;
+                    funcDefinition->inlined = oldInlined;
+
+                } else {
+                    function = resolveTrampolineTarget(function);
+                    addCallGraphEdge(tailCall ? BranchKind::Goto : BranchKind::Call, function);
+
+                    auto destOperand = createOperandFromExpression(function, true);
+
+                    if (!destOperand) {
+                        return false;
+                    }
+
+                    const InstructionOperandRoot operandRoots[] {
+                        InstructionOperandRoot(nullptr, createOperand(InstructionOperand::Integer(Int128(distanceHint)))),
+                        InstructionOperandRoot(function, destOperand),
+                    };
+
+                    bool far = functionType.far;
+                    BranchKind kind = BranchKind::None;
+
+                    if (tailCall) {
+                        kind = far ? BranchKind::FarGoto : BranchKind::Goto;
+                    } else {
+                        kind = far ? BranchKind::FarCall : BranchKind::Call;
+                    }
+
+                    if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
+                        irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), function->location);
+                    } else {
+                        return false;
+                    }
+                }
+
+                if (resultDestination != nullptr) {
+                    const auto returnType = functionType.returnType.get();
+
+					if (const auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
+						auto destOperand = createOperandFromExpression(resultDestination, true);
+						auto sourceOperand = createOperandFromExpression(designatedStorageType->holder.get(), true);
+
+						if (destOperand == nullptr || sourceOperand == nullptr || *destOperand != *sourceOperand) {
+							report->error("could not generate assignment for `func " + definition->name.toString() + "` result of type `" + getTypeName(returnType) + "`", location);
+							return false;
+						}
+					}
+				}
+
+                return true;
+            } else if (definition->kind == DefinitionKind::BuiltinVoidIntrinsic) {
+                if (resultDestination != nullptr) {
+                    report->error("void intrinsic `" + definition->name.toString() + "` has no return value so its result cannot be stored.", location);
+                    return false;
+                }
+
+                const auto operandRootOffset = operandRootStack.size();
+                const auto restoreOperandRootStack = makeScopeGuard([&]() {
+                    operandRootStack.resize(operandRootOffset);
+                });
+
+                for (const auto& argument : arguments) {
+                    const Expression* expression = nullptr;
+                    const InstructionOperand* operand = nullptr;
+
+                    expression = argument.get();
+                    operand = createOperandFromExpression(argument.get(), true);
+                    if (!operand) {
+                        if (const auto binaryOperator = argument->tryGet<Expression::BinaryOperator>()) {
+                            if (binaryOperator->op == BinaryOperatorKind::Assignment) {
+                                if (!emitAssignmentExpressionIr(binaryOperator->left.get(), binaryOperator->right.get(), binaryOperator->left->location)) {
+                                    return false;
+                                }
+                                expression = binaryOperator->left.get();
+                                operand = createOperandFromExpression(expression, true);
+                            }
+                        } else if (const auto unaryOperator = argument->tryGet<Expression::UnaryOperator>()) {
+                            const auto term = unaryOperator->operand.get();
+                            const auto op = unaryOperator->op;
+                            if (op == UnaryOperatorKind::PreIncrement || op == UnaryOperatorKind::PreDecrement) {
+                                if (!emitUnaryExpressionIr(term, op, term, term->location)) {
+                                    raiseEmitUnaryExpressionError(term, op, term, term->location);
+                                    return false;
+                                }
+                                expression = term;
+                                operand = createOperandFromExpression(term, true);
+                            } else {
+                                expression = nullptr;
+                                operand = nullptr;
+                            }
+                        }
+                    }
+                        
+                    operandRootStack.push_back(InstructionOperandRoot(expression, operand));
+                }
+
+                const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStack).sub(operandRootOffset);
+
+                if (const auto instruction = builtins.selectInstruction(
+                    InstructionType(InstructionType::VoidIntrinsic(definition)),
+                    modeFlags,
+                    operandRoots)
+                ) {
+                    irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), function->location);
+                    return true;
+                } else {
+                    raiseEmitIntrinsicError(InstructionType(InstructionType::VoidIntrinsic(definition)), operandRoots, location);
+                    return false;
+                }
+            } else if (definition->kind == DefinitionKind::BuiltinLoadIntrinsic) {
+                if (resultDestination == nullptr) {
+                    report->error("load intrinsic `" + definition->name.toString() + "` must have its result stored somewhere.", location);
+                    return false;
+                }
+
+                const auto operandRootOffset = operandRootStack.size();
+                const auto restoreOperandRootStack = makeScopeGuard([&]() {
+                    operandRootStack.resize(operandRootOffset);
+                });
+
+                operandRootStack.push_back(InstructionOperandRoot(resultDestination, createOperandFromExpression(resultDestination, true)));
+
+                for (const auto& argument : arguments) {
+                    const Expression* expression = nullptr;
+                    const InstructionOperand* operand = nullptr;
+
+                    expression = argument.get();
+                    operand = createOperandFromExpression(argument.get(), true);
+
+                    if (!operand) {
+                        if (const auto binaryOperator = argument->tryGet<Expression::BinaryOperator>()) {
+                            if (binaryOperator->op == BinaryOperatorKind::Assignment) {
+                                if (!emitAssignmentExpressionIr(binaryOperator->left.get(), binaryOperator->right.get(), binaryOperator->left->location)) {
+                                    return false;
+                                }
+                                expression = binaryOperator->left.get();
+                                operand = createOperandFromExpression(expression, true);
+                            }
+                        } else if (const auto unaryOperator = argument->tryGet<Expression::UnaryOperator>()) {
+                            const auto term = unaryOperator->operand.get();
+                            const auto op = unaryOperator->op;
+                            if (op == UnaryOperatorKind::PreIncrement || op == UnaryOperatorKind::PreDecrement) {
+                                if (!emitUnaryExpressionIr(term, op, term, term->location)) {
+                                    raiseEmitUnaryExpressionError(term, op, term, term->location);
+                                    return false;
+                                }
+                                expression = term;
+                                operand = createOperandFromExpression(term, true);
+                            } else {
+                                expression = nullptr;
+                                operand = nullptr;
+                            }
+                        }
+                    }
+                    
+                    operandRootStack.push_back(InstructionOperandRoot(expression, operand));
+                }
+
+                const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStack).sub(operandRootOffset);
+                
+                if (const auto instruction = builtins.selectInstruction(
+                    InstructionType(InstructionType::LoadIntrinsic(definition)),
+                    modeFlags,
+                    operandRoots)
+                ) {
+                    irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), location);
+                    return true;
+                } else {
+                    raiseEmitIntrinsicError(InstructionType(InstructionType::LoadIntrinsic(definition)), operandRoots, location);
+                    return false;
+                }
+            }
+        } else if (const auto functionType = function->info->type->tryGet<TypeExpression::Function>()) {
+            addCallGraphEdge(tailCall ? BranchKind::Goto : BranchKind::Call, function);
+
+            auto destOperand = createOperandFromExpression(function, true);
+
+            if (!destOperand) {
+                return false;
+            }
+
+            const InstructionOperandRoot operandRoots[] {
+                InstructionOperandRoot(nullptr, createOperand(InstructionOperand::Integer(Int128(0)))),
+                InstructionOperandRoot(function, destOperand),
+            };
+
+            if (!emitArgumentPassIr(function->info->type.get(), {}, arguments, location)) {
+                return false;
+            }
+
+            bool far = functionType->far;
+            BranchKind kind = BranchKind::None;
+
+            if (tailCall) {
+                kind = far ? BranchKind::FarGoto : BranchKind::Goto;
+            } else {
+                kind = far ? BranchKind::FarCall : BranchKind::Call;
+            }
+
+            if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
+                irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), function->location);
+
+                if (resultDestination != nullptr) {
+                    const auto returnType = functionType->returnType.get();
+
+                    if (auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
+                        emitAssignmentExpressionIr(resultDestination, designatedStorageType->holder.get(), location);
+                    } else {
+                        report->error("could not generate assignment for `func` result of type `" + getTypeName(returnType) + "`", location);
+                    }
+                }
+
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        report->error("unhandled call expression", location, ReportErrorFlags::InternalError);
+        return false;
+    }
+
+    bool Compiler::isBankSwitched(const Bank* bank) const {
+        // A ROM bank that shares part of its address range with another ROM bank must be switched in by a mapper before use.
+        const auto kind = bank->getKind();
+        const auto origin = bank->getOrigin();
+        if ((kind != BankKind::ProgramRom && kind != BankKind::DataRom) || !origin.hasValue()) {
+            return false;
+        }
+
+        for (const auto& otherBank : registeredBanks) {
+            const auto otherKind = otherBank->getKind();
+            const auto otherOrigin = otherBank->getOrigin();
+            if (otherBank.get() != bank
+            && (otherKind == BankKind::ProgramRom || otherKind == BankKind::DataRom)
+            && otherOrigin.hasValue()
+            && otherOrigin.get() < origin.get() + bank->getCapacity()
+            && origin.get() < otherOrigin.get() + otherBank->getCapacity()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::size_t Compiler::getRomBankIndex(const Bank* bank) const {
+        // Banks are numbered in the order that they were declared, which is also the order they appear in the ROM.
+        std::size_t index = 0;
+        for (const auto& otherBank : registeredBanks) {
+            if (otherBank.get() == bank) {
+                break;
+            }
+
+            const auto otherKind = otherBank->getKind();
+            if (otherKind == BankKind::ProgramRom || otherKind == BankKind::DataRom) {
+                ++index;
+            }
+        }
+        return index;
+    }
+
+    const Expression* Compiler::resolveTrampolineTarget(const Expression* function) {
+        // The bank of code being placed automatically isn't known yet, so only calls between fixed placements are checked.
+        if (trampolineTemplate == nullptr || emittingTrampolines || checkingUnusedDefinition || currentBank == nullptr || placementBanks.size() != 0) {
+            return function;
+        }
+
+        const auto resolvedIdentifier = function->tryGet<Expression::ResolvedIdentifier>();
+        if (resolvedIdentifier == nullptr) {
+            return function;
+        }
+
+        const auto definition = resolvedIdentifier->definition;
+        const auto funcDefinition = definition->tryGet<Definition::Func>();
+        if (funcDefinition == nullptr || funcDefinition->inlined || funcDefinition->far) {
+            return function;
+        }
+
+        const auto match = funcBanks.find(definition);
+        if (match == funcBanks.end()) {
+            return function;
+        }
+
+        const auto bank = match->second;
+        if (bank == currentBank || bank == trampolineBank || !isBankSwitched(bank)) {
+            return function;
+        }
+
+        Definition* trampoline = nullptr;
+        const auto trampolineMatch = trampolinesByTarget.find(definition);
+        if (trampolineMatch != trampolinesByTarget.end()) {
+            trampoline = trampolineMatch->second;
+        } else {
+            const auto prefix = "$trampoline_" + definition->name.toString();
+            const auto suffix = ++labelSuffixes[stringPool->intern(prefix)];
+            const auto name = stringPool->intern(prefix + std::to_string(suffix));
+
+            trampoline = definitionPool.addNew(Definition::Func(false, false, false, BranchKind::Return, funcDefinition->returnTypeExpression, funcDefinition->enclosingScope, nullptr), name, nullptr);
+            trampoline->func.resolvedSignatureType = funcDefinition->resolvedSignatureType->clone();
+
+            trampolines.push_back(std::make_pair(definition, trampoline));
+            trampolinesByTarget[definition] = trampoline;
+        }
+
+        if (auto result = resolveDefinitionExpression(trampoline, {trampoline->name}, function->location)) {
+            return expressionPool.add(std::move(result));
+        }
+        return function;
+    }
+
+    std::string Compiler::getModeFlagString(std::uint32_t modeFlags) {
+        std::string result = "";
+        for (std::size_t modeIndex = 0, modeCount = builtins.getModeAttributeCount(); modeIndex != modeCount; ++modeIndex) {
+            if ((modeFlags & (1U << modeIndex)) != 0) {
+                const auto modeAttribute = builtins.getModeAttribute(modeIndex);
+                result += (result.size() > 0 ? ", " : "") + modeAttribute->name.toString();
+            }
+        }
+        return result;
+    }
+
+    void Compiler::raiseEmitLoadError(const Expression* dest, const Expression* source, SourceLocation location) {
+        const auto candidates = builtins.findAllInstructionsByType(InstructionType(BinaryOperatorKind::Assignment));
+        report->error("could not generate code for " + getBinaryOperatorName(BinaryOperatorKind::Assignment).toString(), source->location, ReportErrorFlags::Continued);
+
+        auto destOperand = createOperandFromExpression(dest, false);
+        auto sourceOperand = createOperandFromExpression(source, false);
+
+        if (destOperand == nullptr) {
+            report->error("could not create an instruction operand for destination of " + getBinaryOperatorName(BinaryOperatorKind::Assignment).toString(), location);
+            return;
+        }
+        if (sourceOperand == nullptr) {
+            report->error("could not create an instruction operand for source of " + getBinaryOperatorName(BinaryOperatorKind::Assignment).toString(), location);
+            return;
+        }
+
+        {
+            auto message = "got: `"
+                + destOperand->toString()
+                + " = " + sourceOperand->toString()
+                + "`";
+            if (modeFlags != 0) {
+                message += " (" + getModeFlagString(modeFlags) + ")";
+            }
+
+            report->error(message, source->location, ReportErrorFlags::Continued);
+        }
+
+        if (candidates.size() > 0) {
+            std::size_t optionCount = 0;
+            for (const auto candidate : candidates) {
+                switch (candidate->signature.operandPatterns.size()) {
+                    case 2: {
+                        if (candidate->signature.operandPatterns[0]->matches(*destOperand)) {
+                            if (optionCount == 0) {
+                                report->error("possible options:", source->location, ReportErrorFlags::Continued);
+                            }
+                            ++optionCount;
+
+                            auto message = "  `"
+                                + candidate->signature.operandPatterns[0]->toString()
+                                + " = " + candidate->signature.operandPatterns[1]->toString()
+                                + "`";
+                            if (candidate->signature.requiredModeFlags != 0) {
+                                message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                            }
+
+                            report->log(message);
+                        }
+                        break;
+                    }
+                    default: {
+                        std::abort();
+                        break;
+                    }
+                }
+            }
+        }
+
+        report->error("assignment must be rewritten some other way\n", source->location);
+    }
+
+    void Compiler::raiseEmitUnaryExpressionError(const Expression* dest, UnaryOperatorKind op, const Expression* source, SourceLocation location) {
+        const auto candidates = builtins.findAllInstructionsByType(InstructionType(op));
+        report->error("could not generate code for " + getUnaryOperatorName(op).toString(), source->location, ReportErrorFlags::Continued);
+
+        auto destOperand = createOperandFromExpression(dest, false);
+        auto sourceOperand = createOperandFromExpression(source, false);
+
+        if (destOperand == nullptr) {
+            report->error("could not create an instruction operand for destination of " + getUnaryOperatorName(op).toString(), location);
+            return;
+        }
+        if (sourceOperand == nullptr) {
+            report->error("could not create an instruction operand for source of " + getUnaryOperatorName(op).toString(), location);
+            return;
+        }
+
+        bool isIncrement = isUnaryIncrementOperator(op);
+        op = getUnaryPreIncrementEquivalent(op);
+
+        if (isIncrement && *destOperand == *sourceOperand) {
+            auto message = "got: `"
+                + getUnaryOperatorSymbol(op).toString()
+                + destOperand->toString()
+                + "`";
+            if (modeFlags != 0) {
+                message += " (" + getModeFlagString(modeFlags) + ")";
+            }
+
+            report->error(message, source->location, ReportErrorFlags::Continued);
+        } else {
+            auto message = "got: `"
+                + destOperand->toString()
+                + " = "
+                + getUnaryOperatorSymbol(op).toString()
+                + sourceOperand->toString()
+                + "`";
+            if (modeFlags != 0) {
+                message += " (" + getModeFlagString(modeFlags) + ")";
+            }
+
+            report->error(message, source->location, ReportErrorFlags::Continued);
+        }
+
+        if (candidates.size() > 0) {
+            report->error("possible options:", source->location, ReportErrorFlags::Continued);
+            for (const auto candidate : candidates) {
+                switch (candidate->signature.operandPatterns.size()) {
+                    case 1: {
+                        std::string message;
+                        if (isIncrement) {
+                            message += "  `"
+                                + getUnaryOperatorSymbol(op).toString()
+                                + candidate->signature.operandPatterns[0]->toString()
+                                + "`";
+                        } else {
+                            message += "  `"
+                                + candidate->signature.operandPatterns[0]->toString()
+                                + " = "
+                                + getUnaryOperatorSymbol(op).toString()
+                                + candidate->signature.operandPatterns[0]->toString()
+                                + "`";
+                        }
+                        if (candidate->signature.requiredModeFlags != 0) {
+                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                        }
+
+                        report->log(message);
+
+                        break;
+                    }
+                    case 2: {
+                        auto message = "  `"
+                            + candidate->signature.operandPatterns[0]->toString()
+                            + " = "
+                            + getUnaryOperatorSymbol(op).toString()
+                            + candidate->signature.operandPatterns[1]->toString()
+                            + "`";
+                        if (candidate->signature.requiredModeFlags != 0) {
+                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                        }
+
+                        report->log(message);
+                        break;
+                    }
+                    default: {
+                        std::abort();
+                        break;
+                    }
+                }
+            }
+        }
+
+        report->error("expression must be rewritten some other way\n", source->location);
+    }
+
+    void Compiler::raiseEmitBinaryExpressionError(const Expression* dest, BinaryOperatorKind op, const Expression* left, const Expression* right, SourceLocation location) {
+        const auto candidates = builtins.findAllInstructionsByType(InstructionType(op));
+        report->error("could not generate code for " + getBinaryOperatorName(op).toString(), right->location, ReportErrorFlags::Continued);
+
+        auto destOperand = createOperandFromExpression(dest, false);
+        auto leftOperand = createOperandFromExpression(left, false);
+        auto rightOperand = createOperandFromExpression(right, false);
+
+        if (destOperand == nullptr) {
+            report->error("could not create an instruction operand for assignment destination of " + getBinaryOperatorName(op).toString(), location);
+            return;
+        }
+        if (leftOperand == nullptr) {
+            report->error("could not create an instruction operand for left-hand side of " + getBinaryOperatorName(op).toString(), location);
+            return;
+        }
+        if (rightOperand == nullptr) {
+            report->error("could not create an instruction operand for right-hand side of " + getBinaryOperatorName(op).toString(), location);
+            return;
+        }
+
+        if (*destOperand == *leftOperand) {
+            auto message = "got: `"
+                + destOperand->toString()
+                + " " + getBinaryOperatorSymbol(op).toString() + "= "
+                + rightOperand->toString()
+                + "`";
+            if (modeFlags != 0) {
+                message += " (" + getModeFlagString(modeFlags) + ")";
+            }
+
+            report->error(message, right->location, ReportErrorFlags::Continued);
+        } else {
+            auto message = "got: `"
+                + destOperand->toString()
+                + " " + leftOperand->toString()
+                + " " + getBinaryOperatorSymbol(op).toString()
+                + " " + rightOperand->toString()
+                + "`";
+            if (modeFlags != 0) {
+                message += " (" + getModeFlagString(modeFlags) + ")";
+            }
+
+            report->error(message, right->location, ReportErrorFlags::Continued);
+        }
+
+        if (candidates.size() > 0) {
+            report->error("possible options:", right->location, ReportErrorFlags::Continued);
+            for (const auto candidate : candidates) {
+                switch (candidate->signature.operandPatterns.size()) {
+                    case 2: {
+                        auto message = "  `"
+                            + candidate->signature.operandPatterns[0]->toString()
+                            + " " + getBinaryOperatorSymbol(op).toString()
+                            + "= " + candidate->signature.operandPatterns[1]->toString()
+                            + "`";
+                        if (candidate->signature.requiredModeFlags != 0) {
+                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                        }
+
+                        report->log(message);
+                        break;
+                    }
+                    case 3: {
+                        auto message = "  `"
+                            + candidate->signature.operandPatterns[0]->toString()
+                            + " = " + candidate->signature.operandPatterns[1]->toString()
+                            + " " + getBinaryOperatorSymbol(op).toString()
+                            + " " + candidate->signature.operandPatterns[2]->toString()
+                            + "`";
+                        if (candidate->signature.requiredModeFlags != 0) {
+                            message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                        }
+
+                        report->log(message);
+                        break;
+                    }
+                    default: {
+                        std::abort();
+                        break;
+                    }
+                }
+            }
+        }
+
+        report->error("expression must be rewritten some other way\n", right->location);
+    }
+
+    void Compiler::raiseEmitIntrinsicError(const InstructionType& instructionType, ArrayView<InstructionOperandRoot> operandRoots, SourceLocation location) {
+        std::string intrinsicName;
+        bool isLoadIntrinsic = false;
+        if (const auto voidIntrinsic = instructionType.tryGet<InstructionType::VoidIntrinsic>()) {
+            intrinsicName = voidIntrinsic->definition->name.toString();
+        } else if (const auto loadIntrinsic = instructionType.tryGet<InstructionType::LoadIntrinsic>()) {
+            intrinsicName = loadIntrinsic->definition->name.toString();
+            isLoadIntrinsic = true;
+        } else {
+            std::abort();
+            return;
+        }
+
+        const auto candidates = builtins.findAllInstructionsByType(instructionType);
+        report->error("could not generate code for intrinsic `" + intrinsicName + "`", location, ReportErrorFlags::Continued);
+
+        for (std::size_t i = 0; i != operandRoots.size(); ++i) {
+            const auto& operand = operandRoots[i].operand;
+            if (operand == nullptr) {
+                if (isLoadIntrinsic && i == 0) {
+                    report->error("could not create an instruction operand for assignment destination of instrinsic `" + intrinsicName + "`", location);
+                } else {
+                    report->error("could not create an instruction operand for argument #" + std::to_string(i - (isLoadIntrinsic ? 1 : 0) + 1) + " to instrinsic `" + intrinsicName + "`", location);
+                }
+                return;
+            }
+        }
+
+        {
+            std::string message = "got: `"
+                + (isLoadIntrinsic ? operandRoots[0].operand->toString() + " = " : "")
+                + intrinsicName + "(";
+            bool comma = false;
+            for (const auto& argument : operandRoots) {
+                if (!isLoadIntrinsic || argument.operand != operandRoots[0].operand) {
+                    message += (comma ? ", " : "") + argument.operand->toString();
+                    comma = true;
+                }
+            }
+            message += ")`";
+            if (modeFlags != 0) {
+                message += " (" + getModeFlagString(modeFlags) + ")";
+            }
+
+            report->error(message, location, ReportErrorFlags::Continued);
+        }
+
+        if (candidates.size() > 0) {
+            report->error("possible options:", location, ReportErrorFlags::Continued);
+            for (const auto candidate : candidates) {
+                std::string message = "  `"
+                    + (isLoadIntrinsic ? candidate->signature.operandPatterns[0]->toString() + " = " : "")
+                    + intrinsicName + "(";
+                bool comma = false;
+                for (const auto operandPattern : candidate->signature.operandPatterns) {
+                    if (!isLoadIntrinsic || operandPattern != candidate->signature.operandPatterns[0]) {
+                        message += (comma ? ", " : "") + operandPattern->toString();
+                        comma = true;
+                    }
+                }
+                message += ")`";
+                if (candidate->signature.requiredModeFlags != 0) {
+                    message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                }
+
+                report->log(message);
+            }
+        }
+
+        report->error("expression must be rewritten some other way\n", location);
+    }
+
+    bool Compiler::emitAssignmentExpressionIr(const Expression* dest, const Expression* source, SourceLocation location) {
+        // TODO: figure out a more general way to handle nested assigments and increments.
+
+        if (isLeafExpression(source)) {
+            if (isSimpleCast(source)) {
+                return emitAssignmentExpressionIr(dest, source->cast.operand.get(), location);
+            } 
+
+            if (!emitLoadExpressionIr(dest, source, dest->location)) {
+                if (hasNestedAssignment(source)) {
+                    auto strippedSource = expressionPool.add(stripNestedAssignment(source));
+                    return emitNestedAssignmentIr(source, true, false)
+                        && emitAssignmentExpressionIr(dest, strippedSource, location)
+                        && emitNestedAssignmentIr(source, false, true);
+                } else if (hasNestedAssignment(dest)) {
+                    auto strippedDest = expressionPool.add(stripNestedAssignment(dest));
+                    return emitNestedAssignmentIr(dest, true, false)
+                        && emitAssignmentExpressionIr(strippedDest, source, location)
+                        && emitNestedAssignmentIr(dest, false, true);
+                } else {
+                    raiseEmitLoadError(dest, source, dest->location);
+                    return false;
+                }
+            }
+            return true;
+        } else if (const auto binaryOperator = source->tryGet<Expression::BinaryOperator>()) {
+            const auto left = binaryOperator->left.get();
+            const auto right = binaryOperator->right.get();
+            const auto op = binaryOperator->op;
+            if (op == BinaryOperatorKind::Assignment) {
+                if(!emitAssignmentExpressionIr(left, right, left->location)) {
+                    return false;
+                }
+                if (!emitAssignmentExpressionIr(dest, left, dest->location)) {
+                    return false;
+                }
+                return true;
+            } else {
+                if (emitBinaryExpressionIr(dest, op, left, right, dest->location)) {
+                    return true;
+                } else {
+                    if (!emitAssignmentExpressionIr(dest, left, left->location)) {
+                        return false;
+                    }
+
+                    bool tempRequired = true;
+
+                    if (isLeafExpression(right)) {
+                        if (!emitBinaryExpressionIr(dest, op, dest, right, right->location)) {
+                            if (hasNestedAssignment(right)) {
+                                auto strippedRight = expressionPool.add(stripNestedAssignment(right));
+                                if (!emitNestedAssignmentIr(right, true, false)) {
+                                    return false;
+                                }
+                                if (!emitBinaryExpressionIr(dest, op, dest, strippedRight, right->location)) {
+                                    raiseEmitBinaryExpressionError(dest, op, dest, strippedRight, right->location);
+                                    return false;
+                                }
+                                if (!emitNestedAssignmentIr(right, false, true)) {
+                                    return false;
+                                }
+                            } else {
+                                raiseEmitBinaryExpressionError(dest, op, dest, right, right->location);
+                                return false;
+                            }
+                        }
+
+                        tempRequired = false;
+                    } else if (hasNestedAssignment(right)) {
+                        auto strippedRight = expressionPool.add(stripNestedAssignment(right));
+                        if (!emitNestedAssignmentIr(right, true, false)) {
+                            return false;
+                        }
+                        if (!emitBinaryExpressionIr(dest, op, dest, strippedRight, right->location)) {
+                            raiseEmitBinaryExpressionError(dest, op, dest, strippedRight, right->location);
+                            return false;
+                        }
+                        if (!emitNestedAssignmentIr(right, false, true)) {
+                            return false;
+                        }
+
+                        tempRequired = false;
+                    }
+
+                    if ((dest->info->qualifiers & Qualifiers::WriteOnly) != Qualifiers::None) {
+                        report->error(getBinaryOperatorName(op).toString() + " expression cannot be done in-place because destination is `writeonly`, so it would require a temporary", right->location);
+                        return false;
+                    }
+
+                    if (tempRequired) {
+                        report->error(getBinaryOperatorName(op).toString() + " expression would require a temporary", right->location);
+                        return false;
+                    } else {
+                        return true;
+                    }
+                }
+            }
+        } else if (const auto unaryOperator = source->tryGet<Expression::UnaryOperator>()) {
+            const auto operand = unaryOperator->operand.get();
+            const auto op = unaryOperator->op;
+            if (emitUnaryExpressionIr(dest, op, operand, dest->location)) {
+                return true;
+            } else {
+                // Incrementation of the source must happen on the source operand directly.
+                if (isUnaryIncrementOperator(op)) {
+                    if (isUnaryPostIncrementOperator(op)) {
+                        if (!emitAssignmentExpressionIr(dest, operand, operand->location)) {
+                            return false;
+                        }
+                        if (!emitUnaryExpressionIr(operand, getUnaryPreIncrementEquivalent(op), operand, operand->location)) {
+                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
+                            return false;
+                        }
+                    } else if (isUnaryPreIncrementOperator(op)) {
+                        if (!emitUnaryExpressionIr(operand, op, operand, operand->location)) {
+                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
+                            return false;
+                        }
+                        if (!emitAssignmentExpressionIr(dest, operand, operand->location)) {
+                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
+                            return false;
+                        }
+                    }
+                // Other unary operations can have their operand loaded into the destination first and then be computed on the destination.
+                } else {
+                    if (!emitAssignmentExpressionIr(dest, operand, operand->location)) {
+                        return false;
+                    }
+                    if (!emitUnaryExpressionIr(dest, op, dest, operand->location)) {
+                        raiseEmitUnaryExpressionError(dest, op, dest, operand->location);
+                        return false;
+                    }
+                }
+
+                if ((dest->info->qualifiers & Qualifiers::WriteOnly) != Qualifiers::None) {
+                    report->error(getUnaryOperatorName(op).toString() + " expression cannot be done in-place because destination is `writeonly`, so it would require a temporary", operand->location);
+                    return false;
+                }
+
+                return true;
+            }
+        } else if (const auto call = source->tryGet<Expression::Call>()) {
+            return emitCallExpressionIr(0, call->inlined, false, dest, call->function.get(), call->arguments, location);
+        }
+
+        return false;
+    }
+
+    bool Compiler::emitExpressionStatementIr(const Expression* expression, SourceLocation location) {
+        if (const auto binaryOperator = expression->tryGet<Expression::BinaryOperator>()) {
+            switch (binaryOperator->op) {
+                case BinaryOperatorKind::Assignment: {
+                    return emitAssignmentExpressionIr(binaryOperator->left.get(), binaryOperator->right.get(), binaryOperator->left->location);
+                }
+                default:
+                    break;
+            }
+        } else if (const auto unaryOperator = expression->tryGet<Expression::UnaryOperator>()) {
+            const auto operand = unaryOperator->operand.get();
+            const auto op = unaryOperator->op;
+            switch (op) {
+                case UnaryOperatorKind::PreIncrement:
+                case UnaryOperatorKind::PostIncrement: {
+                    if (!emitUnaryExpressionIr(operand, UnaryOperatorKind::PreIncrement, operand, operand->location)) {
+                        raiseEmitUnaryExpressionError(operand, UnaryOperatorKind::PreIncrement, operand, operand->location);
+                        return false;
+                    }
+                    return true;
+                }
+                case UnaryOperatorKind::PreDecrement:
+                case UnaryOperatorKind::PostDecrement: {
+                    if (!emitUnaryExpressionIr(operand, UnaryOperatorKind::PreDecrement, operand, operand->location)) {
+                        raiseEmitUnaryExpressionError(operand, UnaryOperatorKind::PreDecrement, operand, operand->location);
+                    }
+                    return true;
+                }
+                default: break;
+            }
+        } else if (const auto call = expression->tryGet<Expression::Call>()) {
+            return emitCallExpressionIr(0, call->inlined, false, nullptr, call->function.get(), call->arguments, location);
+        }
+
+        report->error("expression provided cannot be used as a statement", location);
+        return false;
+    }
+
+    bool Compiler::emitReturnAssignmentIr(std::size_t distanceHint, const TypeExpression* returnType, const Expression* returnValue, SourceLocation location) {
+        if (const auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
+            const auto holderExpression = designatedStorageType->holder.get();
+
+            if (const auto call = returnValue->tryGet<Expression::Call>()) {
+                return emitCallExpressionIr(distanceHint, call->inlined, true, holderExpression, call->function.get(), call->arguments, location);
+            } else {
+                return emitAssignmentExpressionIr(holderExpression, returnValue, returnValue->location);
+            }
+        } else {
+            report->error("could not generate initializer for return value of type `" + getTypeName(returnType) + "`", location);
+            return false;
+        }
+        return false;
+    }
+
+    std::unique_ptr<PlatformTestAndBranch> Compiler::getTestAndBranch(BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const {
+        auto innerLeft = left;
+        auto innerRight = right;
+        while (isSimpleCast(innerLeft)) {
+            innerLeft = left->cast.operand.get();
+        }
+        while (isSimpleCast(innerRight)) {
+            innerRight = right->cast.operand.get();
+        } 
+        
+        if (const auto commonType = findCompatibleBinaryArithmeticExpressionType(left, right)) {
+            const auto definition = tryGetResolvedIdentifierTypeDefinition(commonType);
+            return platform->getTestAndBranch(*this, definition, op, innerLeft, innerRight, distanceHint);
+        } else if (isBooleanType(left->info->type.get()) && isBooleanType(right->info->type.get())) {
+            const auto definition = tryGetResolvedIdentifierTypeDefinition(left->info->type.get());
+            return platform->getTestAndBranch(*this, definition, op, innerLeft, innerRight, distanceHint);
+        } else {
+            return nullptr;
+        }
+    }
+
+    bool Compiler::emitBranchIr(std::size_t distanceHint, BranchKind kind, const Expression* destination, const Expression* returnValue, bool negated, const Expression* condition, SourceLocation location) {
+        switch (kind) {
+            case BranchKind::Continue: {
+                if (breakLabel != nullptr) {                    
+                    const auto labelReferenceExpresison = expressionPool.add(resolveDefinitionExpression(continueLabel, {}, location));
+                    return emitBranchIr(distanceHint, BranchKind::Goto, labelReferenceExpresison, returnValue, negated, condition, location);
+                } else {
+                    report->error("`continue` cannot be used outside of a loop", location);
+                    return false;
+                }
+            }
+            case BranchKind::Break: {
+                if (breakLabel != nullptr) {
+                    const auto labelReferenceExpresison = expressionPool.add(resolveDefinitionExpression(breakLabel, {}, location));
+                    return emitBranchIr(distanceHint, BranchKind::Goto, labelReferenceExpresison, returnValue, negated, condition, location);
+                } else {
+                    report->error("`break` cannot be used outside of a loop", location);
+                    return false;
+                }
+            }
+            case BranchKind::Return: {
+                if (currentFunction != nullptr) {
+                    const auto& funcDefinition = currentFunction->func;
+                    const auto returnType = funcDefinition.resolvedSignatureType->function.returnType.get();
+                    bool isVoid = isEmptyTupleType(returnType);
+                    bool needsIntermediateBranch = false;
+
+                    if (returnValue != nullptr) {
+                        if (condition != nullptr) {
+                            needsIntermediateBranch = true;
+
+                            if (const auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
+                                auto destOperand = createOperandFromExpression(designatedStorageType->holder.get(), true);
+                                auto sourceOperand = createOperandFromExpression(returnValue, true);
+
+                                if (destOperand != nullptr && sourceOperand != nullptr && *destOperand == *sourceOperand) {
+                                    needsIntermediateBranch = false;
+                                }
+                            }
+                        }
+
+                        if (isVoid) {
+                            if (const auto call = returnValue->tryGet<Expression::Call>()) {
+                                return emitCallExpressionIr(distanceHint, call->inlined, true, nullptr, call->function.get(), call->arguments, location);
+                            } else {
+                                report->error("`return` value of `func` returning `()` can only be a function call", location);
+                                return false;
+                            }
+                        } else if (!needsIntermediateBranch) {
+                            if (!emitReturnAssignmentIr(distanceHint, returnType, returnValue, location)) {
+                                return false;
+                            }
+                        }
+                    } else if (returnValue == nullptr) {
+                        if (!isVoid) {
+                            report->error("expected `return` value of type `" + getTypeName(returnType) + "` but got empty `return;` nstead.", location);
+                            return false;
+                        }
+                    }
+
+                    // If a function has a different return convention use that instead of normal return.
+                    const auto returnKind = funcDefinition.returnKind;
+
+                    if (needsIntermediateBranch) {
+                        const auto oldFunction = currentFunction;
+                        currentFunction = nullptr;
+
+                        const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
+                        const auto failureReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, location));
+
+                        bool result = emitBranchIr(distanceHint, BranchKind::Goto, failureReferenceExpression, nullptr, !negated, condition, condition->location)
+                            && emitReturnAssignmentIr(distanceHint, returnType, returnValue, location)
+                            && emitBranchIr(distanceHint, returnKind, nullptr, nullptr, false, nullptr, location);
+
+                        currentFunction = oldFunction;
+                        irNodes.emplace_back(IrNode::Label(failureLabelDefinition), location);
+                        return result;
+                    } else if (returnKind != BranchKind::Return) {
+                        if (returnLabel != nullptr) {
+                            // inline functions should jump to a "return label" instead of actually returning.
+                            const auto labelReferenceExpresison = expressionPool.add(resolveDefinitionExpression(returnLabel, {}, location));
+                            return emitBranchIr(distanceHint, BranchKind::Goto, labelReferenceExpresison, returnValue, negated, condition, location);
+                        } else {
+                            return emitBranchIr(distanceHint, returnKind, nullptr, returnValue, negated, condition, location);
+                        }
+                    }
+                }
+                break;
+            }
+            case BranchKind::None: return true;
+            default: break;
+        }
+
+        if (destination) {
+            if (destination->info->type->kind != TypeExpressionKind::Function) {
+                report->error("branch destination must be a label or function, but got expression of type `" + getTypeName(destination->info->type.get()) + "`", destination->location);
+                return false;
+            }
+        }
+
+        if (condition) {
+            if (!isBooleanType(condition->info->type.get())) {
+                report->error("branch conditional must be a boolean expression, but got expression of type `" + getTypeName(condition->info->type.get()) + "`", condition->location);
+                return false;
+            }
+
+            if (const auto unaryOperator = condition->tryGet<Expression::UnaryOperator>()) {
+                const auto op = unaryOperator->op;
+                if (op == UnaryOperatorKind::LogicalNegation) {
+                    return emitBranchIr(distanceHint, kind, destination, returnValue, !negated, unaryOperator->operand.get(), condition->location);
+                } else {
+                    report->error(getUnaryOperatorName(op).toString() + " operator is not allowed in conditional", condition->location);
+                }
+            } else if (const auto binaryOperator = condition->tryGet<Expression::BinaryOperator>()) {
+                const auto preNegated = negated && getBinaryOperatorLogicalNegation(binaryOperator->op) != BinaryOperatorKind::None;
+                const auto op = preNegated ? getBinaryOperatorLogicalNegation(binaryOperator->op) : binaryOperator->op;
+                const auto left = binaryOperator->left.get();
+                const auto right = binaryOperator->right.get();
+
+                auto testAndBranch = getTestAndBranch(op, left, right, distanceHint);
+
+                // If failed to find a test-and-branch, try "flipping" the comparison.
+                // a == b -> b == a, a < b -> b > a, a <= b -> b >= a.
+                if (testAndBranch == nullptr) {
+                    switch (op) {
+                        case BinaryOperatorKind::Equal:
+                        case BinaryOperatorKind::NotEqual:
+                        {
+                            testAndBranch = getTestAndBranch(op, right, left, distanceHint);
+                            break;
+                        }
+                        case BinaryOperatorKind::LessThan:
+                        case BinaryOperatorKind::GreaterThan:
+                        {
+                            testAndBranch = getTestAndBranch(op == BinaryOperatorKind::LessThan ? BinaryOperatorKind::GreaterThan : BinaryOperatorKind::LessThan, right, left, distanceHint);
+                            break;
+                        }
+                        case BinaryOperatorKind::LessThanOrEqual:
+                        case BinaryOperatorKind::GreaterThanOrEqual:
+                        {
+                            testAndBranch = getTestAndBranch(op == BinaryOperatorKind::LessThanOrEqual ? BinaryOperatorKind::GreaterThanOrEqual : BinaryOperatorKind::LessThanOrEqual, right, left, distanceHint);
+                            break;
+                        }
+                        default: break;
+                    }
+                }
+
+                if (testAndBranch != nullptr) {
+                    const auto operandRootOffset = operandRootStack.size();
+                    const auto restoreOperandRootStack = makeScopeGuard([&]() {
+                        operandRootStack.resize(operandRootOffset);
+                    });
+
+                    for (const auto testOperand : testAndBranch->testOperands) {
+                        auto operand = createOperandFromExpression(testOperand, true);
+                        operandRootStack.push_back(InstructionOperandRoot(testOperand, operand));
+                    }
+
+                    if (testAndBranch->branches.size() == 0) {
+                        if (kind == BranchKind::Goto || kind == BranchKind::FarGoto) {
+                            if (destination != nullptr) {
+                                auto operand = createOperandFromExpression(destination, true);
+                                if (!operand) {
+                                    return false;
+                                }
+
+                                operandRootStack.push_back(InstructionOperandRoot(destination, operand));
+                            }
+
+                            const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStack).sub(operandRootOffset);
+
+                            if (const auto instruction = builtins.selectInstruction(testAndBranch->testInstructionType, modeFlags, operandRoots)) {
+                                irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), location);
+                                return true;
+                            }
+                        }
+
+                        return false;
+                    } else {
+                        const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStack).sub(operandRootOffset);
+
+                        if (const auto testInstruction = builtins.selectInstruction(testAndBranch->testInstructionType, modeFlags, operandRoots)) {
+                            irNodes.emplace_back(IrNode::Code(testInstruction, irOperandRoots.add(operandRoots)), location);
+                        } else {
+                            return false;
+                        }
+
+                        const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
+                        const auto failureReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, location));
+
+                        for (const auto& branch : testAndBranch->branches) {
+                            const auto flagReferenceExpression = expressionPool.add(resolveDefinitionExpression(branch.flag, {}, condition->location));
+
+                            if (!emitBranchIr(distanceHint, kind, branch.success ? destination : failureReferenceExpression, returnValue, (preNegated ? !negated : negated) ? branch.value : !branch.value, flagReferenceExpression, condition->location)) {
+                                return false;
+                            }
+                        }
+
+                        irNodes.emplace_back(IrNode::Label(failureLabelDefinition), location);
+                        return true;
+                    }
+                }
+
+                switch (op) {
+                    case BinaryOperatorKind::LogicalAnd: {
+                        if (!negated) {
+                            const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
+                            const auto failureLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, condition->location));
+
+                            if (!emitBranchIr(distanceHint, kind, failureLabelReferenceExpression, returnValue, true, binaryOperator->left.get(), condition->location)
+                            || !emitBranchIr(distanceHint, kind, destination, returnValue, false, binaryOperator->right.get(), condition->location)) {
+                                return false;
+                            }
+
+                            irNodes.emplace_back(IrNode::Label(failureLabelDefinition), location);
+                            return true;
+                        } else {
+                            return emitBranchIr(distanceHint, kind, destination, returnValue, true, binaryOperator->left.get(), condition->location)
+                            && emitBranchIr(distanceHint, kind, destination, returnValue, true, binaryOperator->right.get(), condition->location);
+                        }
+                    }
+                    case BinaryOperatorKind::LogicalOr: {
+                        if (!negated) {
+                            return emitBranchIr(distanceHint, kind, destination, returnValue, false, binaryOperator->left.get(), condition->location)
+                            && emitBranchIr(distanceHint, kind, destination, returnValue, false, binaryOperator->right.get(), condition->location);
+                        } else {
+                            const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);                        
+                            const auto failureLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, condition->location));
+
+                            if (!emitBranchIr(distanceHint, kind, failureLabelReferenceExpression, returnValue, false, binaryOperator->left.get(), condition->location)
+                            || !emitBranchIr(distanceHint, kind, destination, returnValue, true, binaryOperator->right.get(), condition->location)) {
+                                return false;
+                            }
+
+                            irNodes.emplace_back(IrNode::Label(failureLabelDefinition), location);
+                            return true;
+                        }
+                    }
+                    default: {
+                        const auto failingOperator = negated ? getBinaryOperatorLogicalNegation(op) : op;
+                        report->error(getBinaryOperatorName(failingOperator).toString() + " operator is not allowed in conditional", condition->location);
+                    }
+                }
+            } else if (const auto booleanLiteral = condition->tryGet<Expression::BooleanLiteral>()) {
+                if (booleanLiteral->value != negated) {
+                    return emitBranchIr(distanceHint, kind, destination, returnValue, false, nullptr, condition->location);
+                } else {
+                    // condition is known to be false, no branch generated.
+                    return true;
+                }
+            } else if (const auto resolvedIdentifier = condition->tryGet<Expression::ResolvedIdentifier>()) {
+                if (const auto builtinRegister = resolvedIdentifier->definition->tryGet<Definition::BuiltinRegister>()) {
+                    static_cast<void>(builtinRegister);
+                    
+                    InstructionOperandRoot operandRootStorage[4];
+                    std::size_t operandRootCount = 0;
+
+                    operandRootStorage[operandRootCount++] = InstructionOperandRoot(nullptr, createOperand(InstructionOperand::Integer(Int128(distanceHint))));
+
+                    if (destination != nullptr) {
+                        auto operand = createOperandFromExpression(destination, true);
+                        if (!operand) {
+                            return false;
+                        }
+
+                        operandRootStorage[operandRootCount++] = InstructionOperandRoot(destination, operand);
+                    }
+
+                    operandRootStorage[operandRootCount++] = InstructionOperandRoot(nullptr, createOperand(InstructionOperand::Register(resolvedIdentifier->definition)));
+                    operandRootStorage[operandRootCount++] = InstructionOperandRoot(nullptr, createOperand(InstructionOperand::Boolean(!negated)));
+
+                    const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStorage, operandRootCount);
+
+                    if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
+                        irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), location);
+                        return true;
+                    } else {
+                        // If that fails, try to branch-on-opposite around a return.
+                        const auto oldFunction = currentFunction;
+                        currentFunction = nullptr;
+
+                        const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
+                        const auto failureReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, location));
+
+                        bool result = emitBranchIr(distanceHint, BranchKind::Goto, failureReferenceExpression, nullptr, !negated, condition, condition->location)
+                            && emitBranchIr(distanceHint, kind, nullptr, nullptr, false, nullptr, location);
+
+                        currentFunction = oldFunction;
+
+                        if (result) {
+                            irNodes.emplace_back(IrNode::Label(failureLabelDefinition), location);
+                            return true;
+                        }
+
+                        return false;
+                    }
+                } else {
+                    report->error("`" + getResolvedIdentifierName(resolvedIdentifier->definition, resolvedIdentifier->pieces) + "` cannot be used as conditional term", condition->location);
+                    return false;
+                }
+            } else if (const auto sideEffect = condition->tryGet<Expression::SideEffect>()) {
+                return emitStatementIr(sideEffect->statement.get())
+                    && emitBranchIr(distanceHint, kind, destination, returnValue, negated, sideEffect->result.get(), location);
+            }
+        } else {
+            InstructionOperandRoot operandRootStorage[2];
+            std::size_t operandRootCount = 0;
+
+            operandRootStorage[operandRootCount++] = InstructionOperandRoot(nullptr, createOperand(InstructionOperand::Integer(Int128(distanceHint))));
+
+            if (destination != nullptr) {
+                if (kind == BranchKind::Goto || kind == BranchKind::Call) {
+                    destination = resolveTrampolineTarget(destination);
+                    addCallGraphEdge(kind, destination);
+                }
+
+                auto operand = createOperandFromExpression(destination, true);
+                if (!operand) {
+                    return false;
+                }
+
+                operandRootStorage[operandRootCount++] = InstructionOperandRoot(destination, operand);
+
+                if ((destination->info->qualifiers & Qualifiers::Far) != Qualifiers::None) {
+                    switch (kind) {
+                        case BranchKind::Goto: kind = BranchKind::FarGoto; break;
+                        case BranchKind::Call: kind = BranchKind::FarCall; break;
+                        default: break;
+                    }
+                }
+            }
+
+            const auto operandRoots = ArrayView<InstructionOperandRoot>(operandRootStorage, operandRootCount);
+
+            if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
+                irNodes.emplace_back(IrNode::Code(instruction, irOperandRoots.add(operandRoots)), location);
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    bool Compiler::hasUnconditionalReturn(const Statement* statement) const {
+        switch (statement->kind) {
+            case StatementKind::Block: {
+                const auto& block = statement->block;
+                const auto& items = block.items;
+                return items.size() != 0 && hasUnconditionalReturn(items.back().get());
+            }
+            case StatementKind::Branch: {
+                const auto& branch = statement->branch;
+                switch (branch.kind) {
+                    case BranchKind::Goto:
+                    case BranchKind::FarGoto:
+                    case BranchKind::Return:
+                    case BranchKind::IrqReturn:
+                    case BranchKind::NmiReturn:
+                    case BranchKind::FarReturn:
+                        return branch.condition == nullptr;
+                    default: return false;
+                }
+            }
+            case StatementKind::If: {
+                const auto& if_ = statement->if_;
+                return if_.body != nullptr
+                && if_.alternative != nullptr
+                && hasUnconditionalReturn(if_.body.get())
+                && hasUnconditionalReturn(if_.alternative.get());
+            }
+            default: return false;
+        }
+    }
+
+    bool Compiler::emitFunctionIr(Definition* definition, SourceLocation location) {
+        auto& funcDefinition = definition->func;
+
+        const auto oldFunction = currentFunction;
+        const auto oldReturnLabel = returnLabel;
+        const auto oldFrameFunction = frameFunction;
+        const auto onExit = makeScopeGuard([&]() {
+            currentFunction = oldFunction;
+            returnLabel = oldReturnLabel;
+            frameFunction = oldFrameFunction;
+        });        
+
+        currentFunction = definition;
+        if (!funcDefinition.inlined) {
+            frameFunction = definition;
+        }
+        const auto returnKind = funcDefinition.returnKind;
+        const auto returnType = funcDefinition.resolvedSignatureType->function.returnType.get();
+
+        returnLabel = nullptr;
+        if (returnKind == BranchKind::None) {
+            returnLabel = createAnonymousLabelDefinition("$ret"_sv);
+        }
+
+        if (!funcDefinition.inlined) {
+            irNodes.emplace_back(IrNode::Label(currentFunction), location);
+        }
+
+        funcDefinition.hasUnconditionalReturn = funcDefinition.hasUnconditionalReturn || hasUnconditionalReturn(funcDefinition.body);
+
+        if (!emitStatementIr(funcDefinition.body)) {
+            return false;
+        }
+
+        // TODO: omit trailing return if the function is determined to never reach the return statement (nothing breaks the loop)
+        // TODO: error if there is no return at end of non-void func unless it is marked #[fallthrough] (and we determined an implicit return would have been needed)
+
+        if (!funcDefinition.hasUnconditionalReturn && !isEmptyTupleType(returnType)) {
+            report->error("`" + definition->name.toString() + "` is missing return value of type `" + getTypeName(returnType) + "`", location);
+        }
+
+        if (!funcDefinition.fallthrough && returnKind != BranchKind::None && isEmptyTupleType(returnType) && !funcDefinition.hasUnconditionalReturn) {
+            if (!emitBranchIr(0, returnKind, nullptr, nullptr, false, nullptr, location)) {
+                report->error("could not generate return instruction for " + definition->declaration->getDescription().toString(), location);
+                return false;
+            }
+        }
+
+        if (returnLabel != nullptr) {
+            irNodes.emplace_back(IrNode::Label(returnLabel), location);
+        }
+
+        // Marks where a `#[nocross]` func ends, so that placement can tell how big it turned out.
+        if (!funcDefinition.inlined && pageLocalDefinitions.find(definition) != pageLocalDefinitions.end()) {
+            const auto endLabel = createAnonymousLabelDefinition("$nocross"_sv);
+            irNodes.emplace_back(IrNode::Label(endLabel), location);
+            pageLocalFuncEnds[endLabel] = definition;
+        }
+
+        return true;
+    }
+
+    bool Compiler::checkUnusedFunctionIr(Definition* definition, SourceLocation location) {
+        std::vector<IrNode> unusedIrNodes;
+        irNodes.swap(unusedIrNodes);
+        checkingUnusedDefinition = true;
+
+        const auto onExit = makeScopeGuard([&]() {
+            irNodes.swap(unusedIrNodes);
+            checkingUnusedDefinition = false;
+        });
+
+        return emitFunctionIr(definition, location);
+    }
+
+    bool Compiler::emitStatementIr(const Statement* statement) {
+        switch (statement->kind) {
+            case StatementKind::Attribution: {
+                const auto& attributedStatement = statement->attribution;
+                pushAttributeList(statementAttributeLists[statement]);
+                if (checkConditionalCompilationAttributes()) {
+                    emitStatementIr(attributedStatement.body.get());
+                }
+                popAttributeList();
+                break;
+            }
+            case StatementKind::Bank: break;
+            case StatementKind::Block: {
+                const auto& blockStatement = statement->block;
+                enterScope(getOrCreateStatementScope(StringView(), statement, currentScope));
+                for (const auto& item : blockStatement.items) {
+                    emitStatementIr(item.get());
+                }
+                exitScope();
+                break;
+            }
+            case StatementKind::Config: {
+                const auto& configStatement = statement->config;
+                for (const auto& item : configStatement.items) {
+                    if (auto reducedValue = reduceExpression(item->value.get())) {
+                        config->add(report, item->name, std::move(reducedValue));
+                    }
+                }
+                break;
+            }
+            case StatementKind::DoWhile: {
+                const auto& doWhileStatement = statement->doWhile;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
+                }
+
+                const auto oldContinueLabel = continueLabel;
+                const auto oldBreakLabel = breakLabel;
+                const auto onExit = makeScopeGuard([&]() {
+                    continueLabel = oldContinueLabel;
+                    breakLabel = oldBreakLabel;
+                });
+
+                const auto reducedCondition = expressionPool.add(reduceExpression(doWhileStatement.condition.get()));
+                if (!reducedCondition) {
+                    break;
+                }
+
+                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);                
+                const auto beginLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(beginLabelDefinition, {}, statement->location));
+                const auto continueLabelDefinition = createAnonymousLabelDefinition("$continue"_sv);
+                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
+
+                continueLabel = continueLabelDefinition;
+                breakLabel = endLabelDefinition;
+
+                irNodes.emplace_back(IrNode::Label(beginLabelDefinition), statement->location);
+                emitStatementIr(doWhileStatement.body.get());
+                irNodes.emplace_back(IrNode::Label(continueLabelDefinition), reducedCondition->location);
+                if (!emitBranchIr(doWhileStatement.distanceHint, BranchKind::Goto, beginLabelReferenceExpression, nullptr, false, reducedCondition, reducedCondition->location)) {
+                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
+                    break;
+                }
+                irNodes.emplace_back(IrNode::Label(endLabelDefinition), reducedCondition->location);
+                break;
+            }
+            case StatementKind::Enum: break;
+            case StatementKind::ExpressionStatement: {
+                const auto& expressionStatement = statement->expressionStatement;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
+                }
+
+                auto reducedExpression = expressionPool.add(reduceExpression(expressionStatement.expression.get()));
+                if (!reducedExpression) {
+                    break;
+                }
+
+                if (!emitExpressionStatementIr(reducedExpression, reducedExpression->location)) {
+                    report->error("could not generate code for statement", statement->location);
+                }
+                break;
+            }
+            case StatementKind::File: {
+                const auto& file = statement->file;
+                enterScope(findStatementScope(statement));
+                for (const auto& item : file.items) {
+                    emitStatementIr(item.get());
+                }
+                exitScope();
+                break;
+            }
+            case StatementKind::For: {
+                const auto& forStatement = statement->for_;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
+                }
+
+                const auto oldContinueLabel = continueLabel;
+                const auto oldBreakLabel = breakLabel;
+                const auto onExit = makeScopeGuard([&]() {
+                    continueLabel = oldContinueLabel;
+                    breakLabel = oldBreakLabel;
+                });
+
+                const auto reducedCounter = expressionPool.add(reduceExpression(forStatement.counter.get()));
+                const auto reducedSequence = expressionPool.add(reduceExpression(forStatement.sequence.get()));
+                if (!reducedCounter || !reducedSequence) {
+                    break;
+                }
+                if (reducedSequence->kind != ExpressionKind::RangeLiteral || reducedSequence->info->context == EvaluationContext::RunTime) {
+                    report->error("`for` loop range must be a compile-time range literal.", statement->location);
+                    break;
+                }
+
+                const auto& rangeLiteral = reducedSequence->tryGet<Expression::RangeLiteral>();
+                const auto counterResolvedIdentifierType = reducedCounter->info->type->tryGet<TypeExpression::ResolvedIdentifier>();
+                const auto counterBuiltinIntegerType = counterResolvedIdentifierType ? counterResolvedIdentifierType->definition->tryGet<Definition::BuiltinIntegerType>() : nullptr;
+                if (!counterBuiltinIntegerType) {
+                    report->error("`for` loop counter start must be a sized integer type.", statement->location);
+                    break;
+                }
+
+                const auto rangeStart = rangeLiteral->start->tryGet<Expression::IntegerLiteral>();
+                const auto rangeEnd = rangeLiteral->end->tryGet<Expression::IntegerLiteral>();
+                const auto rangeStep = rangeLiteral->step->tryGet<Expression::IntegerLiteral>();
+
+                if (!rangeStart) {
+                    report->error("`for` loop range start must be a compile-time integer literal.", statement->location);
+                    break;
+                }
+                if (!rangeEnd) {
+                    report->error("`for` loop range end must be a compile-time integer literal.", statement->location);
+                    break;
+                }
+                if (!rangeStep) {
+                    report->error("`for` loop range step must be a compile-time integer literal.", statement->location);
+                    break;
+                }
+                if (rangeStep->value.isZero()) {
+                    report->error("`for` loop range step must be non-zero.", statement->location);
+                    break;
+                }
+                
+                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);
+                const auto beginLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(beginLabelDefinition, {}, statement->location));
+                const auto continueLabelDefinition = createAnonymousLabelDefinition("$continue"_sv);
+                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
+
+                continueLabel = continueLabelDefinition;
+                breakLabel = endLabelDefinition;
+
+                auto initAssignment = makeFwdUnique<Expression>(
+                    Expression::BinaryOperator(BinaryOperatorKind::Assignment, reducedCounter->clone(), rangeLiteral->start->clone()),
+                    reducedCounter->location,
+                    Optional<ExpressionInfo>());
+                auto reducedInitAssignment = expressionPool.add(reduceExpression(initAssignment.get()));
+
+                bool conditionNegated = false;
+                const Expression* reducedCondition = nullptr;
+
+                const Instruction* incrementInstruction = nullptr;               
+                InstructionOperandRoot incrementOperandRoots[1];
+
+                if (rangeStep->value == Int128(1) || rangeStep->value == Int128(-1)) {
+                    if (auto destOperand = createOperandFromExpression(reducedCounter, true)) {
+                        const auto op = rangeStep->value.isPositive() ? UnaryOperatorKind::PreIncrement : UnaryOperatorKind::PreDecrement; 
+                        incrementOperandRoots[0] = InstructionOperandRoot(reducedCounter, destOperand);
+                        incrementInstruction = builtins.selectInstruction(InstructionType(op), modeFlags, incrementOperandRoots);
+                    }
+
+                    if (incrementInstruction) {
+                        if ((rangeStep->value.isPositive() && rangeStart->value > rangeEnd->value)
+                        || (rangeStep->value.isNegative() && rangeStart->value < rangeEnd->value)) {
+                            break;
+                        }
+
+                        if ((rangeStep->value.isPositive() && rangeEnd->value == counterBuiltinIntegerType->max)
+                        || (rangeStep->value.isNegative() && rangeEnd->value == Int128(1))) {
+                            if (const auto zeroFlag = platform->getZeroFlag()) {
+                                const auto& affectedFlags = incrementInstruction->options.affectedFlags;
+                                if (std::find(affectedFlags.begin(), affectedFlags.end(), zeroFlag) != affectedFlags.end()) {
+                                    conditionNegated = true;
+                                    reducedCondition = expressionPool.add(resolveDefinitionExpression(zeroFlag, {}, statement->location));
+                                }
+                            }
+                            if (!reducedCondition) {
+                                auto comparisonValue = makeFwdUnique<Expression>(
+                                    Expression::IntegerLiteral(Int128(0)),
+                                    reducedSequence->location,
+                                    ExpressionInfo(EvaluationContext::CompileTime,
+                                        makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::IExpr)), reducedSequence->location),
+                                        Qualifiers::None));
+                                auto condition = makeFwdUnique<Expression>(Expression::BinaryOperator(BinaryOperatorKind::NotEqual, reducedCounter->clone(), std::move(comparisonValue)), reducedCounter->location, Optional<ExpressionInfo>());
+                                reducedCondition = expressionPool.add(reduceExpression(condition.get()));
+                            }
+                        } else if (rangeEnd->value >= Int128(0) && rangeEnd->value <= counterBuiltinIntegerType->max) {
+                            auto comparisonValue = makeFwdUnique<Expression>(
+                                Expression::IntegerLiteral(rangeEnd->value + rangeStep->value),
+                                reducedSequence->location,
+                                ExpressionInfo(EvaluationContext::CompileTime,
+                                    makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::IExpr)), reducedSequence->location),
+                                    Qualifiers::None));
+                            auto condition = makeFwdUnique<Expression>(Expression::BinaryOperator(BinaryOperatorKind::NotEqual, reducedCounter->clone(), std::move(comparisonValue)), reducedCounter->location, Optional<ExpressionInfo>());
+                            reducedCondition = expressionPool.add(reduceExpression(condition.get()));
                         }
-
-                        report->log(message);
-                        break;
-                    }
-                    default: {
-                        std::abort();
-                        break;
                     }
                 }
-            }
-        }
-
-        report->error("expression must be rewritten some other way\n", right->location);
-    }
-
-    void Compiler::raiseEmitIntrinsicError(const InstructionType& instructionType, const std::vector<InstructionOperandRoot>& operandRoots, SourceLocation location) {
-        std::string intrinsicName;
-        bool isLoadIntrinsic = false;
-        if (const auto voidIntrinsic = instructionType.tryGet<InstructionType::VoidIntrinsic>()) {
-            intrinsicName = voidIntrinsic->definition->name.toString();
-        } else if (const auto loadIntrinsic = instructionType.tryGet<InstructionType::LoadIntrinsic>()) {
-            intrinsicName = loadIntrinsic->definition->name.toString();
-            isLoadIntrinsic = true;
-        } else {
-            std::abort();
-            return;
-        }
-
-        const auto candidates = builtins.findAllInstructionsByType(instructionType);
-        report->error("could not generate code for intrinsic `" + intrinsicName + "`", location, ReportErrorFlags::Continued);
 
-        for (std::size_t i = 0; i != operandRoots.size(); ++i) {
-            const auto& operand = operandRoots[i].operand;
-            if (operand == nullptr) {
-                if (isLoadIntrinsic && i == 0) {
-                    report->error("could not create an instruction operand for assignment destination of instrinsic `" + intrinsicName + "`", location);
-                } else {
-                    report->error("could not create an instruction operand for argument #" + std::to_string(i - (isLoadIntrinsic ? 1 : 0) + 1) + " to instrinsic `" + intrinsicName + "`", location);
+                if (!reducedCondition) {
+                    report->error("`for` loop range of `" + rangeStart->value.toString()
+                        + "` ..  `" + rangeEnd->value.toString() + "`"
+                        + (rangeStep->value != Int128(1)
+                            ? " by `" + rangeStep->value.toString() + "`"
+                            : "")
+                        + " is not supported.", reducedSequence->location);
+                    break;
                 }
-                return;
-            }
-        }
 
-        {
-            std::string message = "got: `"
-                + (isLoadIntrinsic ? operandRoots[0].operand->toString() + " = " : "")
-                + intrinsicName + "(";
-            bool comma = false;
-            for (const auto& argument : operandRoots) {
-                if (!isLoadIntrinsic || argument.operand != operandRoots[0].operand) {
-                    message += (comma ? ", " : "") + argument.operand->toString();
-                    comma = true;
-                }
-            }
-            message += ")`";
-            if (modeFlags != 0) {
-                message += " (" + getModeFlagString(modeFlags) + ")";
-            }
+                if (!incrementInstruction) {
+                    report->error("could not generate increment instruction for " + statement->getDescription().toString(), statement->location);
+                    break;
+                }               
 
-            report->error(message, location, ReportErrorFlags::Continued);
-        }
+                // TODO: decrement-and-branch optimization if the instruction exists.
 
-        if (candidates.size() > 0) {
-            report->error("possible options:", location, ReportErrorFlags::Continued);
-            for (const auto candidate : candidates) {
-                std::string message = "  `"
-                    + (isLoadIntrinsic ? candidate->signature.operandPatterns[0]->toString() + " = " : "")
-                    + intrinsicName + "(";
-                bool comma = false;
-                for (const auto operandPattern : candidate->signature.operandPatterns) {
-                    if (!isLoadIntrinsic || operandPattern != candidate->signature.operandPatterns[0]) {
-                        message += (comma ? ", " : "") + operandPattern->toString();
-                        comma = true;
-                    }
+                if (!emitExpressionStatementIr(reducedInitAssignment, reducedInitAssignment->location)) {
+                    report->error("could not generate initial assignment instruction for " + statement->getDescription().toString(), statement->location);
+                    break;
                 }
-                message += ")`";
-                if (candidate->signature.requiredModeFlags != 0) {
-                    message += " (" + getModeFlagString(candidate->signature.requiredModeFlags) + ")";
+                irNodes.emplace_back(IrNode::Label(beginLabelDefinition), statement->location);
+                emitStatementIr(forStatement.body.get());
+                irNodes.emplace_back(IrNode::Label(continueLabelDefinition), reducedCondition->location);
+                irNodes.emplace_back(IrNode::Code(incrementInstruction, irOperandRoots.add(incrementOperandRoots)), reducedCondition->location);
+                if (!emitBranchIr(forStatement.distanceHint, BranchKind::Goto, beginLabelReferenceExpression, nullptr, conditionNegated, reducedCondition, reducedCondition->location)) {
+                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
+                    break;
                 }
-
-                report->log(message);
+                irNodes.emplace_back(IrNode::Label(endLabelDefinition), reducedCondition->location);
+                break;
             }
-        }
-
-        report->error("expression must be rewritten some other way\n", location);
-    }
-
-    bool Compiler::emitAssignmentExpressionIr(const Expression* dest, const Expression* source, SourceLocation location) {
-        // TODO: figure out a more general way to handle nested assigments and increments.
-
-        if (isLeafExpression(source)) {
-            if (isSimpleCast(source)) {
-                return emitAssignmentExpressionIr(dest, source->cast.operand.get(), location);
-            } 
+            case StatementKind::Func: {
+                const auto& funcDeclaration = statement->func;
+                auto definition = currentScope->findLocalMemberDefinition(funcDeclaration.name);
+                auto& funcDefinition = definition->func;
 
-            if (!emitLoadExpressionIr(dest, source, dest->location)) {
-                if (hasNestedAssignment(source)) {
-                    auto strippedSource = expressionPool.add(stripNestedAssignment(source));
-                    return emitNestedAssignmentIr(source, true, false)
-                        && emitAssignmentExpressionIr(dest, strippedSource, location)
-                        && emitNestedAssignmentIr(source, false, true);
-                } else if (hasNestedAssignment(dest)) {
-                    auto strippedDest = expressionPool.add(stripNestedAssignment(dest));
-                    return emitNestedAssignmentIr(dest, true, false)
-                        && emitAssignmentExpressionIr(strippedDest, source, location)
-                        && emitNestedAssignmentIr(dest, false, true);
+                if (funcDefinition.inlined) {
+                    //report->error("TODO: `inline func`", statement->location);
+                    break;
+                } else if (unusedDefinitions.find(definition) != unusedDefinitions.end()) {
+                    checkUnusedFunctionIr(definition, statement->location);
                 } else {
-                    raiseEmitLoadError(dest, source, dest->location);
-                    return false;
+                    emitFunctionIr(definition, statement->location);
                 }
+                break;
             }
-            return true;
-        } else if (const auto binaryOperator = source->tryGet<Expression::BinaryOperator>()) {
-            const auto left = binaryOperator->left.get();
-            const auto right = binaryOperator->right.get();
-            const auto op = binaryOperator->op;
-            if (op == BinaryOperatorKind::Assignment) {
-                if(!emitAssignmentExpressionIr(left, right, left->location)) {
-                    return false;
-                }
-                if (!emitAssignmentExpressionIr(dest, left, dest->location)) {
-                    return false;
+            case StatementKind::If: {
+                const auto& ifStatement = statement->if_;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
                 }
-                return true;
-            } else {
-                if (emitBinaryExpressionIr(dest, op, left, right, dest->location)) {
-                    return true;
-                } else {
-                    if (!emitAssignmentExpressionIr(dest, left, left->location)) {
-                        return false;
-                    }
 
-                    bool tempRequired = true;
-
-                    if (isLeafExpression(right)) {
-                        if (!emitBinaryExpressionIr(dest, op, dest, right, right->location)) {
-                            if (hasNestedAssignment(right)) {
-                                auto strippedRight = expressionPool.add(stripNestedAssignment(right));
-                                if (!emitNestedAssignmentIr(right, true, false)) {
-                                    return false;
-                                }
-                                if (!emitBinaryExpressionIr(dest, op, dest, strippedRight, right->location)) {
-                                    raiseEmitBinaryExpressionError(dest, op, dest, strippedRight, right->location);
-                                    return false;
-                                }
-                                if (!emitNestedAssignmentIr(right, false, true)) {
-                                    return false;
-                                }
-                            } else {
-                                raiseEmitBinaryExpressionError(dest, op, dest, right, right->location);
-                                return false;
-                            }
-                        }
+                const auto reducedCondition = expressionPool.add(reduceExpression(ifStatement.condition.get()));
+                if (!reducedCondition) {
+                    break;
+                }
 
-                        tempRequired = false;
-                    } else if (hasNestedAssignment(right)) {
-                        auto strippedRight = expressionPool.add(stripNestedAssignment(right));
-                        if (!emitNestedAssignmentIr(right, true, false)) {
-                            return false;
-                        }
-                        if (!emitBinaryExpressionIr(dest, op, dest, strippedRight, right->location)) {
-                            raiseEmitBinaryExpressionError(dest, op, dest, strippedRight, right->location);
-                            return false;
-                        }
-                        if (!emitNestedAssignmentIr(right, false, true)) {
-                            return false;
+                if (const auto booleanLiteral = reducedCondition->tryGet<Expression::BooleanLiteral>()) {
+                    if (booleanLiteral->value) {
+                        emitStatementIr(ifStatement.body.get());
+                    } else {
+                        if (ifStatement.alternative) {
+                            emitStatementIr(ifStatement.alternative.get());
                         }
-
-                        tempRequired = false;
                     }
 
-                    if ((dest->info->qualifiers & Qualifiers::WriteOnly) != Qualifiers::None) {
-                        report->error(getBinaryOperatorName(op).toString() + " expression cannot be done in-place because destination is `writeonly`, so it would require a temporary", right->location);
-                        return false;
-                    }
+                    break;
+                }
 
-                    if (tempRequired) {
-                        report->error(getBinaryOperatorName(op).toString() + " expression would require a temporary", right->location);
-                        return false;
-                    } else {
-                        return true;
-                    }
+                const auto endLabelDefinition = createAnonymousLabelDefinition("$endif"_sv);
+                const auto endLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(endLabelDefinition, {}, statement->location));
+                const auto elseLabelDefinition = createAnonymousLabelDefinition("$else"_sv);
+                const auto elseLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(elseLabelDefinition, {}, statement->location));
+
+                if (!emitBranchIr(ifStatement.distanceHint, BranchKind::Goto, elseLabelReferenceExpression, nullptr, true, reducedCondition, statement->location)) {
+                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
+                    break;
                 }
-            }
-        } else if (const auto unaryOperator = source->tryGet<Expression::UnaryOperator>()) {
-            const auto operand = unaryOperator->operand.get();
-            const auto op = unaryOperator->op;
-            if (emitUnaryExpressionIr(dest, op, operand, dest->location)) {
-                return true;
-            } else {
-                // Incrementation of the source must happen on the source operand directly.
-                if (isUnaryIncrementOperator(op)) {
-                    if (isUnaryPostIncrementOperator(op)) {
-                        if (!emitAssignmentExpressionIr(dest, operand, operand->location)) {
-                            return false;
-                        }
-                        if (!emitUnaryExpressionIr(operand, getUnaryPreIncrementEquivalent(op), operand, operand->location)) {
-                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
-                            return false;
-                        }
-                    } else if (isUnaryPreIncrementOperator(op)) {
-                        if (!emitUnaryExpressionIr(operand, op, operand, operand->location)) {
-                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
-                            return false;
-                        }
-                        if (!emitAssignmentExpressionIr(dest, operand, operand->location)) {
-                            raiseEmitUnaryExpressionError(operand, op, operand, operand->location);
-                            return false;
-                        }
+
+                emitStatementIr(ifStatement.body.get());
+                if (ifStatement.alternative) {
+                    if (!emitBranchIr(ifStatement.distanceHint, BranchKind::Goto, endLabelReferenceExpression, nullptr, false, nullptr, statement->location)) {
+                        report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
+                        break;
                     }
-                // Other unary operations can have their operand loaded into the destination first and then be computed on the destination.
+                    irNodes.emplace_back(IrNode::Label(elseLabelDefinition), statement->location);
+                    emitStatementIr(ifStatement.alternative.get());
                 } else {
-                    if (!emitAssignmentExpressionIr(dest, operand, operand->location)) {
-                        return false;
-                    }
-                    if (!emitUnaryExpressionIr(dest, op, dest, operand->location)) {
-                        raiseEmitUnaryExpressionError(dest, op, dest, operand->location);
-                        return false;
-                    }
+                    irNodes.emplace_back(IrNode::Label(elseLabelDefinition), statement->location);
                 }
+                irNodes.emplace_back(IrNode::Label(endLabelDefinition), statement->location);
+                break;
+            }
+            case StatementKind::In: {
+                const auto& inStatement = statement->in;
+                bankStack.push_back(currentBank);
 
-                if ((dest->info->qualifiers & Qualifiers::WriteOnly) != Qualifiers::None) {
-                    report->error(getUnaryOperatorName(op).toString() + " expression cannot be done in-place because destination is `writeonly`, so it would require a temporary", operand->location);
-                    return false;
+                const auto dest = inStatement.alternatePieces.size() == 0 ? inStatement.dest.get() : nullptr;
+                const auto oldPlacementBanks = placementBanks;
+
+                const auto result = handleInStatement(inStatement.pieces, dest, statement->location);
+                if (result.first) {
+                    placementBanks = ArrayView<Bank*>();
+                    if (inStatement.alternatePieces.size() != 0) {
+                        placementBanks = resolvePlacementBanks(inStatement.alternatePieces, inStatement.dest.get(), statement->location);
+                        if (placementBanks.size() != 0) {
+                            emitPlacedStatementIr(inStatement.body.get(), placementBanks);
+                        }
+                    } else {
+                        irNodes.emplace_back(IrNode::PushRelocation(currentBank, result.second), statement->location);
+                        emitStatementIr(inStatement.body.get());
+                        irNodes.emplace_back(IrNode::PopRelocation(), statement->location);
+                    }
                 }
 
-                return true;
+                currentBank = bankStack.back();
+                bankStack.pop_back();
+                placementBanks = oldPlacementBanks;
+                break;
             }
-        } else if (const auto call = source->tryGet<Expression::Call>()) {
-            return emitCallExpressionIr(0, call->inlined, false, dest, call->function.get(), call->arguments, location);
-        }
+            case StatementKind::InlineFor: {
+                const auto& inlineForStatement = statement->inlineFor;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
+                }
 
-        return false;
-    }
+                const auto oldContinueLabel = continueLabel;
+                const auto oldBreakLabel = breakLabel;
+                const auto onExit = makeScopeGuard([&]() {
+                    continueLabel = oldContinueLabel;
+                    breakLabel = oldBreakLabel;
+                });
 
-    bool Compiler::emitExpressionStatementIr(const Expression* expression, SourceLocation location) {
-        if (const auto binaryOperator = expression->tryGet<Expression::BinaryOperator>()) {
-            switch (binaryOperator->op) {
-                case BinaryOperatorKind::Assignment: {
-                    return emitAssignmentExpressionIr(binaryOperator->left.get(), binaryOperator->right.get(), binaryOperator->left->location);
-                }
-                default:
+                auto reducedSequence = reduceExpression(inlineForStatement.sequence.get());
+                if (reducedSequence == nullptr) {
                     break;
-            }
-        } else if (const auto unaryOperator = expression->tryGet<Expression::UnaryOperator>()) {
-            const auto operand = unaryOperator->operand.get();
-            const auto op = unaryOperator->op;
-            switch (op) {
-                case UnaryOperatorKind::PreIncrement:
-                case UnaryOperatorKind::PostIncrement: {
-                    if (!emitUnaryExpressionIr(operand, UnaryOperatorKind::PreIncrement, operand, operand->location)) {
-                        raiseEmitUnaryExpressionError(operand, UnaryOperatorKind::PreIncrement, operand, operand->location);
-                        return false;
-                    }
-                    return true;
-                }
-                case UnaryOperatorKind::PreDecrement:
-                case UnaryOperatorKind::PostDecrement: {
-                    if (!emitUnaryExpressionIr(operand, UnaryOperatorKind::PreDecrement, operand, operand->location)) {
-                        raiseEmitUnaryExpressionError(operand, UnaryOperatorKind::PreDecrement, operand, operand->location);
-                    }
-                    return true;
                 }
-                default: break;
-            }
-        } else if (const auto call = expression->tryGet<Expression::Call>()) {
-            return emitCallExpressionIr(0, call->inlined, false, nullptr, call->function.get(), call->arguments, location);
-        }
 
-        report->error("expression provided cannot be used as a statement", location);
-        return false;
-    }
+                const auto length = tryGetSequenceLiteralLength(reducedSequence.get());
+                if (!length.hasValue()) {
+                    report->error("source for array comprehension must be a valid compile-time sequence", statement->location);
+                    break;
+                }
 
-    bool Compiler::emitReturnAssignmentIr(std::size_t distanceHint, const TypeExpression* returnType, const Expression* returnValue, SourceLocation location) {
-        if (const auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
-            const auto holderExpression = designatedStorageType->holder.get();
+                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), statement, currentScope));
+                
+                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);
+                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
 
-            if (const auto call = returnValue->tryGet<Expression::Call>()) {
-                return emitCallExpressionIr(distanceHint, call->inlined, true, holderExpression, call->function.get(), call->arguments, location);
-            } else {
-                return emitAssignmentExpressionIr(holderExpression, returnValue, returnValue->location);
-            }
-        } else {
-            report->error("could not generate initializer for return value of type `" + getTypeName(returnType) + "`", location);
-            return false;
-        }
-        return false;
-    }
+                breakLabel = endLabelDefinition;
 
-    std::unique_ptr<PlatformTestAndBranch> Compiler::getTestAndBranch(BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const {
-        auto innerLeft = left;
-        auto innerRight = right;
-        while (isSimpleCast(innerLeft)) {
-            innerLeft = left->cast.operand.get();
-        }
-        while (isSimpleCast(innerRight)) {
-            innerRight = right->cast.operand.get();
-        } 
-        
-        if (const auto commonType = findCompatibleBinaryArithmeticExpressionType(left, right)) {
-            const auto definition = tryGetResolvedIdentifierTypeDefinition(commonType);
-            return platform->getTestAndBranch(*this, definition, op, innerLeft, innerRight, distanceHint);
-        } else if (isBooleanType(left->info->type.get()) && isBooleanType(right->info->type.get())) {
-            const auto definition = tryGetResolvedIdentifierTypeDefinition(left->info->type.get());
-            return platform->getTestAndBranch(*this, definition, op, innerLeft, innerRight, distanceHint);
-        } else {
-            return nullptr;
-        }
-    }
+                irNodes.emplace_back(IrNode::Label(beginLabelDefinition), statement->location);
 
-    bool Compiler::emitBranchIr(std::size_t distanceHint, BranchKind kind, const Expression* destination, const Expression* returnValue, bool negated, const Expression* condition, SourceLocation location) {
-        switch (kind) {
-            case BranchKind::Continue: {
-                if (breakLabel != nullptr) {                    
-                    const auto labelReferenceExpresison = expressionPool.add(resolveDefinitionExpression(continueLabel, {}, location));
-                    return emitBranchIr(distanceHint, BranchKind::Goto, labelReferenceExpresison, returnValue, negated, condition, location);
-                } else {
-                    report->error("`continue` cannot be used outside of a loop", location);
-                    return false;
-                }
-            }
-            case BranchKind::Break: {
-                if (breakLabel != nullptr) {
-                    const auto labelReferenceExpresison = expressionPool.add(resolveDefinitionExpression(breakLabel, {}, location));
-                    return emitBranchIr(distanceHint, BranchKind::Goto, labelReferenceExpresison, returnValue, negated, condition, location);
-                } else {
-                    report->error("`break` cannot be used outside of a loop", location);
-                    return false;
-                }
-            }
-            case BranchKind::Return: {
-                if (currentFunction != nullptr) {
-                    const auto& funcDefinition = currentFunction->func;
-                    const auto returnType = funcDefinition.resolvedSignatureType->function.returnType.get();
-                    bool isVoid = isEmptyTupleType(returnType);
-                    bool needsIntermediateBranch = false;
+                for (std::size_t i = 0; i != *length; ++i) {
+                    enterInlineSite(registeredInlineSites.addNew());
+                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), statement, currentScope));
 
-                    if (returnValue != nullptr) {
-                        if (condition != nullptr) {
-                            needsIntermediateBranch = true;
+                    const auto continueLabelDefinition = createAnonymousLabelDefinition("$continue"_sv);
 
-                            if (const auto designatedStorageType = returnType->tryGet<TypeExpression::DesignatedStorage>()) {
-                                auto destOperand = createOperandFromExpression(designatedStorageType->holder.get(), true);
-                                auto sourceOperand = createOperandFromExpression(returnValue, true);
+                    continueLabel = continueLabelDefinition;
+                    const auto body = inlineForStatement.body.get();
 
-                                if (destOperand != nullptr && sourceOperand != nullptr && *destOperand == *sourceOperand) {
-                                    needsIntermediateBranch = false;
-                                }
-                            }
-                        }
+                    bool valid = reserveDefinitions(body) && resolveDefinitionTypes() && reserveStorage(body);
 
-                        if (isVoid) {
-                            if (const auto call = returnValue->tryGet<Expression::Call>()) {
-                                return emitCallExpressionIr(distanceHint, call->inlined, true, nullptr, call->function.get(), call->arguments, location);
-                            } else {
-                                report->error("`return` value of `func` returning `()` can only be a function call", location);
-                                return false;
-                            }
-                        } else if (!needsIntermediateBranch) {
-                            if (!emitReturnAssignmentIr(distanceHint, returnType, returnValue, location)) {
-                                return false;
-                            }
-                        }
-                    } else if (returnValue == nullptr) {
-                        if (!isVoid) {
-                            report->error("expected `return` value of type `" + getTypeName(returnType) + "` but got empty `return;` nstead.", location);
-                            return false;
-                        }
-                    }
+                    if (valid) {
+                        auto tempDeclaration = statementPool.addNew(Statement::InternalDeclaration(), statement->location);
+                        auto tempDefinition = currentScope->createDefinition(report, Definition::Let({}, nullptr, nullptr), inlineForStatement.name, tempDeclaration);
+                        auto& tempLetDefinition = tempDefinition->let;
 
-                    // If a function has a different return convention use that instead of normal return.
-                    const auto returnKind = funcDefinition.returnKind;
+                        auto sourceItem = getSequenceLiteralItem(reducedSequence.get(), i);
+                        tempLetDefinition.expression = sourceItem.get();
 
-                    if (needsIntermediateBranch) {
-                        const auto oldFunction = currentFunction;
-                        currentFunction = nullptr;
+                        valid = emitStatementIr(body);
+                    }
 
-                        const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
-                        const auto failureReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, location));
+                    irNodes.emplace_back(IrNode::Label(continueLabelDefinition), statement->location);
 
-                        bool result = emitBranchIr(distanceHint, BranchKind::Goto, failureReferenceExpression, nullptr, !negated, condition, condition->location)
-                            && emitReturnAssignmentIr(distanceHint, returnType, returnValue, location)
-                            && emitBranchIr(distanceHint, returnKind, nullptr, nullptr, false, nullptr, location);
+                    exitScope();
+                    exitInlineSite();
 
-                        currentFunction = oldFunction;
-                        irNodes.addNew(IrNode::Label(failureLabelDefinition), location);
-                        return result;
-                    } else if (returnKind != BranchKind::Return) {
-                        if (returnLabel != nullptr) {
-                            // inline functions should jump to a "return label" instead of actually returning.
-                            const auto labelReferenceExpresison = expressionPool.add(resolveDefinitionExpression(returnLabel, {}, location));
-                            return emitBranchIr(distanceHint, BranchKind::Goto, labelReferenceExpresison, returnValue, negated, condition, location);
-                        } else {
-                            return emitBranchIr(distanceHint, returnKind, nullptr, returnValue, negated, condition, location);
-                        }
+                    if (!valid) {
+                        break;
                     }
                 }
-                break;
-            }
-            case BranchKind::None: return true;
-            default: break;
-        }
 
-        if (destination) {
-            if (destination->info->type->kind != TypeExpressionKind::Function) {
-                report->error("branch destination must be a label or function, but got expression of type `" + getTypeName(destination->info->type.get()) + "`", destination->location);
-                return false;
-            }
-        }
+                irNodes.emplace_back(IrNode::Label(endLabelDefinition), statement->location);
 
-        if (condition) {
-            if (!isBooleanType(condition->info->type.get())) {
-                report->error("branch conditional must be a boolean expression, but got expression of type `" + getTypeName(condition->info->type.get()) + "`", condition->location);
-                return false;
+                exitScope();
+                break;
             }
-
-            if (const auto unaryOperator = condition->tryGet<Expression::UnaryOperator>()) {
-                const auto op = unaryOperator->op;
-                if (op == UnaryOperatorKind::LogicalNegation) {
-                    return emitBranchIr(distanceHint, kind, destination, returnValue, !negated, unaryOperator->operand.get(), condition->location);
-                } else {
-                    report->error(getUnaryOperatorName(op).toString() + " operator is not allowed in conditional", condition->location);
+            case StatementKind::ImportReference: break;
+            case StatementKind::InternalDeclaration: break;
+            case StatementKind::Branch: {
+                const auto& branch = statement->branch;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
                 }
-            } else if (const auto binaryOperator = condition->tryGet<Expression::BinaryOperator>()) {
-                const auto preNegated = negated && getBinaryOperatorLogicalNegation(binaryOperator->op) != BinaryOperatorKind::None;
-                const auto op = preNegated ? getBinaryOperatorLogicalNegation(binaryOperator->op) : binaryOperator->op;
-                const auto left = binaryOperator->left.get();
-                const auto right = binaryOperator->right.get();
-
-                auto testAndBranch = getTestAndBranch(op, left, right, distanceHint);
 
-                // If failed to find a test-and-branch, try "flipping" the comparison.
-                // a == b -> b == a, a < b -> b > a, a <= b -> b >= a.
-                if (testAndBranch == nullptr) {
-                    switch (op) {
-                        case BinaryOperatorKind::Equal:
-                        case BinaryOperatorKind::NotEqual:
-                        {
-                            testAndBranch = getTestAndBranch(op, right, left, distanceHint);
-                            break;
-                        }
-                        case BinaryOperatorKind::LessThan:
-                        case BinaryOperatorKind::GreaterThan:
-                        {
-                            testAndBranch = getTestAndBranch(op == BinaryOperatorKind::LessThan ? BinaryOperatorKind::GreaterThan : BinaryOperatorKind::LessThan, right, left, distanceHint);
-                            break;
-                        }
-                        case BinaryOperatorKind::LessThanOrEqual:
-                        case BinaryOperatorKind::GreaterThanOrEqual:
-                        {
-                            testAndBranch = getTestAndBranch(op == BinaryOperatorKind::LessThanOrEqual ? BinaryOperatorKind::GreaterThanOrEqual : BinaryOperatorKind::LessThanOrEqual, right, left, distanceHint);
-                            break;
-                        }
-                        default: break;
+                const Expression* reducedDestination = nullptr;
+                if (branch.destination) {
+                    reducedDestination = expressionPool.add(reduceExpression(branch.destination.get()));
+                    if (!reducedDestination) {
+                        break;
                     }
                 }
 
-                if (testAndBranch != nullptr) {
-                    std::vector<InstructionOperandRoot> operandRoots;
-                    operandRoots.reserve(testAndBranch->testOperands.size() + (testAndBranch->branches.size() == 0 ? 1 : 0));
+                const Expression* reducedReturnValue = nullptr;
+                if (branch.returnValue) {
+                    reducedReturnValue = expressionPool.add(reduceExpression(branch.returnValue.get()));
+                    if (!reducedReturnValue) {
+                        break;
+                    }
+                }
 
-                    for (const auto testOperand : testAndBranch->testOperands) {
-                        auto operand = createOperandFromExpression(testOperand, true);
-                        operandRoots.push_back(InstructionOperandRoot(testOperand, std::move(operand)));
+                const Expression* reducedCondition = nullptr;
+                if (branch.condition) {
+                    reducedCondition = expressionPool.add(reduceExpression(branch.condition.get()));
+                    if (!reducedCondition) {
+                        break;
                     }
+                }            
 
-                    if (testAndBranch->branches.size() == 0) {
-                        if (kind == BranchKind::Goto || kind == BranchKind::FarGoto) {
-                            if (destination != nullptr) {
-                                auto operand = createOperandFromExpression(destination, true);
-                                if (!operand) {
-                                    return false;
-                                }
+                if (!emitBranchIr(branch.distanceHint, branch.kind, reducedDestination, reducedReturnValue, false, reducedCondition, statement->location)) {
+                    report->error("branch instruction could not be generated", statement->location);
+                }
+                break;
+            }
+            case StatementKind::Label: {
+                const auto& labelDeclaration = statement->label;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
+                }
 
-                                operandRoots.push_back(InstructionOperandRoot(destination, std::move(operand)));
-                            }
+                irNodes.emplace_back(IrNode::Label(currentScope->findLocalMemberDefinition(labelDeclaration.name)), statement->location);
+                break;
+            }
+            case StatementKind::Let: break;
+            case StatementKind::Namespace: {
+                const auto& namespaceDeclaration = statement->namespace_;
+                enterScope(findStatementScope(namespaceDeclaration.body.get()));
+                emitStatementIr(namespaceDeclaration.body.get());
+                exitScope();
+                break;
+            }
+            case StatementKind::Struct: break;
+            case StatementKind::TypeAlias: break;
+            case StatementKind::Var: {
+                const auto& varDeclaration = statement->var;
+                for (const auto& name : varDeclaration.names) {
+                    auto definition = currentScope->findLocalMemberDefinition(name);
+                    auto& varDefinition = definition->var;
 
-                            if (const auto instruction = builtins.selectInstruction(testAndBranch->testInstructionType, modeFlags, operandRoots)) {
-                                irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), location);
-                                return true;
-                            }
-                        }
+                    if (unusedDefinitions.find(definition) != unusedDefinitions.end()) {
+                        continue;
+                    }
 
-                        return false;
-                    } else {
-                        if (const auto testInstruction = builtins.selectInstruction(testAndBranch->testInstructionType, modeFlags, operandRoots)) {
-                            irNodes.addNew(IrNode::Code(testInstruction, std::move(operandRoots)), location);
-                        } else {
-                            return false;
+                    if ((varDefinition.qualifiers & Qualifiers::Extern) == Qualifiers::None) {
+                        if (currentBank == nullptr && varDefinition.addressExpression == nullptr) {
+                            report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                            break;
                         }
 
-                        const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
-                        const auto failureReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, location));
-
-                        for (const auto& branch : testAndBranch->branches) {
-                            const auto flagReferenceExpression = expressionPool.add(resolveDefinitionExpression(branch.flag, {}, condition->location));
+                        if (currentBank != nullptr && isBankKindStored(currentBank->getKind())) {
+                            if (varDefinition.resolvedType && varDefinition.resolvedType->kind == TypeExpressionKind::DesignatedStorage && varDefinition.initializerExpression != nullptr) {
+                                const auto destExpression = expressionPool.add(resolveDefinitionExpression(definition, {}, statement->location));
+                                emitAssignmentExpressionIr(destExpression, varDefinition.initializerExpression.get(), statement->location);
+                            } else if (varDefinition.enclosingFunction == nullptr) {
+                                irNodes.emplace_back(IrNode::Var(definition), statement->location);
 
-                            if (!emitBranchIr(distanceHint, kind, branch.success ? destination : failureReferenceExpression, returnValue, (preNegated ? !negated : negated) ? branch.value : !branch.value, flagReferenceExpression, condition->location)) {
-                                return false;
+                                for (auto& nestedConstant : varDefinition.nestedConstants) {
+                                    irNodes.emplace_back(IrNode::Var(nestedConstant), statement->location);
+                                }
                             }
                         }
-
-                        irNodes.addNew(IrNode::Label(failureLabelDefinition), location);
-                        return true;
                     }
                 }
+                break;
+            }
+            case StatementKind::While: {
+                const auto& whileStatement = statement->while_;
+                if (currentBank == nullptr) {
+                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+                    break;
+                }
 
-                switch (op) {
-                    case BinaryOperatorKind::LogicalAnd: {
-                        if (!negated) {
-                            const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
-                            const auto failureLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, condition->location));
+                const auto oldContinueLabel = continueLabel;
+                const auto oldBreakLabel = breakLabel;
+                const auto onExit = makeScopeGuard([&]() {
+                    continueLabel = oldContinueLabel;
+                    breakLabel = oldBreakLabel;
+                });
 
-                            if (!emitBranchIr(distanceHint, kind, failureLabelReferenceExpression, returnValue, true, binaryOperator->left.get(), condition->location)
-                            || !emitBranchIr(distanceHint, kind, destination, returnValue, false, binaryOperator->right.get(), condition->location)) {
-                                return false;
-                            }
+                const auto reducedCondition = expressionPool.add(reduceExpression(whileStatement.condition.get()));
+                if (!reducedCondition) {
+                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
+                    break;
+                }
 
-                            irNodes.addNew(IrNode::Label(failureLabelDefinition), location);
-                            return true;
-                        } else {
-                            return emitBranchIr(distanceHint, kind, destination, returnValue, true, binaryOperator->left.get(), condition->location)
-                            && emitBranchIr(distanceHint, kind, destination, returnValue, true, binaryOperator->right.get(), condition->location);
-                        }
-                    }
-                    case BinaryOperatorKind::LogicalOr: {
-                        if (!negated) {
-                            return emitBranchIr(distanceHint, kind, destination, returnValue, false, binaryOperator->left.get(), condition->location)
-                            && emitBranchIr(distanceHint, kind, destination, returnValue, false, binaryOperator->right.get(), condition->location);
-                        } else {
-                            const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);                        
-                            const auto failureLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, condition->location));
+                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);
+                const auto beginLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(beginLabelDefinition, {}, statement->location));
+                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
+                const auto endLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(endLabelDefinition, {}, statement->location));
 
-                            if (!emitBranchIr(distanceHint, kind, failureLabelReferenceExpression, returnValue, false, binaryOperator->left.get(), condition->location)
-                            || !emitBranchIr(distanceHint, kind, destination, returnValue, true, binaryOperator->right.get(), condition->location)) {
-                                return false;
-                            }
+                continueLabel = beginLabelDefinition;
+                breakLabel = endLabelDefinition;
 
-                            irNodes.addNew(IrNode::Label(failureLabelDefinition), location);
-                            return true;
-                        }
-                    }
-                    default: {
-                        const auto failingOperator = negated ? getBinaryOperatorLogicalNegation(op) : op;
-                        report->error(getBinaryOperatorName(failingOperator).toString() + " operator is not allowed in conditional", condition->location);
-                    }
+                irNodes.emplace_back(IrNode::Label(beginLabelDefinition), statement->location);
+                if (!emitBranchIr(whileStatement.distanceHint, BranchKind::Goto, endLabelReferenceExpression, nullptr, true, reducedCondition, statement->location)) {
+                    break;
                 }
-            } else if (const auto booleanLiteral = condition->tryGet<Expression::BooleanLiteral>()) {
-                if (booleanLiteral->value != negated) {
-                    return emitBranchIr(distanceHint, kind, destination, returnValue, false, nullptr, condition->location);
-                } else {
-                    // condition is known to be false, no branch generated.
-                    return true;
+                emitStatementIr(whileStatement.body.get());
+                if (!emitBranchIr(whileStatement.distanceHint, BranchKind::Goto, beginLabelReferenceExpression, nullptr, false, nullptr, statement->location)) {
+                    break;
                 }
-            } else if (const auto resolvedIdentifier = condition->tryGet<Expression::ResolvedIdentifier>()) {
-                if (const auto builtinRegister = resolvedIdentifier->definition->tryGet<Definition::BuiltinRegister>()) {
-                    static_cast<void>(builtinRegister);
-                    
-                    std::vector<InstructionOperandRoot> operandRoots;
-                    operandRoots.reserve((destination != nullptr ? 1 : 0) + 3);
+                irNodes.emplace_back(IrNode::Label(endLabelDefinition), statement->location);
+                break;
+            }
+            default: std::abort(); return false;
+        }
 
-                    operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(distanceHint)))));
+        return statement == program.get() ? report->validate() : report->alive();
+    }
 
-                    if (destination != nullptr) {
-                        auto operand = createOperandFromExpression(destination, true);
-                        if (!operand) {
-                            return false;
-                        }
+    bool Compiler::runIrPasses() {
+        irPassStatistics.clear();
 
-                        operandRoots.push_back(InstructionOperandRoot(destination, std::move(operand)));
-                    }
+        // Tables have to stay within a page, so they are found before constants can be merged into the middle of something else.
+        findIndexedTables();
 
-                    operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Register(resolvedIdentifier->definition))));
-                    operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Boolean(!negated))));                    
+        for (std::size_t i = 0; i != IrPassCount; ++i) {
+            const auto kind = static_cast<IrPassKind>(i);
+            // Unused declarations were already removed by removeUnusedDefinitions(), before there was any IR.
+            // Page crossings are avoided by generateCode(), since that needs to know where things end up.
+            if (kind == IrPassKind::RemoveUnusedDefinitions || kind == IrPassKind::AvoidPageCrossing || !optimizationOptions.isPassEnabled(kind)) {
+                continue;
+            }
 
-                    if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
-                        irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), location);
-                        return true;
-                    } else {
-                        // If that fails, try to branch-on-opposite around a return.
-                        const auto oldFunction = currentFunction;
-                        currentFunction = nullptr;
+            const auto nodeCountBefore = irNodes.size();
+            const auto startTime = std::chrono::steady_clock::now();
 
-                        const auto failureLabelDefinition = createAnonymousLabelDefinition("$skip"_sv);
-                        const auto failureReferenceExpression = expressionPool.add(resolveDefinitionExpression(failureLabelDefinition, {}, location));
+            bool result = false;
+            switch (kind) {
+                case IrPassKind::RemoveUnreachableCode: result = removeUnreachableCodeIr(); break;
+                case IrPassKind::RemoveRedundantJumps: result = removeRedundantJumpIr(); break;
+                case IrPassKind::MergeConstants: result = mergeConstantIr(); break;
+                default: std::abort(); break;
+            }
 
-                        bool result = emitBranchIr(distanceHint, BranchKind::Goto, failureReferenceExpression, nullptr, !negated, condition, condition->location)
-                            && emitBranchIr(distanceHint, kind, nullptr, nullptr, false, nullptr, location);
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+            irPassStatistics.push_back(IrPassStatistics(kind, nodeCountBefore, irNodes.size(), static_cast<std::uint64_t>(elapsed.count())));
 
-                        currentFunction = oldFunction;
+            if (!result) {
+                return false;
+            }
+        }
 
-                        if (result) {
-                            irNodes.addNew(IrNode::Label(failureLabelDefinition), location);
-                            return true;
-                        }
+        return true;
+    }
 
+    bool Compiler::isPlacementUnitEnd(const Statement* statement) const {
+        switch (statement->kind) {
+            case StatementKind::Attribution: {
+                const auto& attributedStatement = statement->attribution;
+                for (const auto& attribute : attributedStatement.attributes) {
+                    if (builtins.findDeclarationAttributeByName(attribute->name) == Builtins::DeclarationAttribute::Fallthrough) {
                         return false;
                     }
-                } else {
-                    report->error("`" + getResolvedIdentifierName(resolvedIdentifier->definition, resolvedIdentifier->pieces) + "` cannot be used as conditional term", condition->location);
-                    return false;
                 }
-            } else if (const auto sideEffect = condition->tryGet<Expression::SideEffect>()) {
-                return emitStatementIr(sideEffect->statement.get())
-                    && emitBranchIr(distanceHint, kind, destination, returnValue, negated, sideEffect->result.get(), location);
+                return isPlacementUnitEnd(attributedStatement.body.get());
             }
-        } else {
-            std::vector<InstructionOperandRoot> operandRoots;
-            operandRoots.reserve((destination != nullptr ? 1 : 0) + 1);
+            case StatementKind::Block: {
+                const auto& items = statement->block.items;
+                return items.size() == 0 || isPlacementUnitEnd(items.back().get());
+            }
+            case StatementKind::Func:
+            case StatementKind::Var:
+                return true;
+            default: return false;
+        }
+    }
 
-            operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(distanceHint)))));
+    bool Compiler::emitPlacedStatementIr(const Statement* statement, ArrayView<Bank*> banks) {
+        // Each declaration gets its own relocation, so that layout can put it in a different bank from its neighbors.
+        // Labels, loose code and `#[fallthrough]` functions can run into whatever comes after them, so they stay with it.
+        std::vector<const Statement*> items;
+        const auto block = statement->tryGet<Statement::Block>();
+        if (block != nullptr) {
+            enterScope(getOrCreateStatementScope(StringView(), statement, currentScope));
+            for (const auto& item : block->items) {
+                items.push_back(item.get());
+            }
+        } else {
+            items.push_back(statement);
+        }
 
-            if (destination != nullptr) {
-                auto operand = createOperandFromExpression(destination, true);
-                if (!operand) {
-                    return false;
-                }
+        auto unitStart = SIZE_MAX;
+        for (std::size_t i = 0; i != items.size(); ++i) {
+            const auto item = items[i];
+            if (unitStart == SIZE_MAX) {
+                unitStart = irNodes.size();
+                irNodes.emplace_back(IrNode::PushRelocation(currentBank, Optional<std::size_t>(), banks), item->location);
+            }
 
-                operandRoots.push_back(InstructionOperandRoot(destination, std::move(operand)));
+            emitStatementIr(item);
 
-                if ((destination->info->qualifiers & Qualifiers::Far) != Qualifiers::None) {
-                    switch (kind) {
-                        case BranchKind::Goto: kind = BranchKind::FarGoto; break;
-                        case BranchKind::Call: kind = BranchKind::FarCall; break;
-                        default: break;
-                    }
+            if (i == items.size() - 1 || isPlacementUnitEnd(item)) {
+                if (irNodes.size() == unitStart + 1) {
+                    irNodes.pop_back();
+                } else {
+                    irNodes.emplace_back(IrNode::PopRelocation(), item->location);
                 }
-            }
-
-            if (const auto instruction = builtins.selectInstruction(InstructionType(kind), modeFlags, operandRoots)) {
-                irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), location);
-                return true;
-            } else {
-                return false;
+                unitStart = SIZE_MAX;
             }
         }
 
-        return false;
+        if (block != nullptr) {
+            exitScope();
+        }
+
+        return report->alive();
     }
 
-    bool Compiler::hasUnconditionalReturn(const Statement* statement) const {
-        switch (statement->kind) {
-            case StatementKind::Block: {
-                const auto& block = statement->block;
-                const auto& items = block.items;
-                return items.size() != 0 && hasUnconditionalReturn(items.back().get());
-            }
-            case StatementKind::Branch: {
-                const auto& branch = statement->branch;
-                switch (branch.kind) {
-                    case BranchKind::Goto:
-                    case BranchKind::FarGoto:
-                    case BranchKind::Return:
-                    case BranchKind::IrqReturn:
-                    case BranchKind::NmiReturn:
-                    case BranchKind::FarReturn:
-                        return branch.condition == nullptr;
-                    default: return false;
+    void Compiler::addCallGraphEdge(BranchKind kind, const Expression* destination) {
+        if (checkingUnusedDefinition) {
+            return;
+        }
+
+        const Definition* callee = nullptr;
+        if (const auto resolvedIdentifier = destination->tryGet<Expression::ResolvedIdentifier>()) {
+            if (const auto funcDefinition = resolvedIdentifier->definition->tryGet<Definition::Func>()) {
+                // A label continues the func that jumps to it, but calling one runs code that can't be followed.
+                if (funcDefinition->returnKind == BranchKind::None) {
+                    if (kind == BranchKind::Goto || kind == BranchKind::FarGoto) {
+                        return;
+                    }
+                } else {
+                    callee = resolvedIdentifier->definition;
                 }
             }
-            case StatementKind::If: {
-                const auto& if_ = statement->if_;
-                return if_.body != nullptr
-                && if_.alternative != nullptr
-                && hasUnconditionalReturn(if_.body.get())
-                && hasUnconditionalReturn(if_.alternative.get());
+        }
+
+        if (frameFunction == nullptr) {
+            if (callee != nullptr) {
+                topLevelCallees.insert(callee);
+            }
+        } else if (callee == nullptr) {
+            indirectCallers.insert(frameFunction);
+        } else {
+            auto& callees = callGraph[frameFunction];
+            if (callees.empty()) {
+                callGraphCallers.push_back(frameFunction);
+            }
+            if (std::find(callees.begin(), callees.end(), callee) == callees.end()) {
+                callees.push_back(callee);
             }
-            default: return false;
         }
     }
 
-    bool Compiler::emitFunctionIr(Definition* definition, SourceLocation location) {
-        auto& funcDefinition = definition->func;
+    bool Compiler::emitTrampolineIr() {
+        if (trampolines.empty()) {
+            return true;
+        }
+
+        const auto location = trampolineTemplate->declaration->location;
+        if (trampolineBank == nullptr) {
+            return false;
+        }
+        if (isBankSwitched(trampolineBank)) {
+            report->error("`#[trampoline]` func `" + trampolineTemplate->name.toString() + "` must be in a bank that is never switched out, but `" + trampolineBank->getName().toString() + "` shares its address range with another bank", location);
+            return false;
+        }
 
         const auto oldFunction = currentFunction;
         const auto oldReturnLabel = returnLabel;
+        const auto oldFrameFunction = frameFunction;
+        const auto oldBank = currentBank;
         const auto onExit = makeScopeGuard([&]() {
             currentFunction = oldFunction;
             returnLabel = oldReturnLabel;
-        });        
+            frameFunction = oldFrameFunction;
+            currentBank = oldBank;
+            emittingTrampolines = false;
+        });
+
+        // Every trampoline has the same shape: the mapper description is expanded with the target's bank and address,
+        // and then it returns to the caller. Calls made inside of a trampoline are never redirected through another one.
+        emittingTrampolines = true;
+        currentBank = trampolineBank;
+        irNodes.emplace_back(IrNode::PushRelocation(trampolineBank, Optional<std::size_t>()), location);
+
+        for (const auto& trampoline : trampolines) {
+            const auto target = trampoline.first;
+            const auto definition = trampoline.second;
+
+            currentFunction = definition;
+            frameFunction = definition;
+            returnLabel = nullptr;
+            irNodes.emplace_back(IrNode::Label(definition), location);
+
+            std::vector<FwdUniquePtr<const Expression>> arguments;
+            arguments.push_back(makeFwdUnique<const Expression>(
+                Expression::IntegerLiteral(Int128(getRomBankIndex(funcBanks[target]))), location,
+                ExpressionInfo(EvaluationContext::CompileTime,
+                    makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::IExpr)), location),
+                    Qualifiers::None)));
+            arguments.push_back(resolveDefinitionExpression(target, {target->name}, location));
 
-        currentFunction = definition;
-        const auto returnKind = funcDefinition.returnKind;
-        const auto returnType = funcDefinition.resolvedSignatureType->function.returnType.get();
+            const auto function = resolveDefinitionExpression(trampolineTemplate, {trampolineTemplate->name}, location);
+            if (function == nullptr || arguments.back() == nullptr) {
+                return false;
+            }
 
-        returnLabel = nullptr;
-        if (returnKind == BranchKind::None) {
-            returnLabel = createAnonymousLabelDefinition("$ret"_sv);
-        }
+            if (!emitCallExpressionIr(0, true, false, nullptr, function.get(), arguments, location)) {
+                return false;
+            }
 
-        if (!funcDefinition.inlined) {
-            irNodes.addNew(IrNode::Label(currentFunction), location);
+            if (!emitBranchIr(0, BranchKind::Return, nullptr, nullptr, false, nullptr, location)) {
+                report->error("could not generate return instruction for trampoline to `" + target->name.toString() + "`", location);
+                return false;
+            }
         }
 
-        funcDefinition.hasUnconditionalReturn = funcDefinition.hasUnconditionalReturn || hasUnconditionalReturn(funcDefinition.body);
+        irNodes.emplace_back(IrNode::PopRelocation(), location);
 
-        if (!emitStatementIr(funcDefinition.body)) {
-            return false;
-        }
+        return report->validate();
+    }
 
-        // TODO: omit trailing return if the function is determined to never reach the return statement (nothing breaks the loop)
-        // TODO: error if there is no return at end of non-void func unless it is marked #[fallthrough] (and we determined an implicit return would have been needed)
+    bool Compiler::allocateLocalStorage() {
+        if (frameFunctions.empty()) {
+            return true;
+        }
 
-        if (!funcDefinition.hasUnconditionalReturn && !isEmptyTupleType(returnType)) {
-            report->error("`" + definition->name.toString() + "` is missing return value of type `" + getTypeName(returnType) + "`", location);
+        const auto bank = localsBankDefinition->bank.bank;
+        const auto location = localsBankDefinition->declaration->location;
+        if (bank == nullptr) {
+            return false;
+        }
+        if (bank->getKind() != BankKind::UninitializedRam) {
+            report->error("`#[locals]` bank `" + bank->getName().toString() + "` must be a `vardata` bank", location);
+            return false;
+        }
+        const auto bankAddress = bank->getAddress();
+        if (!bankAddress.absolutePosition.hasValue()) {
+            report->error("`#[locals]` bank `" + bank->getName().toString() + "` must have an address", location);
+            return false;
         }
 
-        if (!funcDefinition.fallthrough && returnKind != BranchKind::None && isEmptyTupleType(returnType) && !funcDefinition.hasUnconditionalReturn) {
-            if (!emitBranchIr(0, returnKind, nullptr, nullptr, false, nullptr, location)) {
-                report->error("could not generate return instruction for " + definition->declaration->getDescription().toString(), location);
-                return false;
+        // Number every func in the call graph, funcs with locals first.
+        std::vector<const Definition*> nodes;
+        std::unordered_map<const Definition*, std::size_t> nodeIndices;
+        const auto addNode = [&](const Definition* definition) {
+            if (nodeIndices.find(definition) == nodeIndices.end()) {
+                nodeIndices[definition] = nodes.size();
+                nodes.push_back(definition);
             }
+        };
+        for (const auto definition : frameFunctions) {
+            addNode(definition);
         }
-
-        if (returnLabel != nullptr) {
-            irNodes.addNew(IrNode::Label(returnLabel), location);
+        for (const auto caller : callGraphCallers) {
+            addNode(caller);
+            for (const auto callee : callGraph[caller]) {
+                addNode(callee);
+            }
+        }
+        for (const auto caller : indirectCallers) {
+            addNode(caller);
         }
 
-        return true;
-    }
+        // Find every func that can be running underneath each func.
+        // Calls that can't be followed could reach anything, and so could any func that leads to one.
+        const auto nodeCount = nodes.size();
+        std::vector<std::vector<bool>> reaches(nodeCount, std::vector<bool>(nodeCount, false));
+        std::vector<std::size_t> pending;
+        for (std::size_t i = 0; i != nodeCount; ++i) {
+            auto& reached = reaches[i];
 
-    bool Compiler::emitStatementIr(const Statement* statement) {
-        switch (statement->kind) {
-            case StatementKind::Attribution: {
-                const auto& attributedStatement = statement->attribution;
-                pushAttributeList(statementAttributeLists[statement]);
-                if (checkConditionalCompilationAttributes()) {
-                    emitStatementIr(attributedStatement.body.get());
+            pending.assign(1, i);
+            while (!pending.empty()) {
+                const auto node = pending.back();
+                pending.pop_back();
+
+                if (indirectCallers.find(nodes[node]) != indirectCallers.end()) {
+                    reached.assign(nodeCount, true);
+                    break;
                 }
-                popAttributeList();
-                break;
-            }
-            case StatementKind::Bank: break;
-            case StatementKind::Block: {
-                const auto& blockStatement = statement->block;
-                enterScope(getOrCreateStatementScope(StringView(), statement, currentScope));
-                for (const auto& item : blockStatement.items) {
-                    emitStatementIr(item.get());
+
+                const auto match = callGraph.find(nodes[node]);
+                if (match == callGraph.end()) {
+                    continue;
                 }
-                exitScope();
-                break;
-            }
-            case StatementKind::Config: {
-                const auto& configStatement = statement->config;
-                for (const auto& item : configStatement.items) {
-                    if (auto reducedValue = reduceExpression(item->value.get())) {
-                        config->add(report, item->name, std::move(reducedValue));
+                for (const auto callee : match->second) {
+                    const auto calleeIndex = nodeIndices[callee];
+                    if (!reached[calleeIndex]) {
+                        reached[calleeIndex] = true;
+                        pending.push_back(calleeIndex);
                     }
                 }
-                break;
             }
-            case StatementKind::DoWhile: {
-                const auto& doWhileStatement = statement->doWhile;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                    break;
-                }
-
-                const auto oldContinueLabel = continueLabel;
-                const auto oldBreakLabel = breakLabel;
-                const auto onExit = makeScopeGuard([&]() {
-                    continueLabel = oldContinueLabel;
-                    breakLabel = oldBreakLabel;
-                });
-
-                const auto reducedCondition = expressionPool.add(reduceExpression(doWhileStatement.condition.get()));
-                if (!reducedCondition) {
-                    break;
-                }
-
-                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);                
-                const auto beginLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(beginLabelDefinition, {}, statement->location));
-                const auto continueLabelDefinition = createAnonymousLabelDefinition("$continue"_sv);
-                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
-
-                continueLabel = continueLabelDefinition;
-                breakLabel = endLabelDefinition;
+        }
 
-                irNodes.addNew(IrNode::Label(beginLabelDefinition), statement->location);
-                emitStatementIr(doWhileStatement.body.get());
-                irNodes.addNew(IrNode::Label(continueLabelDefinition), reducedCondition->location);
-                if (!emitBranchIr(doWhileStatement.distanceHint, BranchKind::Goto, beginLabelReferenceExpression, nullptr, false, reducedCondition, reducedCondition->location)) {
-                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
-                    break;
+        // Interrupt handlers can run in the middle of anything else, so each one starts a separate context.
+        // Anything without callers is an entry point of the main program.
+        enum : std::uint8_t { MainContext = 1, IrqContext = 2, NmiContext = 4 };
+        std::vector<std::uint8_t> contexts(nodeCount, 0);
+        std::vector<bool> called(nodeCount, false);
+        for (std::size_t i = 0; i != nodeCount; ++i) {
+            for (std::size_t j = 0; j != nodeCount; ++j) {
+                if (i != j && reaches[i][j]) {
+                    called[j] = true;
                 }
-                irNodes.addNew(IrNode::Label(endLabelDefinition), reducedCondition->location);
-                break;
             }
-            case StatementKind::Enum: break;
-            case StatementKind::ExpressionStatement: {
-                const auto& expressionStatement = statement->expressionStatement;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
+        }
+        for (std::size_t i = 0; i != nodeCount; ++i) {
+            std::uint8_t context = 0;
+            switch (nodes[i]->func.returnKind) {
+                case BranchKind::IrqReturn: context = IrqContext; break;
+                case BranchKind::NmiReturn: context = NmiContext; break;
+                default: {
+                    if (!called[i] || topLevelCallees.find(nodes[i]) != topLevelCallees.end()) {
+                        context = MainContext;
+                    }
                     break;
                 }
+            }
 
-                auto reducedExpression = expressionPool.add(reduceExpression(expressionStatement.expression.get()));
-                if (!reducedExpression) {
-                    break;
+            if (context != 0) {
+                contexts[i] |= context;
+                for (std::size_t j = 0; j != nodeCount; ++j) {
+                    if (reaches[i][j]) {
+                        contexts[j] |= context;
+                    }
                 }
+            }
+        }
+        for (auto& context : contexts) {
+            if (context == 0) {
+                context = MainContext;
+            }
+        }
 
-                if (!emitExpressionStatementIr(reducedExpression, reducedExpression->location)) {
-                    report->error("could not generate code for statement", statement->location);
-                }
-                break;
+        const auto conflicts = [&](std::size_t a, std::size_t b) {
+            const auto context = contexts[a] | contexts[b];
+            return reaches[a][b] || reaches[b][a] || (context & (context - 1)) != 0;
+        };
+
+        // Lay out the locals of each func one after another, relative to the start of its frame.
+        std::vector<std::size_t> frameSizes;
+        std::vector<std::size_t> frameAlignments;
+        std::vector<std::vector<std::size_t>> localOffsets;
+        for (const auto definition : frameFunctions) {
+            std::size_t size = 0;
+            std::size_t frameAlignment = 1;
+            std::vector<std::size_t> offsets;
+            for (const auto local : frameLocals[definition]) {
+                const auto& varDefinition = local->var;
+                const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
+                size = (size + alignment - 1) / alignment * alignment;
+                offsets.push_back(size);
+                size += varDefinition.storageSize.get();
+                frameAlignment = std::max(frameAlignment, alignment);
             }
-            case StatementKind::File: {
-                const auto& file = statement->file;
-                enterScope(findStatementScope(statement));
-                for (const auto& item : file.items) {
-                    emitStatementIr(item.get());
+            frameSizes.push_back(size);
+            frameAlignments.push_back(frameAlignment);
+            localOffsets.push_back(std::move(offsets));
+        }
+
+        // Place the largest frames first, each at the lowest offset that doesn't overlap a frame that could be live at the same time.
+        std::vector<std::size_t> order(frameFunctions.size());
+        for (std::size_t i = 0; i != order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return frameSizes[a] > frameSizes[b]; });
+
+        const auto base = bankAddress.absolutePosition.get();
+        std::vector<std::size_t> frameOffsets(frameFunctions.size(), 0);
+        std::vector<std::size_t> placed;
+        std::size_t usedSize = 0;
+        std::size_t totalSize = 0;
+        for (const auto frame : order) {
+            const auto alignment = frameAlignments[frame];
+            const auto alignOffset = [&](std::size_t offset) {
+                return (base + offset + alignment - 1) / alignment * alignment - base;
+            };
+
+            auto offset = alignOffset(0);
+            bool moved = true;
+            while (moved) {
+                moved = false;
+                for (const auto other : placed) {
+                    if (conflicts(frame, other)
+                    && offset < frameOffsets[other] + frameSizes[other]
+                    && frameOffsets[other] < offset + frameSizes[frame]) {
+                        offset = alignOffset(frameOffsets[other] + frameSizes[other]);
+                        moved = true;
+                    }
                 }
-                exitScope();
-                break;
             }
-            case StatementKind::For: {
-                const auto& forStatement = statement->for_;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                    break;
-                }
 
-                const auto oldContinueLabel = continueLabel;
-                const auto oldBreakLabel = breakLabel;
-                const auto onExit = makeScopeGuard([&]() {
-                    continueLabel = oldContinueLabel;
-                    breakLabel = oldBreakLabel;
-                });
+            frameOffsets[frame] = offset;
+            placed.push_back(frame);
+            usedSize = std::max(usedSize, offset + frameSizes[frame]);
+            totalSize += frameSizes[frame];
+        }
 
-                const auto reducedCounter = expressionPool.add(reduceExpression(forStatement.counter.get()));
-                const auto reducedSequence = expressionPool.add(reduceExpression(forStatement.sequence.get()));
-                if (!reducedCounter || !reducedSequence) {
-                    break;
-                }
-                if (reducedSequence->kind != ExpressionKind::RangeLiteral || reducedSequence->info->context == EvaluationContext::RunTime) {
-                    report->error("`for` loop range must be a compile-time range literal.", statement->location);
-                    break;
-                }
+        for (std::size_t frame = 0; frame != frameFunctions.size(); ++frame) {
+            const auto& locals = frameLocals[frameFunctions[frame]];
+            for (std::size_t i = 0; i != locals.size(); ++i) {
+                const auto offset = frameOffsets[frame] + localOffsets[frame][i];
+                locals[i]->var.address = Address(bankAddress.relativePosition.get() + offset, base + offset, bank);
+            }
+        }
 
-                const auto& rangeLiteral = reducedSequence->tryGet<Expression::RangeLiteral>();
-                const auto counterResolvedIdentifierType = reducedCounter->info->type->tryGet<TypeExpression::ResolvedIdentifier>();
-                const auto counterBuiltinIntegerType = counterResolvedIdentifierType ? counterResolvedIdentifierType->definition->tryGet<Definition::BuiltinIntegerType>() : nullptr;
-                if (!counterBuiltinIntegerType) {
-                    report->error("`for` loop counter start must be a sized integer type.", statement->location);
-                    break;
-                }
+        localStorageStatistics = LocalStorageStatistics(frameFunctions.size(), totalSize, usedSize);
 
-                const auto rangeStart = rangeLiteral->start->tryGet<Expression::IntegerLiteral>();
-                const auto rangeEnd = rangeLiteral->end->tryGet<Expression::IntegerLiteral>();
-                const auto rangeStep = rangeLiteral->step->tryGet<Expression::IntegerLiteral>();
+        return bank->reserveRam(report, "local variables"_sv, localsBankDefinition, location, usedSize)
+            && report->validate();
+    }
 
-                if (!rangeStart) {
-                    report->error("`for` loop range start must be a compile-time integer literal.", statement->location);
-                    break;
-                }
-                if (!rangeEnd) {
-                    report->error("`for` loop range end must be a compile-time integer literal.", statement->location);
-                    break;
-                }
-                if (!rangeStep) {
-                    report->error("`for` loop range step must be a compile-time integer literal.", statement->location);
-                    break;
-                }
-                if (rangeStep->value.isZero()) {
-                    report->error("`for` loop range step must be non-zero.", statement->location);
-                    break;
+    bool Compiler::endsControlFlow(const IrNode& irNode) {
+        if (const auto code = irNode.tryGet<IrNode::Code>()) {
+            if (const auto branchKind = code->instruction->signature.type.tryGet<BranchKind>()) {
+                switch (*branchKind) {
+                    case BranchKind::Goto:
+                    case BranchKind::FarGoto:
+                    case BranchKind::Return:
+                    case BranchKind::FarReturn:
+                    case BranchKind::IrqReturn:
+                    case BranchKind::NmiReturn: {
+                        // Conditional branches are the only ones that test a flag.
+                        return std::none_of(code->operandRoots.begin(), code->operandRoots.end(),
+                            [](const InstructionOperandRoot& operandRoot) {
+                                return operandRoot.operand->kind == InstructionOperandKind::Boolean;
+                            });
+                    }
+                    default: break;
                 }
-                
-                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);
-                const auto beginLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(beginLabelDefinition, {}, statement->location));
-                const auto continueLabelDefinition = createAnonymousLabelDefinition("$continue"_sv);
-                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
+            }
+        }
+        return false;
+    }
 
-                continueLabel = continueLabelDefinition;
-                breakLabel = endLabelDefinition;
+    bool Compiler::removeUnreachableCodeIr() {
+        std::size_t count = 0;
+        bool unreachable = false;
 
-                auto initAssignment = makeFwdUnique<Expression>(
-                    Expression::BinaryOperator(BinaryOperatorKind::Assignment, reducedCounter->clone(), rangeLiteral->start->clone()),
-                    reducedCounter->location,
-                    Optional<ExpressionInfo>());
-                auto reducedInitAssignment = expressionPool.add(reduceExpression(initAssignment.get()));
+        // Code after an unconditional jump or return can't run until the next label, so it is removed.
+        // Relocations and vars end the unreachable region too, since they aren't part of the same stream of code.
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            auto& irNode = irNodes[i];
+            bool removed = false;
 
-                bool conditionNegated = false;
-                const Expression* reducedCondition = nullptr;
+            if (irNode.kind == IrNodeKind::Code) {
+                if (unreachable) {
+                    removed = true;
+                } else {
+                    unreachable = endsControlFlow(irNode);
+                }
+            } else {
+                unreachable = false;
+            }
 
-                const Instruction* incrementInstruction = nullptr;               
-                std::vector<InstructionOperandRoot> incrementOperandRoots;
+            if (!removed) {
+                if (count != i) {
+                    irNodes[count] = std::move(irNode);
+                }
+                ++count;
+            }
+        }
 
-                if (rangeStep->value == Int128(1) || rangeStep->value == Int128(-1)) {
-                    if (auto destOperand = createOperandFromExpression(reducedCounter, true)) {
-                        const auto op = rangeStep->value.isPositive() ? UnaryOperatorKind::PreIncrement : UnaryOperatorKind::PreDecrement; 
-                        incrementOperandRoots.reserve(1);
-                        incrementOperandRoots.push_back(InstructionOperandRoot(reducedCounter, std::move(destOperand)));
-                        incrementInstruction = builtins.selectInstruction(InstructionType(op), modeFlags, incrementOperandRoots);
-                    }
+        irNodes.erase(irNodes.begin() + count, irNodes.end());
+        return true;
+    }
 
-                    if (incrementInstruction) {
-                        if ((rangeStep->value.isPositive() && rangeStart->value > rangeEnd->value)
-                        || (rangeStep->value.isNegative() && rangeStart->value < rangeEnd->value)) {
-                            break;
-                        }
+    bool Compiler::removeRedundantJumpIr() {
+        std::size_t count = 0;
 
-                        if ((rangeStep->value.isPositive() && rangeEnd->value == counterBuiltinIntegerType->max)
-                        || (rangeStep->value.isNegative() && rangeEnd->value == Int128(1))) {
-                            if (const auto zeroFlag = platform->getZeroFlag()) {
-                                const auto& affectedFlags = incrementInstruction->options.affectedFlags;
-                                if (std::find(affectedFlags.begin(), affectedFlags.end(), zeroFlag) != affectedFlags.end()) {
-                                    conditionNegated = true;
-                                    reducedCondition = expressionPool.add(resolveDefinitionExpression(zeroFlag, {}, statement->location));
+        // Remove redundant jump if the destination label is immediately after this.
+        // (Also handle a checking multiple labels when defined with no code between)
+        // Nodes are compacted in place, so this is a single linear pass regardless of how many are removed.
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            auto& irNode = irNodes[i];
+            bool removed = false;
+
+            if (const auto code = irNode.tryGet<IrNode::Code>()) {
+                const auto& instruction = code->instruction;
+
+                if (const auto branchKind = instruction->signature.type.tryGet<BranchKind>()) {
+                    if (*branchKind == BranchKind::Goto) {
+                        const auto& patterns = instruction->signature.operandPatterns;
+
+                        if (patterns.size() >= 2 && patterns[1]->kind == InstructionOperandPatternKind::IntegerRange) {
+                            if (const auto resolvedIdentifier = code->operandRoots[1].expression->tryGet<Expression::ResolvedIdentifier>()) {
+                                std::size_t nextIndex = i + 1;
+
+                                while (nextIndex < irNodes.size()) {
+                                    const auto& nextIrNode = irNodes[nextIndex];
+                                    if (const auto nextLabel = nextIrNode.tryGet<IrNode::Label>()) {
+                                        if (resolvedIdentifier->definition == nextLabel->definition) {
+                                            removed = true;
+                                            break;
+                                        }
+                                    } else {
+                                        break;
+                                    }
+
+                                    nextIndex++;
                                 }
                             }
-                            if (!reducedCondition) {
-                                auto comparisonValue = makeFwdUnique<Expression>(
-                                    Expression::IntegerLiteral(Int128(0)),
-                                    reducedSequence->location,
-                                    ExpressionInfo(EvaluationContext::CompileTime,
-                                        makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::IExpr)), reducedSequence->location),
-                                        Qualifiers::None));
-                                auto condition = makeFwdUnique<Expression>(Expression::BinaryOperator(BinaryOperatorKind::NotEqual, reducedCounter->clone(), std::move(comparisonValue)), reducedCounter->location, Optional<ExpressionInfo>());
-                                reducedCondition = expressionPool.add(reduceExpression(condition.get()));
-                            }
-                        } else if (rangeEnd->value >= Int128(0) && rangeEnd->value <= counterBuiltinIntegerType->max) {
-                            auto comparisonValue = makeFwdUnique<Expression>(
-                                Expression::IntegerLiteral(rangeEnd->value + rangeStep->value),
-                                reducedSequence->location,
-                                ExpressionInfo(EvaluationContext::CompileTime,
-                                    makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::IExpr)), reducedSequence->location),
-                                    Qualifiers::None));
-                            auto condition = makeFwdUnique<Expression>(Expression::BinaryOperator(BinaryOperatorKind::NotEqual, reducedCounter->clone(), std::move(comparisonValue)), reducedCounter->location, Optional<ExpressionInfo>());
-                            reducedCondition = expressionPool.add(reduceExpression(condition.get()));
                         }
                     }
                 }
+            }
 
-                if (!reducedCondition) {
-                    report->error("`for` loop range of `" + rangeStart->value.toString()
-                        + "` ..  `" + rangeEnd->value.toString() + "`"
-                        + (rangeStep->value != Int128(1)
-                            ? " by `" + rangeStep->value.toString() + "`"
-                            : "")
-                        + " is not supported.", reducedSequence->location);
-                    break;
+            if (!removed) {
+                if (count != i) {
+                    irNodes[count] = std::move(irNode);
                 }
+                ++count;
+            }
+        }
 
-                if (!incrementInstruction) {
-                    report->error("could not generate increment instruction for " + statement->getDescription().toString(), statement->location);
-                    break;
-                }               
+        irNodes.erase(irNodes.begin() + count, irNodes.end());
+        return true;
+    }
 
-                // TODO: decrement-and-branch optimization if the instruction exists.
+    bool Compiler::mergeConstantIr() {
+        struct Constant {
+            std::size_t nodeIndex;
+            Bank* bank;
+            std::vector<std::uint8_t> data;
+        };
 
-                if (!emitExpressionStatementIr(reducedInitAssignment, reducedInitAssignment->location)) {
-                    report->error("could not generate initial assignment instruction for " + statement->getDescription().toString(), statement->location);
-                    break;
+        std::vector<Constant> constants;
+        std::vector<Bank*> banks;
+        Bank* bank = nullptr;
+
+        // Gather every constant whose bytes are already known, along with the bank it ends up in.
+        // Declarations that are placed in whichever of several banks has room are left alone, since the bank isn't known yet.
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            const auto& irNode = irNodes[i];
+
+            if (const auto pushRelocation = irNode.tryGet<IrNode::PushRelocation>()) {
+                banks.push_back(bank);
+                bank = pushRelocation->placementBanks.size() == 0 ? pushRelocation->bank : nullptr;
+            } else if (irNode.kind == IrNodeKind::PopRelocation) {
+                bank = banks.back();
+                banks.pop_back();
+            } else if (const auto var = irNode.tryGet<IrNode::Var>()) {
+                const auto& varDefinition = var->definition->var;
+                const auto& initializerExpression = varDefinition.initializerExpression;
+
+                if (bank == nullptr
+                || isBankKindWritable(bank->getKind())
+                || (varDefinition.qualifiers & Qualifiers::Const) == Qualifiers::None
+                || varDefinition.addressExpression != nullptr
+                || !varDefinition.storageSize.hasValue()
+                || varDefinition.storageSize.get() == 0
+                || (initializerExpression != nullptr && initializerExpression->info->context == EvaluationContext::LinkTime)) {
+                    continue;
                 }
-                irNodes.addNew(IrNode::Label(beginLabelDefinition), statement->location);
-                emitStatementIr(forStatement.body.get());
-                irNodes.addNew(IrNode::Label(continueLabelDefinition), reducedCondition->location);
-                irNodes.addNew(IrNode::Code(incrementInstruction, std::move(incrementOperandRoots)), reducedCondition->location);
-                if (!emitBranchIr(forStatement.distanceHint, BranchKind::Goto, beginLabelReferenceExpression, nullptr, conditionNegated, reducedCondition, reducedCondition->location)) {
-                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
-                    break;
+
+                std::vector<std::uint8_t> data(varDefinition.storageSize.get());
+                BankWriter writer(data.data(), data.size());
+                if (initializerExpression != nullptr && (!serializeConstantInitializer(initializerExpression.get(), writer) || writer.size() != data.size())) {
+                    continue;
                 }
-                irNodes.addNew(IrNode::Label(endLabelDefinition), reducedCondition->location);
-                break;
+
+                constants.push_back(Constant {i, bank, std::move(data)});
             }
-            case StatementKind::Func: {
-                const auto& funcDeclaration = statement->func;
-                auto definition = currentScope->findLocalMemberDefinition(funcDeclaration.name);
-                auto& funcDefinition = definition->func;
+        }
 
-                if (funcDefinition.inlined) {
-                    //report->error("TODO: `inline func`", statement->location);
-                    break;
-                } else {
-                    emitFunctionIr(definition, statement->location);
-                }
-                break;
+        // Sorting by the reversed bytes puts each constant right before the ones that end with it.
+        // Identical constants sort latest first, so that the first one declared is the one that keeps its bytes.
+        std::vector<std::size_t> order(constants.size());
+        for (std::size_t i = 0; i != order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            const auto& left = constants[a];
+            const auto& right = constants[b];
+            if (left.bank != right.bank) {
+                return std::less<const Bank*>()(left.bank, right.bank);
             }
-            case StatementKind::If: {
-                const auto& ifStatement = statement->if_;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                    break;
+            if (std::lexicographical_compare(left.data.rbegin(), left.data.rend(), right.data.rbegin(), right.data.rend())) {
+                return true;
+            }
+            if (std::lexicographical_compare(right.data.rbegin(), right.data.rend(), left.data.rbegin(), left.data.rend())) {
+                return false;
+            }
+            return left.nodeIndex > right.nodeIndex;
+        });
+
+        // Each constant that is the tail of the next one in order shares the bytes of whichever constant that one is stored in.
+        // Constants with an alignment keep their own bytes, because the offset they'd land at isn't known until placement.
+        // So do tables that must stay within a page, since the middle of another constant could cross one.
+        std::vector<std::size_t> hosts(constants.size());
+        std::vector<bool> removedNodes(irNodes.size());
+        for (std::size_t i = order.size(); i-- != 0;) {
+            const auto index = order[i];
+            hosts[index] = index;
+
+            if (i + 1 != order.size()) {
+                const auto& constant = constants[index];
+                const auto& next = constants[order[i + 1]];
+                const auto definition = irNodes[constant.nodeIndex].var.definition;
+
+                if (constant.bank == next.bank
+                && definition->var.alignment <= 1
+                && pageLocalDefinitions.find(definition) == pageLocalDefinitions.end()
+                && constant.data.size() <= next.data.size()
+                && std::equal(constant.data.rbegin(), constant.data.rend(), next.data.rbegin())) {
+                    const auto host = hosts[order[i + 1]];
+                    hosts[index] = host;
+                    constantAliases[irNodes[constants[host].nodeIndex].var.definition].push_back(
+                        std::make_pair(definition, constants[host].data.size() - constant.data.size()));
+                    removedNodes[constant.nodeIndex] = true;
                 }
+            }
+        }
 
-                const auto reducedCondition = expressionPool.add(reduceExpression(ifStatement.condition.get()));
-                if (!reducedCondition) {
-                    break;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            if (!removedNodes[i]) {
+                if (count != i) {
+                    irNodes[count] = std::move(irNodes[i]);
                 }
+                ++count;
+            }
+        }
 
-                if (const auto booleanLiteral = reducedCondition->tryGet<Expression::BooleanLiteral>()) {
-                    if (booleanLiteral->value) {
-                        emitStatementIr(ifStatement.body.get());
-                    } else {
-                        if (ifStatement.alternative) {
-                            emitStatementIr(ifStatement.alternative.get());
-                        }
-                    }
+        irNodes.erase(irNodes.begin() + count, irNodes.end());
+        return true;
+    }
 
-                    break;
-                }
+    bool Compiler::writeCodeIr(Report* writeReport, Bank* bank, const IrNode* irNode, ArrayView<InstructionOperandRoot> operandRoots, std::vector<std::vector<const InstructionOperand*>>& captureLists) const {
+        const auto& instruction = irNode->code.instruction;
 
-                const auto endLabelDefinition = createAnonymousLabelDefinition("$endif"_sv);
-                const auto endLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(endLabelDefinition, {}, statement->location));
-                const auto elseLabelDefinition = createAnonymousLabelDefinition("$else"_sv);
-                const auto elseLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(elseLabelDefinition, {}, statement->location));
+        if (instruction->signature.extract(operandRoots, captureLists)) {
+            const auto size = instruction->encoding->calculateSize(instruction->options, captureLists);
+            const auto data = bank->getWritableData(writeReport, "code"_sv, irNode, irNode->location, size);
+            if (data == nullptr) {
+                return false;
+            }
 
-                if (!emitBranchIr(ifStatement.distanceHint, BranchKind::Goto, elseLabelReferenceExpression, nullptr, true, reducedCondition, statement->location)) {
-                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
-                    break;
-                }
+            BankWriter writer(data, size);
+            instruction->encoding->write(writeReport, bank, writer, instruction->options, captureLists, irNode->location);
+            return finishBankWrite(writeReport, bank, writer, "code"_sv, irNode->location);
+        } else {
+            writeReport->error("failed to extract instruction capture list during generation pass", irNode->location, ReportErrorFlags::InternalError);
+            return false;
+        }
+    }
 
-                emitStatementIr(ifStatement.body.get());
-                if (ifStatement.alternative) {
-                    if (!emitBranchIr(ifStatement.distanceHint, BranchKind::Goto, endLabelReferenceExpression, nullptr, false, nullptr, statement->location)) {
-                        report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
-                        break;
-                    }
-                    irNodes.addNew(IrNode::Label(elseLabelDefinition), statement->location);
-                    emitStatementIr(ifStatement.alternative.get());
-                } else {
-                    irNodes.addNew(IrNode::Label(elseLabelDefinition), statement->location);
-                }
-                irNodes.addNew(IrNode::Label(endLabelDefinition), statement->location);
-                break;
+    bool Compiler::writeVarIr(const IrNode* irNode) {
+        const auto& varDefinition = irNode->var.definition->var;
+
+        FwdUniquePtr<const Expression> tempExpression;
+        const auto hasInitializer = varDefinition.initializerExpression.get() != nullptr;
+        const Expression* finalInitializerExpression = varDefinition.initializerExpression.get();
+
+        if (hasInitializer && varDefinition.initializerExpression->info->context == EvaluationContext::LinkTime) {
+            if (auto reducedExpression = reduceExpression(varDefinition.initializerExpression.get())) {
+                tempExpression = createConvertedExpression(reducedExpression.get(), varDefinition.resolvedType);
+                finalInitializerExpression = tempExpression.get();
             }
-            case StatementKind::In: {
-                const auto& inStatement = statement->in;
-                bankStack.push_back(currentBank);
+        }
 
-                const auto result = handleInStatement(inStatement.pieces, inStatement.dest.get(), statement->location);
-                if (result.first) {
-                    irNodes.addNew(IrNode::PushRelocation(currentBank, result.second), statement->location);
-                    emitStatementIr(inStatement.body.get());
-                    irNodes.addNew(IrNode::PopRelocation(), statement->location);
-                }
+        const auto size = varDefinition.storageSize.get();
+        const auto data = currentBank->getWritableData(report, "constant data"_sv, irNode, irNode->location, size);
+        if (data == nullptr) {
+            return false;
+        }
 
-                currentBank = bankStack.back();
-                bankStack.pop_back();
-                break;
+        BankWriter writer(data, size);
+
+        if (hasInitializer) {
+            if (!finalInitializerExpression || !serializeConstantInitializer(finalInitializerExpression, writer)) {
+                report->error("constant initializer could not be resolved at link-time", irNode->location, ReportErrorFlags::Fatal);
+                return false;
             }
-            case StatementKind::InlineFor: {
-                const auto& inlineForStatement = statement->inlineFor;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                    break;
-                }
+        } else {
+            for (std::size_t i = 0; i != size; ++i) {
+                writer.push_back(0);
+            }
+        }
 
-                const auto oldContinueLabel = continueLabel;
-                const auto oldBreakLabel = breakLabel;
-                const auto onExit = makeScopeGuard([&]() {
-                    continueLabel = oldContinueLabel;
-                    breakLabel = oldBreakLabel;
-                });
+        return finishBankWrite(report, currentBank, writer, "constant data"_sv, irNode->location);
+    }
 
-                auto reducedSequence = reduceExpression(inlineForStatement.sequence.get());
-                if (reducedSequence == nullptr) {
+    bool Compiler::finishBankWrite(Report* writeReport, Bank* bank, const BankWriter& writer, StringView description, SourceLocation location) const {
+        if (writer.size() > writer.getCapacity()) {
+            writeReport->error(description.toString() + " wrote " + std::to_string(writer.size())
+                + " byte(s), but only reserved " + std::to_string(writer.getCapacity()) + " byte(s)",
+                location, ReportErrorFlags::Fatal | ReportErrorFlags::InternalError);
+            return false;
+        }
+
+        bank->setRelativePosition(bank->getRelativePosition() + writer.getCapacity());
+        return true;
+    }
+
+    Bank* Compiler::choosePlacementBank(const IrNode* irNode, std::vector<std::vector<const InstructionOperand*>>& captureLists) {
+        const auto& banks = irNode->pushRelocation.placementBanks;
+
+        struct PlacedItem {
+            std::size_t size;
+            std::size_t alignment;
+        };
+
+        std::vector<PlacedItem> items;
+        std::vector<const Definition*> labels;
+        std::vector<const Definition*> references;
+
+        // Gather everything relocated directly by this node. Nested relocations are placed separately, so they're skipped.
+        std::size_t depth = 0;
+        for (auto node = irNode + 1; node != irNodes.data() + irNodes.size(); ++node) {
+            if (node->kind == IrNodeKind::PushRelocation) {
+                ++depth;
+            } else if (node->kind == IrNodeKind::PopRelocation) {
+                if (depth == 0) {
                     break;
                 }
+                --depth;
+            } else if (depth == 0) {
+                if (const auto label = node->tryGet<IrNode::Label>()) {
+                    labels.push_back(label->definition);
+                } else if (const auto code = node->tryGet<IrNode::Code>()) {
+                    const auto& instruction = code->instruction;
+                    if (instruction->signature.extract(code->operandRoots, captureLists)) {
+                        items.push_back(PlacedItem {instruction->encoding->calculateSize(instruction->options, captureLists), 1});
+                    }
+
+                    for (const auto& operandRoot : code->operandRoots) {
+                        if (operandRoot.expression != nullptr) {
+                            if (const auto resolvedIdentifier = operandRoot.expression->tryGet<Expression::ResolvedIdentifier>()) {
+                                if (resolvedIdentifier->definition->kind == DefinitionKind::Func) {
+                                    references.push_back(resolvedIdentifier->definition);
+                                }
+                            }
+                        }
+                    }
+                } else if (const auto var = node->tryGet<IrNode::Var>()) {
+                    const auto& varDefinition = var->definition->var;
+                    if (varDefinition.addressExpression == nullptr) {
+                        items.push_back(PlacedItem {varDefinition.storageSize.get(), varDefinition.alignment != 0 ? varDefinition.alignment : 1});
+                    }
+                }
+            }
+        }
 
-                const auto length = tryGetSequenceLiteralLength(reducedSequence.get());
-                if (!length.hasValue()) {
-                    report->error("source for array comprehension must be a valid compile-time sequence", statement->location);
-                    break;
+        // Prefer the bank that has the most calls to and from this code, so that related code stays together.
+        // Otherwise, prefer the bank it fits most snugly in, to leave bigger gaps for bigger things.
+        Bank* bestBank = nullptr;
+        std::size_t bestAffinity = 0;
+        std::size_t bestRemaining = 0;
+        std::size_t totalSize = 0;
+
+        for (const auto bank : banks) {
+            const auto start = bank->getRelativePosition();
+            const auto origin = bank->getAddress().absolutePosition;
+            auto position = start;
+
+            for (const auto& item : items) {
+                if (item.alignment > 1 && origin.hasValue()) {
+                    const auto absolutePosition = origin.get() - start + position;
+                    position += (item.alignment - absolutePosition % item.alignment) % item.alignment;
                 }
+                position += item.size;
+            }
 
-                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), statement, currentScope));
-                
-                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);
-                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
+            totalSize = std::max(totalSize, position - start);
 
-                breakLabel = endLabelDefinition;
+            if (!bank->isRangeAvailable(start, position - start)) {
+                continue;
+            }
 
-                irNodes.addNew(IrNode::Label(beginLabelDefinition), statement->location);
+            std::size_t affinity = 0;
+            for (const auto definition : references) {
+                if (const auto address = definition->func.address.tryGet()) {
+                    affinity += address->bank == bank ? 1 : 0;
+                }
+            }
+            for (const auto definition : labels) {
+                const auto match = placementReferenceBanks.find(definition);
+                if (match != placementReferenceBanks.end()) {
+                    affinity += static_cast<std::size_t>(std::count(match->second.begin(), match->second.end(), bank));
+                }
+            }
 
-                for (std::size_t i = 0; i != *length; ++i) {
-                    enterInlineSite(registeredInlineSites.addNew());
-                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), statement, currentScope));
+            const auto remaining = bank->getCapacity() - position;
+            if (bestBank == nullptr || affinity > bestAffinity || (affinity == bestAffinity && remaining < bestRemaining)) {
+                bestBank = bank;
+                bestAffinity = affinity;
+                bestRemaining = remaining;
+            }
+        }
 
-                    const auto continueLabelDefinition = createAnonymousLabelDefinition("$continue"_sv);
+        if (bestBank == nullptr) {
+            std::string bankNames;
+            for (const auto bank : banks) {
+                bankNames += (bankNames.empty() ? "`" : ", `") + bank->getName().toString() + "`";
+            }
+            report->error("declaration needs " + std::to_string(totalSize) + " byte(s), which doesn't fit in the remaining space of any of the banks " + bankNames, irNode->location, ReportErrorFlags::Fatal);
+            return nullptr;
+        }
 
-                    continueLabel = continueLabelDefinition;
-                    const auto body = inlineForStatement.body.get();
+        for (const auto definition : references) {
+            if (!definition->func.address.hasValue()) {
+                placementReferenceBanks[definition].push_back(bestBank);
+            }
+        }
 
-                    bool valid = reserveDefinitions(body) && resolveDefinitionTypes() && reserveStorage(body);
+        return bestBank;
+    }
 
-                    if (valid) {
-                        auto tempDeclaration = statementPool.addNew(Statement::InternalDeclaration(), statement->location);
-                        auto tempDefinition = currentScope->createDefinition(report, Definition::Let({}, nullptr, nullptr), inlineForStatement.name, tempDeclaration);
-                        auto& tempLetDefinition = tempDefinition->let;
+    void Compiler::findIndexedTables() {
+        if (!optimizationOptions.isPassEnabled(IrPassKind::AvoidPageCrossing) || !platform->hasPageCrossingPenalty()) {
+            return;
+        }
 
-                        auto sourceItem = getSequenceLiteralItem(reducedSequence.get(), i);
-                        tempLetDefinition.expression = sourceItem.get();
+        // A constant that is read at a register offset is a table.
+        for (const auto& irNode : irNodes) {
+            if (const auto code = irNode.tryGet<IrNode::Code>()) {
+                for (const auto& operandRoot : code->operandRoots) {
+                    if (operandRoot.expression == nullptr || operandRoot.operand->kind != InstructionOperandKind::Index) {
+                        continue;
+                    }
 
-                        valid = emitStatementIr(body);
+                    if (const auto binaryOperator = operandRoot.expression->tryGet<Expression::BinaryOperator>()) {
+                        if (const auto resolvedIdentifier = binaryOperator->left->tryGet<Expression::ResolvedIdentifier>()) {
+                            const auto definition = resolvedIdentifier->definition;
+                            if (definition->kind == DefinitionKind::Var
+                            && (definition->var.qualifiers & Qualifiers::Const) != Qualifiers::None
+                            && definition->var.addressExpression == nullptr) {
+                                pageLocalDefinitions.insert(definition);
+                            }
+                        }
                     }
+                }
+            }
+        }
+    }
+
+    void Compiler::findPageRegions() {
+        pageRegions.clear();
 
-                    irNodes.addNew(IrNode::Label(continueLabelDefinition), statement->location);
+        const auto automatic = optimizationOptions.isPassEnabled(IrPassKind::AvoidPageCrossing) && platform->hasPageCrossingPenalty();
+        if (!automatic && pageLocalFuncEnds.empty()) {
+            return;
+        }
 
-                    exitScope();
-                    exitInlineSite();
+        std::unordered_map<const Definition*, std::size_t> labelIndices;
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            const auto& irNode = irNodes[i];
 
-                    if (!valid) {
-                        break;
+            if (const auto label = irNode.tryGet<IrNode::Label>()) {
+                labelIndices[label->definition] = i;
+
+                const auto match = pageLocalFuncEnds.find(label->definition);
+                if (match != pageLocalFuncEnds.end()) {
+                    const auto start = labelIndices.find(match->second);
+                    if (start != labelIndices.end()) {
+                        pageRegions.push_back(PageRegion(PageRegionKind::Func, start->second, i));
                     }
                 }
+            } else if (const auto code = irNode.tryGet<IrNode::Code>()) {
+                if (!automatic) {
+                    continue;
+                }
 
-                irNodes.addNew(IrNode::Label(endLabelDefinition), statement->location);
+                const auto conditional = std::any_of(code->operandRoots.begin(), code->operandRoots.end(),
+                    [](const InstructionOperandRoot& operandRoot) {
+                        return operandRoot.operand->kind == InstructionOperandKind::Boolean;
+                    });
 
-                exitScope();
-                break;
-            }
-            case StatementKind::ImportReference: break;
-            case StatementKind::InternalDeclaration: break;
-            case StatementKind::Branch: {
-                const auto& branch = statement->branch;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                    break;
+                // A conditional branch back to an earlier label is the bottom of a loop.
+                if (!conditional || code->instruction->signature.type.kind != InstructionTypeKind::BranchKind) {
+                    continue;
                 }
-
-                const Expression* reducedDestination = nullptr;
-                if (branch.destination) {
-                    reducedDestination = expressionPool.add(reduceExpression(branch.destination.get()));
-                    if (!reducedDestination) {
-                        break;
+                for (const auto& operandRoot : code->operandRoots) {
+                    if (operandRoot.expression == nullptr) {
+                        continue;
                     }
-                }
 
-                const Expression* reducedReturnValue = nullptr;
-                if (branch.returnValue) {
-                    reducedReturnValue = expressionPool.add(reduceExpression(branch.returnValue.get()));
-                    if (!reducedReturnValue) {
-                        break;
+                    if (const auto resolvedIdentifier = operandRoot.expression->tryGet<Expression::ResolvedIdentifier>()) {
+                        const auto match = labelIndices.find(resolvedIdentifier->definition);
+                        if (match != labelIndices.end()) {
+                            pageRegions.push_back(PageRegion(PageRegionKind::Loop, match->second, i));
+                        }
                     }
                 }
+            }
+        }
 
-                const Expression* reducedCondition = nullptr;
-                if (branch.condition) {
-                    reducedCondition = expressionPool.add(reduceExpression(branch.condition.get()));
-                    if (!reducedCondition) {
-                        break;
-                    }
-                }            
+        std::stable_sort(pageRegions.begin(), pageRegions.end(), [](const PageRegion& a, const PageRegion& b) {
+            return a.startIndex < b.startIndex;
+        });
+    }
 
-                if (!emitBranchIr(branch.distanceHint, branch.kind, reducedDestination, reducedReturnValue, false, reducedCondition, statement->location)) {
-                    report->error("branch instruction could not be generated", statement->location);
-                }
-                break;
-            }
-            case StatementKind::Label: {
-                const auto& labelDeclaration = statement->label;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                    break;
-                }
+    std::size_t Compiler::choosePageRegionPadding(std::size_t nodeIndex, std::vector<std::vector<const InstructionOperand*>>& captureLists) {
+        if (!currentBank->getOrigin().hasValue()) {
+            return 0;
+        }
+
+        struct PlacedRegion {
+            PageRegionKind kind;
+            std::size_t endIndex;
+            std::size_t start;
+            // The first byte past the region that has to share its page. For a loop, this is the address after the branch, which is what the branch is taken from.
+            std::size_t end;
+        };
+
+        // Padding only goes in front of this label, so look ahead as far as the next place that could be padded on its own.
+        // Regions that start before that have to end before it too. A relocation or data cuts the code off, and anything still open is dropped.
+        std::vector<PlacedRegion> regions;
+        auto nextRegion = std::lower_bound(pageRegions.begin(), pageRegions.end(), nodeIndex, [](const PageRegion& region, std::size_t index) {
+            return region.startIndex < index;
+        });
+        auto openUntil = nodeIndex;
+        std::size_t offset = 0;
+        bool flowEnded = false;
+
+        for (auto i = nodeIndex; i != irNodes.size(); ++i) {
+            const auto& irNode = irNodes[i];
 
-                irNodes.addNew(IrNode::Label(currentScope->findLocalMemberDefinition(labelDeclaration.name)), statement->location);
+            if (irNode.kind != IrNodeKind::Label && irNode.kind != IrNodeKind::Code) {
                 break;
             }
-            case StatementKind::Let: break;
-            case StatementKind::Namespace: {
-                const auto& namespaceDeclaration = statement->namespace_;
-                enterScope(findStatementScope(namespaceDeclaration.body.get()));
-                emitStatementIr(namespaceDeclaration.body.get());
-                exitScope();
+            if (irNode.kind == IrNodeKind::Label && flowEnded && i > openUntil) {
                 break;
             }
-            case StatementKind::Struct: break;
-            case StatementKind::TypeAlias: break;
-            case StatementKind::Var: {
-                const auto& varDeclaration = statement->var;
-                for (const auto& name : varDeclaration.names) {
-                    auto definition = currentScope->findLocalMemberDefinition(name);
-                    auto& varDefinition = definition->var;
 
-                    if ((varDefinition.qualifiers & Qualifiers::Extern) == Qualifiers::None) {
-                        if (currentBank == nullptr && varDefinition.addressExpression == nullptr) {
-                            report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                            break;
-                        }
+            for (; nextRegion != pageRegions.end() && nextRegion->startIndex == i; ++nextRegion) {
+                regions.push_back(PlacedRegion {nextRegion->kind, nextRegion->endIndex, offset, 0});
+                openUntil = std::max(openUntil, nextRegion->endIndex);
+            }
 
-                        if (currentBank != nullptr && isBankKindStored(currentBank->getKind())) {
-                            if (varDefinition.resolvedType && varDefinition.resolvedType->kind == TypeExpressionKind::DesignatedStorage && varDefinition.initializerExpression != nullptr) {
-                                const auto destExpression = expressionPool.add(resolveDefinitionExpression(definition, {}, statement->location));
-                                emitAssignmentExpressionIr(destExpression, varDefinition.initializerExpression.get(), statement->location);
-                            } else if (varDefinition.enclosingFunction == nullptr) {
-                                irNodes.addNew(IrNode::Var(definition), statement->location);
+            if (const auto code = irNode.tryGet<IrNode::Code>()) {
+                const auto& instruction = code->instruction;
+                if (instruction->signature.extract(code->operandRoots, captureLists)) {
+                    offset += instruction->encoding->calculateSize(instruction->options, captureLists);
+                }
+                flowEnded = endsControlFlow(irNode);
+            }
 
-                                for (auto& nestedConstant : varDefinition.nestedConstants) {
-                                    irNodes.addNew(IrNode::Var(nestedConstant), statement->location);
-                                }
-                            }
-                        }
-                    }
+            for (auto& region : regions) {
+                if (region.endIndex == i) {
+                    region.end = region.kind == PageRegionKind::Loop ? offset + 1 : offset;
                 }
-                break;
             }
-            case StatementKind::While: {
-                const auto& whileStatement = statement->while_;
-                if (currentBank == nullptr) {
-                    report->error(statement->getDescription().toString() + " must be inside an `in` statement", statement->location);
-                    break;
+        }
+
+        const auto start = currentBank->getAddress().absolutePosition.get();
+        const auto countCrossings = [&](std::size_t padding) {
+            std::size_t count = 0;
+            for (const auto& region : regions) {
+                if (region.end != 0 && (start + padding + region.start) / PageSize != (start + padding + region.end - 1) / PageSize) {
+                    ++count;
                 }
+            }
+            return count;
+        };
 
-                const auto oldContinueLabel = continueLabel;
-                const auto oldBreakLabel = breakLabel;
-                const auto onExit = makeScopeGuard([&]() {
-                    continueLabel = oldContinueLabel;
-                    breakLabel = oldBreakLabel;
-                });
+        // Try each padding that would start one of the crossing regions at the top of a page, and keep whichever leaves the fewest crossings.
+        std::size_t bestPadding = 0;
+        auto bestCrossings = countCrossings(0);
+        for (const auto& region : regions) {
+            if (region.end == 0 || region.end - region.start > PageSize) {
+                continue;
+            }
 
-                const auto reducedCondition = expressionPool.add(reduceExpression(whileStatement.condition.get()));
-                if (!reducedCondition) {
-                    report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
-                    break;
+            const auto padding = (PageSize - (start + region.start) % PageSize) % PageSize;
+            const auto crossings = countCrossings(padding);
+            if (crossings < bestCrossings || (crossings == bestCrossings && padding < bestPadding)) {
+                if (currentBank->isRangeAvailable(currentBank->getRelativePosition(), padding + offset)) {
+                    bestPadding = padding;
+                    bestCrossings = crossings;
                 }
+            }
+        }
 
-                const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);
-                const auto beginLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(beginLabelDefinition, {}, statement->location));
-                const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
-                const auto endLabelReferenceExpression = expressionPool.add(resolveDefinitionExpression(endLabelDefinition, {}, statement->location));
-
-                continueLabel = beginLabelDefinition;
-                breakLabel = endLabelDefinition;
+        for (const auto& region : regions) {
+            if (region.end == 0) {
+                continue;
+            }
 
-                irNodes.addNew(IrNode::Label(beginLabelDefinition), statement->location);
-                if (!emitBranchIr(whileStatement.distanceHint, BranchKind::Goto, endLabelReferenceExpression, nullptr, true, reducedCondition, statement->location)) {
-                    break;
-                }
-                emitStatementIr(whileStatement.body.get());
-                if (!emitBranchIr(whileStatement.distanceHint, BranchKind::Goto, beginLabelReferenceExpression, nullptr, false, nullptr, statement->location)) {
-                    break;
+            // Regions that still cross are counted once everything is placed, along with those that were never up for padding.
+            const auto crossedBefore = (start + region.start) / PageSize != (start + region.end - 1) / PageSize;
+            const auto crossedAfter = (start + bestPadding + region.start) / PageSize != (start + bestPadding + region.end - 1) / PageSize;
+            if (crossedBefore && !crossedAfter) {
+                switch (region.kind) {
+                    case PageRegionKind::Loop: ++pageCrossingStatistics.loopCount; break;
+                    case PageRegionKind::Func: ++pageCrossingStatistics.funcCount; break;
                 }
-                irNodes.addNew(IrNode::Label(endLabelDefinition), statement->location);
-                break;
             }
-            default: std::abort(); return false;
         }
 
-        return statement == program.get() ? report->validate() : report->alive();
+        pageCrossingStatistics.paddingSize += bestPadding;
+        return bestPadding;
     }
 
     bool Compiler::generateCode() {
@@ -7030,19 +9169,39 @@ namespace wiz {
         }
         
         std::vector<std::vector<const InstructionOperand*>> captureLists;
-        std::set<std::size_t> irNodeIndexesToRemove;
+
+        fixups.clear();
+
+        // Code can only be padded where nothing runs into it, which is after a jump, a return or data.
+        // The first code in a bank, and code at an explicit address, is left where it is, but still counts if it crosses a page.
+        findPageRegions();
+        std::unordered_map<const Bank*, bool> pagePaddingAllowed;
+        // Where each page region's last node ended up, by node index, to count the regions that still cross a page.
+        std::unordered_map<std::size_t, Optional<std::size_t>> pageRegionEnds;
+        for (const auto& region : pageRegions) {
+            pageRegionEnds[region.endIndex] = Optional<std::size_t>();
+        }
 
         // First pass: calculate data/instruction sizes, assign labels.
-        for (std::size_t i = 0; i != irNodes.size(); ++i) {
-            const auto& irNode = irNodes[i];
-            switch (irNode->kind) {
+        // Anything that doesn't depend on link-time addresses is written immediately, everything else is recorded as a fixup.
+        for (const auto& irNode : irNodes) {
+            switch (irNode.kind) {
                 case IrNodeKind::PushRelocation: {
-                    const auto& pushRelocation = irNode->pushRelocation;
+                    const auto& pushRelocation = irNode.pushRelocation;
                     bankStack.push_back(currentBank);
                     currentBank = pushRelocation.bank;
 
+                    if (pushRelocation.placementBanks.size() != 0) {
+                        if (const auto bank = choosePlacementBank(&irNode, captureLists)) {
+                            currentBank = bank;
+                        } else {
+                            return false;
+                        }
+                    }
+
                     if (const auto address = pushRelocation.address.tryGet()) {
-                        currentBank->absoluteSeek(report, *address, irNode->location);
+                        currentBank->absoluteSeek(report, *address, irNode.location);
+                        pagePaddingAllowed[currentBank] = false;
                     }
                     break;
                 }
@@ -7052,60 +9211,48 @@ namespace wiz {
                     break;
                 }
                 case IrNodeKind::Label: {
-                    const auto& label = irNode->label;
+                    const auto& label = irNode.label;
                     auto& funcDefinition = label.definition->func;
+
+                    if (!pageRegions.empty() && pagePaddingAllowed[currentBank]) {
+                        const auto padding = choosePageRegionPadding(static_cast<std::size_t>(&irNode - irNodes.data()), captureLists);
+                        if (padding != 0) {
+                            currentBank->absoluteSeek(report, currentBank->getAddress().absolutePosition.get() + padding, irNode.location);
+                        }
+                    }
+
                     funcDefinition.address = currentBank->getAddress();                    
                     break;
                 }
                 case IrNodeKind::Code: {
-                    const auto& code = irNode->code;
+                    const auto& code = irNode.code;
                     const auto& instruction = code.instruction;
                     if (instruction->signature.extract(code.operandRoots, captureLists)) {
-                        bool removed = false;
-
-                        // Slight optimization: remove redundant jump if the destination label is immediately after this.
-                        // (Also handle a checking multiple labels when defined with no code between)
-                        // TODO: maybe move this optimization till the very end?
-                        // There's some cases this can't catch, but doing this after addresses are calculated will make for a mess.
-                        if (const auto branchKind = instruction->signature.type.tryGet<BranchKind>()) {
-                            if (*branchKind == BranchKind::Goto) {
-                                const auto& patterns = instruction->signature.operandPatterns;
-
-                                if (patterns.size() >= 2 && patterns[1]->kind == InstructionOperandPatternKind::IntegerRange) {
-                                    if (const auto resolvedIdentifier = code.operandRoots[1].expression->tryGet<Expression::ResolvedIdentifier>()) {
-                                        std::size_t nextIndex = i + 1;
-
-                                        while (nextIndex < irNodes.size()) {
-                                            const auto& nextIrNode = irNodes[nextIndex];
-                                            if (const auto nextLabel = nextIrNode->tryGet<IrNode::Label>()) {
-                                                if (resolvedIdentifier->definition == nextLabel->definition) {
-                                                    removed = true;
-                                                    break;
-                                                }
-                                            } else {
-                                                break;
-                                            }
-
-                                            nextIndex++;
-                                        }
-                                    }
-                                }
-                            }
+                        const auto size = instruction->encoding->calculateSize(instruction->options, captureLists);
+                        const auto relativePosition = currentBank->getRelativePosition();
+                        if (!currentBank->reserveRom(report, "code"_sv, &irNode, irNode.location, size)) {
+                            break;
                         }
 
-                        if (removed) {
-                            irNodeIndexesToRemove.insert(i);
+                        const auto resolved = std::none_of(code.operandRoots.begin(), code.operandRoots.end(),
+                            [](const InstructionOperandRoot& operandRoot) { return operandRoot.operand->hasPlaceholder(); });
+
+                        if (resolved) {
+                            // The encoding might depend on the instruction's address, so rewind to where it starts.
+                            currentBank->setRelativePosition(relativePosition);
+                            writeCodeIr(report, currentBank, &irNode, code.operandRoots, captureLists);
                         } else {
-                            const auto size = instruction->encoding->calculateSize(instruction->options, captureLists);
-                            currentBank->reserveRom(report, "code"_sv, irNode.get(), irNode->location, size);
+                            fixups.push_back(Fixup(FixupKind::Code, &irNode, currentBank, relativePosition));
                         }
                     } else {
-                        report->error("failed to extract instruction capture list during instruction selection pass", irNode->location, ReportErrorFlags::InternalError);
+                        report->error("failed to extract instruction capture list during instruction selection pass", irNode.location, ReportErrorFlags::InternalError);
                     }
+
+                    pagePaddingAllowed[currentBank] = endsControlFlow(irNode);
                     break;
                 }
                 case IrNodeKind::Var: {
-                    const auto& var = irNode->var;
+                    const auto& var = irNode.var;
                     auto& varDefinition = var.definition->var;
 
                     Optional<std::size_t> oldPosition;
@@ -7115,7 +9262,7 @@ namespace wiz {
                         const auto address = resolveExplicitAddressExpression(varDefinition.addressExpression);
                         if (address.hasValue()) {
                             oldPosition = currentBank->getRelativePosition();
-                            currentBank->absoluteSeek(report, address.get(), irNode->location);
+                            currentBank->absoluteSeek(report, address.get(), irNode.location);
                         } else {
                             break;
                         }
@@ -7126,15 +9273,43 @@ namespace wiz {
                         const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
                         if (alignment > 1) {
                             const auto unalignedAddress = currentBank->getAddress().absolutePosition.get();
-                            currentBank->absoluteSeek(report, (unalignedAddress + alignment - 1) / alignment * alignment, irNode->location);
+                            currentBank->absoluteSeek(report, (unalignedAddress + alignment - 1) / alignment * alignment, irNode.location);
+                        }
+
+                        if (pageLocalDefinitions.find(var.definition) != pageLocalDefinitions.end()) {
+                            keepTableInPage(currentBank, varDefinition.storageSize.get(), irNode.location);
                         }
+                        pagePaddingAllowed[currentBank] = true;
                     }
  
                     varDefinition.address = currentBank->getAddress();
- 
-                    if (!currentBank->reserveRom(report, "constant data"_sv, irNode.get(), irNode->location, varDefinition.storageSize.get())) {
+
+                    // Constants merged into this one point somewhere inside of its bytes.
+                    const auto aliases = constantAliases.find(var.definition);
+                    if (aliases != constantAliases.end()) {
+                        const auto address = varDefinition.address.get();
+                        for (const auto& alias : aliases->second) {
+                            alias.first->var.address = Address(
+                                address.relativePosition.get() + alias.second,
+                                address.absolutePosition.hasValue() ? address.absolutePosition.get() + alias.second : Optional<std::size_t>(),
+                                address.bank);
+                        }
+                    }
+
+                    const auto relativePosition = currentBank->getRelativePosition();
+                    if (!currentBank->reserveRom(report, "constant data"_sv, &irNode, irNode.location, varDefinition.storageSize.get())) {
                         break;
                     }
+
+                    const auto& initializerExpression = varDefinition.initializerExpression;
+                    if (initializerExpression != nullptr && initializerExpression->info->context == EvaluationContext::LinkTime) {
+                        fixups.push_back(Fixup(FixupKind::Var, &irNode, currentBank, relativePosition));
+                    } else {
+                        currentBank->setRelativePosition(relativePosition);
+                        if (!writeVarIr(&irNode)) {
+                            break;
+                        }
+                    }
  
                     if (oldPosition.hasValue()) {
                         currentBank->setRelativePosition(oldPosition.get());
@@ -7143,88 +9318,71 @@ namespace wiz {
                 }
                 default: std::abort(); return false;
             }
-        }
 
-        for (auto it = irNodeIndexesToRemove.rbegin(); it != irNodeIndexesToRemove.rend(); ++it) {
-            irNodes.remove(*it);
+            if (!pageRegionEnds.empty()) {
+                const auto match = pageRegionEnds.find(static_cast<std::size_t>(&irNode - irNodes.data()));
+                if (match != pageRegionEnds.end()) {
+                    match->second = currentBank->getAddress().absolutePosition;
+                }
+            }
         }
 
-        irNodeIndexesToRemove.clear();
-
         if (!report->validate()) {
             return false;
         }
 
-        for (auto& bank : registeredBanks) {
-            bank->rewind();
+        for (const auto& region : pageRegions) {
+            const auto& startAddress = irNodes[region.startIndex].label.definition->func.address;
+            const auto& end = pageRegionEnds[region.endIndex];
+            if (startAddress.hasValue() && startAddress->absolutePosition.hasValue() && end.hasValue()) {
+                // A loop's branch is taken from the address after it, so that has to share the page too.
+                const auto start = startAddress->absolutePosition.get();
+                const auto last = region.kind == PageRegionKind::Loop ? end.get() : end.get() - 1;
+                if (last >= start && start / PageSize != last / PageSize) {
+                    ++pageCrossingStatistics.crossingCount;
+                }
+            }
         }
 
-        std::vector<std::uint8_t> tempBuffer;
         std::vector<FwdUniquePtr<const Expression>> tempExpressions;
-        std::vector<InstructionOperandRoot> tempOperandRoots;
-
-        // Second pass: resolve all link-time expressions, write the instructions into the correct banks.
-        for (const auto& irNode : irNodes) {
-            switch (irNode->kind) {
-                case IrNodeKind::PushRelocation: {
-                    const auto& pushRelocation = irNode->pushRelocation;
-                    bankStack.push_back(currentBank);
-                    currentBank = pushRelocation.bank;
-
-                    if (const auto address = pushRelocation.address.tryGet()) {
-                        currentBank->absoluteSeek(report, *address, irNode->location);
-                    }
-                    break;
-                }
-                case IrNodeKind::PopRelocation: {
-                    currentBank = bankStack.back();
-                    bankStack.pop_back();
-                    break;
-                }
-                case IrNodeKind::Label: {
-                    const auto& label = irNode->label;
-                    Address labelAddress;
-
-                    auto& funcDefinition = label.definition->func;
-                    labelAddress = funcDefinition.address.get();
-
-                    const auto currentBankAddress = currentBank->getAddress();
-                    if (labelAddress != currentBankAddress) {
-                        std::string message = "label `" + label.definition->name.toString() + "` was supposed to be at ";
-
-                        if (labelAddress.absolutePosition.hasValue()) {
-                            message += "absolute address 0x" + Int128(labelAddress.absolutePosition.get()).toString(16);
-                        } else {
-                            message += "relative position " + std::to_string(labelAddress.relativePosition.get());
-                        }
-
-                        message += ", but bank is at ";
-
-                        if (currentBankAddress.absolutePosition.hasValue()) {
-                            message += "absolute address 0x" + Int128(currentBankAddress.absolutePosition.get()).toString(16);
-                        } else {
-                            message += "relative position " + std::to_string(currentBankAddress.relativePosition.get());
-                        }
-
-                        report->error(message, irNode->location, ReportErrorFlags::InternalError);
-                    }
-                    break;
-                }
-                case IrNodeKind::Code: {
+        std::vector<InstructionOperandRoot> resolvedOperandRoots;
+        std::vector<Optional<std::size_t>> resolvedOperandRootOffsets(fixups.size());
+
+        // Each fixup gets its own report, so that messages from every step can be replayed in source order afterward,
+        // no matter which thread wrote the fixup or when.
+        std::vector<Report> fixupReports(fixups.size());
+
+        const auto previousBank = currentBank;
+        const auto sharedReport = report;
+        const auto operandPoolSize = operandPool.size();
+
+        // Second pass: resolve the remaining link-time expressions.
+        // Reducing expressions reads and updates a lot of shared compiler state, so this happens in order on this thread.
+        // Constant data is cheap to serialize once it's reduced, so it's written here too.
+        for (std::size_t fixupIndex = 0; fixupIndex != fixups.size(); ++fixupIndex) {
+            const auto& fixup = fixups[fixupIndex];
+            const auto irNode = fixup.irNode;
+            currentBank = fixup.bank;
+            currentBank->setRelativePosition(fixup.relativePosition);
+            report = &fixupReports[fixupIndex];
+
+            switch (fixup.kind) {
+                case FixupKind::Code: {
                     const auto& code = irNode->code;
-                    const auto& instruction = code.instruction;
-
-                    tempOperandRoots.clear();
-                    tempExpressions.clear();
+                    const auto offset = resolvedOperandRoots.size();
 
                     bool failed = false;
 
                     for (std::size_t i = 0; i != code.operandRoots.size() && !failed; ++i) {
                         const auto& operandRoot = code.operandRoots[i];
-                        if (const auto expression = operandRoot.expression) {
+
+                        // Operands without placeholders were already resolved when they were emitted, so they can be shared as-is.
+                        if (!operandRoot.operand->hasPlaceholder()) {
+                            resolvedOperandRoots.push_back(operandRoot);
+                        } else if (const auto expression = operandRoot.expression) {
                             if (auto reducedExpression = reduceExpression(expression)) {
                                 if (auto operand = createOperandFromExpression(reducedExpression.get(), true)) {
-                                    tempOperandRoots.push_back(InstructionOperandRoot(reducedExpression.get(), std::move(operand)));
+                                    resolvedOperandRoots.push_back(InstructionOperandRoot(reducedExpression.get(), operand));
                                     tempExpressions.push_back(std::move(reducedExpression));
                                 } else {
                                     report->error("failed to create operand for reduced expresion", irNode->location, ReportErrorFlags::InternalError);
@@ -7236,78 +9394,84 @@ namespace wiz {
                                 break;
                             }
                         } else {
-                            tempOperandRoots.push_back(InstructionOperandRoot(nullptr, operandRoot.operand->clone()));
+                            resolvedOperandRoots.push_back(operandRoot);
                         }
                     }
 
                     if (failed) {
-                        break;
-                    }
-
-                    if (instruction->signature.extract(tempOperandRoots, captureLists)) {
-                        tempBuffer.clear();
-                        instruction->encoding->write(report, currentBank, tempBuffer, instruction->options, captureLists, irNode->location);
-                        if (!currentBank->write(report, "code"_sv, irNode.get(), irNode->location, tempBuffer)) {
-                            break;
-                        }
+                        resolvedOperandRoots.resize(offset);
                     } else {
-                        report->error("failed to extract instruction capture list during generation pass", irNode->location, ReportErrorFlags::InternalError);
+                        resolvedOperandRootOffsets[fixupIndex] = offset;
                     }
                     break;
                 }
-                case IrNodeKind::Var: {
-                    const auto& var = irNode->var;
-                    auto& varDefinition = var.definition->var;
+                case FixupKind::Var: {
+                    writeVarIr(irNode);
+                    break;
+                }
+                default: std::abort(); return false;
+            }
+        }
 
-                    Optional<std::size_t> oldPosition;
-                    if (varDefinition.addressExpression != nullptr) {
-                        oldPosition = currentBank->getRelativePosition();
-                        currentBank->setRelativePosition(varDefinition.address.get().relativePosition.get());
+        currentBank = previousBank;
+        report = sharedReport;
+
+        // Third pass: encode the resolved instructions.
+        // Every fixup for a given bank is written by the same task, in order, since encodings can depend on the bank's position.
+        // Match programs are compiled on first use, so that happens here for every instruction before any task starts.
+        // After that, tasks share nothing that they modify, so separate banks are written concurrently.
+        std::vector<std::vector<std::size_t>> bankFixupIndices;
+        std::size_t encodedFixupCount = 0;
+        {
+            std::unordered_map<const Bank*, std::size_t> bankTaskIndices;
+            for (std::size_t fixupIndex = 0; fixupIndex != fixups.size(); ++fixupIndex) {
+                if (resolvedOperandRootOffsets[fixupIndex].hasValue()) {
+                    fixups[fixupIndex].irNode->code.instruction->signature.compileMatchPrograms();
+                    ++encodedFixupCount;
+
+                    const auto bank = fixups[fixupIndex].bank;
+                    const auto match = bankTaskIndices.find(bank);
+                    if (match != bankTaskIndices.end()) {
+                        bankFixupIndices[match->second].push_back(fixupIndex);
                     } else {
-                        // FIXME: natural alignment requirements
-                        const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
-                        if (alignment > 1) {
-                            const auto unalignedAddress = currentBank->getAddress().absolutePosition.get();
-                            currentBank->absoluteSeek(report, (unalignedAddress + alignment - 1) / alignment * alignment, irNode->location);
-                        }
+                        bankTaskIndices[bank] = bankFixupIndices.size();
+                        bankFixupIndices.push_back(std::vector<std::size_t> {fixupIndex});
                     }
+                }
+            }
+        }
 
-                    FwdUniquePtr<const Expression> tempExpression;
-                    const auto hasInitializer = varDefinition.initializerExpression.get() != nullptr;
-                    const Expression* finalInitializerExpression = varDefinition.initializerExpression.get();
-                    
-                    if (hasInitializer && varDefinition.initializerExpression->info->context == EvaluationContext::LinkTime) {
-                        if (auto reducedExpression = reduceExpression(varDefinition.initializerExpression.get())) {
-                             tempExpression = createConvertedExpression(reducedExpression.get(), varDefinition.resolvedType);
-                             finalInitializerExpression = tempExpression.get();
-                        }
-                    }
- 
-                    tempBuffer.clear();
-                    tempBuffer.reserve(varDefinition.storageSize.get());
+        const auto writeBankFixups = [&](std::size_t taskIndex) {
+            std::vector<std::vector<const InstructionOperand*>> taskCaptureLists;
 
-                    if (hasInitializer) {
-                        if (!finalInitializerExpression || !serializeConstantInitializer(finalInitializerExpression, tempBuffer)) {
-                            report->error("constant initializer could not be resolved at link-time", irNode->location, ReportErrorFlags::Fatal);
-                            break;
-                        }
-                    } else {
-                        tempBuffer.resize(varDefinition.storageSize.get());
-                    }
+            for (const auto fixupIndex : bankFixupIndices[taskIndex]) {
+                const auto& fixup = fixups[fixupIndex];
+                const auto irNode = fixup.irNode;
+                const auto operandRoots = ArrayView<InstructionOperandRoot>(
+                    resolvedOperandRoots.data() + resolvedOperandRootOffsets[fixupIndex].get(),
+                    irNode->code.operandRoots.size());
 
-                    if (!currentBank->write(report, "constant data"_sv, irNode.get(), irNode->location, tempBuffer)) {
-                        break;
-                    }
- 
-                    if (oldPosition.hasValue()) {
-                        currentBank->setRelativePosition(oldPosition.get());
-                    }
-                    break;
-                }
-                default: std::abort(); return false;
+                fixup.bank->setRelativePosition(fixup.relativePosition);
+                writeCodeIr(&fixupReports[fixupIndex], fixup.bank, irNode, operandRoots, taskCaptureLists);
+            }
+        };
+
+        // Starting threads costs more than encoding a few fixups, so those are written on this thread.
+        if (encodedFixupCount < MinParallelFixupCount) {
+            for (std::size_t taskIndex = 0; taskIndex != bankFixupIndices.size(); ++taskIndex) {
+                writeBankFixups(taskIndex);
             }
+        } else {
+            parallelFor(bankFixupIndices.size(), writeBankFixups);
+        }
+
+        for (std::size_t fixupIndex = 0; fixupIndex != fixups.size(); ++fixupIndex) {
+            fixupReports[fixupIndex].replay(report);
         }
 
+        // Operands built for fixups are only needed until they're written, so their space can be reused.
+        operandPool.truncate(operandPoolSize);
+
         return report->validate();
     }
 }
\ No newline at end of file
@@ -8,9 +8,12 @@
 #include <cstddef>
 #include <utility>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <wiz/compiler/instruction.h>
 #include <wiz/compiler/builtins.h>
+#include <wiz/compiler/ir_node.h>
+#include <wiz/compiler/optimization.h>
 #include <wiz/utility/string_pool.h>
 #include <wiz/utility/fwd_unique_ptr.h>
 #include <wiz/utility/int128.h>
@@ -18,6 +21,8 @@
 #include <wiz/utility/source_location.h>
 #include <wiz/utility/ptr_pool.h>
 #include <wiz/utility/array_view.h>
+#include <wiz/utility/array_pool.h>
+#include <wiz/utility/object_pool.h>
 
 namespace wiz {
     enum class BranchKind;
@@ -26,13 +31,13 @@ namespace wiz {
     enum class EvaluationContext;
 
     class Bank;
+    class BankWriter;
     class Config;
     class Report;
     class Platform;
     class SymbolTable;
     class ImportManager;
 
-    struct IrNode;
     struct Attribute;
     struct Statement;
     struct Definition;
@@ -40,6 +45,48 @@ namespace wiz {
     struct TypeExpression;
     struct PlatformTestAndBranch;
 
+    // How much room the locals placed in the `#[locals]` bank took up, for reporting with `--stats`.
+    struct LocalStorageStatistics {
+        LocalStorageStatistics() = default;
+
+        LocalStorageStatistics(
+            std::size_t frameCount,
+            std::size_t totalSize,
+            std::size_t usedSize)
+        : frameCount(frameCount),
+        totalSize(totalSize),
+        usedSize(usedSize) {}
+
+        // How many funcs had locals, how many bytes they add up to, and how many bytes they needed once overlapped.
+        std::size_t frameCount = 0;
+        std::size_t totalSize = 0;
+        std::size_t usedSize = 0;
+    };
+
+    // Where a var that could go in the `#[fast]` bank ended up, for reporting with `--stats`.
+    struct FastVariablePlacement {
+        FastVariablePlacement(
+            const Definition* definition,
+            std::size_t score)
+        : definition(definition),
+        score(score) {}
+
+        const Definition* definition;
+        // How often the var is used, either counted in the program with uses inside loops weighted higher, or taken from the profile.
+        std::size_t score;
+    };
+
+    // What was kept from crossing a 256-byte page boundary, and the padding it took, for reporting with `--stats`.
+    struct PageCrossingStatistics {
+        // Each one saves a cycle on every indexed read that would have crossed, or on every taken branch back to the start of the loop.
+        std::size_t tableCount = 0;
+        std::size_t loopCount = 0;
+        std::size_t funcCount = 0;
+        // How many still cross a page, because they're bigger than a page or the padding wouldn't fit.
+        std::size_t crossingCount = 0;
+        std::size_t paddingSize = 0;
+    };
+
     class Compiler {
         public:
             Compiler(
@@ -49,7 +96,9 @@ namespace wiz {
                 Config* config,
                 ImportManager* importManager,
                 Report* report,
-                std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines);
+                const OptimizationOptions& optimizationOptions,
+                std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines,
+                std::unordered_map<std::string, std::size_t> variableProfile);
             ~Compiler();
 
             bool compile();
@@ -60,8 +109,14 @@ namespace wiz {
             std::vector<const Definition*> getRegisteredDefinitions() const;
             const Builtins& getBuiltins() const;
             std::uint32_t getModeFlags() const;
-
-            FwdUniquePtr<InstructionOperand> createOperandFromExpression(const Expression* expression, bool quiet) const;
+            const std::vector<IrPassStatistics>& getIrPassStatistics() const;
+            const LocalStorageStatistics& getLocalStorageStatistics() const;
+            const std::vector<FastVariablePlacement>& getFastVariablePlacements() const;
+            const std::vector<const Definition*>& getRemovedDefinitions() const;
+            const PageCrossingStatistics& getPageCrossingStatistics() const;
+
+            const InstructionOperand* createOperand(InstructionOperand operand) const;
+            const InstructionOperand* createOperandFromExpression(const Expression* expression, bool quiet) const;
         private:
             Compiler(const Compiler&) = delete;  
             Compiler& operator=(const Compiler&) = delete;
@@ -121,8 +176,10 @@ namespace wiz {
             std::string getTypeName(const TypeExpression* typeExpression) const;
             Optional<std::size_t> calculateStorageSize(const TypeExpression* typeExpression, StringView description) const;
             Optional<std::size_t> resolveExplicitAddressExpression(const Expression* expression);
-            bool serializeInteger(Int128 value, std::size_t size, std::vector<std::uint8_t>& result) const;
-            bool serializeConstantInitializer(const Expression* expression, std::vector<std::uint8_t>& result) const;
+            bool serializeInteger(Int128 value, std::size_t size, BankWriter& result) const;
+            bool serializeConstantInitializer(const Expression* expression, BankWriter& result) const;
+            Bank* resolveBankIdentifier(const std::vector<StringView>& pieces, SourceLocation location);
+            ArrayView<Bank*> resolvePlacementBanks(const std::vector<std::vector<StringView>>& alternatePieces, const Expression* dest, SourceLocation location);
             std::pair<bool, Optional<std::size_t>> handleInStatement(const std::vector<StringView>& bankIdentifierPieces, const Expression* dest, SourceLocation location);
 
             struct CompiledAttributeList;
@@ -133,16 +190,32 @@ namespace wiz {
             bool reserveDefinitions(const Statement* statement);
 
             bool resolveDefinitionTypes();
+            // Like resolveIdentifier(), but without reporting errors. Leaves every match of an ambiguous name in resolveIdentifierTempState.results.
+            bool findDefinitionsQuietly(const std::vector<StringView>& pieces);
+            // Returns true the first time it's called for a bank with an origin that declarations are being collected into.
+            bool startsCollectedBank();
+            bool canRunIntoNextStatement(const Statement* statement) const;
+            void collectDefinitionReferences(const Statement* statement, Definition* source, bool removable);
+            void collectDefinitionReferences(const Expression* expression, Definition* source);
+            void collectDefinitionReferences(const TypeExpression* typeExpression, Definition* source);
+            bool removeUnusedDefinitions();
 
             bool reserveStorage(const Statement* statement);
             bool resolveVariableInitializer(Definition* definition, const Expression* initializer, StringView description, SourceLocation location);
             bool reserveVariableStorage(Definition* definition, StringView description, SourceLocation location);
-
-            FwdUniquePtr<InstructionOperand> createPlaceholderFromResolvedTypeDefinition(const Definition* resolvedTypeDefinition) const;
-            FwdUniquePtr<InstructionOperand> createPlaceholderFromTypeExpression(const TypeExpression* typeExpression) const;
-            FwdUniquePtr<InstructionOperand> createOperandFromResolvedIdentifier(const Expression* expression, const Definition* definition) const;
-            FwdUniquePtr<InstructionOperand> createOperandFromLinkTimeExpression(const Expression* expression, bool quiet) const;
-            FwdUniquePtr<InstructionOperand> createOperandFromRunTimeExpression(const Expression* expression, bool quiet) const;
+            Bank* findBankWithRoom(ArrayView<Bank*> banks, const Definition* definition) const;
+            bool reserveVariableRam(Definition* definition, Bank* bank, StringView description, SourceLocation location);
+            Optional<std::size_t> calculatePagePadding(std::size_t absolutePosition, std::size_t size) const;
+            void keepTableInPage(Bank* bank, std::size_t size, SourceLocation location);
+            void countVariableUses(const Statement* statement, std::size_t weight);
+            void countVariableUses(const Expression* expression, std::size_t weight);
+            bool placeFastVariables();
+
+            const InstructionOperand* createPlaceholderFromResolvedTypeDefinition(const Definition* resolvedTypeDefinition) const;
+            const InstructionOperand* createPlaceholderFromTypeExpression(const TypeExpression* typeExpression) const;
+            const InstructionOperand* createOperandFromResolvedIdentifier(const Expression* expression, const Definition* definition) const;
+            const InstructionOperand* createOperandFromLinkTimeExpression(const Expression* expression, bool quiet) const;
+            const InstructionOperand* createOperandFromRunTimeExpression(const Expression* expression, bool quiet) const;
             bool isLeafExpression(const Expression* expression) const;
             bool hasNestedAssignment(const Expression* expression) const;
             bool emitNestedAssignmentIr(const Expression* expression, bool pre, bool post);
@@ -153,12 +226,16 @@ namespace wiz {
             bool emitBinaryExpressionIr(const Expression* dest, BinaryOperatorKind op, const Expression* left, const Expression* right, SourceLocation location);
             bool emitArgumentPassIr(const TypeExpression* functionTypeExpression, const std::vector<Definition*>& parameters, const std::vector<FwdUniquePtr<const Expression>>& arguments, SourceLocation location);
             bool emitCallExpressionIr(std::size_t distanceHint, bool inlined, bool tailCall, const Expression* resultDestination, const Expression* function, const std::vector<FwdUniquePtr<const Expression>>& arguments, SourceLocation location);
+            bool isBankSwitched(const Bank* bank) const;
+            std::size_t getRomBankIndex(const Bank* bank) const;
+            const Expression* resolveTrampolineTarget(const Expression* function);
+            void addCallGraphEdge(BranchKind kind, const Expression* destination);
 
             std::string getModeFlagString(std::uint32_t modeFlags);
             void raiseEmitLoadError(const Expression* dest, const Expression* source, SourceLocation location);
             void raiseEmitUnaryExpressionError(const Expression* dest, UnaryOperatorKind op, const Expression* source, SourceLocation location);
             void raiseEmitBinaryExpressionError(const Expression* dest, BinaryOperatorKind op, const Expression* left, const Expression* right, SourceLocation location);
-            void raiseEmitIntrinsicError(const InstructionType& instructionType, const std::vector<InstructionOperandRoot>& operandRoots, SourceLocation location);
+            void raiseEmitIntrinsicError(const InstructionType& instructionType, ArrayView<InstructionOperandRoot> operandRoots, SourceLocation location);
 
             bool emitAssignmentExpressionIr(const Expression* dest, const Expression* source, SourceLocation location);
             bool emitExpressionStatementIr(const Expression* expression, SourceLocation location);
@@ -168,7 +245,26 @@ namespace wiz {
             bool emitBranchIr(std::size_t distanceHint, BranchKind kind, const Expression* destination, const Expression* returnValue, bool negated, const Expression* condition, SourceLocation location);
             bool hasUnconditionalReturn(const Statement* statement) const;
             bool emitFunctionIr(Definition* definition, SourceLocation location);
+            // Emits a func that was left out, so that mistakes in its body are still reported, and then throws the result away.
+            bool checkUnusedFunctionIr(Definition* definition, SourceLocation location);
             bool emitStatementIr(const Statement* statement);
+            bool isPlacementUnitEnd(const Statement* statement) const;
+            bool emitPlacedStatementIr(const Statement* statement, ArrayView<Bank*> placementBanks);
+            bool emitTrampolineIr();
+            bool allocateLocalStorage();
+            bool runIrPasses();
+            static bool endsControlFlow(const IrNode& irNode);
+            bool removeUnreachableCodeIr();
+            bool removeRedundantJumpIr();
+            bool mergeConstantIr();
+            // Writing code only touches the given bank and report, so banks can be written on separate threads.
+            bool writeCodeIr(Report* writeReport, Bank* bank, const IrNode* irNode, ArrayView<InstructionOperandRoot> operandRoots, std::vector<std::vector<const InstructionOperand*>>& captureLists) const;
+            bool writeVarIr(const IrNode* irNode);
+            bool finishBankWrite(Report* writeReport, Bank* bank, const BankWriter& writer, StringView description, SourceLocation location) const;
+            Bank* choosePlacementBank(const IrNode* irNode, std::vector<std::vector<const InstructionOperand*>>& captureLists);
+            void findIndexedTables();
+            void findPageRegions();
+            std::size_t choosePageRegionPadding(std::size_t nodeIndex, std::vector<std::vector<const InstructionOperand*>>& captureLists);
             bool generateCode();
 
             FwdUniquePtr<const Statement> program;
@@ -177,6 +273,7 @@ namespace wiz {
             Config* config = nullptr;
             ImportManager* importManager = nullptr;
             Report* report = nullptr;
+            OptimizationOptions optimizationOptions;
             Builtins builtins;
 
             std::unordered_map<StringView, SymbolTable*> moduleScopes;
@@ -253,6 +350,103 @@ namespace wiz {
             std::vector<Bank*> bankStack;
             PtrPool<Bank> registeredBanks;
 
+            // The banks listed by the innermost `in` statement that names more than one.
+            ArrayView<Bank*> placementBanks;
+            ArrayPool<Bank*> placementBankLists;
+            // Banks that already placed code refers to each not-yet-placed definition from, so that it can be placed near its callers.
+            std::unordered_map<const Definition*, std::vector<Bank*>> placementReferenceBanks;
+
+            // The `#[trampoline]` func that describes how to switch banks, and the bank that its trampolines are placed in.
+            Definition* trampolineTemplate = nullptr;
+            Bank* trampolineBank = nullptr;
+            // The bank that each func was declared in, for telling which calls cross into another bank.
+            std::unordered_map<const Definition*, Bank*> funcBanks;
+            // One trampoline per func that is called from another bank, paired with that func, in the order they were first needed.
+            std::vector<std::pair<Definition*, Definition*>> trampolines;
+            std::unordered_map<const Definition*, Definition*> trampolinesByTarget;
+            bool emittingTrampolines = false;
+
+            // The bank marked `#[locals]`, where local vars without an address are given storage that overlaps between funcs.
+            Definition* localsBankDefinition = nullptr;
+            // The outermost func being reserved or emitted, which owns the locals of anything inlined into it.
+            Definition* frameFunction = nullptr;
+            // Funcs that have locals to place, in the order they were first seen, and the locals of each.
+            std::vector<Definition*> frameFunctions;
+            std::unordered_map<const Definition*, std::vector<Definition*>> frameLocals;
+            // Funcs called directly by each func, in the order that callers were first seen.
+            std::vector<const Definition*> callGraphCallers;
+            std::unordered_map<const Definition*, std::vector<const Definition*>> callGraph;
+            // Funcs that make calls that can't be followed, and funcs called from code outside of any func.
+            std::unordered_set<const Definition*> indirectCallers;
+            std::unordered_set<const Definition*> topLevelCallees;
+            LocalStorageStatistics localStorageStatistics;
+
+            struct FastCandidate {
+                FastCandidate(
+                    Definition* definition,
+                    ArrayView<Bank*> banks,
+                    StringView description,
+                    SourceLocation location)
+                : definition(definition),
+                banks(banks),
+                description(description),
+                location(location) {}
+
+                Definition* definition;
+                ArrayView<Bank*> banks;
+                StringView description;
+                SourceLocation location;
+            };
+
+            // The bank marked `#[fast]`, and the vars that could be placed in it, in declaration order.
+            // They're held back until every var is reserved, and then the most used ones are given what's left of it.
+            Definition* fastBankDefinition = nullptr;
+            std::vector<FastCandidate> fastCandidates;
+            std::unordered_map<const Definition*, std::size_t> variableUseCounts;
+            // Use counts recorded while running the program, by full name, which replace the counted ones when given.
+            std::unordered_map<std::string, std::size_t> variableProfile;
+            std::vector<FastVariablePlacement> fastVariablePlacements;
+
+            // Funcs and consts that could be left out if nothing uses them, and what each declaration refers to, with nullptr for code that is always kept.
+            // Whatever can't be reached from the kept code is still checked but gets no storage or code, and is listed in declaration order for `--stats`.
+            std::vector<Definition*> removableDefinitions;
+            std::unordered_map<const Definition*, std::vector<Definition*>> definitionReferences;
+            std::unordered_set<const Definition*> unusedDefinitions;
+            std::vector<const Definition*> removedDefinitions;
+            // The bank that declarations being collected go in, if it's known, and the banks with an origin that already have something at their start.
+            Bank* collectedBank = nullptr;
+            std::unordered_set<const Bank*> startedBanks;
+            // Set while a left out func or const is checked, so that it gets no storage, and asks for no trampolines or call graph edges.
+            bool checkingUnusedDefinition = false;
+
+            enum class PageRegionKind {
+                Loop,
+                Func,
+            };
+
+            // A run of IR nodes that should be kept within a single page, from the first node to the last, inclusive.
+            struct PageRegion {
+                PageRegion(
+                    PageRegionKind kind,
+                    std::size_t startIndex,
+                    std::size_t endIndex)
+                : kind(kind),
+                startIndex(startIndex),
+                endIndex(endIndex) {}
+
+                PageRegionKind kind;
+                std::size_t startIndex;
+                std::size_t endIndex;
+            };
+
+            static const std::size_t PageSize = 0x100;
+
+            // Declarations marked `#[nocross]`, along with tables that were found to be indexed, and which marked func each end label belongs to.
+            std::unordered_set<const Definition*> pageLocalDefinitions;
+            std::unordered_map<const Definition*, const Definition*> pageLocalFuncEnds;
+            std::vector<PageRegion> pageRegions;
+            PageCrossingStatistics pageCrossingStatistics;
+
             Definition* currentFunction = nullptr;
             Definition* breakLabel = nullptr;
             Definition* continueLabel = nullptr;
@@ -263,8 +457,44 @@ namespace wiz {
             FwdPtrPool<Definition> definitionPool;
             FwdPtrPool<const Statement> statementPool;
             FwdPtrPool<const Expression> expressionPool;
-            FwdPtrPool<IrNode> irNodes;
+            std::vector<IrNode> irNodes;
+            std::vector<IrPassStatistics> irPassStatistics;
+            // Constants whose bytes are the same as, or the tail of, another constant's, keyed by that constant, with the offset into it.
+            std::unordered_map<const Definition*, std::vector<std::pair<Definition*, std::size_t>>> constantAliases;
+            ArrayPool<InstructionOperandRoot> irOperandRoots;
+            // Scratch space for operand roots whose count isn't known up front, used as a stack so that IR emitted while they are collected can share it.
+            std::vector<InstructionOperandRoot> operandRootStack;
+            // Operand trees referenced by the IR, and any temporaries built while selecting instructions.
+            // Mutable, since operands are created by const queries, including ones that platforms call.
+            mutable ObjectPool<InstructionOperand> operandPool;
             std::unordered_map<StringView, std::size_t> labelSuffixes;
+
+            enum class FixupKind {
+                Code,
+                Var,
+            };
+
+            // A node that depends on link-time addresses, which must be written after layout is finished.
+            struct Fixup {
+                Fixup(
+                    FixupKind kind,
+                    const IrNode* irNode,
+                    Bank* bank,
+                    std::size_t relativePosition)
+                : kind(kind),
+                irNode(irNode),
+                bank(bank),
+                relativePosition(relativePosition) {}
+
+                FixupKind kind;
+                const IrNode* irNode;
+                Bank* bank;
+                std::size_t relativePosition;
+            };
+
+            std::vector<Fixup> fixups;
+            // The fewest fixups that are worth spreading over several threads.
+            static const std::size_t MinParallelFixupCount = 1024;
     };
 }
 
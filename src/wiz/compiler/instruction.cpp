@@ -7,71 +7,17 @@
 #include <wiz/compiler/instruction.h>
 
 namespace wiz {
-    template <>
-    void FwdDeleter<InstructionOperand>::operator()(const InstructionOperand* ptr) {
-        delete ptr;
-    }
-
-    InstructionOperand::~InstructionOperand() {
-        switch (kind) {
-            case InstructionOperandKind::BitIndex: bitIndex.~BitIndex(); break;
-            case InstructionOperandKind::Binary: binary.~Binary(); break;
-            case InstructionOperandKind::Boolean: boolean.~Boolean(); break;
-            case InstructionOperandKind::Dereference: dereference.~Dereference(); break;
-            case InstructionOperandKind::Index: index.~Index(); break;
-            case InstructionOperandKind::Integer: integer.~Integer(); break;
-            case InstructionOperandKind::Register: register_.~Register(); break;
-            case InstructionOperandKind::Unary: unary.~Unary(); break;
-        }
-    }
-
-    FwdUniquePtr<InstructionOperand> InstructionOperand::clone() const {
+    bool InstructionOperand::hasPlaceholder() const {
         switch (kind) {
-            case InstructionOperandKind::BitIndex: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::BitIndex(
-                    bitIndex.operand->clone(),
-                    bitIndex.subscript->clone()));
-            }
-            case InstructionOperandKind::Binary: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Binary(
-                    binary.kind,
-                    binary.left->clone(),
-                    binary.right->clone()));
-            }
-            case InstructionOperandKind::Boolean: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Boolean(
-                    boolean.value,
-                    boolean.placeholder));
-            }
-            case InstructionOperandKind::Dereference: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Dereference(
-                    dereference.far,
-                    dereference.operand->clone(),
-                    dereference.size));
-            }
-            case InstructionOperandKind::Index: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Index(
-                    index.far,
-                    index.operand->clone(),
-                    index.subscript->clone(),
-                    index.subscriptScale,
-                    index.size));
-            }
-            case InstructionOperandKind::Integer: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(
-                    integer.value,
-                    integer.placeholder));
-            }
-            case InstructionOperandKind::Register: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Register(
-                    register_.definition));
-            }
-            case InstructionOperandKind::Unary: {
-                return makeFwdUnique<InstructionOperand>(InstructionOperand::Unary(
-                    unary.kind,
-                    unary.operand->clone()));
-            }
-            default: std::abort(); return nullptr;
+            case InstructionOperandKind::BitIndex: return bitIndex.operand->hasPlaceholder() || bitIndex.subscript->hasPlaceholder();
+            case InstructionOperandKind::Binary: return binary.left->hasPlaceholder() || binary.right->hasPlaceholder();
+            case InstructionOperandKind::Boolean: return boolean.placeholder;
+            case InstructionOperandKind::Dereference: return dereference.operand->hasPlaceholder();
+            case InstructionOperandKind::Index: return index.operand->hasPlaceholder() || index.subscript->hasPlaceholder();
+            case InstructionOperandKind::Integer: return integer.placeholder;
+            case InstructionOperandKind::Register: return false;
+            case InstructionOperandKind::Unary: return unary.operand->hasPlaceholder();
+            default: std::abort(); return false;
         }
     }
 
@@ -301,7 +247,7 @@ namespace wiz {
             }
             case InstructionOperandPatternKind::Boolean: {
                 const auto& otherBoolean = other.boolean;
-                return (otherBoolean.value ? 1 : 0) - (otherBoolean.value ? 1 : 0);
+                return (boolean.value ? 1 : 0) - (otherBoolean.value ? 1 : 0);
             }
             case InstructionOperandPatternKind::Capture: {
                 const auto& otherCapture = other.capture;
@@ -312,6 +258,9 @@ namespace wiz {
                 if (dereference.far != otherDereference.far) {
                     return (dereference.far ? 1 : 0) - (otherDereference.far ? 1 : 0);
                 }
+                if (dereference.size != otherDereference.size) {
+                    return dereference.size < otherDereference.size ? -1 : 1;
+                }
                 return dereference.operandPattern->compare(*otherDereference.operandPattern);
             }
             case InstructionOperandPatternKind::Index: {
@@ -683,6 +632,122 @@ namespace wiz {
 
 
 
+    namespace {
+        // Appends the ops for a pattern in pre-order, with Capture nodes folded into the node they wrap.
+        // An unscaled index is commutative, so whether its operand and subscript patterns are emitted swapped
+        // is read from choices, in the order such indexes are reached. Missing choices default to unswapped.
+        void emitMatchOps(const InstructionOperandPattern& pattern, bool captured, bool insideCapture, std::vector<bool>& choices, std::size_t& choiceIndex, std::size_t& captureCount, std::vector<InstructionMatchOp>& ops) {
+            if (const auto capture = pattern.tryGet<InstructionOperandPattern::Capture>()) {
+                // Captures nested inside of another capture are only matched, not extracted.
+                emitMatchOps(*capture->operandPattern, insideCapture ? captured : true, true, choices, choiceIndex, captureCount, ops);
+                return;
+            }
+
+            ops.push_back(InstructionMatchOp(pattern, captured ? captureCount++ : InstructionMatchOp::NoCaptureSlot));
+
+            switch (pattern.kind) {
+                case InstructionOperandPatternKind::BitIndex: {
+                    emitMatchOps(*pattern.bitIndex.operandPattern, false, insideCapture, choices, choiceIndex, captureCount, ops);
+                    emitMatchOps(*pattern.bitIndex.subscriptPattern, false, insideCapture, choices, choiceIndex, captureCount, ops);
+                    break;
+                }
+                case InstructionOperandPatternKind::Dereference: {
+                    emitMatchOps(*pattern.dereference.operandPattern, false, insideCapture, choices, choiceIndex, captureCount, ops);
+                    break;
+                }
+                case InstructionOperandPatternKind::Index: {
+                    bool swapped = false;
+                    if (pattern.index.subscriptScale == 1) {
+                        if (choiceIndex == choices.size()) {
+                            choices.push_back(false);
+                        }
+                        swapped = choices[choiceIndex++];
+                    }
+
+                    emitMatchOps(swapped ? *pattern.index.subscriptPattern : *pattern.index.operandPattern, false, insideCapture, choices, choiceIndex, captureCount, ops);
+                    emitMatchOps(swapped ? *pattern.index.operandPattern : *pattern.index.subscriptPattern, false, insideCapture, choices, choiceIndex, captureCount, ops);
+                    break;
+                }
+                case InstructionOperandPatternKind::Unary: {
+                    emitMatchOps(*pattern.unary.operandPattern, false, insideCapture, choices, choiceIndex, captureCount, ops);
+                    break;
+                }
+                default: break;
+            }
+        }
+
+        // Counts the ops that emitMatchOps() appends for one program, and the number of commutative indexes in it.
+        // Every combination of choices emits the same number of ops, so this sizes all of a pattern's programs up front.
+        void countMatchOps(const InstructionOperandPattern& pattern, std::size_t& opCount, std::size_t& choiceCount) {
+            if (const auto capture = pattern.tryGet<InstructionOperandPattern::Capture>()) {
+                countMatchOps(*capture->operandPattern, opCount, choiceCount);
+                return;
+            }
+
+            ++opCount;
+
+            switch (pattern.kind) {
+                case InstructionOperandPatternKind::BitIndex: {
+                    countMatchOps(*pattern.bitIndex.operandPattern, opCount, choiceCount);
+                    countMatchOps(*pattern.bitIndex.subscriptPattern, opCount, choiceCount);
+                    break;
+                }
+                case InstructionOperandPatternKind::Dereference: {
+                    countMatchOps(*pattern.dereference.operandPattern, opCount, choiceCount);
+                    break;
+                }
+                case InstructionOperandPatternKind::Index: {
+                    if (pattern.index.subscriptScale == 1) {
+                        ++choiceCount;
+                    }
+                    countMatchOps(*pattern.index.operandPattern, opCount, choiceCount);
+                    countMatchOps(*pattern.index.subscriptPattern, opCount, choiceCount);
+                    break;
+                }
+                case InstructionOperandPatternKind::Unary: {
+                    countMatchOps(*pattern.unary.operandPattern, opCount, choiceCount);
+                    break;
+                }
+                default: break;
+            }
+        }
+
+        std::size_t getMatchOpChildCount(InstructionOperandPatternKind kind) {
+            switch (kind) {
+                case InstructionOperandPatternKind::BitIndex: return 2;
+                case InstructionOperandPatternKind::Dereference: return 1;
+                case InstructionOperandPatternKind::Index: return 2;
+                case InstructionOperandPatternKind::Unary: return 1;
+                default: return 0;
+            }
+        }
+    }
+
+    InstructionMatchOp::InstructionMatchOp(
+        const InstructionOperandPattern& pattern,
+        std::size_t captureSlot)
+    : kind(pattern.kind),
+    far(false),
+    value(false),
+    unaryKind(UnaryOperatorKind::None),
+    size(0),
+    subscriptScale(0),
+    definition(nullptr),
+    min(0),
+    max(0),
+    captureSlot(captureSlot) {
+        switch (kind) {
+            case InstructionOperandPatternKind::Boolean: value = pattern.boolean.value; break;
+            case InstructionOperandPatternKind::Dereference: far = pattern.dereference.far; size = pattern.dereference.size; break;
+            case InstructionOperandPatternKind::Index: far = pattern.index.far; size = pattern.index.size; subscriptScale = pattern.index.subscriptScale; break;
+            case InstructionOperandPatternKind::IntegerAtLeast: min = pattern.integerAtLeast.min; break;
+            case InstructionOperandPatternKind::IntegerRange: min = pattern.integerRange.min; max = pattern.integerRange.max; break;
+            case InstructionOperandPatternKind::Register: definition = pattern.register_.definition; break;
+            case InstructionOperandPatternKind::Unary: unaryKind = pattern.unary.kind; break;
+            default: break;
+        }
+    }
+
     int InstructionSignature::compare(const InstructionSignature& other) const {
         if (this == &other) {
             return 0;
@@ -717,15 +782,16 @@ namespace wiz {
         if (this == &other) {
             return true;
         }
-        if (type != other.type) {
-            return false;
-        }
+        // Cheapest checks first, this is called pairwise while the specialization graph is built.
         if (requiredModeFlags != other.requiredModeFlags) {
             return false;
         }
         if (operandPatterns.size() != other.operandPatterns.size()) {
             return false;
         }
+        if (type != other.type) {
+            return false;
+        }
         for (std::size_t i = 0; i != operandPatterns.size(); ++i) {
             if (!operandPatterns[i]->isSubsetOf(*other.operandPatterns[i])) {
                 return false;
@@ -734,22 +800,36 @@ namespace wiz {
         return true;
     }
 
-    bool InstructionSignature::matches(std::uint32_t modeFlags, const std::vector<InstructionOperandRoot>& operandRoots) const {
-        if (requiredModeFlags != 0 && (requiredModeFlags & modeFlags) != requiredModeFlags) {
+    bool InstructionSignature::matchesModeFlags(std::uint32_t modeFlags) const {
+        return requiredModeFlags == 0 || (requiredModeFlags & modeFlags) == requiredModeFlags;
+    }
+
+    bool InstructionSignature::matches(std::uint32_t modeFlags, ArrayView<InstructionOperandRoot> operandRoots) const {
+        if (!matchesModeFlags(modeFlags)) {
             return false;
         }
         if (operandPatterns.size() != operandRoots.size()) {
             return false;
         }
-        for (std::size_t i = 0; i != operandPatterns.size(); ++i) {
-            if (!operandPatterns[i]->matches(*operandRoots[i].operand)) {
+
+        compileMatchPrograms();
+
+        std::size_t programIndex = 0;
+        for (std::size_t i = 0; i != operandRoots.size(); ++i) {
+            bool matched = false;
+            for (; programIndex != matchPrograms.size() && matchPrograms[programIndex].operandIndex == i; ++programIndex) {
+                if (!matched && runMatchProgram(matchPrograms[programIndex], *operandRoots[i].operand, nullptr)) {
+                    matched = true;
+                }
+            }
+            if (!matched) {
                 return false;
             }
         }
         return true;
     }
 
-    bool InstructionSignature::extract(const std::vector<InstructionOperandRoot>& operandRoots, std::vector<std::vector<const InstructionOperand*>>& captureLists) const {
+    bool InstructionSignature::extract(ArrayView<InstructionOperandRoot> operandRoots, std::vector<std::vector<const InstructionOperand*>>& captureLists) const {
         const auto operandRootsCount = operandRoots.size();
         if (captureLists.size() < operandRootsCount) {
             captureLists.resize(operandRootsCount);
@@ -757,22 +837,176 @@ namespace wiz {
         for (auto& captureList : captureLists) {
             captureList.clear();
         }
+
+        compileMatchPrograms();
+
+        std::size_t programIndex = 0;
         for (std::size_t i = 0; i != operandRootsCount; ++i) {
-            const auto operandPattern = operandPatterns[i];
-            const auto& operand = operandRoots[i].operand;
+            const auto operand = operandRoots[i].operand;
             auto& captureList = captureLists[i];
 
-            if (!operandPattern->extract(*operand, captureList)) {
+            bool matched = false;
+            for (; programIndex != matchPrograms.size() && matchPrograms[programIndex].operandIndex == i; ++programIndex) {
+                if (!matched && runMatchProgram(matchPrograms[programIndex], *operand, &captureList)) {
+                    matched = true;
+                }
+            }
+            if (!matched) {
                 return false;
             }
             if (captureList.size() == 0) {
-                captureList.push_back(operand.get());
+                captureList.push_back(operand);
             }
         }
         return true;
     }
 
+    void InstructionSignature::compileMatchPrograms() const {
+        if (matchProgramsCompiled) {
+            return;
+        }
+        matchProgramsCompiled = true;
+
+        std::size_t totalOpCount = 0;
+        std::size_t totalProgramCount = 0;
+        for (const auto operandPattern : operandPatterns) {
+            std::size_t opCount = 0;
+            std::size_t choiceCount = 0;
+            countMatchOps(*operandPattern, opCount, choiceCount);
+            totalOpCount += opCount << choiceCount;
+            totalProgramCount += static_cast<std::size_t>(1) << choiceCount;
+        }
+        matchOps.reserve(totalOpCount);
+        matchPrograms.reserve(totalProgramCount);
+
+        std::vector<bool> choices;
+
+        for (std::size_t i = 0; i != operandPatterns.size(); ++i) {
+            choices.clear();
+
+            // Emit one program per combination of commutative index choices, unswapped first,
+            // which is the order that the recursive extract() would have preferred them.
+            while (true) {
+                const auto opIndex = matchOps.size();
+                std::size_t choiceIndex = 0;
+                std::size_t captureCount = 0;
+                emitMatchOps(*operandPatterns[i], false, false, choices, choiceIndex, captureCount, matchOps);
+
+                std::size_t pendingCount = 1;
+                for (std::size_t j = opIndex; j != matchOps.size(); ++j) {
+                    pendingCount = pendingCount - 1 + getMatchOpChildCount(matchOps[j].kind);
+                    if (pendingCount > InstructionMatchProgram::MaxPendingOperands) {
+                        std::abort();
+                    }
+                }
+
+                matchPrograms.push_back(InstructionMatchProgram(i, opIndex, matchOps.size() - opIndex, captureCount));
+
+                choices.resize(choiceIndex);
+                while (!choices.empty() && choices.back()) {
+                    choices.pop_back();
+                }
+                if (choices.empty()) {
+                    break;
+                }
+                choices.back() = true;
+            }
+        }
+    }
+
+    bool InstructionSignature::runMatchProgram(const InstructionMatchProgram& program, const InstructionOperand& operand, std::vector<const InstructionOperand*>* captureList) const {
+        // Operands waiting to be matched by the ops that follow, next one on top.
+        const InstructionOperand* pendingOperands[InstructionMatchProgram::MaxPendingOperands];
+        std::size_t pendingCount = 0;
+        pendingOperands[pendingCount++] = &operand;
+
+        if (captureList != nullptr) {
+            captureList->resize(program.captureCount);
+        }
+
+        const auto opEnd = program.opIndex + program.opCount;
+        for (std::size_t i = program.opIndex; i != opEnd; ++i) {
+            const auto& op = matchOps[i];
+            const auto& current = *pendingOperands[--pendingCount];
 
+            switch (op.kind) {
+                case InstructionOperandPatternKind::BitIndex: {
+                    const auto bitIndexOperand = current.tryGet<InstructionOperand::BitIndex>();
+                    if (bitIndexOperand == nullptr) {
+                        return false;
+                    }
+                    pendingOperands[pendingCount++] = bitIndexOperand->subscript;
+                    pendingOperands[pendingCount++] = bitIndexOperand->operand;
+                    break;
+                }
+                case InstructionOperandPatternKind::Boolean: {
+                    const auto booleanOperand = current.tryGet<InstructionOperand::Boolean>();
+                    if (booleanOperand == nullptr || booleanOperand->value != op.value) {
+                        return false;
+                    }
+                    break;
+                }
+                case InstructionOperandPatternKind::Dereference: {
+                    const auto dereferenceOperand = current.tryGet<InstructionOperand::Dereference>();
+                    if (dereferenceOperand == nullptr
+                    || dereferenceOperand->far != op.far
+                    || dereferenceOperand->size != op.size) {
+                        return false;
+                    }
+                    pendingOperands[pendingCount++] = dereferenceOperand->operand;
+                    break;
+                }
+                case InstructionOperandPatternKind::Index: {
+                    const auto indexOperand = current.tryGet<InstructionOperand::Index>();
+                    if (indexOperand == nullptr
+                    || indexOperand->far != op.far
+                    || indexOperand->size != op.size
+                    || indexOperand->subscriptScale != op.subscriptScale) {
+                        return false;
+                    }
+                    pendingOperands[pendingCount++] = indexOperand->subscript;
+                    pendingOperands[pendingCount++] = indexOperand->operand;
+                    break;
+                }
+                case InstructionOperandPatternKind::IntegerAtLeast: {
+                    const auto integerOperand = current.tryGet<InstructionOperand::Integer>();
+                    if (integerOperand == nullptr || integerOperand->value < op.min) {
+                        return false;
+                    }
+                    break;
+                }
+                case InstructionOperandPatternKind::IntegerRange: {
+                    const auto integerOperand = current.tryGet<InstructionOperand::Integer>();
+                    if (integerOperand == nullptr || integerOperand->value < op.min || integerOperand->value > op.max) {
+                        return false;
+                    }
+                    break;
+                }
+                case InstructionOperandPatternKind::Register: {
+                    const auto registerOperand = current.tryGet<InstructionOperand::Register>();
+                    if (registerOperand == nullptr || registerOperand->definition != op.definition) {
+                        return false;
+                    }
+                    break;
+                }
+                case InstructionOperandPatternKind::Unary: {
+                    const auto unaryOperand = current.tryGet<InstructionOperand::Unary>();
+                    if (unaryOperand == nullptr || unaryOperand->kind != op.unaryKind) {
+                        return false;
+                    }
+                    pendingOperands[pendingCount++] = unaryOperand->operand;
+                    break;
+                }
+                default: std::abort(); return false;
+            }
+
+            if (captureList != nullptr && op.captureSlot != InstructionMatchOp::NoCaptureSlot) {
+                (*captureList)[op.captureSlot] = &current;
+            }
+        }
+
+        return true;
+    }
 
     template<>
     void FwdDeleter<Instruction>::operator()(const Instruction* ptr) {
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <utility>
 #include <type_traits>
 
 #include <wiz/utility/fwd_unique_ptr.h>
@@ -23,6 +24,7 @@ namespace wiz {
     enum class BinaryOperatorKind;
 
     class Bank;
+    class BankWriter;
     class Report;
 
     enum class InstructionOperandKind {
@@ -36,30 +38,32 @@ namespace wiz {
         Unary,
     };
 
+    // Operand trees are immutable once built, and don't own their children, so subtrees can be shared between trees.
+    // They are allocated from the compiler's operand pool, which keeps them alive for as long as the IR that refers to them.
     struct InstructionOperand {
         struct BitIndex {
             BitIndex(
-                FwdUniquePtr<const InstructionOperand> operand,
-                FwdUniquePtr<const InstructionOperand> index)
-            : operand(std::move(operand)),
-            subscript(std::move(index)) {}
+                const InstructionOperand* operand,
+                const InstructionOperand* index)
+            : operand(operand),
+            subscript(index) {}
 
-            FwdUniquePtr<const InstructionOperand> operand;
-            FwdUniquePtr<const InstructionOperand> subscript;
+            const InstructionOperand* operand;
+            const InstructionOperand* subscript;
         };
 
         struct Binary {
             Binary(
                 BinaryOperatorKind kind,
-                FwdUniquePtr<const InstructionOperand> left,
-                FwdUniquePtr<const InstructionOperand> right)
+                const InstructionOperand* left,
+                const InstructionOperand* right)
             : kind(kind),
-            left(std::move(left)),
-            right(std::move(right)) {}
+            left(left),
+            right(right) {}
 
             BinaryOperatorKind kind;
-            FwdUniquePtr<const InstructionOperand> left;
-            FwdUniquePtr<const InstructionOperand> right;
+            const InstructionOperand* left;
+            const InstructionOperand* right;
         };
 
         struct Boolean {
@@ -81,33 +85,33 @@ namespace wiz {
         struct Dereference {
             Dereference(
                 bool far,
-                FwdUniquePtr<const InstructionOperand> operand,
+                const InstructionOperand* operand,
                 std::size_t size)
             : far(far),
-            operand(std::move(operand)),
+            operand(operand),
             size(size) {}
 
             bool far;
-            FwdUniquePtr<const InstructionOperand> operand;
+            const InstructionOperand* operand;
             std::size_t size;
         };
 
         struct Index {
             Index(
                 bool far,
-                FwdUniquePtr<const InstructionOperand> operand,
-                FwdUniquePtr<const InstructionOperand> subscript,
+                const InstructionOperand* operand,
+                const InstructionOperand* subscript,
                 std::size_t subscriptScale,
                 std::size_t size)
             : far(far),
-            operand(std::move(operand)),
-            subscript(std::move(subscript)),
+            operand(operand),
+            subscript(subscript),
             subscriptScale(subscriptScale),
             size(size) {}
 
             bool far;
-            FwdUniquePtr<const InstructionOperand> operand;
-            FwdUniquePtr<const InstructionOperand> subscript;
+            const InstructionOperand* operand;
+            const InstructionOperand* subscript;
             std::size_t subscriptScale;
             std::size_t size;
         };
@@ -139,12 +143,12 @@ namespace wiz {
         struct Unary {
             Unary(
                 UnaryOperatorKind kind,
-                FwdUniquePtr<const InstructionOperand> operand)
+                const InstructionOperand* operand)
             : kind(kind),
-            operand(std::move(operand)) {}
+            operand(operand) {}
 
             UnaryOperatorKind kind;
-            FwdUniquePtr<const InstructionOperand> operand;
+            const InstructionOperand* operand;
         };
 
         InstructionOperand(
@@ -187,11 +191,9 @@ namespace wiz {
         : kind(InstructionOperandKind::Unary),
         unary(std::move(unary)) {}
 
-        ~InstructionOperand();
-
         template <typename T> const T* tryGet() const;
 
-        FwdUniquePtr<InstructionOperand> clone() const;
+        bool hasPlaceholder() const;
         int compare(const InstructionOperand& other) const;
         std::string toString() const;
 
@@ -503,25 +505,22 @@ namespace wiz {
 
         InstructionOperandRoot(
             const Expression* expression,
-            FwdUniquePtr<const InstructionOperand> operand)
+            const InstructionOperand* operand)
         : expression(expression),
-        operand(std::move(operand)) {}
-
-        InstructionOperandRoot(InstructionOperandRoot&&) noexcept = default;
-        InstructionOperandRoot(const InstructionOperandRoot&) = delete;
+        operand(operand) {}
 
         const Expression* expression = nullptr;
-        FwdUniquePtr<const InstructionOperand> operand;
+        const InstructionOperand* operand;
     };
 
     struct InstructionOptions {
         InstructionOptions(
-            const std::vector<std::uint8_t>& opcode,
-            const std::vector<std::size_t>& parameter,
-            const std::vector<Definition*> affectedFlags)
-        : opcode(opcode),
-        parameter(parameter),
-        affectedFlags(affectedFlags) {}
+            std::vector<std::uint8_t> opcode,
+            std::vector<std::size_t> parameter,
+            std::vector<Definition*> affectedFlags)
+        : opcode(std::move(opcode)),
+        parameter(std::move(parameter)),
+        affectedFlags(std::move(affectedFlags)) {}
 
         std::vector<std::uint8_t> opcode;
         std::vector<std::size_t> parameter;
@@ -529,7 +528,7 @@ namespace wiz {
     };
 
     using InstructionSizeFunc = std::size_t (*)(const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists);
-    using InstructionWriteFunc = bool (*)(Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location);
+    using InstructionWriteFunc = bool (*)(Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location);
 
     struct InstructionEncoding {
         InstructionEncoding(
@@ -652,33 +651,83 @@ namespace wiz {
         return kind == InstructionTypeKind::LoadIntrinsic ? &loadIntrinsic : nullptr;
     }
 
+    // One step of a compiled operand pattern.
+    // Ops are stored in pre-order, and each one only checks the local properties of a single operand node.
+    struct InstructionMatchOp {
+        static const std::size_t NoCaptureSlot = SIZE_MAX;
+
+        InstructionMatchOp(
+            const InstructionOperandPattern& pattern,
+            std::size_t captureSlot);
+
+        InstructionOperandPatternKind kind;
+        bool far;
+        bool value;
+        UnaryOperatorKind unaryKind;
+        std::size_t size;
+        std::size_t subscriptScale;
+        const Definition* definition;
+        Int128 min;
+        Int128 max;
+        std::size_t captureSlot;
+    };
+
+    // A contiguous run of ops in InstructionSignature::matchOps that matches the operand at operandIndex.
+    // Commutative index patterns compile to more than one program for the same operand, tried in order.
+    struct InstructionMatchProgram {
+        static const std::size_t MaxPendingOperands = 16;
+
+        InstructionMatchProgram(
+            std::size_t operandIndex,
+            std::size_t opIndex,
+            std::size_t opCount,
+            std::size_t captureCount)
+        : operandIndex(operandIndex),
+        opIndex(opIndex),
+        opCount(opCount),
+        captureCount(captureCount) {}
+
+        std::size_t operandIndex;
+        std::size_t opIndex;
+        std::size_t opCount;
+        std::size_t captureCount;
+    };
+
     struct InstructionSignature {
         InstructionSignature(
             const InstructionType& type,
             std::uint32_t requiredModeFlags,
-            const std::vector<const InstructionOperandPattern*>& operandPatterns)
+            std::vector<const InstructionOperandPattern*> operandPatterns)
         : type(type),
         requiredModeFlags(requiredModeFlags),
-        operandPatterns(operandPatterns) {}
+        operandPatterns(std::move(operandPatterns)) {}
 
         InstructionType type;
         std::uint32_t requiredModeFlags;
         std::vector<const InstructionOperandPattern*> operandPatterns;
 
+        // Compiled on first use by compileMatchPrograms(), since most instructions are never selected by a given program.
+        mutable std::vector<InstructionMatchOp> matchOps;
+        mutable std::vector<InstructionMatchProgram> matchPrograms;
+        mutable bool matchProgramsCompiled = false;
+
         int compare(const InstructionSignature& other) const;
         bool isSubsetOf(const InstructionSignature& other) const;
-        bool matches(std::uint32_t modeFlags, const std::vector<InstructionOperandRoot>& operandRoots) const;
-        bool extract(const std::vector<InstructionOperandRoot>& operandRoots, std::vector<std::vector<const InstructionOperand*>>& captureLists) const;
+        bool matchesModeFlags(std::uint32_t modeFlags) const;
+        bool matches(std::uint32_t modeFlags, ArrayView<InstructionOperandRoot> operandRoots) const;
+        bool extract(ArrayView<InstructionOperandRoot> operandRoots, std::vector<std::vector<const InstructionOperand*>>& captureLists) const;
+        void compileMatchPrograms() const;
+        bool runMatchProgram(const InstructionMatchProgram& program, const InstructionOperand& operand, std::vector<const InstructionOperand*>* captureList) const;
     };
 
     struct Instruction {
         Instruction(
-            const InstructionSignature& signature,
+            InstructionSignature signature,
             const InstructionEncoding* encoding,
-            const InstructionOptions& options)
-        : signature(signature),
+            InstructionOptions options)
+        : signature(std::move(signature)),
         encoding(encoding),
-        options(options) {}
+        options(std::move(options)) {}
 
         InstructionSignature signature;
         const InstructionEncoding* encoding;
@@ -0,0 +1,311 @@
+#include <cstring>
+#include <algorithm>
+
+#include <wiz/ast/expression.h>
+#include <wiz/compiler/instruction_index.h>
+
+namespace wiz {
+    namespace {
+        void flattenOperand(const InstructionOperand& operand, std::vector<const InstructionOperand*>& operands) {
+            operands.push_back(&operand);
+
+            switch (operand.kind) {
+                case InstructionOperandKind::BitIndex: {
+                    flattenOperand(*operand.bitIndex.operand, operands);
+                    flattenOperand(*operand.bitIndex.subscript, operands);
+                    break;
+                }
+                case InstructionOperandKind::Dereference: {
+                    flattenOperand(*operand.dereference.operand, operands);
+                    break;
+                }
+                case InstructionOperandKind::Index: {
+                    flattenOperand(*operand.index.operand, operands);
+                    flattenOperand(*operand.index.subscript, operands);
+                    break;
+                }
+                case InstructionOperandKind::Unary: {
+                    flattenOperand(*operand.unary.operand, operands);
+                    break;
+                }
+                default: break;
+            }
+        }
+
+        void addIntegerBound(std::vector<Int128>& bounds, Int128 value) {
+            const auto it = std::lower_bound(bounds.begin(), bounds.end(), value);
+            if (it == bounds.end() || *it != value) {
+                bounds.insert(it, value);
+            }
+        }
+
+        template <typename T>
+        void appendShapeValue(std::string& shape, T value) {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            shape.append(bytes, sizeof(T));
+        }
+    }
+
+    bool InstructionIndex::Key::operator ==(const Key& other) const {
+        return kind == other.kind
+        && flag == other.flag
+        && size == other.size
+        && subscriptScale == other.subscriptScale
+        && definition == other.definition;
+    }
+
+    void InstructionIndex::add(const Instruction* instruction) {
+        if (nodes.empty()) {
+            nodes.emplace_back();
+        }
+
+        // Patterns are consumed from the back, so push them in reverse to visit operands left-to-right.
+        const auto& operandPatterns = instruction->signature.operandPatterns;
+        pendingPatterns.assign(operandPatterns.rbegin(), operandPatterns.rend());
+        insert(0, pendingPatterns, instruction);
+    }
+
+    void InstructionIndex::findAllMatches(ArrayView<InstructionOperandRoot> operandRoots, std::vector<const Instruction*>& results) const {
+        results.clear();
+
+        if (nodes.empty()) {
+            return;
+        }
+
+        std::vector<const InstructionOperand*> operands;
+        for (const auto& operandRoot : operandRoots) {
+            flattenOperand(*operandRoot.operand, operands);
+        }
+
+        match(0, operands, 0, results);
+    }
+
+    void InstructionIndex::appendShape(ArrayView<InstructionOperandRoot> operandRoots, std::string& shape) const {
+        std::vector<const InstructionOperand*> operands;
+        for (const auto& operandRoot : operandRoots) {
+            flattenOperand(*operandRoot.operand, operands);
+        }
+
+        for (const auto operand : operands) {
+            appendShapeValue(shape, static_cast<std::uint8_t>(operand->kind));
+
+            switch (operand->kind) {
+                case InstructionOperandKind::Boolean: {
+                    appendShapeValue(shape, operand->boolean.value);
+                    break;
+                }
+                case InstructionOperandKind::Dereference: {
+                    appendShapeValue(shape, operand->dereference.far);
+                    appendShapeValue(shape, operand->dereference.size);
+                    break;
+                }
+                case InstructionOperandKind::Index: {
+                    appendShapeValue(shape, operand->index.far);
+                    appendShapeValue(shape, operand->index.size);
+                    appendShapeValue(shape, operand->index.subscriptScale);
+                    break;
+                }
+                case InstructionOperandKind::Integer: {
+                    const auto upper = std::upper_bound(integerBounds.begin(), integerBounds.end(), operand->integer.value);
+                    appendShapeValue(shape, static_cast<std::size_t>(upper - integerBounds.begin()));
+                    break;
+                }
+                case InstructionOperandKind::Register: {
+                    appendShapeValue(shape, operand->register_.definition);
+                    break;
+                }
+                case InstructionOperandKind::Unary: {
+                    appendShapeValue(shape, operand->unary.kind);
+                    break;
+                }
+                default: break;
+            }
+        }
+    }
+
+    std::size_t InstructionIndex::addChild(std::size_t nodeIndex, const Key& key) {
+        for (auto edgeIndex = nodes[nodeIndex].firstEdge; edgeIndex != NoIndex; edgeIndex = edges[edgeIndex].next) {
+            if (edges[edgeIndex].key == key) {
+                return edges[edgeIndex].child;
+            }
+        }
+
+        const auto child = nodes.size();
+        nodes.emplace_back();
+        edges.push_back(Edge(key, child, nodes[nodeIndex].firstEdge));
+        nodes[nodeIndex].firstEdge = edges.size() - 1;
+        return child;
+    }
+
+    std::size_t InstructionIndex::addIntegerChild(std::size_t nodeIndex, Int128 min, Int128 max, bool bounded) {
+        for (auto edgeIndex = nodes[nodeIndex].firstIntegerEdge; edgeIndex != NoIndex; edgeIndex = integerEdges[edgeIndex].next) {
+            const auto& edge = integerEdges[edgeIndex];
+            if (edge.min == min && edge.bounded == bounded && (!bounded || edge.max == max)) {
+                return edge.child;
+            }
+        }
+
+        const auto child = nodes.size();
+        nodes.emplace_back();
+        integerEdges.push_back(IntegerEdge(min, max, bounded, child, nodes[nodeIndex].firstIntegerEdge));
+        nodes[nodeIndex].firstIntegerEdge = integerEdges.size() - 1;
+
+        addIntegerBound(integerBounds, min);
+        if (bounded && max + Int128(1) > max) {
+            addIntegerBound(integerBounds, max + Int128(1));
+        }
+
+        return child;
+    }
+
+    void InstructionIndex::insert(std::size_t nodeIndex, std::vector<const InstructionOperandPattern*>& pendingPatterns, const Instruction* instruction) {
+        if (pendingPatterns.empty()) {
+            auto& node = nodes[nodeIndex];
+            for (auto leafIndex = node.firstLeaf; leafIndex != NoIndex; leafIndex = leaves[leafIndex].next) {
+                if (leaves[leafIndex].instruction == instruction) {
+                    return;
+                }
+            }
+
+            leaves.push_back(Leaf(instruction, node.firstLeaf));
+            node.firstLeaf = leaves.size() - 1;
+            return;
+        }
+
+        // The pending stack is shared between every branch of the walk, so each case pushes the children
+        // of the current pattern, descends, and pops them again, then the pattern itself is restored at the end.
+        const auto originalPattern = pendingPatterns.back();
+        pendingPatterns.pop_back();
+
+        // Captures don't affect whether a pattern matches, only what gets extracted afterward.
+        auto pattern = originalPattern;
+        while (const auto capture = pattern->tryGet<InstructionOperandPattern::Capture>()) {
+            pattern = capture->operandPattern.get();
+        }
+
+        switch (pattern->kind) {
+            case InstructionOperandPatternKind::BitIndex: {
+                const auto& bitIndex = pattern->bitIndex;
+                const auto child = addChild(nodeIndex, Key(InstructionOperandKind::BitIndex));
+                pendingPatterns.push_back(bitIndex.subscriptPattern.get());
+                pendingPatterns.push_back(bitIndex.operandPattern.get());
+                insert(child, pendingPatterns, instruction);
+                pendingPatterns.resize(pendingPatterns.size() - 2);
+                break;
+            }
+            case InstructionOperandPatternKind::Boolean: {
+                Key key(InstructionOperandKind::Boolean);
+                key.flag = pattern->boolean.value;
+                insert(addChild(nodeIndex, key), pendingPatterns, instruction);
+                break;
+            }
+            case InstructionOperandPatternKind::Dereference: {
+                const auto& dereference = pattern->dereference;
+                Key key(InstructionOperandKind::Dereference);
+                key.flag = dereference.far;
+                key.size = dereference.size;
+                const auto child = addChild(nodeIndex, key);
+                pendingPatterns.push_back(dereference.operandPattern.get());
+                insert(child, pendingPatterns, instruction);
+                pendingPatterns.pop_back();
+                break;
+            }
+            case InstructionOperandPatternKind::Index: {
+                const auto& index = pattern->index;
+                Key key(InstructionOperandKind::Index);
+                key.flag = index.far;
+                key.size = index.size;
+                key.subscriptScale = index.subscriptScale;
+                const auto child = addChild(nodeIndex, key);
+
+                // An unscaled index is commutative, so it's also reachable with operand and subscript swapped.
+                if (index.subscriptScale == 1) {
+                    pendingPatterns.push_back(index.operandPattern.get());
+                    pendingPatterns.push_back(index.subscriptPattern.get());
+                    insert(child, pendingPatterns, instruction);
+                    pendingPatterns.resize(pendingPatterns.size() - 2);
+                }
+
+                pendingPatterns.push_back(index.subscriptPattern.get());
+                pendingPatterns.push_back(index.operandPattern.get());
+                insert(child, pendingPatterns, instruction);
+                pendingPatterns.resize(pendingPatterns.size() - 2);
+                break;
+            }
+            case InstructionOperandPatternKind::IntegerAtLeast: {
+                const auto child = addIntegerChild(nodeIndex, pattern->integerAtLeast.min, Int128(0), false);
+                insert(child, pendingPatterns, instruction);
+                break;
+            }
+            case InstructionOperandPatternKind::IntegerRange: {
+                const auto& integerRange = pattern->integerRange;
+                const auto child = addIntegerChild(nodeIndex, integerRange.min, integerRange.max, true);
+                insert(child, pendingPatterns, instruction);
+                break;
+            }
+            case InstructionOperandPatternKind::Register: {
+                Key key(InstructionOperandKind::Register);
+                key.definition = pattern->register_.definition;
+                insert(addChild(nodeIndex, key), pendingPatterns, instruction);
+                break;
+            }
+            case InstructionOperandPatternKind::Unary: {
+                const auto& unary = pattern->unary;
+                Key key(InstructionOperandKind::Unary);
+                key.size = static_cast<std::size_t>(unary.kind);
+                const auto child = addChild(nodeIndex, key);
+                pendingPatterns.push_back(unary.operandPattern.get());
+                insert(child, pendingPatterns, instruction);
+                pendingPatterns.pop_back();
+                break;
+            }
+            default: std::abort(); break;
+        }
+
+        pendingPatterns.push_back(originalPattern);
+    }
+
+    void InstructionIndex::match(std::size_t nodeIndex, ArrayView<const InstructionOperand*> operands, std::size_t position, std::vector<const Instruction*>& results) const {
+        const auto& node = nodes[nodeIndex];
+
+        if (position == operands.size()) {
+            for (auto leafIndex = node.firstLeaf; leafIndex != NoIndex; leafIndex = leaves[leafIndex].next) {
+                const auto instruction = leaves[leafIndex].instruction;
+                if (std::find(results.begin(), results.end(), instruction) == results.end()) {
+                    results.push_back(instruction);
+                }
+            }
+            return;
+        }
+
+        const auto& operand = *operands[position];
+
+        if (const auto integerOperand = operand.tryGet<InstructionOperand::Integer>()) {
+            for (auto edgeIndex = node.firstIntegerEdge; edgeIndex != NoIndex; edgeIndex = integerEdges[edgeIndex].next) {
+                const auto& edge = integerEdges[edgeIndex];
+                if (edge.contains(integerOperand->value)) {
+                    match(edge.child, operands, position + 1, results);
+                }
+            }
+            return;
+        }
+
+        Key key(operand.kind);
+        switch (operand.kind) {
+            case InstructionOperandKind::Boolean: key.flag = operand.boolean.value; break;
+            case InstructionOperandKind::Dereference: key.flag = operand.dereference.far; key.size = operand.dereference.size; break;
+            case InstructionOperandKind::Index: key.flag = operand.index.far; key.size = operand.index.size; key.subscriptScale = operand.index.subscriptScale; break;
+            case InstructionOperandKind::Register: key.definition = operand.register_.definition; break;
+            case InstructionOperandKind::Unary: key.size = static_cast<std::size_t>(operand.unary.kind); break;
+            default: break;
+        }
+
+        for (auto edgeIndex = node.firstEdge; edgeIndex != NoIndex; edgeIndex = edges[edgeIndex].next) {
+            if (edges[edgeIndex].key == key) {
+                match(edges[edgeIndex].child, operands, position + 1, results);
+                return;
+            }
+        }
+    }
+}
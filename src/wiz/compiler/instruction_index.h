@@ -0,0 +1,116 @@
+#ifndef WIZ_COMPILER_INSTRUCTION_INDEX_H
+#define WIZ_COMPILER_INSTRUCTION_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <wiz/compiler/instruction.h>
+#include <wiz/utility/int128.h>
+#include <wiz/utility/array_view.h>
+
+namespace wiz {
+    // A discrimination tree over the operand patterns of instructions that share an InstructionType.
+    // Both patterns and operands are flattened in pre-order, so finding every matching instruction
+    // walks one edge per operand node, instead of testing each instruction signature in turn.
+    // Nodes are kept in flat arrays, and their edges in singly-linked lists threaded through shared arrays,
+    // so that building an index doesn't allocate per node. Nodes rarely have more than a few edges.
+    class InstructionIndex {
+        public:
+            void add(const Instruction* instruction);
+            void findAllMatches(ArrayView<InstructionOperandRoot> operandRoots, std::vector<const Instruction*>& results) const;
+
+            // Appends a key that is equal for any two operand lists that the indexed patterns cannot tell apart:
+            // the operand kinds, registers and sizes, and which of the index's integer ranges each integer falls into.
+            void appendShape(ArrayView<InstructionOperandRoot> operandRoots, std::string& shape) const;
+
+        private:
+            static const std::size_t NoIndex = SIZE_MAX;
+
+            struct Key {
+                Key(
+                    InstructionOperandKind kind)
+                : kind(kind) {}
+
+                bool operator ==(const Key& other) const;
+
+                InstructionOperandKind kind;
+                bool flag = false;
+                std::size_t size = 0;
+                std::size_t subscriptScale = 0;
+                const Definition* definition = nullptr;
+            };
+
+            struct Edge {
+                Edge(
+                    const Key& key,
+                    std::size_t child,
+                    std::size_t next)
+                : key(key),
+                child(child),
+                next(next) {}
+
+                Key key;
+                std::size_t child;
+                std::size_t next;
+            };
+
+            struct IntegerEdge {
+                IntegerEdge(
+                    Int128 min,
+                    Int128 max,
+                    bool bounded,
+                    std::size_t child,
+                    std::size_t next)
+                : min(min),
+                max(max),
+                bounded(bounded),
+                child(child),
+                next(next) {}
+
+                bool contains(Int128 value) const {
+                    return min <= value && (!bounded || value <= max);
+                }
+
+                Int128 min;
+                Int128 max;
+                bool bounded;
+                std::size_t child;
+                std::size_t next;
+            };
+
+            struct Leaf {
+                Leaf(
+                    const Instruction* instruction,
+                    std::size_t next)
+                : instruction(instruction),
+                next(next) {}
+
+                const Instruction* instruction;
+                std::size_t next;
+            };
+
+            struct Node {
+                std::size_t firstEdge = NoIndex;
+                std::size_t firstIntegerEdge = NoIndex;
+                std::size_t firstLeaf = NoIndex;
+            };
+
+            std::size_t addChild(std::size_t nodeIndex, const Key& key);
+            std::size_t addIntegerChild(std::size_t nodeIndex, Int128 min, Int128 max, bool bounded);
+            void insert(std::size_t nodeIndex, std::vector<const InstructionOperandPattern*>& pendingPatterns, const Instruction* instruction);
+            void match(std::size_t nodeIndex, ArrayView<const InstructionOperand*> operands, std::size_t position, std::vector<const Instruction*>& results) const;
+
+            std::vector<Node> nodes;
+            std::vector<Edge> edges;
+            std::vector<IntegerEdge> integerEdges;
+            std::vector<Leaf> leaves;
+            std::vector<const InstructionOperandPattern*> pendingPatterns;
+
+            // Every integer range boundary used by any indexed pattern, sorted.
+            std::vector<Int128> integerBounds;
+    };
+}
+
+#endif
@@ -1,3 +1,5 @@
+#include <new>
+
 #include <wiz/compiler/ir_node.h>
 
 namespace wiz {
@@ -6,6 +8,26 @@ namespace wiz {
         delete ptr;
     }
 
+    IrNode::IrNode(IrNode&& other)
+    : kind(other.kind),
+    location(other.location) {
+        switch (kind) {
+            case IrNodeKind::PushRelocation: new (&pushRelocation) PushRelocation(std::move(other.pushRelocation)); break;
+            case IrNodeKind::PopRelocation: new (&popRelocation) PopRelocation(std::move(other.popRelocation)); break;
+            case IrNodeKind::Label: new (&label) Label(std::move(other.label)); break;
+            case IrNodeKind::Code: new (&code) Code(std::move(other.code)); break;
+            case IrNodeKind::Var: new (&var) Var(std::move(other.var)); break;
+        }
+    }
+
+    IrNode& IrNode::operator =(IrNode&& other) {
+        if (this != &other) {
+            this->~IrNode();
+            new (this) IrNode(std::move(other));
+        }
+        return *this;
+    }
+
     IrNode::~IrNode() {
         switch (kind) {
             case IrNodeKind::PushRelocation: pushRelocation.~PushRelocation(); break;
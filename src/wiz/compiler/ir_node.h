@@ -9,6 +9,7 @@
 #include <wiz/compiler/instruction.h>
 #include <wiz/utility/macros.h>
 #include <wiz/utility/optional.h>
+#include <wiz/utility/array_view.h>
 #include <wiz/utility/fwd_unique_ptr.h>
 
 namespace wiz {
@@ -27,12 +28,16 @@ namespace wiz {
         struct PushRelocation {
             PushRelocation(
                 Bank* bank,
-                Optional<std::size_t> address)
+                Optional<std::size_t> address,
+                ArrayView<Bank*> placementBanks = ArrayView<Bank*>())
             : bank(bank),
-            address(address) {}
+            address(address),
+            placementBanks(placementBanks) {}
 
             Bank* bank;
             Optional<std::size_t> address;
+            // If there's more than one, layout picks which of these banks the relocated nodes go in, and `bank` is only the first of them.
+            ArrayView<Bank*> placementBanks;
         };
 
         struct PopRelocation {};
@@ -48,12 +53,13 @@ namespace wiz {
         struct Code {
             Code(
                 const Instruction* instruction,
-                std::vector<InstructionOperandRoot> operandRoots)
+                ArrayView<InstructionOperandRoot> operandRoots)
             : instruction(instruction),
-            operandRoots(std::move(operandRoots)) {}
+            operandRoots(operandRoots) {}
 
             const Instruction* instruction;
-            std::vector<InstructionOperandRoot> operandRoots;
+            // Operands are owned by the compiler's operand pool, so that nodes stay cheap to move.
+            ArrayView<InstructionOperandRoot> operandRoots;
         };
 
         struct Var {
@@ -99,6 +105,9 @@ namespace wiz {
         var(std::move(var)),
         location(sourceLocation) {}
 
+        IrNode(IrNode&& other);
+        IrNode& operator =(IrNode&& other);
+
         ~IrNode();
 
         template <typename T> const T* tryGet() const;
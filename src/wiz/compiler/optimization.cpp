@@ -0,0 +1,56 @@
+#include <wiz/compiler/optimization.h>
+
+namespace wiz {
+    namespace {
+        const char* const irPassNames[IrPassCount] = {
+            "remove-unused-definitions",
+            "remove-unreachable-code",
+            "remove-redundant-jumps",
+            "merge-constants",
+            "avoid-page-crossing",
+        };
+    }
+
+    StringView getIrPassName(IrPassKind kind) {
+        return StringView(irPassNames[static_cast<std::size_t>(kind)]);
+    }
+
+    Optional<IrPassKind> findIrPassKind(StringView name) {
+        for (std::size_t i = 0; i != IrPassCount; ++i) {
+            if (name == StringView(irPassNames[i])) {
+                return Optional<IrPassKind>(static_cast<IrPassKind>(i));
+            }
+        }
+        return Optional<IrPassKind>();
+    }
+
+    OptimizationOptions::OptimizationOptions() {
+        setLevel("1"_sv);
+    }
+
+    bool OptimizationOptions::setLevel(StringView level) {
+        if (level != "0"_sv && level != "1"_sv && level != "s"_sv && level != "2"_sv) {
+            return false;
+        }
+
+        // `2` is the only level that spends bytes on speed, by padding code and data away from page boundaries.
+        enabledPasses[static_cast<std::size_t>(IrPassKind::RemoveUnusedDefinitions)] = level == "s"_sv || level == "2"_sv;
+        enabledPasses[static_cast<std::size_t>(IrPassKind::RemoveUnreachableCode)] = level == "s"_sv || level == "2"_sv;
+        enabledPasses[static_cast<std::size_t>(IrPassKind::RemoveRedundantJumps)] = level != "0"_sv;
+        enabledPasses[static_cast<std::size_t>(IrPassKind::MergeConstants)] = level == "s"_sv || level == "2"_sv;
+        enabledPasses[static_cast<std::size_t>(IrPassKind::AvoidPageCrossing)] = level == "2"_sv;
+        return true;
+    }
+
+    bool OptimizationOptions::setPassEnabled(StringView name, bool enabled) {
+        if (const auto kind = findIrPassKind(name)) {
+            enabledPasses[static_cast<std::size_t>(*kind)] = enabled;
+            return true;
+        }
+        return false;
+    }
+
+    bool OptimizationOptions::isPassEnabled(IrPassKind kind) const {
+        return enabledPasses[static_cast<std::size_t>(kind)];
+    }
+}
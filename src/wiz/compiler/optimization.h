@@ -0,0 +1,64 @@
+#ifndef WIZ_COMPILER_OPTIMIZATION_H
+#define WIZ_COMPILER_OPTIMIZATION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <wiz/utility/optional.h>
+#include <wiz/utility/string_view.h>
+
+namespace wiz {
+    // Passes that rewrite the IR between emission and code generation, listed in the order they run.
+    // The exceptions are RemoveUnusedDefinitions, which runs on declarations before anything is emitted,
+    // and AvoidPageCrossing, which happens while code is being placed.
+    enum class IrPassKind {
+        RemoveUnusedDefinitions,
+        RemoveUnreachableCode,
+        RemoveRedundantJumps,
+        MergeConstants,
+        AvoidPageCrossing,
+
+        Count
+    };
+
+    static const std::size_t IrPassCount = static_cast<std::size_t>(IrPassKind::Count);
+
+    StringView getIrPassName(IrPassKind kind);
+    Optional<IrPassKind> findIrPassKind(StringView name);
+
+    // What a single IR pass did during compilation, for reporting with `--stats`.
+    struct IrPassStatistics {
+        IrPassStatistics(
+            IrPassKind kind,
+            std::size_t nodeCountBefore,
+            std::size_t nodeCountAfter,
+            std::uint64_t microseconds)
+        : kind(kind),
+        nodeCountBefore(nodeCountBefore),
+        nodeCountAfter(nodeCountAfter),
+        microseconds(microseconds) {}
+
+        IrPassKind kind;
+        std::size_t nodeCountBefore;
+        std::size_t nodeCountAfter;
+        std::uint64_t microseconds;
+    };
+
+    // Which IR passes the compiler runs. Starts out at the default level, `1`.
+    // A level selects a preset, and individual passes can then be switched on or off on top of it.
+    class OptimizationOptions {
+        public:
+            OptimizationOptions();
+
+            // Applies the preset for `0`, `1`, `s` or `2`. Returns false if the level is not recognized.
+            bool setLevel(StringView level);
+            // Returns false if there is no pass by that name.
+            bool setPassEnabled(StringView name, bool enabled);
+            bool isPassEnabled(IrPassKind kind) const;
+
+        private:
+            bool enabledPasses[IrPassCount];
+    };
+}
+
+#endif
@@ -0,0 +1,350 @@
+#include <map>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <wiz/ast/statement.h>
+#include <wiz/compiler/bank.h>
+#include <wiz/compiler/definition.h>
+#include <wiz/compiler/symbol_table.h>
+#include <wiz/format/bank_map.h>
+#include <wiz/utility/misc.h>
+#include <wiz/utility/path.h>
+#include <wiz/utility/text.h>
+#include <wiz/utility/writer.h>
+#include <wiz/utility/resource_manager.h>
+
+namespace wiz {
+    namespace {
+        // A run of reserved bytes that belong to the same symbol, or to the same kind of unnamed owner.
+        struct BankMapEntry {
+            BankMapEntry(
+                std::size_t start,
+                std::size_t end,
+                const Definition* definition,
+                const BankRegionOwner* owner)
+            : start(start),
+            end(end),
+            definition(definition),
+            owner(owner) {}
+
+            std::size_t start;
+            std::size_t end;
+            const Definition* definition;
+            const BankRegionOwner* owner;
+        };
+
+        struct BankMapGap {
+            BankMapGap(
+                std::size_t start,
+                std::size_t end)
+            : start(start),
+            end(end) {}
+
+            std::size_t start;
+            std::size_t end;
+        };
+
+        struct BankMap {
+            BankMap(const Bank* bank)
+            : bank(bank) {}
+
+            const Bank* bank;
+            std::vector<BankMapEntry> entries;
+            std::vector<BankMapGap> gaps;
+            std::size_t usedSize = 0;
+            std::size_t freeSize = 0;
+            std::size_t largestGapSize = 0;
+        };
+
+        // How much of the free space can't be used by something as big as the largest gap, as a percentage.
+        std::size_t calculateFragmentation(std::size_t freeSize, std::size_t largestGapSize) {
+            return freeSize != 0 ? (freeSize - largestGapSize) * 100 / freeSize : 0;
+        }
+
+        StringView getBankKindName(BankKind kind) {
+            switch (kind) {
+                case BankKind::UninitializedRam: return "vardata"_sv;
+                case BankKind::InitializedRam: return "varinitdata"_sv;
+                case BankKind::ProgramRom: return "prgdata"_sv;
+                case BankKind::DataRom: return "constdata"_sv;
+                case BankKind::CharacterRom: return "chrdata"_sv;
+                default: return "none"_sv;
+            }
+        }
+
+        StringView getSymbolKindName(const Definition* definition) {
+            if (definition->kind == DefinitionKind::Func) {
+                return definition->func.body != nullptr ? "func"_sv : "label"_sv;
+            }
+            return (definition->var.qualifiers & Qualifiers::Const) != Qualifiers::None ? "const"_sv : "var"_sv;
+        }
+
+        std::string getSymbolName(const Definition* definition) {
+            std::string fullName;
+            if (definition->parentScope != nullptr) {
+                fullName = definition->parentScope->getFullName();
+                if (!fullName.empty()) {
+                    fullName += '.';
+                }
+            }
+            fullName += definition->name.toString();
+            return fullName;
+        }
+
+        SourceLocation getEntryLocation(const BankMapEntry& entry) {
+            if (entry.definition != nullptr && entry.definition->declaration != nullptr) {
+                return entry.definition->declaration->location;
+            }
+            return entry.owner->location;
+        }
+
+        std::string formatAddress(const Bank* bank, std::size_t offset) {
+            const auto origin = bank->getOrigin();
+            return origin.hasValue()
+                ? "$" + text::padLeft(toHexString(origin.get() + offset), '0', 4)
+                : "+" + text::padLeft(toHexString(offset), '0', 4);
+        }
+
+        std::string escapeJsonString(StringView text) {
+            std::string result = "\"";
+            for (std::size_t i = 0; i != text.getLength(); ++i) {
+                const auto c = text[i];
+                if (c == '"' || c == '\\') {
+                    result += '\\';
+                    result += c;
+                } else if (static_cast<std::uint8_t>(c) < 0x20) {
+                    result += "\\u00" + text::padLeft(toHexString(static_cast<std::uint8_t>(c)), '0', 2);
+                } else {
+                    result += c;
+                }
+            }
+            result += '"';
+            return result;
+        }
+
+        // Symbols that can name a range: funcs, top-level labels and vars that were given storage in a bank.
+        // Labels inside of a func are part of the func, and names starting with `$` are generated by the compiler.
+        std::unordered_map<const Bank*, std::map<std::size_t, const Definition*>> collectBankSymbols(ArrayView<const Definition*> definitions) {
+            std::unordered_set<const SymbolTable*> funcScopes;
+            for (const auto definition : definitions) {
+                if (definition->kind == DefinitionKind::Func && definition->func.body != nullptr) {
+                    funcScopes.insert(definition->func.environment);
+                }
+            }
+
+            std::unordered_map<const Bank*, std::map<std::size_t, const Definition*>> result;
+            for (const auto definition : definitions) {
+                if (definition->kind != DefinitionKind::Func && definition->kind != DefinitionKind::Var) {
+                    continue;
+                }
+                if (definition->name.getLength() == 0 || definition->name[0] == '$') {
+                    continue;
+                }
+                if (definition->kind == DefinitionKind::Var
+                && ((definition->var.qualifiers & Qualifiers::Extern) != Qualifiers::None || definition->var.enclosingFunction != nullptr)) {
+                    continue;
+                }
+                if (definition->kind == DefinitionKind::Func && definition->func.body == nullptr) {
+                    bool nested = false;
+                    for (auto scope = definition->parentScope; scope != nullptr && !nested; scope = scope->getParent()) {
+                        nested = funcScopes.find(scope) != funcScopes.end();
+                    }
+                    if (nested) {
+                        continue;
+                    }
+                }
+
+                const auto address = definition->getAddress();
+                if (address.hasValue() && address->bank != nullptr && address->relativePosition.hasValue()) {
+                    // The first declared name wins when several share an address.
+                    result[address->bank].emplace(address->relativePosition.get(), definition);
+                }
+            }
+            return result;
+        }
+
+        // Ranges are grouped under the symbol that starts them, until the next symbol or a gap.
+        // Anything that doesn't start at a symbol, like local variable frames, is grouped by what reserved it.
+        BankMap buildBankMap(const Bank* bank, const std::map<std::size_t, const Definition*>& symbols) {
+            BankMap result(bank);
+
+            const Definition* currentSymbol = nullptr;
+            std::size_t position = 0;
+            for (const auto& range : bank->getOwnedRanges()) {
+                if (range.start != position) {
+                    result.gaps.push_back(BankMapGap(position, range.start));
+                    currentSymbol = nullptr;
+                }
+
+                const auto match = symbols.find(range.start);
+                if (match != symbols.end()) {
+                    currentSymbol = match->second;
+                }
+
+                auto& entries = result.entries;
+                if (!entries.empty() && entries.back().end == range.start
+                && (currentSymbol != nullptr
+                    ? entries.back().definition == currentSymbol
+                    : entries.back().definition == nullptr && entries.back().owner->description == range.owner->description)) {
+                    entries.back().end = range.end;
+                } else {
+                    entries.push_back(BankMapEntry(range.start, range.end, currentSymbol, range.owner));
+                }
+
+                result.usedSize += range.end - range.start;
+                position = range.end;
+            }
+
+            if (position < bank->getCapacity()) {
+                result.gaps.push_back(BankMapGap(position, bank->getCapacity()));
+            }
+
+            for (const auto& gap : result.gaps) {
+                const auto size = gap.end - gap.start;
+                result.freeSize += size;
+                result.largestGapSize = std::max(result.largestGapSize, size);
+            }
+
+            return result;
+        }
+
+        bool writeTextBankMap(Writer* writer, const std::vector<BankMap>& bankMaps) {
+            bool result = true;
+
+            for (const auto& bankMap : bankMaps) {
+                const auto bank = bankMap.bank;
+                result = result && writer->writeLine(StringView("bank `" + bank->getName().toString() + "` (" + getBankKindName(bank->getKind()).toString() + ")"
+                    + (bank->getOrigin().hasValue() ? " @ " + formatAddress(bank, 0) : "")
+                    + ": " + std::to_string(bankMap.usedSize) + " of " + std::to_string(bank->getCapacity()) + " byte(s) used, "
+                    + std::to_string(bankMap.freeSize) + " free in " + std::to_string(bankMap.gaps.size()) + " gap(s), largest gap "
+                    + std::to_string(bankMap.largestGapSize) + ", " + std::to_string(calculateFragmentation(bankMap.freeSize, bankMap.largestGapSize)) + "% fragmented"));
+
+                // Entries and gaps never overlap, so they can be listed together in order of address.
+                auto gap = bankMap.gaps.begin();
+                for (const auto& entry : bankMap.entries) {
+                    for (; gap != bankMap.gaps.end() && gap->start < entry.start; ++gap) {
+                        result = result && writer->writeLine(StringView("  " + formatAddress(bank, gap->start) + " "
+                            + text::padLeft(std::to_string(gap->end - gap->start), ' ', 6) + "  (free)"));
+                    }
+
+                    const auto location = getEntryLocation(entry).toString();
+                    result = result && writer->writeLine(StringView("  " + formatAddress(bank, entry.start) + " "
+                        + text::padLeft(std::to_string(entry.end - entry.start), ' ', 6) + "  "
+                        + (entry.definition != nullptr
+                            ? text::padRight(getSymbolKindName(entry.definition).toString(), ' ', 6) + getSymbolName(entry.definition)
+                            : "(" + entry.owner->description.toString() + ")")
+                        + (location.empty() ? "" : "  " + location)));
+                }
+                for (; gap != bankMap.gaps.end(); ++gap) {
+                    result = result && writer->writeLine(StringView("  " + formatAddress(bank, gap->start) + " "
+                        + text::padLeft(std::to_string(gap->end - gap->start), ' ', 6) + "  (free)"));
+                }
+
+                result = result && writer->writeLine(""_sv);
+            }
+
+            // ROM and RAM are budgeted separately, since running out of one can't be solved with room in the other.
+            for (const auto rom : {true, false}) {
+                std::size_t bankCount = 0;
+                std::size_t capacity = 0;
+                std::size_t usedSize = 0;
+                std::size_t freeSize = 0;
+                std::size_t largestGapSize = 0;
+                for (const auto& bankMap : bankMaps) {
+                    const auto kind = bankMap.bank->getKind();
+                    if ((kind == BankKind::UninitializedRam || kind == BankKind::InitializedRam) != rom) {
+                        ++bankCount;
+                        capacity += bankMap.bank->getCapacity();
+                        usedSize += bankMap.usedSize;
+                        freeSize += bankMap.freeSize;
+                        largestGapSize = std::max(largestGapSize, bankMap.largestGapSize);
+                    }
+                }
+
+                if (bankCount != 0) {
+                    result = result && writer->writeLine(StringView(std::string(rom ? "rom" : "ram") + ": "
+                        + std::to_string(usedSize) + " of " + std::to_string(capacity) + " byte(s) used across " + std::to_string(bankCount) + " bank(s), "
+                        + std::to_string(freeSize) + " free, largest gap " + std::to_string(largestGapSize)));
+                }
+            }
+
+            return result;
+        }
+
+        bool writeJsonBankMap(Writer* writer, const std::vector<BankMap>& bankMaps) {
+            bool result = writer->writeLine("{"_sv);
+            result = result && writer->writeLine("  \"banks\": ["_sv);
+
+            for (std::size_t i = 0; i != bankMaps.size(); ++i) {
+                const auto& bankMap = bankMaps[i];
+                const auto bank = bankMap.bank;
+                const auto origin = bank->getOrigin();
+
+                std::string text = "    {\n";
+                text += "      \"name\": " + escapeJsonString(bank->getName()) + ",\n";
+                text += "      \"kind\": " + escapeJsonString(getBankKindName(bank->getKind())) + ",\n";
+                text += "      \"origin\": " + (origin.hasValue() ? std::to_string(origin.get()) : "null") + ",\n";
+                text += "      \"capacity\": " + std::to_string(bank->getCapacity()) + ",\n";
+                text += "      \"used\": " + std::to_string(bankMap.usedSize) + ",\n";
+                text += "      \"free\": " + std::to_string(bankMap.freeSize) + ",\n";
+                text += "      \"largestGap\": " + std::to_string(bankMap.largestGapSize) + ",\n";
+                text += "      \"fragmentation\": " + std::to_string(calculateFragmentation(bankMap.freeSize, bankMap.largestGapSize)) + ",\n";
+
+                text += "      \"ranges\": [";
+                for (std::size_t j = 0; j != bankMap.entries.size(); ++j) {
+                    const auto& entry = bankMap.entries[j];
+                    const auto location = getEntryLocation(entry);
+                    text += std::string(j != 0 ? "," : "") + "\n        {"
+                        "\"offset\": " + std::to_string(entry.start) + ", "
+                        "\"size\": " + std::to_string(entry.end - entry.start) + ", "
+                        "\"kind\": " + escapeJsonString(entry.definition != nullptr ? getSymbolKindName(entry.definition) : entry.owner->description) + ", "
+                        "\"symbol\": " + (entry.definition != nullptr ? escapeJsonString(StringView(getSymbolName(entry.definition))) : "null") + ", "
+                        "\"file\": " + (location.displayPath.getLength() != 0 ? escapeJsonString(location.displayPath) : "null") + ", "
+                        "\"line\": " + (location.line != 0 ? std::to_string(location.line) : "null") + "}";
+                }
+                text += bankMap.entries.empty() ? "],\n" : "\n      ],\n";
+
+                text += "      \"gaps\": [";
+                for (std::size_t j = 0; j != bankMap.gaps.size(); ++j) {
+                    const auto& gap = bankMap.gaps[j];
+                    text += std::string(j != 0 ? "," : "") + "\n        {"
+                        "\"offset\": " + std::to_string(gap.start) + ", "
+                        "\"size\": " + std::to_string(gap.end - gap.start) + "}";
+                }
+                text += bankMap.gaps.empty() ? "]\n" : "\n      ]\n";
+
+                text += i + 1 != bankMaps.size() ? "    }," : "    }";
+                result = result && writer->writeLine(StringView(text));
+            }
+
+            result = result && writer->writeLine("  ]"_sv);
+            result = result && writer->writeLine("}"_sv);
+            return result;
+        }
+    }
+
+    bool writeBankMap(ResourceManager* resourceManager, StringView mapFileName, ArrayView<const Bank*> banks, ArrayView<const Definition*> definitions) {
+        auto writer = resourceManager->openWriter(mapFileName);
+        if (!writer || !writer->isOpen()) {
+            return false;
+        }
+
+        const auto bankSymbols = collectBankSymbols(definitions);
+        const std::map<std::size_t, const Definition*> noSymbols;
+
+        std::vector<BankMap> bankMaps;
+        for (const auto bank : banks) {
+            const auto match = bankSymbols.find(bank);
+            bankMaps.push_back(buildBankMap(bank, match != bankSymbols.end() ? match->second : noSymbols));
+        }
+
+        if (path::getExtension(mapFileName) == "json"_sv) {
+            return writeJsonBankMap(writer.get(), bankMaps);
+        } else {
+            return writeTextBankMap(writer.get(), bankMaps);
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef WIZ_FORMAT_BANK_MAP_H
+#define WIZ_FORMAT_BANK_MAP_H
+
+#include <wiz/utility/array_view.h>
+#include <wiz/utility/string_view.h>
+
+namespace wiz {
+    class Bank;
+    class ResourceManager;
+    struct Definition;
+
+    // Writes what was placed in each bank and where, along with the free space left between, so that ROM and RAM can be budgeted.
+    // Written as JSON if the filename ends in `.json`, and as text otherwise.
+    bool writeBankMap(ResourceManager* resourceManager, StringView mapFileName, ArrayView<const Bank*> banks, ArrayView<const Definition*> definitions);
+}
+
+#endif
@@ -11,7 +11,6 @@ namespace wiz {
         const auto report = context.report;
         const auto config = context.config;
         const auto& banks = context.banks;
-        auto& data = context.data;
 
         const auto trim = config->checkBoolean(report, "trim"_sv, false);
         std::size_t trimmedBankIndex = SIZE_MAX;
@@ -27,11 +26,7 @@ namespace wiz {
 
         for (std::size_t i = 0; i != banks.size(); ++i) {
             const auto& bank = banks[i];            
-            const auto bankData = trimmedBankIndex == i ? bank->getUsedData() : bank->getData();
-
-            context.bankOffsets[bank] = data.size();
-            data.reserve(data.size() + bankData.size());
-            data.insert(data.end(), bankData.begin(), bankData.end());
+            context.appendBank(bank, trimmedBankIndex == i);
         }
 
         return true;
@@ -1,3 +1,4 @@
+#include <wiz/compiler/bank.h>
 #include <wiz/format/output/output_format.h>
 #include <wiz/format/output/binary_output_format.h>
 #include <wiz/format/output/gb_output_format.h>
@@ -13,6 +14,19 @@ namespace wiz {
             : Optional<std::size_t>();
     }
 
+    void OutputFormatContext::appendBank(const Bank* bank, bool trimmed) {
+        bankOffsets[bank] = data.size();
+
+        if (!isBankKindStored(bank->getKind())) {
+            return;
+        }
+
+        const auto size = trimmed ? bank->calculateUsedSize() : bank->getCapacity();
+        const auto storedData = bank->getStoredData().sub(0, size);
+        data.appendView(storedData);
+        data.appendFill(size - storedData.size(), bank->getPadValue());
+    }
+
 
 
     OutputFormatCollection::OutputFormatCollection() {
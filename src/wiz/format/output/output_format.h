@@ -8,6 +8,7 @@
 #include <wiz/utility/string_view.h>
 #include <wiz/utility/array_view.h>
 #include <wiz/utility/fwd_unique_ptr.h>
+#include <wiz/utility/segmented_buffer.h>
 
 namespace wiz {
     class Bank;
@@ -30,6 +31,9 @@ namespace wiz {
         banks(banks) {}
 
         Optional<std::size_t> getOutputOffset(Address address) const;
+        // Adds a bank to the end of the output without copying it, padding out the rest of its capacity.
+        // If trimmed, stops after the last reserved byte instead. Banks that aren't stored add nothing.
+        void appendBank(const Bank* bank, bool trimmed);
 
         Report* report;
         StringPool* stringPool;
@@ -47,7 +51,7 @@ namespace wiz {
         std::size_t debugBankSize = 65536;
 
         std::unordered_map<const Bank*, std::size_t> bankOffsets;
-        std::vector<std::uint8_t> data;
+        SegmentedBuffer data;
     };
 
     class OutputFormat {
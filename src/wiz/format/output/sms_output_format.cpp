@@ -22,11 +22,7 @@ namespace wiz {
         auto& data = context.data;
         
         for (const auto& bank : banks) {
-            const auto bankData = bank->getData();
-
-            context.bankOffsets[bank] = data.size();
-            data.reserve(data.size() + bankData.size());
-            data.insert(data.end(), bankData.begin(), bankData.end());
+            context.appendBank(bank, false);
         }
 
         std::size_t headerAddress = 0x1FF0;
@@ -48,8 +44,8 @@ namespace wiz {
             }
         }
 
-        memset(&data[headerAddress], 0, 0x10);
-        memcpy(&data[headerAddress], HeaderSignature.getData(), HeaderSignature.getLength());
+        memset(data.getWritableRange(headerAddress, 0x10), 0, 0x10);
+        memcpy(data.getWritableRange(headerAddress, HeaderSignature.getLength()), HeaderSignature.getData(), HeaderSignature.getLength());
 
         if (const auto productCode = config->checkInteger(report, "product_code"_sv, false)) {
             if (Int128(0) <= productCode->second && productCode->second <= Int128(159999)) {
@@ -95,12 +91,8 @@ namespace wiz {
             data[headerAddress + 0xF] |= setting << 4;
         }
 
-        std::uint16_t checksum = 0;
-        for (std::size_t i = 0, size = data.size(); i != size; ++i) {
-            if (i < headerAddress || i >= headerAddress + HeaderSize) {
-                checksum += data[i];
-            }
-        }
+        const auto headerEnd = headerAddress + HeaderSize;
+        const auto checksum = static_cast<std::uint16_t>(data.sum(0, headerAddress) + data.sum(headerEnd, data.size() - headerEnd));
         data[headerAddress + 0xA] = (checksum >> 8) & 0xFF;
         data[headerAddress + 0xB] = checksum & 0xFF;
 
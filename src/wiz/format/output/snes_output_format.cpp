@@ -90,11 +90,7 @@ namespace wiz {
         auto& data = context.data;
 
         for (const auto& bank : banks) {
-            const auto bankData = bank->getData();
-
-            context.bankOffsets[bank] = data.size();
-            data.reserve(data.size() + bankData.size());
-            data.insert(data.end(), bankData.begin(), bankData.end());
+            context.appendBank(bank, false);
         }
         
         std::uint8_t mapModeSetting = 0x20;
@@ -120,19 +116,19 @@ namespace wiz {
             data.resize(minRomSize, 0xFF);
         }
 
-        memset(&data[headerAddress + 0xB0], ' ', 6);
-        memset(&data[headerAddress + 0xB6], 0, SnesHeaderSize - 6);
-        memset(&data[headerAddress + 0xC0], ' ', SnesTitleMaxLength);
+        memset(data.getWritableRange(headerAddress + 0xB0, 6), ' ', 6);
+        memset(data.getWritableRange(headerAddress + 0xB6, SnesHeaderSize - 6), 0, SnesHeaderSize - 6);
+        memset(data.getWritableRange(headerAddress + 0xC0, SnesTitleMaxLength), ' ', SnesTitleMaxLength);
         data[headerAddress + 0xD5] = mapModeSetting;
         data[headerAddress + 0xDA] = 0x33;
         data[headerAddress + 0xDC] = 0xFF;
         data[headerAddress + 0xDD] = 0xFF;
 
         if (const auto makerCode = config->checkFixedString(report, "maker_code"_sv, 2, false)) {
-            memcpy(&data[headerAddress + 0xB0], makerCode->second.getData(), makerCode->second.getLength());
+            memcpy(data.getWritableRange(headerAddress + 0xB0, makerCode->second.getLength()), makerCode->second.getData(), makerCode->second.getLength());
         }
         if (const auto gameCode = config->checkFixedString(report, "game_code"_sv, 4, false)) {
-            memcpy(&data[headerAddress + 0xB2], gameCode->second.getData(), gameCode->second.getLength());
+            memcpy(data.getWritableRange(headerAddress + 0xB2, gameCode->second.getLength()), gameCode->second.getData(), gameCode->second.getLength());
         }
         if (const auto expansionRamSize = config->checkInteger(report, "expansion_ram_size"_sv, false)) {
             const auto value = static_cast<std::size_t>(expansionRamSize->second);
@@ -156,7 +152,7 @@ namespace wiz {
             data[headerAddress + 0xBF] = static_cast<std::uint8_t>(cartSubType->second);
         }
         if (const auto title = config->checkFixedString(report, "title"_sv, SnesTitleMaxLength, false)) {
-            memcpy(&data[headerAddress + 0xC0], title->second.getData(), title->second.getLength());
+            memcpy(data.getWritableRange(headerAddress + 0xC0, title->second.getLength()), title->second.getData(), title->second.getLength());
         }
 
         {
@@ -247,20 +243,14 @@ namespace wiz {
             const auto dataSize = data.size();
             const auto wholeSize = static_cast<std::size_t>(1) << log2(dataSize);
 
-            std::uint16_t checksum = 0;
-            for (std::size_t i = 0; i != wholeSize; ++i) {
-                checksum += data[i];
-            }
+            auto checksum = static_cast<std::uint16_t>(data.sum(0, wholeSize));
 
             const auto remainderSize = dataSize - wholeSize;
             if (remainderSize != 0) {
                 const auto repeatSize = static_cast<std::size_t>(1) << log2(remainderSize);
                 const auto repeatCount = repeatSize != 0 ? remainderSize / repeatSize : 0;
 
-                std::uint16_t repeatChecksum = 0;
-                for (std::size_t i = 0; i != repeatSize; ++i) {
-                    repeatChecksum += data[wholeSize + i];
-                }
+                const auto repeatChecksum = static_cast<std::uint16_t>(data.sum(wholeSize, repeatSize));
 
                 checksum += static_cast<std::uint16_t>(repeatChecksum * repeatCount);
             }
@@ -290,7 +280,7 @@ namespace wiz {
         std::size_t romSize = data.size();
         std::size_t smcRomBlockCount = romSize / SmcRomBlockSize;
 
-        data.insert(data.end(), SmcHeaderSize, 0);
+        data.appendFill(SmcHeaderSize, 0);
                 
         // I can't seem to find any open documentation on other data that is supposed to be in the SMC headers.
         // Let's just put the number of 8K blocks and be done, seems like some SMCs will do this.
@@ -468,7 +468,7 @@ namespace wiz {
     }
 
     FwdUniquePtr<const Statement> Parser::parseInStatement() {
-        // relocation = `in` (IDENTIFIER (`.` IDENTIFIER)*) (`,` expression)? block
+        // relocation = `in` (IDENTIFIER (`.` IDENTIFIER)*) (`,` IDENTIFIER (`.` IDENTIFIER)*)* (`@` expression)? block
         const auto location = scanner->getLocation();
         FwdUniquePtr<const Expression> dest;
         
@@ -494,6 +494,13 @@ namespace wiz {
             }                
         }
 
+        // (`,` identifier)*
+        std::vector<std::vector<StringView>> alternatePieces;
+        while (token.type == TokenType::Comma) {
+            nextToken(); // `,`
+            alternatePieces.push_back(parseQualifiedIdentifier());
+        }
+
         // (@ expr)?
         if (token.type == TokenType::At) {
             nextToken(); // @
@@ -501,7 +508,7 @@ namespace wiz {
         }
         
         auto block = parseBlockStatement(); // block
-        return makeFwdUnique<const Statement>(Statement::In(pieces, std::move(dest), std::move(block)), location);
+        return makeFwdUnique<const Statement>(Statement::In(pieces, alternatePieces, std::move(dest), std::move(block)), location);
     }
 
     FwdUniquePtr<const Statement> Parser::parseBlockStatement() {
@@ -181,13 +181,13 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(captureLists);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 return true;
             });
         const auto encodingU8Operand = builtins.createInstructionEncoding(
@@ -195,12 +195,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                 return true;
             });
@@ -209,13 +209,13 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
                 
                 const auto value = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
                 buffer.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
                 return true;
@@ -225,8 +225,8 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                buffer.append(options.opcode);
 
                 const auto base = static_cast<std::int32_t>(bank->getAddress().absolutePosition.get() & 0xFFFF);
                 const auto dest = static_cast<std::int32_t>(captureLists[options.parameter[0]][0]->integer.value);
@@ -246,14 +246,14 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[0]][0]->integer.value) * options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                 }
                 return true;
             });
@@ -261,7 +261,7 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[1]][0]->integer.value) * (options.opcode.size() + 1);
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -269,7 +269,7 @@ namespace wiz {
                 const auto value = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(value);
                 }
                 return true;
@@ -278,7 +278,7 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[1]][0]->integer.value) * (options.opcode.size() + 2);
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -286,7 +286,7 @@ namespace wiz {
                 const auto value = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
                     buffer.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
                 }
@@ -297,7 +297,7 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -307,7 +307,7 @@ namespace wiz {
                 // n = $2th capture of $1
                 const auto zp = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto n = static_cast<std::uint8_t>(captureLists[options.parameter[1]][options.parameter[2]]->integer.value);
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer[buffer.size() - 1] |= static_cast<std::uint8_t>(n << 4);
                 buffer.push_back(zp);
                 return true;
@@ -559,14 +559,14 @@ namespace wiz {
                     static_cast<void>(captureLists);
                     return options.opcode.size() + 2;
                 },
-                [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                     // goto dest if *(zp) $ n
                     // zp = 0th capture of $0
                     // n = $2th capture of $1
                     // dest = 0th capture of $3
                     const auto zp = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                     const auto n = static_cast<std::uint8_t>(captureLists[options.parameter[1]][options.parameter[2]]->integer.value);
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer[buffer.size() - 1] |= static_cast<std::uint8_t>(n << 4);
                     buffer.push_back(zp);
 
@@ -589,7 +589,7 @@ namespace wiz {
                     static_cast<void>(captureLists);
                     return options.opcode.size() + 3;
                 },
-                [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                     static_cast<void>(report);
                     static_cast<void>(bank);
                     static_cast<void>(location);
@@ -601,7 +601,7 @@ namespace wiz {
                     const auto zp = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                     const auto n = static_cast<std::uint8_t>(captureLists[options.parameter[1]][options.parameter[2]]->integer.value);
                     const auto dest = static_cast<std::uint16_t>(captureLists[options.parameter[3]][0]->integer.value);
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer[0] |= static_cast<std::uint8_t>(n << 4);
                     buffer.push_back(zp);
                     buffer.push_back(static_cast<std::uint8_t>(dest & 0xFF));
@@ -664,14 +664,14 @@ namespace wiz {
                     static_cast<void>(captureLists);
                     return options.opcode.size() + 2;
                 },
-                [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                     static_cast<void>(report);
                     static_cast<void>(bank);
                     static_cast<void>(location);
 
                     const auto mask = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                     const auto source = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(mask);
                     buffer.push_back(source);
                     return true;
@@ -681,14 +681,14 @@ namespace wiz {
                     static_cast<void>(captureLists);
                     return options.opcode.size() + 3;
                 },
-                [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                     static_cast<void>(report);
                     static_cast<void>(bank);
                     static_cast<void>(location);
 
                     const auto mask = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                     const auto source = static_cast<std::uint16_t>(captureLists[options.parameter[1]][0]->integer.value);
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(mask);
                     buffer.push_back(static_cast<std::uint8_t>(source & 0xFF));
                     buffer.push_back(static_cast<std::uint8_t>((source >> 8) & 0xFF));
@@ -699,7 +699,7 @@ namespace wiz {
                     static_cast<void>(captureLists);
                     return options.opcode.size() + 6;
                 },
-                [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                     static_cast<void>(report);
                     static_cast<void>(bank);
                     static_cast<void>(location);
@@ -707,7 +707,7 @@ namespace wiz {
                     const auto src = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
                     const auto dest = static_cast<std::uint16_t>(captureLists[options.parameter[1]][0]->integer.value);
                     const auto length = static_cast<std::uint16_t>(captureLists[options.parameter[2]][0]->integer.value);
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(static_cast<std::uint8_t>(src & 0xFF));
                     buffer.push_back(static_cast<std::uint8_t>((src >> 8) & 0xFF));
                     buffer.push_back(static_cast<std::uint8_t>(dest & 0xFF));
@@ -721,14 +721,14 @@ namespace wiz {
                     static_cast<void>(captureLists);
                     return options.opcode.size() + 2;
                 },
-                [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                     static_cast<void>(report);
                     static_cast<void>(bank);
                     static_cast<void>(location);
 
                     const auto mask = static_cast<std::uint8_t>(1 << static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                     const auto source = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(mask);
                     buffer.push_back(source);
                     return true;
@@ -738,14 +738,14 @@ namespace wiz {
                     static_cast<void>(captureLists);
                     return options.opcode.size() + 3;
                 },
-                [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                     static_cast<void>(report);
                     static_cast<void>(bank);
                     static_cast<void>(location);
 
                     const auto mask = static_cast<std::uint8_t>(1 << static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                     const auto source = static_cast<std::uint16_t>(captureLists[options.parameter[1]][0]->integer.value);
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(mask);
                     buffer.push_back(static_cast<std::uint8_t>(source & 0xFF));
                     buffer.push_back(static_cast<std::uint8_t>((source >> 8) & 0xFF));
@@ -1076,4 +1076,9 @@ namespace wiz {
     Int128 Mos6502Platform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
+
+    bool Mos6502Platform::hasPageCrossingPenalty() const {
+        // The HuC6280 takes the same number of cycles whether or not a page is crossed.
+        return revision != Revision::Huc6280;
+    }
 }
@@ -23,6 +23,7 @@ namespace wiz {
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const override;
             Definition* getZeroFlag() const override;
             Int128 getPlaceholderValue() const override;
+            bool hasPageCrossingPenalty() const override;
 
         private:
             Revision revision;
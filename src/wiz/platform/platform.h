@@ -63,6 +63,8 @@ namespace wiz {
             virtual std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const = 0;
             virtual Definition* getZeroFlag() const = 0;
             virtual Int128 getPlaceholderValue() const = 0;
+            // Returns true if indexed reads and taken branches cost extra cycles when they cross into another 256-byte page.
+            virtual bool hasPageCrossingPenalty() const = 0;
     };
 
     class PlatformCollection {
@@ -164,13 +164,13 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(captureLists);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 return true;
             });
         const auto encodingU8Operand = builtins.createInstructionEncoding(
@@ -178,12 +178,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                 return true;
             });
@@ -192,12 +192,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 const auto value = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
                 buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
                 buffer.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
@@ -208,12 +208,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value));
                 return true;
@@ -223,8 +223,8 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                buffer.append(options.opcode);
 
                 const auto base = static_cast<std::int32_t>(bank->getAddress().absolutePosition.get() & 0xFFFF);
                 const auto dest = static_cast<std::int32_t>(captureLists[options.parameter[0]][0]->integer.value);
@@ -245,8 +245,8 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                buffer.append(options.opcode);
 
                 const auto base = static_cast<std::int32_t>(bank->getAddress().absolutePosition.get());
                 const auto dest = static_cast<std::int32_t>(captureLists[options.parameter[0]][0]->integer.value);
@@ -270,10 +270,10 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(bank);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
 
                 const auto i8val = static_cast<int>(captureLists[options.parameter[0]][0]->integer.value);
                 if (i8val >= -128 && i8val <= 127) {
@@ -291,14 +291,14 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[0]][0]->integer.value) * options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                 }
                 return true;
             });
@@ -306,7 +306,7 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[1]][0]->integer.value) * (options.opcode.size() + 1);
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -314,7 +314,7 @@ namespace wiz {
                 const auto value = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(value);
                 }
                 return true;
@@ -781,5 +781,9 @@ namespace wiz {
     Int128 PokemonMiniPlatform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
+
+    bool PokemonMiniPlatform::hasPageCrossingPenalty() const {
+        return false;
+    }
 }
 #endif
\ No newline at end of file
@@ -230,13 +230,13 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
                 static_cast<void>(captureLists);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 return true;
             });
         const auto encodingU8Operand = builtins.createInstructionEncoding(
@@ -244,12 +244,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                 return true;
             });
@@ -258,12 +258,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
 
                 const auto value = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
                 buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
@@ -275,8 +275,8 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                buffer.append(options.opcode);
 
                 const auto base = static_cast<std::int32_t>(bank->getAddress().absolutePosition.get() & 0xFFFF);
                 const auto dest = static_cast<std::int32_t>(captureLists[options.parameter[0]][0]->integer.value);
@@ -297,8 +297,8 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
 
                 const auto base = static_cast<int>(bank->getAddress().absolutePosition.get());
@@ -320,7 +320,7 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -330,7 +330,7 @@ namespace wiz {
                 // n = $2th capture of $1
                 const auto zp = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto n = static_cast<std::uint8_t>(captureLists[options.parameter[1]][options.parameter[2]]->integer.value);
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer[buffer.size() - 1] |= static_cast<std::uint8_t>(n << 5);
                 buffer.push_back(zp);
                 return true;
@@ -340,14 +340,14 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 // goto dest if *(zp) $ n
                 // zp = 0th capture of $0
                 // n = $2th capture of $1
                 // dest = 0th capture of $3
                 const auto zp = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto n = static_cast<std::uint8_t>(captureLists[options.parameter[1]][options.parameter[2]]->integer.value);
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer[0] |= static_cast<std::uint8_t>(n << 4);
                 buffer.push_back(zp);
 
@@ -370,7 +370,7 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(bank);
 
                 // *(abs) $ n bit-wise access.
@@ -381,7 +381,7 @@ namespace wiz {
 
                 if (abs < 0x2000) {
                     const auto value = static_cast<std::uint16_t>((abs & 0x1FFF) | (n << 13U));
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(value & 0xFF);
                     buffer.push_back((value >> 8) & 0xFF);
                     return true;
@@ -395,14 +395,14 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[0]][0]->integer.value) * options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                 }
                 return true;
             });
@@ -410,7 +410,7 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[1]][0]->integer.value) * (options.opcode.size() + 1);
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -418,7 +418,7 @@ namespace wiz {
                 const auto value = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(value);
                 }
                 return true;
@@ -427,7 +427,7 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[1]][0]->integer.value) * (options.opcode.size() + 2);
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -435,7 +435,7 @@ namespace wiz {
                 const auto value = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
                     buffer.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
                 }
@@ -446,12 +446,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value));
                 return true;
@@ -757,9 +757,9 @@ namespace wiz {
                     if (const auto leftRegister = left->tryGet<Expression::ResolvedIdentifier>()) {
                         if (leftRegister->definition == a) {
                             std::vector<InstructionOperandRoot> operandRoots;
-                            operandRoots.push_back(InstructionOperandRoot(left, makeFwdUnique<InstructionOperand>(InstructionOperand::Register(a))));
+                            operandRoots.push_back(InstructionOperandRoot(left, compiler.createOperand(InstructionOperand::Register(a))));
                             operandRoots.push_back(InstructionOperandRoot(right, compiler.createOperandFromExpression(right, true)));
-                            operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(0x1234))))); 
+                            operandRoots.push_back(InstructionOperandRoot(nullptr, compiler.createOperand(InstructionOperand::Integer(Int128(0x1234))))); 
 
                             if (compiler.getBuiltins().selectInstruction(InstructionType::VoidIntrinsic(cmp_branch_not_equal), 0, operandRoots)) {
                                 return std::make_unique<PlatformTestAndBranch>(
@@ -880,4 +880,8 @@ namespace wiz {
     Int128 Spc700Platform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
+
+    bool Spc700Platform::hasPageCrossingPenalty() const {
+        return false;
+    }
 }
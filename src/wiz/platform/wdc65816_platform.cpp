@@ -528,13 +528,13 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(captureLists);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 return true;
             });
         const auto encodingU8Operand = builtins.createInstructionEncoding(
@@ -542,12 +542,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                 return true;
             });
@@ -556,12 +556,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value) ^ 0xFF);
                 return true;
             });
@@ -570,12 +570,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 const auto value = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
                 buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
                 buffer.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
@@ -586,12 +586,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 3;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 const auto value = static_cast<std::uint32_t>(captureLists[options.parameter[0]][0]->integer.value);
                 buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
                 buffer.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
@@ -603,8 +603,8 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 1;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                buffer.append(options.opcode);
 
                 const auto base = static_cast<std::int32_t>(bank->getAddress().absolutePosition.get() & 0xFFFF);
                 const auto dest = static_cast<std::int32_t>(captureLists[options.parameter[0]][0]->integer.value);
@@ -625,8 +625,8 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+                buffer.append(options.opcode);
 
                 const auto base = static_cast<std::int32_t>(bank->getAddress().absolutePosition.get() & 0xFFFF);
                 const auto dest = static_cast<std::int32_t>(captureLists[options.parameter[0]][0]->integer.value);
@@ -649,14 +649,14 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[0]][0]->integer.value) * options.opcode.size();
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                 }
                 return true;
             });
@@ -664,7 +664,7 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[1]][0]->integer.value) * (options.opcode.size() + 1);
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -672,7 +672,7 @@ namespace wiz {
                 const auto value = static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(value);
                 }
                 return true;
@@ -681,7 +681,7 @@ namespace wiz {
             [](const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists) {
                 return static_cast<std::size_t>(captureLists[options.parameter[1]][0]->integer.value) * (options.opcode.size() + 2);
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
@@ -689,7 +689,7 @@ namespace wiz {
                 const auto value = static_cast<std::uint16_t>(captureLists[options.parameter[0]][0]->integer.value);
                 const auto count = static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value);
                 for (std::size_t i = 0; i != count; ++i) {
-                    buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                    buffer.append(options.opcode);
                     buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
                     buffer.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
                 }
@@ -700,12 +700,12 @@ namespace wiz {
                 static_cast<void>(captureLists);
                 return options.opcode.size() + 2;
             },
-            [](Report* report, const Bank* bank, std::vector<std::uint8_t>& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
+            [](Report* report, const Bank* bank, BankWriter& buffer, const InstructionOptions& options, const std::vector<std::vector<const InstructionOperand*>>& captureLists, SourceLocation location) {
                 static_cast<void>(report);
                 static_cast<void>(bank);
                 static_cast<void>(location);
 
-                buffer.insert(buffer.end(), options.opcode.begin(), options.opcode.end());
+                buffer.append(options.opcode);
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[0]][0]->integer.value));
                 buffer.push_back(static_cast<std::uint8_t>(captureLists[options.parameter[1]][0]->integer.value));
                 return true;
@@ -1378,4 +1378,8 @@ namespace wiz {
     Int128 Wdc65816Platform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
+
+    bool Wdc65816Platform::hasPageCrossingPenalty() const {
+        return true;
+    }
 }
\ No newline at end of file
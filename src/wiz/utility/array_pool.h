@@ -0,0 +1,45 @@
+#ifndef WIZ_UTILITY_ARRAY_POOL_H
+#define WIZ_UTILITY_ARRAY_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+#include <wiz/utility/macros.h>
+#include <wiz/utility/array_view.h>
+
+namespace wiz {
+    // Packs many small arrays back-to-back into large chunks, rather than giving each its own heap allocation.
+    // Chunks are never reallocated once created, so views returned by add() remain valid until the pool is cleared.
+    // add() copies from any contiguous range, so callers can build small arrays on the stack rather than in a temporary vector.
+    template <typename T>
+    class ArrayPool {
+        public:
+            static const std::size_t DefaultChunkSize = 4096;
+
+            ArrayView<T> add(ArrayView<T> items) {
+                const auto count = items.size();
+                if (count == 0) {
+                    return ArrayView<T>();
+                }
+
+                if (chunks.empty() || chunks.back().capacity() - chunks.back().size() < count) {
+                    chunks.emplace_back();
+                    chunks.back().reserve(count > DefaultChunkSize ? count : DefaultChunkSize);
+                }
+
+                auto& chunk = chunks.back();
+                const auto offset = chunk.size();
+                chunk.insert(chunk.end(), items.begin(), items.end());
+                return ArrayView<T>(chunk.data() + offset, count);
+            }
+
+            WIZ_FORCE_INLINE void clear() {
+                chunks.clear();
+            }
+
+        private:
+            std::vector<std::vector<T>> chunks;
+    };
+}
+
+#endif
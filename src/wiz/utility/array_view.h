@@ -18,6 +18,10 @@ namespace wiz {
             ArrayView(std::add_pointer_t<const T> data, std::size_t length)
             : data(data), length(length) {}
 
+            template <std::size_t N>
+            ArrayView(const T (&data)[N])
+            : data(data), length(N) {}
+
             template <typename Container>
             ArrayView(const Container& other)
             : data(other.data()), length(other.size()) {}
@@ -60,6 +60,7 @@ namespace wiz {
             reader = resourceManager->openReader(canonicalPath, allowShellResources);
             if (reader != nullptr && reader->isOpen()) {
                 alreadyImportedPaths.insert(canonicalPath);
+                importedPaths.push_back(canonicalPath);
                 
                 return ImportResult::JustImported;
             } else {
@@ -103,4 +104,8 @@ namespace wiz {
         canonicalPath = StringView();
         return ImportResult::Failed;
     }
+
+    ArrayView<StringView> ImportManager::getImportedPaths() const {
+        return ArrayView<StringView>(importedPaths);
+    }
 }
\ No newline at end of file
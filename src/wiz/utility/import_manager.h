@@ -2,6 +2,7 @@
 #define WIZ_UTILITY_IMPORT_MANAGER_H
 
 #include <memory>
+#include <vector>
 #include <unordered_set>
 
 #include <wiz/utility/array_view.h>
@@ -34,6 +35,9 @@ namespace wiz {
             ImportResult attemptRelativeImport(StringView originalPath, ImportOptions importOptions, StringView& displayPath, StringView& canonicalPath, std::unique_ptr<Reader>& reader);
             ImportResult importModule(StringView originalPath, ImportOptions importOptions, StringView& displayPath, StringView& canonicalPath, std::unique_ptr<Reader>& reader);
 
+            // Returns the canonical path of every file opened so far, including embeds, in the order they were first imported.
+            ArrayView<StringView> getImportedPaths() const;
+
         private:
             StringPool* stringPool;
             ResourceManager* resourceManager;
@@ -42,6 +46,7 @@ namespace wiz {
             StringView startPath;
             StringView currentPath;
             std::unordered_set<StringView> alreadyImportedPaths;
+            std::vector<StringView> importedPaths;
     };
 }
 
@@ -0,0 +1,61 @@
+#ifndef WIZ_UTILITY_OBJECT_POOL_H
+#define WIZ_UTILITY_OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#include <wiz/utility/macros.h>
+
+namespace wiz {
+    // Constructs many small objects back-to-back in large chunks, rather than giving each its own heap allocation.
+    // Objects never move once created, so pointers returned by addNew() remain valid until the pool is truncated past them.
+    // Destructors are never run, so only trivially destructible types can be pooled.
+    template <typename T>
+    class ObjectPool {
+        static_assert(std::is_trivially_destructible<T>::value, "T must be trivially destructible");
+
+        public:
+            static const std::size_t ChunkSize = 1024;
+
+            template <typename... Args>
+            T* addNew(Args&&... args) {
+                const auto chunkIndex = count / ChunkSize;
+                if (chunkIndex == chunks.size()) {
+                    chunks.push_back(std::unique_ptr<Storage[]>(new Storage[ChunkSize]));
+                }
+
+                const auto result = new (&chunks[chunkIndex][count % ChunkSize]) T(std::forward<Args>(args)...);
+                ++count;
+                return result;
+            }
+
+            WIZ_FORCE_INLINE std::size_t size() const {
+                return count;
+            }
+
+            // Releases every object created after size() returned the given value.
+            // The memory is kept, so that objects created afterward can reuse it without allocating.
+            WIZ_FORCE_INLINE void truncate(std::size_t size) {
+                if (size < count) {
+                    count = size;
+                }
+            }
+
+            WIZ_FORCE_INLINE void clear() {
+                chunks.clear();
+                count = 0;
+            }
+
+        private:
+            using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+            std::vector<std::unique_ptr<Storage[]>> chunks;
+            std::size_t count = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef WIZ_UTILITY_PARALLEL_H
+#define WIZ_UTILITY_PARALLEL_H
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+
+#ifndef __EMSCRIPTEN__
+#define WIZ_UTILITY_PARALLEL_USE_THREADS
+#include <thread>
+#endif
+
+namespace wiz {
+    // Returns how many tasks parallelFor() may run at once on this machine.
+    inline std::size_t getParallelWorkerCount() {
+#ifdef WIZ_UTILITY_PARALLEL_USE_THREADS
+        const auto count = std::thread::hardware_concurrency();
+        return count > 1 ? count : 1;
+#else
+        return 1;
+#endif
+    }
+
+    // Calls func(i) once for every i in [0, count), spread across the available hardware threads.
+    // Tasks run in no particular order, so each one must only touch state that belongs to its own index.
+    // Falls back to running everything on the calling thread when threads are unavailable or wouldn't help.
+    template <typename Func>
+    void parallelFor(std::size_t count, Func func) {
+        auto workerCount = getParallelWorkerCount();
+        if (workerCount > count) {
+            workerCount = count;
+        }
+
+        if (workerCount <= 1) {
+            for (std::size_t i = 0; i != count; ++i) {
+                func(i);
+            }
+            return;
+        }
+
+#ifdef WIZ_UTILITY_PARALLEL_USE_THREADS
+        std::atomic<std::size_t> nextIndex(0);
+        const auto work = [&]() {
+            for (auto i = nextIndex++; i < count; i = nextIndex++) {
+                func(i);
+            }
+        };
+
+        // The calling thread takes a share of the work too, rather than just waiting for the others.
+        std::vector<std::thread> threads;
+        threads.reserve(workerCount - 1);
+        for (std::size_t i = 1; i != workerCount; ++i) {
+            threads.emplace_back(work);
+        }
+
+        work();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+#endif
+    }
+}
+
+#endif
@@ -1,3 +1,5 @@
+#include <cstdlib>
+
 #include <wiz/utility/report.h>
 #include <wiz/utility/logger.h>
 
@@ -19,9 +21,17 @@ namespace wiz {
     Report::Report(std::unique_ptr<Logger> logger)
     : logger(std::move(logger)), aborted(false), errors(0), previousFlags() {}
 
+    Report::Report()
+    : logger(), aborted(false), errors(0), previousFlags() {}
+
     Report::~Report() {}
 
     void Report::error(const std::string& message, const SourceLocation& location, ReportErrorFlags flags) {
+        if (logger == nullptr) {
+            bufferedMessages.push_back(BufferedMessage(BufferedMessageKind::Error, message, location, flags));
+            return;
+        }
+
         if (!aborted) {
             auto severity = getSeverity(flags, previousFlags);
             logger->error(location, severity, message);
@@ -58,10 +68,20 @@ namespace wiz {
     }
 
     void Report::notice(const std::string& message) {
+        if (logger == nullptr) {
+            bufferedMessages.push_back(BufferedMessage(BufferedMessageKind::Notice, message, SourceLocation(), ReportErrorFlags::None));
+            return;
+        }
+
         logger->notice(message);
     }
 
     void Report::log(const std::string& message) {
+        if (logger == nullptr) {
+            bufferedMessages.push_back(BufferedMessage(BufferedMessageKind::Log, message, SourceLocation(), ReportErrorFlags::None));
+            return;
+        }
+
         logger->log(message);
     }
 
@@ -75,4 +95,17 @@ namespace wiz {
     Logger* Report::getLogger() const {
         return logger.get();
     }
+
+    void Report::replay(Report* destination) {
+        for (const auto& bufferedMessage : bufferedMessages) {
+            switch (bufferedMessage.kind) {
+                case BufferedMessageKind::Error: destination->error(bufferedMessage.message, bufferedMessage.location, bufferedMessage.flags); break;
+                case BufferedMessageKind::Notice: destination->notice(bufferedMessage.message); break;
+                case BufferedMessageKind::Log: destination->log(bufferedMessage.message); break;
+                default: std::abort(); break;
+            }
+        }
+
+        bufferedMessages.clear();
+    }
 }
\ No newline at end of file
@@ -4,19 +4,23 @@
 #include <stdexcept>
 #include <string>
 #include <memory>
+#include <vector>
 #include <type_traits>
 
 #include <wiz/utility/report_error_flags.h>
+#include <wiz/utility/source_location.h>
 
 namespace wiz {
     class Logger;
-    class SourceLocation;
 
     class Report {
         public:
             static const std::size_t MaxErrors = 64;
 
             Report(std::unique_ptr<Logger> logger);
+            // Creates a report that records its messages instead of logging them.
+            // This lets work happen off the main thread, and have its messages replayed afterward in a deterministic order.
+            Report();
             ~Report();
 
             void error(const std::string& message, const SourceLocation& location, ReportErrorFlags flags = ReportErrorFlags());
@@ -28,13 +32,40 @@ namespace wiz {
 
             Logger* getLogger() const;
 
+            // Forwards every recorded message to another report in the order they were made, and then forgets them.
+            void replay(Report* destination);
+
         private:
             Report(const Report&) = delete;
             Report& operator =(const Report&) = delete;
 
             void abort();
 
+            enum class BufferedMessageKind {
+                Error,
+                Notice,
+                Log,
+            };
+
+            struct BufferedMessage {
+                BufferedMessage(
+                    BufferedMessageKind kind,
+                    const std::string& message,
+                    const SourceLocation& location,
+                    ReportErrorFlags flags)
+                : kind(kind),
+                message(message),
+                location(location),
+                flags(flags) {}
+
+                BufferedMessageKind kind;
+                std::string message;
+                SourceLocation location;
+                ReportErrorFlags flags;
+            };
+
             std::unique_ptr<Logger> logger;
+            std::vector<BufferedMessage> bufferedMessages;
             bool aborted;
             std::size_t errors;
             ReportErrorFlags previousFlags;
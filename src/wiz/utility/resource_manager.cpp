@@ -33,6 +33,16 @@ namespace wiz {
         return std::make_unique<FileWriter>(filename);
     }
 
+    Optional<std::size_t> FileResourceManager::getFileSize(StringView filename) {
+        const auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(std::fopen(filename.getData(), "rb"), std::fclose);
+        if (file == nullptr || std::fseek(file.get(), 0, SEEK_END) != 0) {
+            return Optional<std::size_t>();
+        }
+
+        const auto size = std::ftell(file.get());
+        return size >= 0 ? Optional<std::size_t>(static_cast<std::size_t>(size)) : Optional<std::size_t>();
+    }
+
     MemoryResourceManager::MemoryResourceManager() {}
     MemoryResourceManager::~MemoryResourceManager() {}
 
@@ -51,6 +61,14 @@ namespace wiz {
         return std::make_unique<MemoryWriter>(writeBuffers[filename]);
     }
 
+    Optional<std::size_t> MemoryResourceManager::getFileSize(StringView filename) {
+        const auto match = readBuffers.find(filename);
+        if (match != readBuffers.end()) {
+            return match->second.size();
+        }
+        return Optional<std::size_t>();
+    }
+
     void MemoryResourceManager::registerReadBuffer(StringView filename, const std::string& buffer) {
         readBuffers[filename] = buffer;
     }
@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <wiz/utility/optional.h>
 #include <wiz/utility/string_view.h>
 
 namespace wiz {
@@ -16,6 +17,8 @@ namespace wiz {
             virtual ~ResourceManager() {}
             virtual std::unique_ptr<Reader> openReader(StringView filename, bool allowShellResources) = 0;
             virtual std::unique_ptr<Writer> openWriter(StringView filename) = 0;
+            // Returns the size of a file without reading it, or nothing if it can't be opened.
+            virtual Optional<std::size_t> getFileSize(StringView filename) = 0;
     };
 
     class FileResourceManager : public ResourceManager {
@@ -25,6 +28,7 @@ namespace wiz {
 
             virtual std::unique_ptr<Reader> openReader(StringView filename, bool allowShellResources) override;
             virtual std::unique_ptr<Writer> openWriter(StringView filename) override;
+            virtual Optional<std::size_t> getFileSize(StringView filename) override;
     };
 
     class MemoryResourceManager : public ResourceManager {
@@ -34,6 +38,7 @@ namespace wiz {
 
             virtual std::unique_ptr<Reader> openReader(StringView filename, bool allowShellResources) override;
             virtual std::unique_ptr<Writer> openWriter(StringView filename) override;
+            virtual Optional<std::size_t> getFileSize(StringView filename) override;
 
             void registerReadBuffer(StringView filename, const std::string& buffer);
             bool getReadBuffer(StringView filename, std::string& result);
@@ -0,0 +1,185 @@
+#include <cstring>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+
+#include <wiz/utility/segmented_buffer.h>
+
+namespace wiz {
+    SegmentedBuffer::SegmentedBuffer()
+    : totalSize(0),
+    fillBlocks(256) {}
+
+    SegmentedBuffer::~SegmentedBuffer() {}
+
+    std::size_t SegmentedBuffer::size() const {
+        return totalSize;
+    }
+
+    void SegmentedBuffer::appendView(ArrayView<std::uint8_t> data) {
+        if (data.size() == 0) {
+            return;
+        }
+
+        Segment segment(SegmentKind::View, totalSize, data.size());
+        segment.view = data.getData();
+        segments.push_back(std::move(segment));
+        totalSize += data.size();
+    }
+
+    void SegmentedBuffer::appendFill(std::size_t size, std::uint8_t value) {
+        if (size == 0) {
+            return;
+        }
+
+        if (!segments.empty() && segments.back().kind == SegmentKind::Fill && segments.back().fillValue == value) {
+            segments.back().size += size;
+        } else {
+            Segment segment(SegmentKind::Fill, totalSize, size);
+            segment.fillValue = value;
+            segments.push_back(std::move(segment));
+        }
+        totalSize += size;
+    }
+
+    void SegmentedBuffer::resize(std::size_t size, std::uint8_t value) {
+        if (size >= totalSize) {
+            appendFill(size - totalSize, value);
+            return;
+        }
+
+        while (!segments.empty() && segments.back().start >= size) {
+            segments.pop_back();
+        }
+        if (!segments.empty()) {
+            auto& last = segments.back();
+            last.size = size - last.start;
+            if (last.kind == SegmentKind::Owned) {
+                last.bytes.resize(last.size);
+            }
+        }
+        totalSize = size;
+    }
+
+    std::uint8_t* SegmentedBuffer::getWritableRange(std::size_t offset, std::size_t size) {
+        const auto index = findSegment(offset);
+        auto& segment = segments[index];
+        if (segment.kind == SegmentKind::Owned && offset + size <= segment.start + segment.size) {
+            return segment.bytes.data() + (offset - segment.start);
+        }
+
+        const auto start = offset / WritableChunkSize * WritableChunkSize;
+        const auto end = std::min(totalSize, (offset + std::max<std::size_t>(size, 1) + WritableChunkSize - 1) / WritableChunkSize * WritableChunkSize);
+
+        Segment owned(SegmentKind::Owned, start, end - start);
+        owned.bytes.resize(end - start);
+
+        const auto first = findSegment(start);
+        const auto last = findSegment(end - 1);
+        for (auto i = first; i <= last; ++i) {
+            const auto& piece = segments[i];
+            const auto from = std::max(start, piece.start);
+            const auto to = std::min(end, piece.start + piece.size);
+            const auto dest = owned.bytes.data() + (from - start);
+            switch (piece.kind) {
+                case SegmentKind::View: std::memcpy(dest, piece.view + (from - piece.start), to - from); break;
+                case SegmentKind::Fill: std::memset(dest, piece.fillValue, to - from); break;
+                case SegmentKind::Owned: std::memcpy(dest, piece.bytes.data() + (from - piece.start), to - from); break;
+            }
+        }
+
+        // Whatever the first and last pieces held outside of the chunk is kept on either side of it.
+        std::vector<Segment> replacements;
+        if (segments[first].start < start) {
+            replacements.push_back(slice(segments[first], segments[first].start, start));
+        }
+        replacements.push_back(std::move(owned));
+        if (segments[last].start + segments[last].size > end) {
+            replacements.push_back(slice(segments[last], end, segments[last].start + segments[last].size));
+        }
+
+        segments.erase(segments.begin() + first, segments.begin() + last + 1);
+        segments.insert(segments.begin() + first, std::make_move_iterator(replacements.begin()), std::make_move_iterator(replacements.end()));
+
+        auto& chunk = segments[findSegment(offset)];
+        return chunk.bytes.data() + (offset - chunk.start);
+    }
+
+    std::size_t SegmentedBuffer::sum(std::size_t offset, std::size_t size) const {
+        if (size == 0) {
+            return 0;
+        }
+
+        const auto end = offset + size;
+        std::size_t result = 0;
+        for (auto i = findSegment(offset); i != segments.size() && segments[i].start < end; ++i) {
+            const auto& segment = segments[i];
+            const auto from = std::max(offset, segment.start) - segment.start;
+            const auto to = std::min(end, segment.start + segment.size) - segment.start;
+            switch (segment.kind) {
+                case SegmentKind::View: {
+                    for (auto j = from; j != to; ++j) {
+                        result += segment.view[j];
+                    }
+                    break;
+                }
+                case SegmentKind::Fill: result += segment.fillValue * (to - from); break;
+                case SegmentKind::Owned: {
+                    for (auto j = from; j != to; ++j) {
+                        result += segment.bytes[j];
+                    }
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    void SegmentedBuffer::getSpans(std::vector<ArrayView<std::uint8_t>>& spans) {
+        spans.clear();
+        for (const auto& segment : segments) {
+            switch (segment.kind) {
+                case SegmentKind::View: spans.push_back(ArrayView<std::uint8_t>(segment.view, segment.size)); break;
+                case SegmentKind::Fill: {
+                    // Every span of a run points at the same block.
+                    const auto block = getFillBlock(segment.fillValue);
+                    for (std::size_t position = 0; position < segment.size; position += FillBlockSize) {
+                        const auto remainingSize = segment.size - position;
+                        spans.push_back(ArrayView<std::uint8_t>(block, remainingSize < FillBlockSize ? remainingSize : FillBlockSize));
+                    }
+                    break;
+                }
+                case SegmentKind::Owned: spans.push_back(ArrayView<std::uint8_t>(segment.bytes)); break;
+            }
+        }
+    }
+
+    std::size_t SegmentedBuffer::findSegment(std::size_t offset) const {
+        const auto next = std::upper_bound(segments.begin(), segments.end(), offset,
+            [](std::size_t offset, const Segment& segment) { return offset < segment.start; });
+        return static_cast<std::size_t>(next - segments.begin()) - 1;
+    }
+
+    SegmentedBuffer::Segment SegmentedBuffer::slice(const Segment& segment, std::size_t from, std::size_t to) const {
+        Segment result(segment.kind, from, to - from);
+        switch (segment.kind) {
+            case SegmentKind::View: result.view = segment.view + (from - segment.start); break;
+            case SegmentKind::Fill: result.fillValue = segment.fillValue; break;
+            case SegmentKind::Owned: {
+                const auto begin = segment.bytes.begin() + static_cast<std::ptrdiff_t>(from - segment.start);
+                result.bytes.assign(begin, begin + static_cast<std::ptrdiff_t>(to - from));
+                break;
+            }
+        }
+        return result;
+    }
+
+    const std::uint8_t* SegmentedBuffer::getFillBlock(std::uint8_t value) {
+        auto& block = fillBlocks[value];
+        if (block == nullptr) {
+            block.reset(new std::uint8_t[FillBlockSize]);
+            std::memset(block.get(), value, FillBlockSize);
+        }
+        return block.get();
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef WIZ_UTILITY_SEGMENTED_BUFFER_H
+#define WIZ_UTILITY_SEGMENTED_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <wiz/utility/macros.h>
+#include <wiz/utility/array_view.h>
+
+namespace wiz {
+    // A run of bytes put together from pieces: views of storage that belongs to someone else, runs of a repeated byte, and bytes of its own.
+    // Appending a view doesn't copy it, so something as big as a whole ROM can be checksummed and written out without ever being one contiguous buffer.
+    // Viewed storage must outlive the buffer, and must not change while the buffer refers to it.
+    class SegmentedBuffer {
+        public:
+            // Bytes that are written to directly are copied out in aligned chunks of this size, so that a header made of many small writes only takes one copy.
+            static const std::size_t WritableChunkSize = 0x100;
+            // Runs of a repeated byte are handed out as spans of up to this size.
+            static const std::size_t FillBlockSize = 0x1000;
+
+            SegmentedBuffer();
+            ~SegmentedBuffer();
+
+            std::size_t size() const;
+
+            void appendView(ArrayView<std::uint8_t> data);
+            void appendFill(std::size_t size, std::uint8_t value);
+            // Grows the buffer with a run of the given value, or cuts it short.
+            void resize(std::size_t size, std::uint8_t value);
+
+            // Returns storage for the given range that can be written to directly, copying it into bytes owned by the buffer first if it has to.
+            // The pointer is valid until the next call that appends, resizes or asks for another writable range.
+            std::uint8_t* getWritableRange(std::size_t offset, std::size_t size);
+
+            std::uint8_t& operator [](std::size_t offset) {
+                return *getWritableRange(offset, 1);
+            }
+
+            // Returns the sum of every byte in the given range, for checksums.
+            std::size_t sum(std::size_t offset, std::size_t size) const;
+
+            // Lists every piece of the buffer in order, ready to be written out with a single gather write.
+            // The spans are valid until the buffer is next changed.
+            void getSpans(std::vector<ArrayView<std::uint8_t>>& spans);
+
+        private:
+            enum class SegmentKind {
+                View,
+                Fill,
+                Owned,
+            };
+
+            struct Segment {
+                Segment(
+                    SegmentKind kind,
+                    std::size_t start,
+                    std::size_t size)
+                : kind(kind),
+                start(start),
+                size(size) {}
+
+                SegmentKind kind;
+                std::size_t start;
+                std::size_t size;
+                const std::uint8_t* view = nullptr;
+                std::uint8_t fillValue = 0;
+                std::vector<std::uint8_t> bytes;
+            };
+
+            // Returns the index of the segment holding the given offset, which must be within the buffer.
+            std::size_t findSegment(std::size_t offset) const;
+            // Returns a copy of part of a segment, as a segment starting at the given offset.
+            Segment slice(const Segment& segment, std::size_t from, std::size_t to) const;
+            const std::uint8_t* getFillBlock(std::uint8_t value);
+
+            // Kept in order, with each segment starting where the previous one ends.
+            std::vector<Segment> segments;
+            std::size_t totalSize;
+            std::vector<std::unique_ptr<std::uint8_t[]>> fillBlocks;
+    };
+}
+
+#endif
@@ -1,7 +1,30 @@
+#include <algorithm>
+
 #include <wiz/utility/text.h>
 #include <wiz/utility/writer.h>
 
+#if (defined(__APPLE__) || defined(__unix__)) && !defined(__EMSCRIPTEN__)
+    #include <climits>
+    #include <unistd.h>
+    #include <sys/uio.h>
+
+    #define WIZ_WRITEV_AVAILABLE
+#endif
+
 namespace wiz {
+#ifdef WIZ_WRITEV_AVAILABLE
+    namespace {
+        // POSIX declares `iov_base` as non-const, even though writev() only reads through it.
+        // This is the one place that casts away const, so that nothing else has to.
+        iovec makeWriteVector(const std::uint8_t* data, std::size_t size) {
+            iovec vector;
+            vector.iov_base = const_cast<std::uint8_t*>(data);
+            vector.iov_len = size;
+            return vector;
+        }
+    }
+#endif
+
     FileWriter::FileWriter(
         StringView filename)
     : filename(filename),
@@ -45,6 +68,56 @@ namespace wiz {
         && write(text::OsNewLine);
     }
 
+    bool FileWriter::writeSpans(ArrayView<ArrayView<std::uint8_t>> spans) {
+        if (!isOpen()) {
+            return false;
+        }
+
+#ifdef WIZ_WRITEV_AVAILABLE
+        // Anything already buffered has to go out first, since writev goes straight to the file descriptor.
+        if (std::fflush(file.get()) != 0) {
+            return false;
+        }
+
+        const auto fd = fileno(file.get());
+        std::vector<iovec> vectors;
+        vectors.reserve(spans.size());
+        for (const auto& span : spans) {
+            if (span.size() != 0) {
+                vectors.push_back(makeWriteVector(span.getData(), span.size()));
+            }
+        }
+
+        std::size_t index = 0;
+        while (index != vectors.size()) {
+            const auto count = std::min(vectors.size() - index, static_cast<std::size_t>(IOV_MAX));
+            const auto result = writev(fd, &vectors[index], static_cast<int>(count));
+            if (result < 0) {
+                return false;
+            }
+
+            // Skip past whatever was written, which can stop partway through a span.
+            auto remaining = static_cast<std::size_t>(result);
+            while (index != vectors.size() && remaining >= vectors[index].iov_len) {
+                remaining -= vectors[index].iov_len;
+                ++index;
+            }
+            if (remaining != 0) {
+                vectors[index].iov_base = static_cast<std::uint8_t*>(vectors[index].iov_base) + remaining;
+                vectors[index].iov_len -= remaining;
+            }
+        }
+        return true;
+#else
+        for (const auto& span : spans) {
+            if (span.size() != 0 && std::fwrite(span.getData(), span.size(), 1, file.get()) != 1) {
+                return false;
+            }
+        }
+        return true;
+#endif
+    }
+
 
     MemoryWriter::MemoryWriter(std::vector<std::uint8_t>& buffer)
     : buffer(buffer) {}
@@ -69,5 +142,12 @@ namespace wiz {
         return write(data)
         && write(text::OsNewLine);
     }
+
+    bool MemoryWriter::writeSpans(ArrayView<ArrayView<std::uint8_t>> spans) {
+        for (const auto& span : spans) {
+            buffer.insert(buffer.end(), span.begin(), span.end());
+        }
+        return true;
+    }
 }
     
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <memory>
 #include <cstdio>
 #include <cstdint>
+#include <wiz/utility/macros.h>
+#include <wiz/utility/array_view.h>
 #include <wiz/utility/string_view.h>
 
 namespace wiz {
@@ -21,6 +23,8 @@ namespace wiz {
             virtual bool write(const std::vector<std::uint8_t>& data) = 0;
             virtual bool write(StringView data) = 0;
             virtual bool writeLine(StringView data) = 0;
+            // Writes each span in order, as if they were one contiguous run of bytes.
+            virtual bool writeSpans(ArrayView<ArrayView<std::uint8_t>> spans) = 0;
     };
 
     class FileWriter : public Writer {
@@ -32,6 +36,7 @@ namespace wiz {
             bool write(const std::vector<std::uint8_t>& data) override;
             bool write(StringView data) override;
             bool writeLine(StringView data) override;
+            bool writeSpans(ArrayView<ArrayView<std::uint8_t>> spans) override;
 
         private:
             FileWriter(const FileWriter&) = delete;  
@@ -50,6 +55,7 @@ namespace wiz {
             bool write(const std::vector<std::uint8_t>& data) override;
             bool write(StringView data) override;
             bool writeLine(StringView data) override;
+            bool writeSpans(ArrayView<ArrayView<std::uint8_t>> spans) override;
 
         private:
             std::vector<std::uint8_t>& buffer;
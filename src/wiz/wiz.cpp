@@ -1,20 +1,27 @@
 #include <memory>
+#include <string>
 #include <utility>
 #include <clocale>
+#include <algorithm>
 
 #include <wiz/ast/statement.h>
 #include <wiz/ast/expression.h>
 #include <wiz/parser/parser.h>
 #include <wiz/parser/scanner.h>
+#include <wiz/compiler/bank.h>
 #include <wiz/compiler/config.h>
 #include <wiz/compiler/version.h>
 #include <wiz/compiler/compiler.h>
+#include <wiz/compiler/optimization.h>
 #include <wiz/compiler/definition.h>
 #include <wiz/compiler/symbol_table.h>
+#include <wiz/format/bank_map.h>
 #include <wiz/format/output/output_format.h>
 #include <wiz/platform/platform.h>
 #include <wiz/utility/tty.h>
 #include <wiz/utility/path.h>
+#include <wiz/utility/text.h>
+#include <wiz/utility/int128.h>
 #include <wiz/utility/logger.h>
 #include <wiz/utility/reader.h>
 #include <wiz/utility/report.h>
@@ -29,6 +36,119 @@
 #include <wiz/format/debug/debug_format.h>
 
 namespace wiz {
+    namespace {
+        std::string escapeMakefilePath(StringView path) {
+            std::string result;
+            for (const auto c : path) {
+                switch (c) {
+                    case ' ': result += "\\ "; break;
+                    case '#': result += "\\#"; break;
+                    case '$': result += "$$"; break;
+                    default: result += c; break;
+                }
+            }
+            return result;
+        }
+
+        // Checks whether a file already holds exactly the given data, so that rewriting it can be skipped.
+        // Leaving the file untouched keeps its timestamp, so nothing that depends on it is rebuilt needlessly.
+        // The size is checked first, so that a file that has obviously changed isn't read.
+        bool isFileUnchanged(ResourceManager* resourceManager, StringView filename, ArrayView<ArrayView<std::uint8_t>> spans) {
+            std::size_t size = 0;
+            for (const auto& span : spans) {
+                size += span.size();
+            }
+
+            const auto previousSize = resourceManager->getFileSize(filename);
+            if (!previousSize.hasValue() || previousSize.get() != size) {
+                return false;
+            }
+
+            const auto reader = resourceManager->openReader(filename, false);
+            if (!reader || !reader->isOpen()) {
+                return false;
+            }
+
+            const auto previousData = reader->readFully();
+            auto position = previousData.begin();
+            for (const auto& span : spans) {
+                if (static_cast<std::size_t>(previousData.end() - position) < span.size()
+                || !std::equal(span.begin(), span.end(), position,
+                    [](std::uint8_t a, char b) { return a == static_cast<std::uint8_t>(b); })) {
+                    return false;
+                }
+                position += static_cast<std::ptrdiff_t>(span.size());
+            }
+            return position == previousData.end();
+        }
+
+        // Writes a makefile rule for the output file, listing every source and embedded file that it was built from.
+        // Each dependency also gets an empty rule, so that deleting a file doesn't break the build before it's regenerated.
+        bool writeDependencyFile(ResourceManager* resourceManager, StringView dependencyFileName, StringView outputName, ArrayView<StringView> importedPaths) {
+            std::vector<StringView> dependencies;
+            for (const auto& importedPath : importedPaths) {
+                // Shell resources like `<stdin>` have no file for a build tool to check.
+                if (!importedPath.startsWith("<"_sv)) {
+                    dependencies.push_back(importedPath);
+                }
+            }
+
+            auto writer = resourceManager->openWriter(dependencyFileName);
+            if (!writer || !writer->isOpen()) {
+                return false;
+            }
+
+            std::string rule = escapeMakefilePath(outputName) + ":";
+            for (const auto& dependency : dependencies) {
+                rule += " \\\n  " + escapeMakefilePath(dependency);
+            }
+
+            bool result = writer->writeLine(StringView(rule));
+            for (const auto& dependency : dependencies) {
+                result = result && writer->writeLine(StringView("\n" + escapeMakefilePath(dependency) + ":"));
+            }
+            return result;
+        }
+
+        // Reads how often each var was used while the program ran, as lines of `name count`, so the `#[fast]` bank can be given to the busiest ones.
+        // Blank lines and lines starting with `#` are skipped.
+        bool readVariableProfile(ResourceManager* resourceManager, StringView filename, std::unordered_map<std::string, std::size_t>& result) {
+            const auto reader = resourceManager->openReader(filename, false);
+            if (!reader || !reader->isOpen()) {
+                return false;
+            }
+
+            std::string line;
+            while (reader->readLine(line)) {
+                std::vector<StringView> fields;
+                for (const auto& field : text::split(StringView(line), " \t\r\n"_sv)) {
+                    if (field.getLength() != 0) {
+                        fields.push_back(field);
+                    }
+                }
+
+                if (fields.empty() || fields[0][0] == '#') {
+                    continue;
+                }
+                if (fields.size() != 2) {
+                    return false;
+                }
+
+                std::size_t count = 0;
+                for (const auto c : fields[1]) {
+                    if (c < '0' || c > '9') {
+                        return false;
+                    }
+                    count = count * 10 + static_cast<std::size_t>(c - '0');
+                }
+
+                result[fields[0].toString()] += count;
+            }
+
+            return true;
+        }
+    }
+
 #if 0
     void dumpAddress(const Definition* definition, OutputFormatContext& outputFormatContext) {
         Optional<Address> address = definition->getAddress();
@@ -56,8 +176,13 @@ namespace wiz {
         StringView inputName;
         StringView outputName;
         StringView debugFormatName;
+        StringView dependencyFileName;
+        StringView mapFileName;
         std::vector<StringView> importDirs;
+        OptimizationOptions optimizationOptions;
+        std::vector<std::pair<StringView, bool>> irPassToggles;
         std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines;
+        std::unordered_map<std::string, std::size_t> variableProfile;
         Platform* platform = nullptr;
         Config config;
 
@@ -75,6 +200,13 @@ namespace wiz {
             Version,
             FromStdin,
             SymbolFormat,
+            DependencyFile,
+            Map,
+            Optimize,
+            EnablePass,
+            DisablePass,
+            VariableProfile,
+            Stats,
             Help,
         };
 
@@ -88,6 +220,11 @@ namespace wiz {
             debugFormatNames += "\n    `" + debugFormatCollection.getFormatName(i).toString() + "`";
         }
 
+        std::string irPassNames = "";
+        for (std::size_t i = 0; i != IrPassCount; ++i) {
+            irPassNames += "\n    `" + getIrPassName(static_cast<IrPassKind>(i)).toString() + "`";
+        }
+
         const auto systemOptionHelp = stringPool.intern(
             std::string() +
             "    specifies the target system to be used for the program.\n"
@@ -98,6 +235,14 @@ namespace wiz {
             "    specifies a symbol table format to export alongside this program.\n"
             "    If set, symbol files will be written to the same folder as the output file.\n\n" +
             "    possible options:" + debugFormatNames);
+        const auto enablePassOptionHelp = stringPool.intern(
+            std::string() +
+            "    runs a single optimization pass, even if the optimization level would leave it out.\n\n" +
+            "    possible options:" + irPassNames);
+        const auto disablePassOptionHelp = stringPool.intern(
+            std::string() +
+            "    skips a single optimization pass, even if the optimization level would run it.\n\n" +
+            "    possible options:" + irPassNames);
 
         auto optionParser = OptionParser<OptionType>{         
             {OptionType::Output, "output", 'o', true, "filename",
@@ -118,6 +263,28 @@ namespace wiz {
                 "    if used as an input path, wiz will read from stdin."}, 
             {OptionType::SymbolFormat, "symbol-format", 's', true, "type",
                 debugFormatOptionHelp.getData()},
+            {OptionType::DependencyFile, "dependency-file", 0, true, "filename",
+                "    writes a makefile rule that lists every source and embedded file the output was built from,\n"
+                "    so that build tools can tell when the output needs to be rebuilt."},
+            {OptionType::Map, "map", 0, true, "filename",
+                "    writes a map of every bank, listing what was placed where, how much room is left and how scattered it is.\n"
+                "    written as JSON if the filename ends in `.json`, and as text otherwise."},
+            {OptionType::Optimize, "optimize", 'O', true, "level",
+                "    selects which optimization passes are run over the generated code.\n\n"
+                "    possible options:\n"
+                "    `0` - no optimization.\n"
+                "    `1` - only remove jumps to the instruction immediately after them (default)\n"
+                "    `s` - also remove unreachable code, unused funcs and constants, and share the bytes of identical constants, to reduce size.\n"
+                "    `2` - also pad indexed tables and small loops so they don't cross a page, trading size for speed. (6502 family only)"},
+            {OptionType::EnablePass, "enable-pass", 0, true, "name",
+                enablePassOptionHelp.getData()},
+            {OptionType::DisablePass, "disable-pass", 0, true, "name",
+                disablePassOptionHelp.getData()},
+            {OptionType::VariableProfile, "var-profile", 0, true, "filename",
+                "    reads how many times each var was used while the program ran, with one `name count` per line,\n"
+                "    and gives the `#[fast]` bank to the most used vars by these counts, instead of by counting uses in the source."},
+            {OptionType::Stats, "stats", 0, false, "",
+                "    prints statistics about the compilation once it finishes."},
             {OptionType::Help, "help", 0, false, "",
                 "    displays this help message."},
         };
@@ -129,6 +296,7 @@ namespace wiz {
 
         bool invalidOptions = false;
         bool displayIntroMessage = true;
+        bool printStats = false;
         const auto options = optionParser.getOptions();
 
         for (const auto& option : options) {
@@ -214,6 +382,52 @@ namespace wiz {
                     }
                     break;
                 }
+                case OptionType::DependencyFile: {
+                    if (dependencyFileName.getLength() == 0) {
+                        dependencyFileName = option.value;
+                    } else {
+                        report->notice("only one dependency file can be specified. (previously specified as `" + dependencyFileName.toString() + "`)");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
+                case OptionType::Map: {
+                    if (mapFileName.getLength() == 0) {
+                        mapFileName = option.value;
+                    } else {
+                        report->notice("only one map file can be specified. (previously specified as `" + mapFileName.toString() + "`)");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
+                case OptionType::Optimize: {
+                    if (!optimizationOptions.setLevel(option.value)) {
+                        report->notice("unrecognized optimization level `" + option.value.toString() + "` provided to `--optimize` argument.");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
+                case OptionType::EnablePass:
+                case OptionType::DisablePass: {
+                    if (findIrPassKind(option.value).hasValue()) {
+                        irPassToggles.push_back(std::make_pair(option.value, option.type == OptionType::EnablePass));
+                    } else {
+                        report->notice("unrecognized optimization pass `" + option.value.toString() + "` provided to `--" + (option.type == OptionType::EnablePass ? "enable" : "disable") + "-pass` argument.");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
+                case OptionType::VariableProfile: {
+                    if (!readVariableProfile(resourceManager, option.value, variableProfile)) {
+                        report->notice("var profile `" + option.value.toString() + "` could not be read. (each line should be a var name followed by a count)");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
+                case OptionType::Stats: {
+                    printStats = true;
+                    break;
+                }
                 case OptionType::Help: {
                     report->log("usage: wiz [options] <input>");
                     report->log("");
@@ -258,6 +472,11 @@ namespace wiz {
 
         importDirs.push_back("."_sv);
 
+        // Individual passes override the level, no matter which order they were given in.
+        for (const auto& irPassToggle : irPassToggles) {
+            optimizationOptions.setPassEnabled(irPassToggle.first, irPassToggle.second);
+        }
+
         if (outputName.getLength() == 0) {
             report->notice("no target/output file given, please provide an output `-o` parameter.\n  type `wiz --help` to see program usage.");
             return 1;
@@ -300,7 +519,7 @@ namespace wiz {
 
         if (auto program = parser.parse(inputName)) {
             report->log(">> Compiling...");
-            Compiler compiler(std::move(program), platform, &stringPool, &config, &importManager, report, std::move(defines));
+            Compiler compiler(std::move(program), platform, &stringPool, &config, &importManager, report, optimizationOptions, std::move(defines), std::move(variableProfile));
 
             if (compiler.compile()) {
                 StringView outputFormatName;
@@ -334,9 +553,14 @@ namespace wiz {
                     return 1;
                 }
 
-                {
+                std::vector<ArrayView<std::uint8_t>> outputSpans;
+                outputContext.data.getSpans(outputSpans);
+
+                if (isFileUnchanged(resourceManager, outputName, outputSpans)) {
+                    report->log(">> Output \"" + outputName.toString() + "\" is already up to date.");
+                } else {
                     auto writer = resourceManager->openWriter(outputName);
-                    if (writer && writer->write(outputContext.data)) {
+                    if (writer && writer->writeSpans(outputSpans)) {
                         report->log(">> Wrote to \"" + outputName.toString() + "\".");
                     } else {
                         report->error("Output file \"" + outputName.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
@@ -344,6 +568,20 @@ namespace wiz {
                     }
                 }
 
+                if (dependencyFileName.getLength() != 0) {
+                    if (!writeDependencyFile(resourceManager, dependencyFileName, outputName, importManager.getImportedPaths())) {
+                        report->error("Dependency file \"" + dependencyFileName.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
+                        return 1;
+                    }
+                }
+
+                if (mapFileName.getLength() != 0) {
+                    if (!writeBankMap(resourceManager, mapFileName, banks, compiler.getRegisteredDefinitions())) {
+                        report->error("Map file \"" + mapFileName.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
+                        return 1;
+                    }
+                }
+
                 if (debugFormatName.getLength() != 0) {
                     DebugFormatContext debugContext(resourceManager, report, &stringPool, &config, debugFormatName, outputName, &outputContext, compiler.getRegisteredDefinitions());
 
@@ -358,6 +596,61 @@ namespace wiz {
                     }
                 }
 
+                if (printStats) {
+                    const auto& builtins = compiler.getBuiltins();
+                    const auto selectionCount = builtins.getInstructionSelectionCount();
+                    const auto selectionCacheHitCount = builtins.getInstructionSelectionCacheHitCount();
+
+                    report->log(">> Statistics:");
+                    report->log("  instruction selections: " + std::to_string(selectionCount)
+                        + " (" + std::to_string(selectionCacheHitCount) + " cache hits, "
+                        + std::to_string(selectionCount != 0 ? selectionCacheHitCount * 100 / selectionCount : 0) + "%)");
+
+                    for (const auto& irPassStatistics : compiler.getIrPassStatistics()) {
+                        report->log("  pass `" + getIrPassName(irPassStatistics.kind).toString() + "`: "
+                            + std::to_string(irPassStatistics.nodeCountBefore) + " -> " + std::to_string(irPassStatistics.nodeCountAfter) + " IR nodes, "
+                            + std::to_string(irPassStatistics.microseconds) + " us");
+                    }
+
+                    const auto& removedDefinitions = compiler.getRemovedDefinitions();
+                    if (!removedDefinitions.empty()) {
+                        report->log("  removed " + std::to_string(removedDefinitions.size()) + " unused declaration(s):");
+                        for (const auto definition : removedDefinitions) {
+                            report->log("    " + std::string(definition->kind == DefinitionKind::Func ? "func" : "const") + " `" + definition->name.toString() + "`");
+                        }
+                    }
+
+                    const auto& pageCrossingStatistics = compiler.getPageCrossingStatistics();
+                    if (pageCrossingStatistics.tableCount + pageCrossingStatistics.loopCount + pageCrossingStatistics.funcCount + pageCrossingStatistics.crossingCount != 0) {
+                        report->log("  page crossing: " + std::to_string(pageCrossingStatistics.tableCount) + " table(s), "
+                            + std::to_string(pageCrossingStatistics.loopCount) + " loop(s) and "
+                            + std::to_string(pageCrossingStatistics.funcCount) + " func(s) moved into one page for "
+                            + std::to_string(pageCrossingStatistics.paddingSize) + " byte(s) of padding, saving 1 cycle per indexed read or taken branch; "
+                            + std::to_string(pageCrossingStatistics.crossingCount) + " still cross");
+                    }
+
+                    const auto& localStorageStatistics = compiler.getLocalStorageStatistics();
+                    if (localStorageStatistics.frameCount != 0) {
+                        report->log("  locals: " + std::to_string(localStorageStatistics.frameCount) + " func(s), "
+                            + std::to_string(localStorageStatistics.totalSize) + " bytes overlapped into "
+                            + std::to_string(localStorageStatistics.usedSize) + " bytes");
+                    }
+
+                    const auto& fastVariablePlacements = compiler.getFastVariablePlacements();
+                    if (!fastVariablePlacements.empty()) {
+                        report->log("  fast var placement, most used first:");
+                        for (const auto& placement : fastVariablePlacements) {
+                            const auto& address = placement.definition->var.address.get();
+                            // Banks without an origin only have a position relative to their start.
+                            const auto position = address.absolutePosition.hasValue()
+                                ? "$" + text::padLeft(Int128(address.absolutePosition.get()).toString(16), '0', 4)
+                                : "+" + text::padLeft(Int128(address.relativePosition.get()).toString(16), '0', 4);
+                            report->log("    `" + placement.definition->name.toString() + "`: "
+                                + std::to_string(placement.score) + " use(s) -> `" + address.bank->getName().toString() + "` " + position);
+                        }
+                    }
+                }
+
 #if 0
                 const auto definitions = compiler.getRegisteredDefinitions();
 
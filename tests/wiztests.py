@@ -11,17 +11,21 @@ from collections import namedtuple
 
 ALL_SYSTEMS = ['6502', '65c02', 'rockwell65c02', 'wdc65c02', 'huc6280', 'wdc65816', 'spc700', 'z80', 'gb' ]
 
-TestFile = namedtuple('TestFile', ('filename', 'systems', 'blocks', 'errors', 'references'))
+TestFile = namedtuple('TestFile', ('filename', 'systems', 'options', 'blocks', 'errors', 'references'))
 BlockData = namedtuple('BlockData', ('address', 'data'))
 
 def read_test_file(filename):
     _system_regex = re.compile(r'// SYSTEM\s+(.+)$')
+    # // OPTIONS [arg]+
+    #  extra command line arguments passed to wiz, such as an optimization level
+    _options_regex = re.compile(r'// OPTIONS\s+(.+)$')
     # // BLOCK [[0x]aaaa] [ bb]+ [  comment]
     #  where aaaa = address (from 4 - 8 hex digits, optional)
     #          bb = space separated bytes in hex
     _block_regex =  re.compile(r'// BLOCK(?:\s+(?:0x)?([0-9A-Fa-f]{4,8}))?\s*((?:\s[0-9A-Fa-f]{2})*)(?:\s{2}|$)')
 
     systems = list()
+    options = list()
     blocks = list()
     errors = set()
     references = set()
@@ -45,6 +49,13 @@ def read_test_file(filename):
 
                 m = _block_regex.search(line)
 
+            if '// OPTIONS' in line:
+                m = _options_regex.search(line)
+                if not m:
+                    raise ValueError(f"{filename}:{lineno}: Invalid `// OPTIONS` tag")
+
+                options.extend(shlex.split(m.group(1)))
+
             if '// REFERENCE' in line:
                 references.add(lineno)
 
@@ -90,7 +101,7 @@ def read_test_file(filename):
     if not blocks and not errors:
         raise ValueError(f"{filename}: Expected at least one `// BLOCK` or `// ERROR` tag")
 
-    return TestFile(filename, systems, blocks, errors, references)
+    return TestFile(filename, systems, options, blocks, errors, references)
 
 
 
@@ -194,9 +205,11 @@ def do_test(test):
     for system in test.systems:
         bin_fn = os.path.join(WIZ_OUTPUT_DIR, os.path.splitext(os.path.basename(test.filename))[0] + '.' + system + '.bin')
 
-        print((WIZ_EXECUTABLE, "--system", system, "-o", bin_fn, test.filename))
+        args = (WIZ_EXECUTABLE, "--system", system, *test.options, "-o", bin_fn, test.filename)
+
+        print(args)
         process = subprocess.Popen(
-            (WIZ_EXECUTABLE, "--system", system, "-o", bin_fn, test.filename),
+            args,
             stdout=subprocess.PIPE,
             stderr=subprocess.PIPE
         )